@@ -26,14 +26,17 @@
 #include "util/XDRStream.h"
 #include "xdrpp/message.h"
 #include <Tracy.hpp>
+#include <atomic>
 #include <fmt/format.h>
 #include <future>
+#include <thread>
 
 namespace stellar
 {
 
-Bucket::Bucket(std::string const& filename, Hash const& hash)
-    : mFilename(filename), mHash(hash)
+Bucket::Bucket(std::string const& filename, Hash const& hash,
+               std::unique_ptr<BucketIndex const>&& index)
+    : mFilename(filename), mHash(hash), mIndex(std::move(index))
 {
     releaseAssert(filename.empty() || fs::exists(filename));
     if (!filename.empty())
@@ -66,6 +69,172 @@ Bucket::getSize() const
     return mSize;
 }
 
+bool
+Bucket::isIndexed() const
+{
+    return static_cast<bool>(mIndex);
+}
+
+void
+Bucket::loadKeys(std::set<LedgerKey, LedgerEntryIdCmp>& keys,
+                 std::vector<LedgerEntry>& result) const
+{
+    ZoneScoped;
+    if (mFilename.empty() || keys.empty())
+    {
+        return;
+    }
+
+    XDRInputFileStream in;
+    in.open(mFilename);
+    BucketEntry be;
+
+    auto recordMatch = [&](BucketEntry const& entry) {
+        if (entry.type() != DEADENTRY)
+        {
+            result.emplace_back(entry.liveEntry());
+        }
+    };
+
+    LedgerEntryIdCmp cmp;
+    if (!mIndex)
+    {
+        // Entries are sorted like `keys`, so walk both together and stop
+        // past the last key.
+        auto iter = keys.begin();
+        while (iter != keys.end() && in.readOne(be))
+        {
+            if (be.type() == METAENTRY)
+            {
+                continue;
+            }
+            auto key = getBucketLedgerKey(be);
+            while (iter != keys.end() && cmp(*iter, key))
+            {
+                ++iter;
+            }
+            if (iter != keys.end() && !cmp(key, *iter))
+            {
+                recordMatch(be);
+                iter = keys.erase(iter);
+            }
+        }
+        return;
+    }
+
+    for (auto iter = keys.begin(); iter != keys.end();)
+    {
+        bool found = false;
+        auto range = mIndex->lookup(*iter);
+        if (range)
+        {
+            in.seek(range->first);
+            while (in.pos() < range->second && in.readOne(be))
+            {
+                if (be.type() == METAENTRY)
+                {
+                    continue;
+                }
+                auto key = getBucketLedgerKey(be);
+                if (cmp(key, *iter))
+                {
+                    continue;
+                }
+                if (!cmp(*iter, key))
+                {
+                    recordMatch(be);
+                    found = true;
+                }
+                break;
+            }
+        }
+        iter = found ? keys.erase(iter) : std::next(iter);
+    }
+}
+
+std::vector<std::pair<LedgerKey, size_t>>
+Bucket::sampleKeys(size_t strideBytes) const
+{
+    ZoneScoped;
+    if (mFilename.empty())
+    {
+        return {};
+    }
+    if (mIndex)
+    {
+        return mIndex->getPageBoundaries();
+    }
+
+    std::vector<std::pair<LedgerKey, size_t>> res;
+    XDRInputFileStream in;
+    in.open(mFilename, /*useMmap=*/true);
+    BucketEntry be;
+    bool nextIsSample = true;
+    size_t nextSampleAt = 0;
+    for (;;)
+    {
+        size_t pos = in.pos();
+        if (nextIsSample || pos >= nextSampleAt)
+        {
+            if (!in.readOne(be))
+            {
+                break;
+            }
+            if (be.type() == METAENTRY)
+            {
+                continue;
+            }
+            res.emplace_back(getBucketLedgerKey(be), pos);
+            nextIsSample = false;
+            nextSampleAt = pos + strideBytes;
+        }
+        else if (!in.skipOne())
+        {
+            break;
+        }
+    }
+    return res;
+}
+
+size_t
+Bucket::lowerBoundOffset(
+    LedgerKey const& key,
+    std::vector<std::pair<LedgerKey, size_t>> const& samples) const
+{
+    ZoneScoped;
+    LedgerEntryIdCmp cmp;
+    auto next = std::upper_bound(
+        samples.begin(), samples.end(), key,
+        [&](LedgerKey const& k, std::pair<LedgerKey, size_t> const& s) {
+            return cmp(k, s.first);
+        });
+    if (next == samples.begin())
+    {
+        return samples.empty() ? mSize : samples.front().second;
+    }
+
+    // The first entry not less than `key` is between the previous sample and
+    // the next one (or the end of the file).
+    size_t end = next == samples.end() ? mSize : next->second;
+    XDRInputFileStream in;
+    in.open(mFilename, /*useMmap=*/true);
+    in.seek(std::prev(next)->second);
+    BucketEntry be;
+    while (in.pos() < end)
+    {
+        size_t pos = in.pos();
+        if (!in.readOne(be))
+        {
+            break;
+        }
+        if (!cmp(getBucketLedgerKey(be), key))
+        {
+            return pos;
+        }
+    }
+    return end;
+}
+
 bool
 Bucket::containsBucketIdentity(BucketEntry const& id) const
 {
@@ -592,13 +761,248 @@ mergeCasesWithEqualKeys(MergeCounters& mc, BucketInputIterator& oi,
     ++ni;
 }
 
+// Runs the merge loop until the input iterators are exhausted (or reach the
+// end of their key range).
+static void
+mergeEntries(BucketManager& bucketManager, MergeCounters& mc,
+             BucketInputIterator& oi, BucketInputIterator& ni,
+             std::vector<BucketInputIterator>& shadowIterators,
+             BucketOutputIterator& out, uint32_t protocolVersion,
+             bool keepShadowedLifecycleEntries)
+{
+    BucketEntryIdCmp cmp;
+    size_t iter = 0;
+
+    while (oi || ni)
+    {
+        // Check if the merge should be stopped every few entries
+        if (++iter >= 1000)
+        {
+            iter = 0;
+            if (bucketManager.isShutdown())
+            {
+                // Stop merging, as BucketManager is now shutdown
+                // This is safe as temp file has not been adopted yet,
+                // so it will be removed with the tmp dir
+                throw std::runtime_error(
+                    "Incomplete bucket merge due to BucketManager shutdown");
+            }
+        }
+
+        if (!mergeCasesWithDefaultAcceptance(cmp, mc, oi, ni, out,
+                                             shadowIterators, protocolVersion,
+                                             keepShadowedLifecycleEntries))
+        {
+            mergeCasesWithEqualKeys(mc, oi, ni, out, shadowIterators,
+                                    protocolVersion,
+                                    keepShadowedLifecycleEntries);
+        }
+    }
+}
+
+// Chooses up to `partitions - 1` keys splitting the sampled input into ranges
+// of roughly equal size.
+static std::vector<LedgerKey>
+chooseSplitKeys(std::vector<std::pair<LedgerKey, size_t>> const& samples,
+                size_t partitions)
+{
+    std::vector<LedgerKey> splits;
+    size_t prev = 0;
+    for (size_t i = 1; i < partitions; ++i)
+    {
+        size_t idx = i * samples.size() / partitions;
+        if (idx > prev)
+        {
+            splits.emplace_back(samples[idx].first);
+            prev = idx;
+        }
+    }
+    return splits;
+}
+
+// Number of helper threads currently running key ranges, across all merges.
+// Capped at the hardware concurrency so concurrent partitioned merges don't
+// oversubscribe the CPU.
+static std::atomic<size_t> gRangeHelperThreads{0};
+
+static bool
+tryReserveRangeHelperThread()
+{
+    size_t const limit = std::max(1u, std::thread::hardware_concurrency());
+    size_t n = gRangeHelperThreads.load();
+    while (n < limit)
+    {
+        if (gRangeHelperThreads.compare_exchange_weak(n, n + 1))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Merges the key ranges delimited by `splits` concurrently, then concatenates
+// them in order into the output bucket. The first range runs on the calling
+// thread, the others on helper threads of their own (not the worker pool,
+// whose threads may all be busy running merges that would wait on them).
+// Ranges that can't get a helper thread run on the calling thread after the
+// first one.
+static std::shared_ptr<Bucket>
+mergeKeyRanges(BucketManager& bucketManager, MergeCounters& mc,
+               std::vector<LedgerKey> const& splits,
+               std::vector<std::vector<std::pair<LedgerKey, size_t>>> const&
+                   inputSamples,
+               size_t stride,
+               std::shared_ptr<Bucket> const& oldBucket,
+               std::shared_ptr<Bucket> const& newBucket,
+               std::vector<std::shared_ptr<Bucket>> const& shadows,
+               BucketMetadata const& meta, uint32_t protocolVersion,
+               bool keepShadowedLifecycleEntries, bool keepDeadEntries,
+               bool countMergeEvents, asio::io_context& ctx, bool doFsync)
+{
+    ZoneScoped;
+    size_t const nRanges = splits.size() + 1;
+
+    // For each input (old, new, then shadows), the file offsets at which each
+    // range begins, followed by the file size.
+    std::vector<std::shared_ptr<Bucket>> inputs{oldBucket, newBucket};
+    inputs.insert(inputs.end(), shadows.begin(), shadows.end());
+    std::vector<std::vector<size_t>> bounds;
+    for (size_t n = 0; n < inputs.size(); ++n)
+    {
+        auto const& b = inputs[n];
+        auto samples =
+            n < inputSamples.size() ? inputSamples[n] : b->sampleKeys(stride);
+        std::vector<size_t> offsets;
+        offsets.emplace_back(samples.empty() ? b->getSize()
+                                             : samples.front().second);
+        for (auto const& k : splits)
+        {
+            offsets.emplace_back(b->lowerBoundOffset(k, samples));
+        }
+        offsets.emplace_back(b->getSize());
+        bounds.emplace_back(std::move(offsets));
+    }
+
+    // Only the first range writes the METAENTRY and the final file, so only
+    // it needs fsyncing.
+    std::vector<MergeCounters> rangeCounters(nRanges);
+    std::vector<std::unique_ptr<BucketOutputIterator>> outs;
+    outs.emplace_back(std::make_unique<BucketOutputIterator>(
+        bucketManager.getTmpDir(), keepDeadEntries, meta, mc, ctx, doFsync));
+    for (size_t i = 1; i < nRanges; ++i)
+    {
+        outs.emplace_back(std::make_unique<BucketOutputIterator>(
+            bucketManager.getTmpDir(), keepDeadEntries, meta, rangeCounters[i],
+            ctx, /*doFsync=*/false, /*isRangeContinuation=*/true));
+    }
+
+    std::vector<std::exception_ptr> errors(nRanges);
+    auto mergeRange = [&](size_t i) {
+        try
+        {
+            ZoneScopedN("merge key range");
+            BucketInputIterator oi(oldBucket);
+            BucketInputIterator ni(newBucket);
+            std::vector<BucketInputIterator> shadowIterators(shadows.begin(),
+                                                             shadows.end());
+            oi.setRange(bounds[0][i], bounds[0][i + 1]);
+            ni.setRange(bounds[1][i], bounds[1][i + 1]);
+            for (size_t s = 0; s < shadowIterators.size(); ++s)
+            {
+                shadowIterators[s].setRange(bounds[s + 2][i],
+                                            bounds[s + 2][i + 1]);
+            }
+            mergeEntries(bucketManager, i == 0 ? mc : rangeCounters[i], oi, ni,
+                         shadowIterators, *outs[i], protocolVersion,
+                         keepShadowedLifecycleEntries);
+            if (i != 0)
+            {
+                outs[i]->closeRange();
+            }
+        }
+        catch (...)
+        {
+            errors[i] = std::current_exception();
+        }
+    };
+
+    std::vector<std::thread> threads;
+    std::vector<size_t> inlineRanges;
+    for (size_t i = 1; i < nRanges; ++i)
+    {
+        if (tryReserveRangeHelperThread())
+        {
+            try
+            {
+                threads.emplace_back([&mergeRange, i]() {
+                    mergeRange(i);
+                    --gRangeHelperThreads;
+                });
+                continue;
+            }
+            catch (std::system_error const&)
+            {
+                --gRangeHelperThreads;
+            }
+        }
+        inlineRanges.emplace_back(i);
+    }
+    mergeRange(0);
+    for (auto i : inlineRanges)
+    {
+        mergeRange(i);
+    }
+    for (auto& t : threads)
+    {
+        t.join();
+    }
+
+    try
+    {
+        for (auto const& e : errors)
+        {
+            if (e)
+            {
+                std::rethrow_exception(e);
+            }
+        }
+        for (size_t i = 1; i < nRanges; ++i)
+        {
+            outs[0]->appendRange(*outs[i]);
+            mc += rangeCounters[i];
+        }
+    }
+    catch (...)
+    {
+        // Close and remove the temp files of every range; appended range
+        // files are already gone.
+        std::vector<std::string> files;
+        for (auto const& out : outs)
+        {
+            files.emplace_back(out->getFilename());
+        }
+        outs.clear();
+        for (auto const& f : files)
+        {
+            std::remove(f.c_str());
+        }
+        throw;
+    }
+    if (countMergeEvents)
+    {
+        bucketManager.incrMergeCounters(mc);
+    }
+    MergeKey mk{keepDeadEntries, oldBucket, newBucket, shadows};
+    return outs[0]->getBucket(bucketManager, &mk);
+}
+
 std::shared_ptr<Bucket>
 Bucket::merge(BucketManager& bucketManager, uint32_t maxProtocolVersion,
               std::shared_ptr<Bucket> const& oldBucket,
               std::shared_ptr<Bucket> const& newBucket,
               std::vector<std::shared_ptr<Bucket>> const& shadows,
               bool keepDeadEntries, bool countMergeEvents,
-              asio::io_context& ctx, bool doFsync)
+              asio::io_context& ctx, bool doFsync, size_t partitions)
 {
     ZoneScoped;
     // This is the key operation in the scheme: merging two (read-only)
@@ -623,37 +1027,37 @@ Bucket::merge(BucketManager& bucketManager, uint32_t maxProtocolVersion,
     auto timer = bucketManager.getMergeTimer().TimeScope();
     BucketMetadata meta;
     meta.ledgerVersion = protocolVersion;
-    BucketOutputIterator out(bucketManager.getTmpDir(), keepDeadEntries, meta,
-                             mc, ctx, doFsync);
-
-    BucketEntryIdCmp cmp;
-    size_t iter = 0;
 
-    while (oi || ni)
+    if (partitions > 1)
     {
-        // Check if the merge should be stopped every few entries
-        if (++iter >= 1000)
+        // Merging a key range only ever looks at entries with keys in that
+        // range (shadows included), so ranges can be merged independently.
+        // Aim for a few dozen samples per range, without letting sampling
+        // decode every entry or leave more than 1MB between samples.
+        size_t larger = std::max(oldBucket->getSize(), newBucket->getSize());
+        size_t stride = std::max<size_t>(
+            4096, std::min<size_t>(larger / (partitions * 32), 1024 * 1024));
+        std::vector<std::vector<std::pair<LedgerKey, size_t>>> samples{
+            oldBucket->sampleKeys(stride), newBucket->sampleKeys(stride)};
+        auto splits = chooseSplitKeys(
+            oldBucket->getSize() >= newBucket->getSize() ? samples[0]
+                                                         : samples[1],
+            partitions);
+        if (!splits.empty())
         {
-            iter = 0;
-            if (bucketManager.isShutdown())
-            {
-                // Stop merging, as BucketManager is now shutdown
-                // This is safe as temp file has not been adopted yet,
-                // so it will be removed with the tmp dir
-                throw std::runtime_error(
-                    "Incomplete bucket merge due to BucketManager shutdown");
-            }
-        }
-
-        if (!mergeCasesWithDefaultAcceptance(cmp, mc, oi, ni, out,
-                                             shadowIterators, protocolVersion,
-                                             keepShadowedLifecycleEntries))
-        {
-            mergeCasesWithEqualKeys(mc, oi, ni, out, shadowIterators,
-                                    protocolVersion,
-                                    keepShadowedLifecycleEntries);
+            return mergeKeyRanges(bucketManager, mc, splits, samples, stride,
+                                  oldBucket, newBucket, shadows, meta,
+                                  protocolVersion,
+                                  keepShadowedLifecycleEntries,
+                                  keepDeadEntries, countMergeEvents, ctx,
+                                  doFsync);
         }
     }
+
+    BucketOutputIterator out(bucketManager.getTmpDir(), keepDeadEntries, meta,
+                             mc, ctx, doFsync);
+    mergeEntries(bucketManager, mc, oi, ni, shadowIterators, out,
+                 protocolVersion, keepShadowedLifecycleEntries);
     if (countMergeEvents)
     {
         bucketManager.incrMergeCounters(mc);
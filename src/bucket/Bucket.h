@@ -4,11 +4,13 @@
 // under the Apache License, Version 2.0. See the COPYING file at the root
 // of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
 
+#include "bucket/BucketIndex.h"
 #include "bucket/LedgerCmp.h"
 #include "crypto/Hex.h"
 #include "overlay/StellarXDR.h"
 #include "util/NonCopyable.h"
 #include "util/XDRStream.h"
+#include <set>
 #include <string>
 
 namespace stellar
@@ -37,6 +39,7 @@ class Bucket : public std::enable_shared_from_this<Bucket>,
     std::string const mFilename;
     Hash const mHash;
     size_t mSize{0};
+    std::unique_ptr<BucketIndex const> const mIndex;
 
   public:
     // Create an empty bucket. The empty bucket has hash '000000...' and its
@@ -46,11 +49,36 @@ class Bucket : public std::enable_shared_from_this<Bucket>,
     // Construct a bucket with a given filename and hash. Asserts that the file
     // exists, but does not check that the hash is the bucket's hash. Caller
     // needs to ensure that.
-    Bucket(std::string const& filename, Hash const& hash);
+    Bucket(std::string const& filename, Hash const& hash,
+           std::unique_ptr<BucketIndex const>&& index = nullptr);
 
     Hash const& getHash() const;
     std::string const& getFilename() const;
     size_t getSize() const;
+    bool isIndexed() const;
+
+    // Looks up every key of `keys` in the bucket. Keys that are found are
+    // erased from `keys`; if the matching entry is live (LIVEENTRY or
+    // INITENTRY) it is also appended to `result`, while a DEADENTRY match
+    // records that the key is deleted as of this bucket. Uses the bucket's
+    // index when it has one, and a sequential scan of the file otherwise.
+    void loadKeys(std::set<LedgerKey, LedgerEntryIdCmp>& keys,
+                  std::vector<LedgerEntry>& result) const;
+
+    // Returns (key, file offset) pairs for a sparse sample of the bucket's
+    // entries, in key order, starting with its first entry: the index's page
+    // boundaries if the bucket is indexed, otherwise the first entry at or
+    // after every `strideBytes` bytes of the file.
+    std::vector<std::pair<LedgerKey, size_t>>
+    sampleKeys(size_t strideBytes) const;
+
+    // Returns the file offset of the first entry whose key is not less than
+    // `key`, or the file size if there is none, scanning only between the two
+    // `samples` (from `sampleKeys`) that bracket `key`.
+    size_t
+    lowerBoundOffset(LedgerKey const& key,
+                     std::vector<std::pair<LedgerKey, size_t>> const& samples)
+        const;
 
     // Returns true if a BucketEntry that is key-wise identical to the given
     // BucketEntry exists in the bucket. For testing.
@@ -62,6 +90,11 @@ class Bucket : public std::enable_shared_from_this<Bucket>,
         FIRST_PROTOCOL_SUPPORTING_INITENTRY_AND_METAENTRY = 11;
     static constexpr uint32_t FIRST_PROTOCOL_SHADOWS_REMOVED = 12;
 
+    // Below this total input size, merges run serially even when asked to
+    // split into key ranges: sampling the inputs and starting threads would
+    // cost more than it saves.
+    static constexpr size_t MIN_PARTITIONED_MERGE_BYTES = 64 * 1024 * 1024;
+
     static void checkProtocolLegality(BucketEntry const& entry,
                                       uint32_t protocolVersion);
 
@@ -100,13 +133,21 @@ class Bucket : public std::enable_shared_from_this<Bucket>,
     // `maxProtocolVersion` bounds this (for error checking) and should usually
     // be the protocol of the ledger header at which the merge is starting. An
     // exception will be thrown if any provided bucket versions exceed it.
+    //
+    // If `partitions` is greater than 1, the key space is split into up to
+    // that many ranges at keys sampled from the larger input, and each range
+    // is merged into its own temporary file, on a thread of its own while the
+    // process-wide number of such threads is below the hardware concurrency
+    // and on the calling thread otherwise. The files are then concatenated in
+    // key order, so the output (and its hash) is byte-identical to a serial
+    // merge of the same inputs.
     static std::shared_ptr<Bucket>
     merge(BucketManager& bucketManager, uint32_t maxProtocolVersion,
           std::shared_ptr<Bucket> const& oldBucket,
           std::shared_ptr<Bucket> const& newBucket,
           std::vector<std::shared_ptr<Bucket>> const& shadows,
           bool keepDeadEntries, bool countMergeEvents, asio::io_context& ctx,
-          bool doFsync);
+          bool doFsync, size_t partitions = 1);
 
     static uint32_t getBucketVersion(std::shared_ptr<Bucket> const& bucket);
 };
@@ -0,0 +1,169 @@
+// Copyright 2022 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include "bucket/BucketIndex.h"
+#include "crypto/ShortHash.h"
+#include "util/GlobalChecks.h"
+#include "util/Logging.h"
+#include "util/XDRStream.h"
+#include "util/types.h"
+#include <Tracy.hpp>
+
+#include <algorithm>
+
+namespace stellar
+{
+
+LedgerKey
+getBucketLedgerKey(BucketEntry const& be)
+{
+    switch (be.type())
+    {
+    case LIVEENTRY:
+    case INITENTRY:
+        return LedgerEntryKey(be.liveEntry());
+    case DEADENTRY:
+        return be.deadEntry();
+    default:
+        throw std::runtime_error("Unexpected BucketEntry type for key");
+    }
+}
+
+void
+BucketIndex::addPage(std::vector<Page>& pages, LedgerKey const& firstKey,
+                     size_t offset, std::vector<uint64_t> const& keyHashes)
+{
+    size_t nBits = std::max<size_t>(64, keyHashes.size() * BLOOM_BITS_PER_KEY);
+    nBits = (nBits + 63) & ~static_cast<size_t>(63);
+
+    Page page;
+    page.mFirstKey = firstKey;
+    page.mOffset = offset;
+    page.mBloom.resize(nBits / 64, 0);
+    for (auto h : keyHashes)
+    {
+        uint32_t h1 = static_cast<uint32_t>(h);
+        uint32_t h2 = static_cast<uint32_t>(h >> 32);
+        for (uint32_t i = 0; i < BLOOM_PROBES; ++i)
+        {
+            size_t bit = (h1 + i * h2) % nBits;
+            page.mBloom[bit / 64] |= (uint64_t{1} << (bit % 64));
+        }
+    }
+    pages.emplace_back(std::move(page));
+}
+
+bool
+BucketIndex::bloomMayContain(std::vector<uint64_t> const& bloom,
+                             uint64_t keyHash)
+{
+    size_t nBits = bloom.size() * 64;
+    uint32_t h1 = static_cast<uint32_t>(keyHash);
+    uint32_t h2 = static_cast<uint32_t>(keyHash >> 32);
+    for (uint32_t i = 0; i < BLOOM_PROBES; ++i)
+    {
+        size_t bit = (h1 + i * h2) % nBits;
+        if ((bloom[bit / 64] & (uint64_t{1} << (bit % 64))) == 0)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+std::unique_ptr<BucketIndex const>
+BucketIndex::createIndex(std::string const& filename)
+{
+    ZoneScoped;
+    releaseAssert(!filename.empty());
+
+    std::unique_ptr<BucketIndex> index(new BucketIndex());
+    XDRInputFileStream in;
+    in.open(filename);
+
+    BucketEntry be;
+    LedgerKey firstKey;
+    size_t pageOffset = 0;
+    bool pageOpen = false;
+    std::vector<uint64_t> keyHashes;
+    for (;;)
+    {
+        size_t pos = in.pos();
+        if (!in.readOne(be))
+        {
+            break;
+        }
+        if (be.type() == METAENTRY)
+        {
+            continue;
+        }
+
+        auto key = getBucketLedgerKey(be);
+        if (pageOpen && pos - pageOffset >= PAGE_SIZE)
+        {
+            addPage(index->mPages, firstKey, pageOffset, keyHashes);
+            keyHashes.clear();
+            pageOpen = false;
+        }
+        if (!pageOpen)
+        {
+            firstKey = key;
+            pageOffset = pos;
+            pageOpen = true;
+        }
+        keyHashes.emplace_back(shortHash::xdrComputeHash(key));
+    }
+    if (pageOpen)
+    {
+        addPage(index->mPages, firstKey, pageOffset, keyHashes);
+    }
+    index->mFileSize = in.size();
+
+    CLOG_DEBUG(Bucket, "Indexed bucket file {} into {} pages", filename,
+               index->mPages.size());
+    return index;
+}
+
+std::optional<std::pair<size_t, size_t>>
+BucketIndex::lookup(LedgerKey const& key) const
+{
+    ZoneScoped;
+    LedgerEntryIdCmp cmp;
+    auto next = std::upper_bound(mPages.begin(), mPages.end(), key,
+                                 [&](LedgerKey const& k, Page const& p) {
+                                     return cmp(k, p.mFirstKey);
+                                 });
+    if (next == mPages.begin())
+    {
+        return std::nullopt;
+    }
+
+    auto const& page = *std::prev(next);
+    if (!bloomMayContain(page.mBloom, shortHash::xdrComputeHash(key)))
+    {
+        return std::nullopt;
+    }
+
+    size_t end = next == mPages.end() ? mFileSize : next->mOffset;
+    return std::make_pair(page.mOffset, end);
+}
+
+size_t
+BucketIndex::getPageCount() const
+{
+    return mPages.size();
+}
+
+std::vector<std::pair<LedgerKey, size_t>>
+BucketIndex::getPageBoundaries() const
+{
+    std::vector<std::pair<LedgerKey, size_t>> res;
+    res.reserve(mPages.size());
+    for (auto const& p : mPages)
+    {
+        res.emplace_back(p.mFirstKey, p.mOffset);
+    }
+    return res;
+}
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+// Copyright 2022 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include "bucket/LedgerCmp.h"
+#include "util/NonCopyable.h"
+#include "xdr/Stellar-ledger.h"
+
+#include <memory>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace stellar
+{
+
+// Returns the LedgerKey identifying a LIVEENTRY, INITENTRY or DEADENTRY.
+LedgerKey getBucketLedgerKey(BucketEntry const& be);
+
+/**
+ * BucketIndex is an in-memory index over the sorted entries of a single bucket
+ * file, supporting point lookups without streaming the whole file.
+ *
+ * The file is divided into pages of roughly PAGE_SIZE bytes. For each page the
+ * index stores the first key in the page, the file offset of that key, and a
+ * small bloom filter over every key in the page. A lookup binary-searches for
+ * the only page that could hold the key and consults that page's bloom filter;
+ * only if the filter passes does the caller need to seek into the file and
+ * scan the page.
+ *
+ * Like Bucket, a BucketIndex is immutable once built and is shared between
+ * threads.
+ */
+class BucketIndex : public NonMovableOrCopyable
+{
+  public:
+    // Pages are closed once they hold at least this many bytes of XDR.
+    static constexpr size_t PAGE_SIZE = 16384;
+
+    // Bloom filter parameters; 10 bits per key and 4 probes gives a false
+    // positive rate a little under 1%.
+    static constexpr size_t BLOOM_BITS_PER_KEY = 10;
+    static constexpr size_t BLOOM_PROBES = 4;
+
+  private:
+    struct Page
+    {
+        LedgerKey mFirstKey;
+        size_t mOffset;
+        std::vector<uint64_t> mBloom;
+    };
+
+    std::vector<Page> mPages;
+    size_t mFileSize{0};
+
+    BucketIndex() = default;
+
+    static void addPage(std::vector<Page>& pages, LedgerKey const& firstKey,
+                        size_t offset, std::vector<uint64_t> const& keyHashes);
+    static bool bloomMayContain(std::vector<uint64_t> const& bloom,
+                                uint64_t keyHash);
+
+  public:
+    // Reads the bucket file `filename` sequentially and builds its index.
+    static std::unique_ptr<BucketIndex const>
+    createIndex(std::string const& filename);
+
+    // Returns the [begin, end) byte range of the page that could contain
+    // `key`, or nullopt if the index can tell that `key` is not in the bucket.
+    std::optional<std::pair<size_t, size_t>>
+    lookup(LedgerKey const& key) const;
+
+    size_t getPageCount() const;
+
+    // The first key and file offset of every page, in key order.
+    std::vector<std::pair<LedgerKey, size_t>> getPageBoundaries() const;
+};
+}
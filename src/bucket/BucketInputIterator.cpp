@@ -4,6 +4,7 @@
 
 #include "bucket/BucketInputIterator.h"
 #include "bucket/Bucket.h"
+#include "util/GlobalChecks.h"
 #include <Tracy.hpp>
 
 namespace stellar
@@ -16,6 +17,11 @@ void
 BucketInputIterator::loadEntry()
 {
     ZoneScoped;
+    if (mEnd != std::numeric_limits<size_t>::max() && mIn.pos() >= mEnd)
+    {
+        mEntryPtr = nullptr;
+        return;
+    }
     if (mIn.readOne(mEntry))
     {
         mEntryPtr = &mEntry;
@@ -52,6 +58,20 @@ BucketInputIterator::loadEntry()
     }
 }
 
+void
+BucketInputIterator::setRange(size_t begin, size_t end)
+{
+    ZoneScoped;
+    if (mBucket->getFilename().empty())
+    {
+        return;
+    }
+    releaseAssert(begin <= end);
+    mIn.seek(begin);
+    mEnd = end;
+    loadEntry();
+}
+
 size_t
 BucketInputIterator::pos()
 {
@@ -101,7 +121,9 @@ BucketInputIterator::BucketInputIterator(std::shared_ptr<Bucket const> bucket)
     {
         CLOG_TRACE(Bucket, "BucketInputIterator opening file to read: {}",
                    mBucket->getFilename());
-        mIn.open(mBucket->getFilename());
+        // Buckets are immutable and read front to back, so map them rather
+        // than streaming them through an ifstream.
+        mIn.open(mBucket->getFilename(), /*useMmap=*/true);
         loadEntry();
     }
 }
@@ -8,6 +8,7 @@
 #include "util/XDRStream.h"
 #include "xdr/Stellar-ledger.h"
 
+#include <limits>
 #include <memory>
 
 namespace stellar
@@ -29,6 +30,7 @@ class BucketInputIterator
     bool mSeenMetadata{false};
     bool mSeenOtherEntries{false};
     BucketMetadata mMetadata;
+    size_t mEnd{std::numeric_limits<size_t>::max()};
     void loadEntry();
 
   public:
@@ -52,6 +54,12 @@ class BucketInputIterator
 
     BucketInputIterator& operator++();
 
+    // Restricts the iterator to the entries stored at file offsets
+    // [begin, end), which must be entry boundaries after any METAENTRY (see
+    // Bucket::lowerBoundOffset), and repositions it at `begin`. Used to merge
+    // one key range of the bucket.
+    void setRange(size_t begin, size_t end);
+
     size_t pos();
     size_t size() const;
 };
@@ -369,6 +369,26 @@ BucketList::getHash() const
     return hsh.finish();
 }
 
+std::vector<LedgerEntry>
+BucketList::loadKeys(std::set<LedgerKey, LedgerEntryIdCmp> const& keys) const
+{
+    ZoneScoped;
+    std::vector<LedgerEntry> result;
+    auto remaining = keys;
+    for (auto const& lev : mLevels)
+    {
+        for (auto const& b : {lev.getCurr(), lev.getSnap()})
+        {
+            if (remaining.empty())
+            {
+                return result;
+            }
+            b->loadKeys(remaining, result);
+        }
+    }
+    return result;
+}
+
 // levelShouldSpill is the set of boundaries at which each level should spill,
 // it's not-entirely obvious which numbers these are by inspection, so we list
 // the first 3 values it's true on each level here for reference:
@@ -5,9 +5,11 @@
 // of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
 
 #include "bucket/FutureBucket.h"
+#include "bucket/LedgerCmp.h"
 #include "overlay/StellarXDR.h"
 #include "xdrpp/message.h"
 #include <future>
+#include <set>
 
 namespace stellar
 {
@@ -402,6 +404,14 @@ class BucketList
     // of the concatenation of the hashes of the `curr` and `snap` buckets.
     Hash getHash() const;
 
+    // Loads the newest version of each of `keys`, searching levels from newest
+    // to oldest (curr before snap within each level) and stopping at the first
+    // bucket that mentions a key. Keys that are absent or whose newest entry is
+    // a DEADENTRY are omitted from the result. This is only efficient when the
+    // buckets are indexed (see EXPERIMENTAL_BUCKETLIST_DB).
+    std::vector<LedgerEntry>
+    loadKeys(std::set<LedgerKey, LedgerEntryIdCmp> const& keys) const;
+
     // Restart any merges that might be running on background worker threads,
     // merging buckets between levels. This needs to be called after forcing a
     // BucketList to adopt a new state, either at application restart or when
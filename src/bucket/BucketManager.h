@@ -7,10 +7,12 @@
 #include "bucket/Bucket.h"
 #include "overlay/StellarXDR.h"
 #include "util/NonCopyable.h"
+#include <functional>
 #include <future>
 #include <map>
 #include <memory>
 #include <set>
+#include <string>
 
 #include "medida/timer_context.h"
 
@@ -119,7 +121,8 @@ class BucketManager : NonMovableOrCopyable
     // Concretely: if `hash` names an existing bucket -- either in-memory or on
     // disk -- delete `filename` and return an object for the existing bucket;
     // otherwise move `filename` to the bucket directory, stored under `hash`,
-    // and return a new bucket pointing to that.
+    // and return a new bucket pointing to that. When EXPERIMENTAL_BUCKETLIST_DB
+    // is enabled the new bucket is also given a BucketIndex for point lookups.
     //
     // This method is mostly-threadsafe -- assuming you don't destruct the
     // BucketManager mid-call -- and is intended to be called from both main and
@@ -157,6 +160,16 @@ class BucketManager : NonMovableOrCopyable
     putMergeFuture(MergeKey const& key,
                    std::shared_future<std::shared_ptr<Bucket>>) = 0;
 
+    // Run a merge task for BucketList level `level`, whose inputs total
+    // `inputBytes`, on a worker thread, subject to the merge concurrency and
+    // memory limits (see BucketMergeScheduler).
+    virtual void scheduleMerge(uint32_t level, size_t inputBytes,
+                               std::function<void()>&& merge) = 0;
+
+    // Per-level summary of deep merges running or waiting to run, or an
+    // empty string if there are none.
+    virtual std::string getMergeProgress() const = 0;
+
 #ifdef BUILD_TESTS
     // Drop all references to merge futures in progress.
     virtual void clearMergeFuturesForTesting() = 0;
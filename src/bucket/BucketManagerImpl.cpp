@@ -9,7 +9,7 @@
 #include "bucket/BucketOutputIterator.h"
 #include "crypto/Hex.h"
 #include "history/HistoryManager.h"
-#include "historywork/VerifyBucketWork.h"
+#include "historywork/VerifyBucketsWork.h"
 #include "ledger/LedgerManager.h"
 #include "main/Application.h"
 #include "main/Config.h"
@@ -118,6 +118,9 @@ BucketManagerImpl::BucketManagerImpl(Application& app)
     // mode does not use minimal DB
     , mDeleteEntireBucketDirInDtor(
           app.getConfig().isInMemoryModeWithoutMinimalDB())
+    , mMergeScheduler(
+          app, app.getConfig().MAX_CONCURRENT_BUCKET_MERGES,
+          app.getConfig().BUCKET_MERGE_MEMORY_BUDGET_MB * 1024 * 1024)
 {
 }
 
@@ -366,6 +369,18 @@ BucketManagerImpl::adoptFileAsBucket(std::string const& filename,
 {
     ZoneScoped;
     releaseAssertOrThrow(mApp.getConfig().MODE_ENABLES_BUCKETLIST);
+
+    // Index the file before taking the bucket mutex: it's a full sequential
+    // read of the file, which we don't want to serialize other adoptions (or
+    // the main thread) behind. Bucket offsets are unaffected by the rename
+    // below. Files of known buckets are deleted below instead, so are not
+    // indexed.
+    std::unique_ptr<BucketIndex const> index;
+    if (mApp.getConfig().EXPERIMENTAL_BUCKETLIST_DB && !isKnownBucket(hash))
+    {
+        index = BucketIndex::createIndex(filename);
+    }
+
     std::lock_guard<std::recursive_mutex> lock(mBucketMutex);
 
     if (mergeKey)
@@ -416,7 +431,12 @@ BucketManagerImpl::adoptFileAsBucket(std::string const& filename,
             }
         }
 
-        b = std::make_shared<Bucket>(canonicalName, hash);
+        if (mApp.getConfig().EXPERIMENTAL_BUCKETLIST_DB && !index)
+        {
+            // The bucket was forgotten since it was checked above.
+            index = BucketIndex::createIndex(canonicalName);
+        }
+        b = std::make_shared<Bucket>(canonicalName, hash, std::move(index));
         {
             mSharedBuckets.emplace(hash, b);
             mSharedBucketsSize.set_count(mSharedBuckets.size());
@@ -451,6 +471,14 @@ BucketManagerImpl::noteEmptyMergeOutput(MergeKey const& mergeKey)
     mLiveFutures.erase(mergeKey);
 }
 
+bool
+BucketManagerImpl::isKnownBucket(uint256 const& hash)
+{
+    std::lock_guard<std::recursive_mutex> lock(mBucketMutex);
+    return isZero(hash) || mSharedBuckets.find(hash) != mSharedBuckets.end() ||
+           fs::exists(bucketFilename(hash));
+}
+
 std::shared_ptr<Bucket>
 BucketManagerImpl::getBucketByHash(uint256 const& hash)
 {
@@ -474,7 +502,13 @@ BucketManagerImpl::getBucketByHash(uint256 const& hash)
                    "BucketManager::getBucketByHash({}) found no bucket, making "
                    "new one",
                    binToHex(hash));
-        auto p = std::make_shared<Bucket>(canonicalName, hash);
+        std::unique_ptr<BucketIndex const> index;
+        if (mApp.getConfig().EXPERIMENTAL_BUCKETLIST_DB)
+        {
+            index = BucketIndex::createIndex(canonicalName);
+        }
+        auto p =
+            std::make_shared<Bucket>(canonicalName, hash, std::move(index));
         mSharedBuckets.emplace(hash, p);
         mSharedBucketsSize.set_count(mSharedBuckets.size());
         return p;
@@ -540,6 +574,19 @@ BucketManagerImpl::putMergeFuture(
     mLiveFutures.emplace(key, wp);
 }
 
+void
+BucketManagerImpl::scheduleMerge(uint32_t level, size_t inputBytes,
+                                 std::function<void()>&& merge)
+{
+    mMergeScheduler.schedule(level, inputBytes, std::move(merge));
+}
+
+std::string
+BucketManagerImpl::getMergeProgress() const
+{
+    return mMergeScheduler.getProgress();
+}
+
 #ifdef BUILD_TESTS
 void
 BucketManagerImpl::clearMergeFuturesForTesting()
@@ -860,6 +907,8 @@ void
 BucketManagerImpl::shutdown()
 {
     mIsShutdown = true;
+    // Queued merges now fail as soon as they start.
+    mMergeScheduler.shutdown();
 }
 
 bool
@@ -970,7 +1019,7 @@ std::shared_ptr<BasicWork>
 BucketManagerImpl::scheduleVerifyReferencedBucketsWork()
 {
     std::set<Hash> hashes = getReferencedBuckets();
-    std::vector<std::shared_ptr<BasicWork>> seq;
+    std::vector<std::pair<std::string, uint256>> buckets;
     for (auto const& h : hashes)
     {
         if (isZero(h))
@@ -983,10 +1032,8 @@ BucketManagerImpl::scheduleVerifyReferencedBucketsWork()
             throw std::runtime_error(fmt::format(
                 FMT_STRING("Missing referenced bucket {}"), binToHex(h)));
         }
-        seq.emplace_back(std::make_shared<VerifyBucketWork>(
-            mApp, b->getFilename(), b->getHash(), nullptr));
+        buckets.emplace_back(b->getFilename(), b->getHash());
     }
-    return mApp.getWorkScheduler().scheduleWork<WorkSequence>(
-        "verify-referenced-buckets", seq);
+    return mApp.getWorkScheduler().scheduleWork<VerifyBucketsWork>(buckets);
 }
 }
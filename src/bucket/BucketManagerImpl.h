@@ -3,6 +3,7 @@
 #include "bucket/BucketList.h"
 #include "bucket/BucketManager.h"
 #include "bucket/BucketMergeMap.h"
+#include "bucket/BucketMergeScheduler.h"
 #include "overlay/StellarXDR.h"
 
 #include <map>
@@ -65,12 +66,15 @@ class BucketManagerImpl : public BucketManager
     // alive. Needs to be queried and updated on mSharedBuckets GC events.
     BucketMergeMap mFinishedMerges;
 
+    BucketMergeScheduler mMergeScheduler;
+
     std::atomic<bool> mIsShutdown{false};
 
     void cleanupStaleFiles();
     void deleteTmpDirAndUnlockBucketDir();
     void deleteEntireBucketDir();
     bool renameBucket(std::string const& src, std::string const& dst);
+    bool isKnownBucket(uint256 const& hash);
 
 #ifdef BUILD_TESTS
     bool mUseFakeTestValuesForNextClose{false};
@@ -106,6 +110,9 @@ class BucketManagerImpl : public BucketManager
     getMergeFuture(MergeKey const& key) override;
     void putMergeFuture(MergeKey const& key,
                         std::shared_future<std::shared_ptr<Bucket>>) override;
+    void scheduleMerge(uint32_t level, size_t inputBytes,
+                       std::function<void()>&& merge) override;
+    std::string getMergeProgress() const override;
 #ifdef BUILD_TESTS
     void clearMergeFuturesForTesting() override;
 #endif
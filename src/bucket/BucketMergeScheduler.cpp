@@ -0,0 +1,181 @@
+// Copyright 2022 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include "bucket/BucketMergeScheduler.h"
+#include "main/Application.h"
+#include "util/GlobalChecks.h"
+#include "util/Logging.h"
+#include <Tracy.hpp>
+#include <fmt/format.h>
+
+namespace stellar
+{
+
+namespace
+{
+std::string
+formatBytes(size_t bytes)
+{
+    return fmt::format(FMT_STRING("{:.1f} MB"),
+                       static_cast<double>(bytes) / 1000000.0);
+}
+}
+
+BucketMergeScheduler::State::State(Application& app,
+                                   size_t maxConcurrentMerges,
+                                   size_t memoryBudgetBytes)
+    : mApp(app)
+    , mMaxConcurrentMerges(maxConcurrentMerges)
+    , mMemoryBudgetBytes(memoryBudgetBytes)
+{
+}
+
+BucketMergeScheduler::BucketMergeScheduler(Application& app,
+                                           size_t maxConcurrentMerges,
+                                           size_t memoryBudgetBytes)
+    : mState(std::make_shared<State>(app, maxConcurrentMerges,
+                                     memoryBudgetBytes))
+{
+}
+
+void
+BucketMergeScheduler::schedule(uint32_t level, size_t inputBytes,
+                               std::function<void()>&& merge)
+{
+    ZoneScoped;
+    if (level < UNSCHEDULED_LEVELS)
+    {
+        mState->mApp.postOnBackgroundThread(std::move(merge),
+                                            "FutureBucket: merge");
+        return;
+    }
+
+    std::unique_lock<std::mutex> lock(mState->mMutex);
+    if (mState->mShutdown)
+    {
+        lock.unlock();
+        merge();
+        return;
+    }
+    mState->mQueued.emplace(level,
+                            Merge{level, inputBytes, std::move(merge), {}});
+    mState->startReadyMerges(lock);
+}
+
+void
+BucketMergeScheduler::shutdown()
+{
+    std::multimap<uint32_t, Merge> queued;
+    {
+        std::lock_guard<std::mutex> lock(mState->mMutex);
+        mState->mShutdown = true;
+        queued.swap(mState->mQueued);
+    }
+    if (!queued.empty())
+    {
+        CLOG_INFO(Bucket, "Running {} queued merges on shutdown",
+                  queued.size());
+    }
+    for (auto& kv : queued)
+    {
+        kv.second.mRun();
+    }
+}
+
+bool
+BucketMergeScheduler::State::canStart(Merge const& merge) const
+{
+    if (mMaxConcurrentMerges != 0 && mRunning.size() >= mMaxConcurrentMerges)
+    {
+        return false;
+    }
+    if (mMemoryBudgetBytes != 0 && !mRunning.empty() &&
+        mRunningBytes + merge.mInputBytes > mMemoryBudgetBytes)
+    {
+        return false;
+    }
+    return true;
+}
+
+void
+BucketMergeScheduler::State::startReadyMerges(
+    std::unique_lock<std::mutex>& lock)
+{
+    releaseAssert(lock.owns_lock());
+    while (!mShutdown && !mQueued.empty() &&
+           canStart(mQueued.begin()->second))
+    {
+        auto running = mRunning.emplace(mRunning.end(),
+                                        std::move(mQueued.begin()->second));
+        mQueued.erase(mQueued.begin());
+        running->mStarted = std::chrono::steady_clock::now();
+        mRunningBytes += running->mInputBytes;
+        CLOG_INFO(Bucket,
+                  "Starting merge on BucketList level {} ({} of inputs; {} "
+                  "deep merges running, {} queued)",
+                  running->mLevel, formatBytes(running->mInputBytes),
+                  mRunning.size(), mQueued.size());
+        post(running);
+    }
+}
+
+void
+BucketMergeScheduler::State::post(std::list<Merge>::iterator running)
+{
+    mApp.postOnBackgroundThread(
+        [self = shared_from_this(), running]() {
+            // Only this job touches the running entry's task; other threads
+            // only add and remove other list elements, which leaves this
+            // iterator valid.
+            running->mRun();
+
+            std::unique_lock<std::mutex> lock(self->mMutex);
+            std::chrono::duration<double> elapsed =
+                std::chrono::steady_clock::now() - running->mStarted;
+            CLOG_INFO(Bucket, "Finished merge on BucketList level {} in {}s",
+                      running->mLevel, elapsed.count());
+            self->mRunningBytes -= running->mInputBytes;
+            self->mRunning.erase(running);
+            self->startReadyMerges(lock);
+        },
+        "FutureBucket: merge");
+}
+
+std::string
+BucketMergeScheduler::getProgress() const
+{
+    std::lock_guard<std::mutex> lock(mState->mMutex);
+    std::string res;
+    auto now = std::chrono::steady_clock::now();
+    for (auto const& m : mState->mRunning)
+    {
+        auto secs =
+            std::chrono::duration_cast<std::chrono::seconds>(now - m.mStarted);
+        res += fmt::format(FMT_STRING("{}level {:d} merging {} for {:d}s"),
+                           res.empty() ? "" : ", ", m.mLevel,
+                           formatBytes(m.mInputBytes), secs.count());
+    }
+    for (auto const& kv : mState->mQueued)
+    {
+        res += fmt::format(FMT_STRING("{}level {:d} queued ({})"),
+                           res.empty() ? "" : ", ", kv.first,
+                           formatBytes(kv.second.mInputBytes));
+    }
+    return res;
+}
+
+size_t
+BucketMergeScheduler::getRunningMergeCount() const
+{
+    std::lock_guard<std::mutex> lock(mState->mMutex);
+    return mState->mRunning.size();
+}
+
+size_t
+BucketMergeScheduler::getQueuedMergeCount() const
+{
+    std::lock_guard<std::mutex> lock(mState->mMutex);
+    return mState->mQueued.size();
+}
+}
@@ -0,0 +1,108 @@
+#pragma once
+
+// Copyright 2022 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include "util/NonCopyable.h"
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+
+namespace stellar
+{
+
+class Application;
+
+/**
+ * BucketMergeScheduler decides when the merges started by FutureBuckets get
+ * posted to the worker pool.
+ *
+ * Merges on the shallow levels (below UNSCHEDULED_LEVELS) have small inputs
+ * and are needed within a few ledgers, so they are always posted immediately
+ * to avoid the priority inversion described at WORKER_THREADS. Deeper merges
+ * can each take minutes and map gigabytes of input, so they are queued and
+ * started shallowest-level first (the order in which they are needed) subject
+ * to two limits:
+ *
+ *   - at most `maxConcurrentMerges` deep merges run at once (0: no limit),
+ *   - the inputs of running deep merges total at most `memoryBudgetBytes`
+ *     (0: no limit); a merge larger than the whole budget still runs, but
+ *     only once no other deep merge is running.
+ *
+ * All levels of a BucketList being restarted (at startup or after catchup
+ * has assumed a new state) are queued together, so independent levels merge
+ * concurrently up to those limits.
+ *
+ * On shutdown the queued merges are run on the calling thread, and so are
+ * deep merges scheduled afterwards: they are expected to fail fast once the
+ * BucketManager is shut down, which resolves their futures with an error
+ * rather than leaving them to break.
+ *
+ * Methods are threadsafe: merges are scheduled from the main thread and
+ * finish on worker threads, which start the next queued merges. Those keep
+ * the scheduler's state alive, so it may be destroyed while merges run.
+ */
+class BucketMergeScheduler : public NonMovableOrCopyable
+{
+  public:
+    static constexpr uint32_t UNSCHEDULED_LEVELS = 4;
+
+    BucketMergeScheduler(Application& app, size_t maxConcurrentMerges,
+                         size_t memoryBudgetBytes);
+
+    // Run `merge`, the merge task for `level` whose input buckets total
+    // `inputBytes`, on a worker thread now or once the limits allow it.
+    void schedule(uint32_t level, size_t inputBytes,
+                  std::function<void()>&& merge);
+
+    // Run the queued merges, and any deep merge scheduled from now on, on the
+    // calling thread.
+    void shutdown();
+
+    // Human-readable per-level summary of running and queued deep merges,
+    // e.g. "level 6 merging 1.2 GB for 35s, level 8 queued (4.8 GB)", or an
+    // empty string if there are none.
+    std::string getProgress() const;
+
+    size_t getRunningMergeCount() const;
+    size_t getQueuedMergeCount() const;
+
+  private:
+    struct Merge
+    {
+        uint32_t mLevel;
+        size_t mInputBytes;
+        std::function<void()> mRun;
+        std::chrono::steady_clock::time_point mStarted;
+    };
+
+    struct State : public std::enable_shared_from_this<State>
+    {
+        Application& mApp;
+        size_t const mMaxConcurrentMerges;
+        size_t const mMemoryBudgetBytes;
+
+        mutable std::mutex mMutex;
+        // Queued deep merges, keyed (and so started) by level.
+        std::multimap<uint32_t, Merge> mQueued;
+        std::list<Merge> mRunning;
+        size_t mRunningBytes{0};
+        bool mShutdown{false};
+
+        State(Application& app, size_t maxConcurrentMerges,
+              size_t memoryBudgetBytes);
+        bool canStart(Merge const& merge) const;
+        void startReadyMerges(std::unique_lock<std::mutex>& lock);
+        void post(std::list<Merge>::iterator running);
+    };
+
+    std::shared_ptr<State> const mState;
+};
+}
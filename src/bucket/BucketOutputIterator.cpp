@@ -6,6 +6,7 @@
 #include "bucket/Bucket.h"
 #include "bucket/BucketManager.h"
 #include "crypto/Random.h"
+#include "util/Fs.h"
 #include "util/GlobalChecks.h"
 #include <Tracy.hpp>
 
@@ -39,22 +40,27 @@ BucketOutputIterator::BucketOutputIterator(std::string const& tmpDir,
                                            bool keepDeadEntries,
                                            BucketMetadata const& meta,
                                            MergeCounters& mc,
-                                           asio::io_context& ctx, bool doFsync)
+                                           asio::io_context& ctx, bool doFsync,
+                                           bool isRangeContinuation)
     : mFilename(randomBucketName(tmpDir))
-    , mOut(ctx, doFsync)
+    , mOut(mFilename, ctx, doFsync, /*hash=*/!isRangeContinuation)
     , mBuf(nullptr)
     , mKeepDeadEntries(keepDeadEntries)
     , mMeta(meta)
+    , mIsRangeContinuation(isRangeContinuation)
     , mMergeCounters(mc)
 {
     ZoneScoped;
-    CLOG_TRACE(Bucket, "BucketOutputIterator opening file to write: {}",
+    CLOG_TRACE(Bucket, "BucketOutputIterator opened file to write: {}",
                mFilename);
-    // Will throw if unable to open the file
-    mOut.open(mFilename);
 
-    if (meta.ledgerVersion >=
-        Bucket::FIRST_PROTOCOL_SUPPORTING_INITENTRY_AND_METAENTRY)
+    if (mIsRangeContinuation)
+    {
+        // The METAENTRY is written by the first range.
+        mPutMeta = true;
+    }
+    else if (meta.ledgerVersion >=
+             Bucket::FIRST_PROTOCOL_SUPPORTING_INITENTRY_AND_METAENTRY)
     {
         BucketEntry bme;
         bme.type(METAENTRY);
@@ -96,7 +102,7 @@ BucketOutputIterator::put(BucketEntry const& e)
         if (mCmp(*mBuf, e))
         {
             ++mMergeCounters.mOutputIteratorActualWrites;
-            mOut.writeOne(*mBuf, &mHasher, &mBytesPut);
+            mOut.writeOne(*mBuf);
             mObjectsPut++;
         }
     }
@@ -110,23 +116,59 @@ BucketOutputIterator::put(BucketEntry const& e)
     *mBuf = e;
 }
 
-std::shared_ptr<Bucket>
-BucketOutputIterator::getBucket(BucketManager& bucketManager,
-                                MergeKey* mergeKey)
+void
+BucketOutputIterator::writeBufferedEntry()
 {
-    ZoneScoped;
     if (mBuf)
     {
-        mOut.writeOne(*mBuf, &mHasher, &mBytesPut);
+        mOut.writeOne(*mBuf);
         mObjectsPut++;
         mBuf.reset();
     }
+}
+
+void
+BucketOutputIterator::closeRange()
+{
+    ZoneScoped;
+    releaseAssert(mIsRangeContinuation);
+    writeBufferedEntry();
+    mOut.finish();
+}
+
+void
+BucketOutputIterator::appendRange(BucketOutputIterator& next)
+{
+    ZoneScoped;
+    releaseAssert(!mIsRangeContinuation);
+    releaseAssert(next.mIsRangeContinuation);
+    releaseAssert(next.mOut.isFinished());
+    if (next.mObjectsPut != 0)
+    {
+        // Every key in `next` is greater than every key put here, so the
+        // buffered entry can't be replaced any more.
+        writeBufferedEntry();
+        fs::MappedFile range(next.mFilename);
+        mOut.writeBytes(range.data(), range.size());
+        mObjectsPut += next.mObjectsPut;
+    }
+    std::remove(next.mFilename.c_str());
+}
+
+std::shared_ptr<Bucket>
+BucketOutputIterator::getBucket(BucketManager& bucketManager,
+                                MergeKey* mergeKey)
+{
+    ZoneScoped;
+    releaseAssert(!mIsRangeContinuation);
+    writeBufferedEntry();
 
-    mOut.close();
-    if (mObjectsPut == 0 || mBytesPut == 0)
+    Hash hash = mOut.finish();
+    size_t bytesPut = mOut.getBytesWritten();
+    if (mObjectsPut == 0 || bytesPut == 0)
     {
         releaseAssert(mObjectsPut == 0);
-        releaseAssert(mBytesPut == 0);
+        releaseAssert(bytesPut == 0);
         CLOG_DEBUG(Bucket, "Deleting empty bucket file {}", mFilename);
         std::remove(mFilename.c_str());
         if (mergeKey)
@@ -135,7 +177,7 @@ BucketOutputIterator::getBucket(BucketManager& bucketManager,
         }
         return std::make_shared<Bucket>();
     }
-    return bucketManager.adoptFileAsBucket(mFilename, mHasher.finish(),
-                                           mObjectsPut, mBytesPut, mergeKey);
+    return bucketManager.adoptFileAsBucket(mFilename, hash, mObjectsPut,
+                                           bytesPut, mergeKey);
 }
 }
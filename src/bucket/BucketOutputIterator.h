@@ -5,6 +5,7 @@
 // of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
 
 #include "bucket/BucketManager.h"
+#include "bucket/BucketWritePipeline.h"
 #include "bucket/LedgerCmp.h"
 #include "util/XDRStream.h"
 #include "xdr/Stellar-ledger.h"
@@ -19,22 +20,24 @@ class Bucket;
 class BucketManager;
 
 // Helper class that writes new elements to a file and returns a bucket
-// when finished.
+// when finished. Hashing and writing the file happen on the stages of a
+// BucketWritePipeline.
 class BucketOutputIterator
 {
   protected:
     std::string mFilename;
-    XDROutputFileStream mOut;
+    BucketWritePipeline mOut;
     BucketEntryIdCmp mCmp;
     std::unique_ptr<BucketEntry> mBuf;
-    SHA256 mHasher;
-    size_t mBytesPut{0};
     size_t mObjectsPut{0};
     bool mKeepDeadEntries{true};
     BucketMetadata mMeta;
     bool mPutMeta{false};
+    bool mIsRangeContinuation{false};
     MergeCounters& mMergeCounters;
 
+    void writeBufferedEntry();
+
   public:
     // BucketOutputIterators must _always_ be constructed with BucketMetadata,
     // regardless of the ledger version the bucket is being written from, even
@@ -43,12 +46,28 @@ class BucketOutputIterator
     // version new enough that it should _write_ the metadata to the stream in
     // the form of a METAENTRY; but that's not a thing the caller gets to decide
     // (or forget to do), it's handled automatically.
+    //
+    // The exception is a merge split into key ranges (see Bucket::merge):
+    // iterators for every range but the first are constructed with
+    // `isRangeContinuation`, write neither a METAENTRY nor a hash, finish with
+    // `closeRange` and are then appended in key order to the first range's
+    // iterator with `appendRange`, before its `getBucket`.
     BucketOutputIterator(std::string const& tmpDir, bool keepDeadEntries,
                          BucketMetadata const& meta, MergeCounters& mc,
-                         asio::io_context& ctx, bool doFsync);
+                         asio::io_context& ctx, bool doFsync,
+                         bool isRangeContinuation = false);
 
     void put(BucketEntry const& e);
 
+    void closeRange();
+    void appendRange(BucketOutputIterator& next);
+
+    std::string const&
+    getFilename() const
+    {
+        return mFilename;
+    }
+
     std::shared_ptr<Bucket> getBucket(BucketManager& bucketManager,
                                       MergeKey* mergeKey = nullptr);
 };
@@ -0,0 +1,253 @@
+// Copyright 2022 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include "bucket/BucketWritePipeline.h"
+#include "crypto/ByteSlice.h"
+#include "util/GlobalChecks.h"
+#include <Tracy.hpp>
+
+#include <algorithm>
+
+namespace stellar
+{
+
+bool
+BucketWritePipeline::ChunkQueue::push(Chunk chunk)
+{
+    std::unique_lock<std::mutex> lock(mMutex);
+    mCv.wait(lock,
+             [&]() { return mClosed || mChunks.size() < QUEUE_DEPTH; });
+    if (mClosed)
+    {
+        return false;
+    }
+    mChunks.emplace_back(std::move(chunk));
+    mCv.notify_all();
+    return true;
+}
+
+bool
+BucketWritePipeline::ChunkQueue::pop(Chunk& chunk)
+{
+    std::unique_lock<std::mutex> lock(mMutex);
+    mCv.wait(lock, [&]() { return mClosed || !mChunks.empty(); });
+    if (mChunks.empty())
+    {
+        return false;
+    }
+    chunk = std::move(mChunks.front());
+    mChunks.pop_front();
+    mCv.notify_all();
+    return true;
+}
+
+void
+BucketWritePipeline::ChunkQueue::close(bool discard)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    mClosed = true;
+    if (discard)
+    {
+        mChunks.clear();
+    }
+    mCv.notify_all();
+}
+
+BucketWritePipeline::BucketWritePipeline(std::string const& filename,
+                                         asio::io_context& ctx, bool doFsync,
+                                         bool hash)
+    : mOut(ctx, doFsync), mHash(hash)
+{
+    // Will throw if unable to open the file
+    mOut.open(filename);
+    mCurrent.reserve(CHUNK_SIZE);
+}
+
+BucketWritePipeline::~BucketWritePipeline()
+{
+    // Only does anything if we're unwinding before `finish`; the file is
+    // closed by mOut's destructor if the writing stage didn't get to it.
+    joinStages(/*discard=*/true);
+}
+
+void
+BucketWritePipeline::writeOne(BucketEntry const& e)
+{
+    ZoneScoped;
+    releaseAssert(!mFinished);
+    uint32_t sz = (uint32_t)xdr::xdr_size(e);
+    releaseAssertOrThrow(sz < 0x80000000);
+
+    size_t start = mCurrent.size();
+    mCurrent.resize(start + sz + 4);
+    char* p = mCurrent.data() + start;
+
+    // Same framing as XDROutputFileStream::writeOne: 4 bytes of size,
+    // big-endian, with the XDR 'continuation' bit set on the high bit.
+    p[0] = static_cast<char>((sz >> 24) & 0xFF) | '\x80';
+    p[1] = static_cast<char>((sz >> 16) & 0xFF);
+    p[2] = static_cast<char>((sz >> 8) & 0xFF);
+    p[3] = static_cast<char>(sz & 0xFF);
+    xdr::xdr_put put(p + 4, p + 4 + sz);
+    xdr_argpack_archive(put, e);
+    mBytesWritten += sz + 4;
+
+    if (mCurrent.size() >= CHUNK_SIZE)
+    {
+        submitChunk();
+    }
+}
+
+void
+BucketWritePipeline::writeBytes(char const* buf, size_t len)
+{
+    ZoneScoped;
+    releaseAssert(!mFinished);
+    while (len > 0)
+    {
+        size_t n = std::min(len, CHUNK_SIZE - mCurrent.size());
+        mCurrent.insert(mCurrent.end(), buf, buf + n);
+        mBytesWritten += n;
+        buf += n;
+        len -= n;
+        if (mCurrent.size() >= CHUNK_SIZE)
+        {
+            submitChunk();
+        }
+    }
+}
+
+void
+BucketWritePipeline::submitChunk()
+{
+    ZoneScoped;
+    if (!mStarted)
+    {
+        startStages();
+    }
+    auto chunk = std::make_shared<std::vector<char> const>(std::move(mCurrent));
+    mCurrent = std::vector<char>();
+    mCurrent.reserve(CHUNK_SIZE);
+    if ((mHash && !mHashQueue.push(chunk)) || !mWriteQueue.push(chunk))
+    {
+        // A stage failed and closed its queue.
+        mFinished = true;
+        joinStages(/*discard=*/true);
+        rethrowStageError();
+    }
+}
+
+void
+BucketWritePipeline::startStages()
+{
+    mStarted = true;
+    if (mHash)
+    {
+        mHashThread = std::thread([this]() {
+            try
+            {
+                ZoneScopedN("bucket hash stage");
+                Chunk chunk;
+                while (mHashQueue.pop(chunk))
+                {
+                    mHasher.add(ByteSlice(chunk->data(), chunk->size()));
+                }
+            }
+            catch (...)
+            {
+                mHashError = std::current_exception();
+                mHashQueue.close(/*discard=*/true);
+            }
+        });
+    }
+    mWriteThread = std::thread([this]() {
+        try
+        {
+            ZoneScopedN("bucket write stage");
+            Chunk chunk;
+            while (mWriteQueue.pop(chunk))
+            {
+                mOut.writeBytes(chunk->data(), chunk->size());
+            }
+            mOut.close();
+        }
+        catch (...)
+        {
+            mWriteError = std::current_exception();
+            mWriteQueue.close(/*discard=*/true);
+        }
+    });
+}
+
+void
+BucketWritePipeline::joinStages(bool discard)
+{
+    mHashQueue.close(discard);
+    mWriteQueue.close(discard);
+    if (mHashThread.joinable())
+    {
+        mHashThread.join();
+    }
+    if (mWriteThread.joinable())
+    {
+        mWriteThread.join();
+    }
+}
+
+void
+BucketWritePipeline::rethrowStageError()
+{
+    if (mWriteError)
+    {
+        std::rethrow_exception(mWriteError);
+    }
+    if (mHashError)
+    {
+        std::rethrow_exception(mHashError);
+    }
+}
+
+Hash
+BucketWritePipeline::finish()
+{
+    ZoneScoped;
+    releaseAssert(!mFinished);
+    if (!mStarted)
+    {
+        mFinished = true;
+        if (!mCurrent.empty())
+        {
+            if (mHash)
+            {
+                mHasher.add(ByteSlice(mCurrent.data(), mCurrent.size()));
+            }
+            mOut.writeBytes(mCurrent.data(), mCurrent.size());
+        }
+        mOut.close();
+    }
+    else
+    {
+        if (!mCurrent.empty())
+        {
+            submitChunk();
+        }
+        mFinished = true;
+        joinStages(/*discard=*/false);
+        rethrowStageError();
+    }
+    return mHash ? mHasher.finish() : Hash{};
+}
+
+bool
+BucketWritePipeline::isFinished() const
+{
+    return mFinished;
+}
+
+size_t
+BucketWritePipeline::getBytesWritten() const
+{
+    return mBytesWritten;
+}
+}
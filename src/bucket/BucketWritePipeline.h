@@ -0,0 +1,106 @@
+#pragma once
+
+// Copyright 2022 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include "crypto/SHA.h"
+#include "util/NonCopyable.h"
+#include "util/XDRStream.h"
+#include "xdr/Stellar-ledger.h"
+
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace stellar
+{
+
+/**
+ * BucketWritePipeline writes a bucket file and computes its hash in three
+ * stages, so that the thread producing entries (usually a merge) only pays for
+ * serializing them:
+ *
+ *   - the calling thread serializes entries into chunks of CHUNK_SIZE bytes,
+ *   - a hashing thread adds each chunk to the SHA256 of the file,
+ *   - a writing thread writes each chunk to the file, which it closes (and
+ *     fsyncs, if asked to) once every chunk is written.
+ *
+ * Chunks are shared, read-only, between the hashing and writing stages, each
+ * of which queues at most QUEUE_DEPTH of them; the caller blocks when either
+ * stage falls that far behind. The stage threads are only started once the
+ * first chunk fills up: smaller files are hashed and written by `finish` on the
+ * calling thread.
+ *
+ * Errors in either stage are rethrown to the caller by the next `writeOne`,
+ * `writeBytes` or `finish`.
+ */
+class BucketWritePipeline : public NonMovableOrCopyable
+{
+  public:
+    static constexpr size_t CHUNK_SIZE = 256 * 1024;
+    static constexpr size_t QUEUE_DEPTH = 4;
+
+    // With `hash` false (for files that aren't buckets on their own, see
+    // BucketOutputIterator::appendRange) the hashing stage is skipped.
+    BucketWritePipeline(std::string const& filename, asio::io_context& ctx,
+                        bool doFsync, bool hash = true);
+    ~BucketWritePipeline();
+
+    void writeOne(BucketEntry const& e);
+
+    // Writes `len` bytes that are already XDR-framed.
+    void writeBytes(char const* buf, size_t len);
+
+    // Waits for every chunk to be hashed and written and the file closed,
+    // and returns the hash of everything written.
+    Hash finish();
+
+    bool isFinished() const;
+    size_t getBytesWritten() const;
+
+  private:
+    using Chunk = std::shared_ptr<std::vector<char> const>;
+
+    class ChunkQueue
+    {
+        std::mutex mMutex;
+        std::condition_variable mCv;
+        std::deque<Chunk> mChunks;
+        bool mClosed{false};
+
+      public:
+        // Returns false, dropping the chunk, if the queue is closed.
+        bool push(Chunk chunk);
+        // Returns false once the queue is closed and empty.
+        bool pop(Chunk& chunk);
+        // Wakes up all waiters; `discard` also drops queued chunks.
+        void close(bool discard);
+    };
+
+    XDROutputFileStream mOut;
+    bool const mHash;
+    SHA256 mHasher;
+    std::vector<char> mCurrent;
+    size_t mBytesWritten{0};
+    bool mFinished{false};
+
+    bool mStarted{false};
+    ChunkQueue mHashQueue;
+    ChunkQueue mWriteQueue;
+    std::thread mHashThread;
+    std::thread mWriteThread;
+    std::exception_ptr mHashError;
+    std::exception_ptr mWriteError;
+
+    void submitChunk();
+    void startStages();
+    void joinStages(bool discard);
+    void rethrowStageError();
+};
+}
@@ -349,6 +349,11 @@ FutureBucket::startMerge(Application& app, uint32_t maxProtocolVersion,
     std::shared_ptr<task_t> task = std::make_shared<task_t>(
         [curr, snap, &bm, shadows, maxProtocolVersion, countMergeEvents, level,
          &timer, &app]() mutable {
+            if (bm.isShutdown())
+            {
+                throw std::runtime_error(
+                    "Bucket merge not started due to BucketManager shutdown");
+            }
             auto timeScope = timer.TimeScope();
             CLOG_TRACE(Bucket, "Worker merging curr={} with snap={}",
                        hexAbbrev(curr->getHash()), hexAbbrev(snap->getHash()));
@@ -358,11 +363,17 @@ FutureBucket::startMerge(Application& app, uint32_t maxProtocolVersion,
                 ZoneNamedN(mergeZone, "Merge task", true);
                 ZoneValueV(mergeZone, static_cast<int64_t>(level));
 
+                size_t partitions = 1;
+                if (curr->getSize() + snap->getSize() >=
+                    Bucket::MIN_PARTITIONED_MERGE_BYTES)
+                {
+                    partitions = app.getConfig().BUCKET_MERGE_PARTITIONS;
+                }
                 auto res = Bucket::merge(
                     bm, maxProtocolVersion, curr, snap, shadows,
                     BucketList::keepDeadEntries(level), countMergeEvents,
                     app.getClock().getIOContext(),
-                    !app.getConfig().DISABLE_XDR_FSYNC);
+                    !app.getConfig().DISABLE_XDR_FSYNC, partitions);
 
                 if (res)
                 {
@@ -395,8 +406,8 @@ FutureBucket::startMerge(Application& app, uint32_t maxProtocolVersion,
 
     mOutputBucketFuture = task->get_future().share();
     bm.putMergeFuture(mk, mOutputBucketFuture);
-    app.postOnBackgroundThread(bind(&task_t::operator(), task),
-                               "FutureBucket: merge");
+    bm.scheduleMerge(level, curr->getSize() + snap->getSize(),
+                     bind(&task_t::operator(), task));
     checkState();
 }
 
@@ -28,6 +28,9 @@
 #include "xdrpp/autocheck.h"
 
 #include <deque>
+#include <map>
+#include <optional>
+#include <set>
 #include <sstream>
 
 using namespace stellar;
@@ -401,6 +404,101 @@ TEST_CASE("bucket tombstones mutually-annihilate init entries",
     });
 }
 
+TEST_CASE("bucket list loadKeys returns newest versions",
+          "[bucket][bucketlist][bucketlistdb]")
+{
+    VirtualClock clock;
+    Config cfg(getTestConfig());
+    cfg.EXPERIMENTAL_BUCKETLIST_DB = true;
+
+    for_versions_with_differing_bucket_logic(cfg, [&](Config const& cfg) {
+        Application::pointer app = createTestApplication(clock, cfg);
+        BucketList bl;
+        auto vers = getAppLedgerVersion(app);
+        autocheck::generator<bool> flip;
+        std::deque<LedgerEntry> entriesToModify;
+        std::map<LedgerKey, std::optional<LedgerEntry>, LedgerEntryIdCmp>
+            expected;
+        for (uint32_t i = 1; i < 256; ++i)
+        {
+            std::vector<LedgerEntry> initEntries;
+            std::vector<LedgerEntry> liveEntries;
+            std::vector<LedgerKey> deadEntries;
+            for (auto const& e : LedgerTestUtils::generateValidLedgerEntries(16))
+            {
+                auto key = LedgerEntryKey(e);
+                if (expected.find(key) == expected.end())
+                {
+                    initEntries.push_back(e);
+                    entriesToModify.push_back(e);
+                    expected[key] = e;
+                }
+            }
+            while (entriesToModify.size() > 200)
+            {
+                LedgerEntry e = entriesToModify.front();
+                entriesToModify.pop_front();
+                if (flip())
+                {
+                    LedgerTestUtils::randomlyModifyEntry(e);
+                    liveEntries.push_back(e);
+                    entriesToModify.push_back(e);
+                    expected[LedgerEntryKey(e)] = e;
+                }
+                else
+                {
+                    deadEntries.push_back(LedgerEntryKey(e));
+                    expected[LedgerEntryKey(e)] = std::nullopt;
+                }
+            }
+            bl.addBatch(*app, i, vers, initEntries, liveEntries, deadEntries);
+            app->getClock().crank(false);
+            for (uint32_t k = 0u; k < BucketList::kNumLevels; ++k)
+            {
+                auto& next = bl.getLevel(k).getNext();
+                if (next.isLive())
+                {
+                    next.resolve();
+                }
+            }
+        }
+
+        for (uint32_t k = 0u; k < BucketList::kNumLevels; ++k)
+        {
+            auto const& lev = bl.getLevel(k);
+            for (auto const& b : {lev.getCurr(), lev.getSnap()})
+            {
+                REQUIRE((b->getFilename().empty() || b->isIndexed()));
+            }
+        }
+
+        std::set<LedgerKey, LedgerEntryIdCmp> keys;
+        for (auto const& kv : expected)
+        {
+            keys.insert(kv.first);
+        }
+        auto loaded = bl.loadKeys(keys);
+        std::map<LedgerKey, LedgerEntry, LedgerEntryIdCmp> loadedByKey;
+        for (auto const& e : loaded)
+        {
+            REQUIRE(loadedByKey.emplace(LedgerEntryKey(e), e).second);
+        }
+        for (auto const& kv : expected)
+        {
+            auto iter = loadedByKey.find(kv.first);
+            if (kv.second)
+            {
+                REQUIRE(iter != loadedByKey.end());
+                REQUIRE(iter->second == *kv.second);
+            }
+            else
+            {
+                REQUIRE(iter == loadedByKey.end());
+            }
+        }
+    });
+}
+
 TEST_CASE("single entry bubbling up", "[bucket][bucketlist][bucketbubble]")
 {
     VirtualClock clock;
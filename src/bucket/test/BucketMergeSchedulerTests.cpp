@@ -0,0 +1,147 @@
+// Copyright 2022 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include "bucket/BucketMergeScheduler.h"
+#include "lib/catch.hpp"
+#include "main/Application.h"
+#include "test/TestUtils.h"
+#include "test/test.h"
+
+#include <atomic>
+#include <future>
+#include <mutex>
+#include <thread>
+
+using namespace stellar;
+
+TEST_CASE("bucket merge scheduler", "[bucket][bucketmergescheduler]")
+{
+    Config cfg(getTestConfig());
+    cfg.WORKER_THREADS = 4;
+    VirtualClock clock;
+    Application::pointer app = createTestApplication(clock, cfg);
+
+    std::mutex mutex;
+    std::vector<uint32_t> started;
+    std::promise<void> release;
+    std::shared_future<void> released = release.get_future().share();
+    std::atomic<size_t> finished{0};
+
+    // Each merge records that it started, then blocks until released.
+    auto makeMerge = [&](uint32_t level) -> std::function<void()> {
+        return [&, level]() {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                started.emplace_back(level);
+            }
+            released.wait();
+            ++finished;
+        };
+    };
+    auto waitFor = [](std::function<bool()> pred) {
+        for (int i = 0; i < 1000 && !pred(); ++i)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        REQUIRE(pred());
+    };
+    auto numStarted = [&]() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return started.size();
+    };
+
+    SECTION("concurrency cap")
+    {
+        BucketMergeScheduler sched(*app, 2, 0);
+        sched.schedule(9, 100, makeMerge(9));
+        sched.schedule(7, 100, makeMerge(7));
+        sched.schedule(8, 100, makeMerge(8));
+        sched.schedule(5, 100, makeMerge(5));
+        waitFor([&]() { return numStarted() == 2; });
+        REQUIRE(sched.getRunningMergeCount() == 2);
+        REQUIRE(sched.getQueuedMergeCount() == 2);
+
+        // Queued merges are started shallowest level first.
+        auto progress = sched.getProgress();
+        REQUIRE(progress.find("level 9 merging") != std::string::npos);
+        REQUIRE(progress.find("level 7 merging") != std::string::npos);
+        REQUIRE(progress.find("level 5 queued") <
+                progress.find("level 8 queued"));
+
+        release.set_value();
+        waitFor([&]() { return finished == 4; });
+        waitFor([&]() { return sched.getRunningMergeCount() == 0; });
+        REQUIRE(sched.getQueuedMergeCount() == 0);
+        REQUIRE(sched.getProgress().empty());
+    }
+
+    SECTION("shallow levels are never queued")
+    {
+        BucketMergeScheduler sched(*app, 1, 0);
+        sched.schedule(6, 100, makeMerge(6));
+        sched.schedule(0, 100, makeMerge(0));
+        sched.schedule(BucketMergeScheduler::UNSCHEDULED_LEVELS - 1, 100,
+                       makeMerge(BucketMergeScheduler::UNSCHEDULED_LEVELS - 1));
+        waitFor([&]() { return numStarted() == 3; });
+        REQUIRE(sched.getRunningMergeCount() == 1);
+        REQUIRE(sched.getQueuedMergeCount() == 0);
+
+        release.set_value();
+        waitFor([&]() { return finished == 3; });
+        waitFor([&]() { return sched.getRunningMergeCount() == 0; });
+    }
+
+    SECTION("memory budget")
+    {
+        BucketMergeScheduler sched(*app, 0, 1000);
+        sched.schedule(5, 600, makeMerge(5));
+        sched.schedule(6, 600, makeMerge(6));
+        waitFor([&]() { return numStarted() == 1; });
+        REQUIRE(sched.getRunningMergeCount() == 1);
+        REQUIRE(sched.getQueuedMergeCount() == 1);
+
+        release.set_value();
+        waitFor([&]() { return finished == 2; });
+
+        // A merge bigger than the whole budget still runs when it's alone.
+        sched.schedule(7, 5000, makeMerge(7));
+        waitFor([&]() { return finished == 3; });
+        waitFor([&]() { return sched.getRunningMergeCount() == 0; });
+        REQUIRE(sched.getQueuedMergeCount() == 0);
+    }
+
+    SECTION("shutdown runs queued merges")
+    {
+        BucketMergeScheduler sched(*app, 1, 0);
+        sched.schedule(5, 100, makeMerge(5));
+        waitFor([&]() { return numStarted() == 1; });
+        bool ranQueued = false;
+        sched.schedule(6, 100, [&]() { ranQueued = true; });
+        REQUIRE(sched.getQueuedMergeCount() == 1);
+
+        sched.shutdown();
+        REQUIRE(ranQueued);
+        REQUIRE(sched.getQueuedMergeCount() == 0);
+
+        // Deep merges scheduled after shutdown run right away.
+        bool ranLater = false;
+        sched.schedule(7, 100, [&]() { ranLater = true; });
+        REQUIRE(ranLater);
+
+        release.set_value();
+        waitFor([&]() { return finished == 1; });
+        waitFor([&]() { return sched.getRunningMergeCount() == 0; });
+    }
+
+    SECTION("merges outlive the scheduler")
+    {
+        {
+            BucketMergeScheduler sched(*app, 1, 0);
+            sched.schedule(5, 100, makeMerge(5));
+            waitFor([&]() { return numStarted() == 1; });
+        }
+        release.set_value();
+        waitFor([&]() { return finished == 1; });
+    }
+}
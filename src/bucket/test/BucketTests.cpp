@@ -16,6 +16,7 @@
 #include "bucket/BucketInputIterator.h"
 #include "bucket/BucketManager.h"
 #include "bucket/BucketOutputIterator.h"
+#include "bucket/BucketWritePipeline.h"
 #include "ledger/LedgerTxn.h"
 #include "ledger/test/LedgerTestUtils.h"
 #include "lib/catch.hpp"
@@ -27,8 +28,13 @@
 #include "util/Logging.h"
 #include "util/Math.h"
 #include "util/Timer.h"
+#include "util/TmpDir.h"
 #include "xdrpp/autocheck.h"
 
+#include <chrono>
+#include <optional>
+#include <set>
+
 using namespace stellar;
 
 namespace BucketTests
@@ -477,6 +483,158 @@ TEST_CASE("merges refuse to exceed max protocol version",
                       std::runtime_error);
 }
 
+TEST_CASE("merges split into key ranges match serial merges",
+          "[bucket][bucketmerge]")
+{
+    VirtualClock clock;
+    Config const& cfg = getTestConfig();
+    for_versions_with_differing_bucket_logic(cfg, [&](Config const& cfg) {
+        // Indexed buckets are split at page boundaries, others at sampled
+        // offsets.
+        for (bool useIndex : {false, true})
+        {
+            Config c(cfg);
+            c.EXPERIMENTAL_BUCKETLIST_DB = useIndex;
+            Application::pointer app = createTestApplication(clock, c);
+            auto& bm = app->getBucketManager();
+            auto vers = getAppLedgerVersion(app);
+
+            std::set<LedgerKey, LedgerEntryIdCmp> seen;
+            auto uniqueEntries = [&](size_t n) {
+                std::vector<LedgerEntry> res;
+                for (auto const& e :
+                     LedgerTestUtils::generateValidLedgerEntries(n))
+                {
+                    if (seen.emplace(LedgerEntryKey(e)).second)
+                    {
+                        res.emplace_back(e);
+                    }
+                }
+                return res;
+            };
+            auto makeBucket = [&](std::vector<LedgerEntry> const& init,
+                                  std::vector<LedgerEntry> const& live,
+                                  std::vector<LedgerKey> const& dead) {
+                return Bucket::fresh(bm, vers, init, live, dead,
+                                     /*countMergeEvents=*/true,
+                                     clock.getIOContext(),
+                                     /*doFsync=*/false);
+            };
+
+            for (int round = 0; round < 3; ++round)
+            {
+                // The new bucket updates and deletes entries of the old one
+                // (both created and updated ones) and creates new entries,
+                // so every range sees every legal pair of lifecycle states.
+                seen.clear();
+                auto oldInit = uniqueEntries(1000);
+                auto oldLive = uniqueEntries(3000);
+                auto newInit = uniqueEntries(1000);
+                std::vector<LedgerEntry> newLive;
+                std::vector<LedgerKey> newDead;
+                std::vector<LedgerEntry> shadowLive;
+                for (auto const* olds : {&oldInit, &oldLive})
+                {
+                    for (size_t i = 0; i < olds->size(); ++i)
+                    {
+                        auto e = (*olds)[i];
+                        if (i % 3 == 0)
+                        {
+                            ++e.lastModifiedLedgerSeq;
+                            newLive.emplace_back(e);
+                        }
+                        else if (i % 3 == 1)
+                        {
+                            newDead.emplace_back(LedgerEntryKey(e));
+                        }
+                        else if (i % 5 == 0)
+                        {
+                            shadowLive.emplace_back(e);
+                        }
+                    }
+                }
+                auto oldBucket = makeBucket(oldInit, oldLive, {});
+                auto newBucket = makeBucket(newInit, newLive, newDead);
+                std::vector<std::shared_ptr<Bucket>> shadows;
+                if (vers < Bucket::FIRST_PROTOCOL_SHADOWS_REMOVED)
+                {
+                    shadows.emplace_back(makeBucket({}, shadowLive, {}));
+                }
+
+                for (bool keepDeadEntries : {true, false})
+                {
+                    auto serial = Bucket::merge(
+                        bm, vers, oldBucket, newBucket, shadows,
+                        keepDeadEntries, /*countMergeEvents=*/true,
+                        clock.getIOContext(), /*doFsync=*/false);
+                    for (size_t partitions : {2, 3, 8, 1000})
+                    {
+                        auto split = Bucket::merge(
+                            bm, vers, oldBucket, newBucket, shadows,
+                            keepDeadEntries, /*countMergeEvents=*/true,
+                            clock.getIOContext(), /*doFsync=*/false,
+                            partitions);
+                        REQUIRE(split->getHash() == serial->getHash());
+                    }
+                }
+            }
+        }
+    });
+}
+
+TEST_CASE("bucket write pipeline hashes what it writes", "[bucket]")
+{
+    VirtualClock clock;
+    Config cfg(getTestConfig());
+    Application::pointer app = createTestApplication(clock, cfg);
+    auto tmpDir = app->getTmpDirManager().tmpDir("bucket-write-pipeline");
+    std::string filename = tmpDir.getName() + "/pipeline.xdr";
+
+    // A small file is hashed and written by `finish` itself, a large one by
+    // the stage threads.
+    for (size_t n : {10, 5000})
+    {
+        auto entries = Bucket::convertToBucketEntry(
+            false, {}, LedgerTestUtils::generateValidLedgerEntries(n), {});
+        Hash hash;
+        size_t bytes;
+        {
+            BucketWritePipeline out(filename, clock.getIOContext(),
+                                    /*doFsync=*/true);
+            for (auto const& e : entries)
+            {
+                out.writeOne(e);
+            }
+            hash = out.finish();
+            bytes = out.getBytesWritten();
+        }
+        REQUIRE(fs::size(filename) == bytes);
+        if (n > 10)
+        {
+            REQUIRE(bytes > BucketWritePipeline::CHUNK_SIZE);
+        }
+
+        SHA256 hasher;
+        {
+            fs::MappedFile f(filename);
+            hasher.add(ByteSlice(f.data(), f.size()));
+        }
+        REQUIRE(hasher.finish() == hash);
+
+        XDRInputFileStream in;
+        in.open(filename);
+        BucketEntry be;
+        size_t i = 0;
+        while (in.readOne(be))
+        {
+            REQUIRE(be == entries.at(i++));
+        }
+        REQUIRE(i == entries.size());
+        in.close();
+        std::remove(filename.c_str());
+    }
+}
+
 TEST_CASE("bucket output iterator rejects wrong-version entries",
           "[bucket][bucketinitoutput]")
 {
@@ -1040,3 +1198,97 @@ TEST_CASE("bucket apply bench", "[bucketbench][!hide]")
     }
 #endif
 }
+
+TEST_CASE("bucket read bench", "[bucketbench][!hide]")
+{
+    VirtualClock clock;
+    Config cfg(getTestConfig());
+    Application::pointer app = createTestApplication(clock, cfg);
+    auto vers = getAppLedgerVersion(app);
+
+    std::vector<LedgerEntry> live =
+        LedgerTestUtils::generateValidLedgerEntries(500000);
+    std::shared_ptr<Bucket> big = Bucket::fresh(
+        app->getBucketManager(), vers, {}, live, {},
+        /*countMergeEvents=*/true, clock.getIOContext(), /*doFsync=*/false);
+    auto sz = static_cast<size_t>(fileSize(big->getFilename()));
+
+    auto logThroughput = [&](std::string const& what, auto start) {
+        auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - start);
+        CLOG_INFO(Bucket, "{}: {} bytes in {}ms ({} MB/s)", what, sz,
+                  elapsed.count(),
+                  elapsed.count() == 0 ? 0 : (sz / 1000) / elapsed.count());
+    };
+
+    for (int i = 0; i < 5; ++i)
+    {
+        for (bool useMmap : {false, true})
+        {
+            auto start = std::chrono::steady_clock::now();
+            XDRInputFileStream in;
+            in.open(big->getFilename(), useMmap);
+            BucketEntry be;
+            size_t n = 0;
+            while (in.readOne(be))
+            {
+                ++n;
+            }
+            REQUIRE(n == live.size() + 1 /* METAENTRY */);
+            logThroughput(useMmap ? "mmap read" : "ifstream read", start);
+        }
+
+        // Merges read both inputs through (mmap-backed) BucketInputIterators.
+        std::vector<LedgerEntry> small =
+            LedgerTestUtils::generateValidLedgerEntries(1000);
+        auto start = std::chrono::steady_clock::now();
+        Bucket::merge(
+            app->getBucketManager(), vers, big,
+            Bucket::fresh(app->getBucketManager(), vers, {}, small, {},
+                          /*countMergeEvents=*/true, clock.getIOContext(),
+                          /*doFsync=*/false),
+            /*shadows=*/{}, /*keepDeadEntries=*/true,
+            /*countMergeEvents=*/true, clock.getIOContext(),
+            /*doFsync=*/false);
+        logThroughput("merge", start);
+    }
+}
+
+TEST_CASE("bucket merge partition bench", "[bucketbench][!hide]")
+{
+    VirtualClock clock;
+    Config cfg(getTestConfig());
+    Application::pointer app = createTestApplication(clock, cfg);
+    auto& bm = app->getBucketManager();
+    auto vers = getAppLedgerVersion(app);
+
+    auto makeBucket = [&](size_t n) {
+        return Bucket::fresh(bm, vers, {},
+                             LedgerTestUtils::generateValidLedgerEntries(n), {},
+                             /*countMergeEvents=*/true, clock.getIOContext(),
+                             /*doFsync=*/false);
+    };
+    auto oldBucket = makeBucket(500000);
+    auto newBucket = makeBucket(100000);
+
+    std::optional<Hash> expected;
+    for (size_t partitions : {1, 2, 4, 8})
+    {
+        auto start = std::chrono::steady_clock::now();
+        auto merged = Bucket::merge(bm, vers, oldBucket, newBucket,
+                                    /*shadows=*/{}, /*keepDeadEntries=*/true,
+                                    /*countMergeEvents=*/true,
+                                    clock.getIOContext(), /*doFsync=*/false,
+                                    partitions);
+        auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - start);
+        CLOG_INFO(Bucket, "merge of {} + {} bytes in {} ranges: {}ms",
+                  oldBucket->getSize(), newBucket->getSize(), partitions,
+                  elapsed.count());
+        if (!expected)
+        {
+            expected = merged->getHash();
+        }
+        REQUIRE(merged->getHash() == *expected);
+    }
+}
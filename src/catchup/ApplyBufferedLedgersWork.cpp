@@ -80,9 +80,15 @@ ApplyBufferedLedgersWork::onRun()
 std::string
 ApplyBufferedLedgersWork::getStatus() const
 {
-    return fmt::format(FMT_STRING("Applying buffered ledgers: {}"),
-                       mConditionalWork ? mConditionalWork->getStatus()
-                                        : BasicWork::getStatus());
+    auto status = fmt::format(FMT_STRING("Applying buffered ledgers: {}"),
+                              mConditionalWork ? mConditionalWork->getStatus()
+                                               : BasicWork::getStatus());
+    auto merges = mApp.getBucketManager().getMergeProgress();
+    if (!merges.empty())
+    {
+        status += fmt::format(FMT_STRING(", bucket merges: {}"), merges);
+    }
+    return status;
 }
 
 void
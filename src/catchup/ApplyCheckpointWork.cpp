@@ -59,6 +59,13 @@ ApplyCheckpointWork::getStatus() const
     if (getState() == State::WORK_RUNNING)
     {
         auto lcl = mApp.getLedgerManager().getLastClosedLedgerNum();
+        auto merges = mApp.getBucketManager().getMergeProgress();
+        if (!merges.empty())
+        {
+            return fmt::format(
+                FMT_STRING("Last applied ledger: {:d}, bucket merges: {}"),
+                lcl, merges);
+        }
         return fmt::format(FMT_STRING("Last applied ledger: {:d}"), lcl);
     }
     return BasicWork::getStatus();
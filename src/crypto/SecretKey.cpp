@@ -16,10 +16,14 @@
 #include "util/HashOfHash.h"
 #include "util/Math.h"
 #include "util/RandomEvictionCache.h"
+#include "util/UnorderedMap.h"
 #include <Tracy.hpp>
+#include <algorithm>
+#include <array>
 #include <chrono>
 #include <memory>
 #include <mutex>
+#include <optional>
 #include <sodium.h>
 #include <type_traits>
 
@@ -36,11 +40,37 @@ namespace stellar
 // to the state of the process; caching its results centrally
 // makes all signature-verification in the program faster and
 // has no effect on correctness.
+//
+// It is called from the main thread, the overlay and the worker threads, so
+// it is split into independently-locked shards (selected by the leading bits
+// of the cache key, which is a uniformly distributed BLAKE2 hash) to keep
+// concurrent verifiers from serializing on a single lock.
+
+static size_t const VERIFY_SIG_CACHE_DEFAULT_SIZE = 0xffff;
+
+struct VerifySigCacheShard
+{
+    std::mutex mMutex;
+    std::unique_ptr<RandomEvictionCache<Hash, bool>> mCache{
+        std::make_unique<RandomEvictionCache<Hash, bool>>(
+            VERIFY_SIG_CACHE_DEFAULT_SIZE /
+            PubKeyUtils::VERIFY_SIG_CACHE_SHARDS)};
+    uint64_t mHits{0};
+    uint64_t mMisses{0};
+};
+
+static std::array<VerifySigCacheShard, PubKeyUtils::VERIFY_SIG_CACHE_SHARDS>
+    gVerifySigCache;
 
-static std::mutex gVerifySigCacheMutex;
-static RandomEvictionCache<Hash, bool> gVerifySigCache(0xffff);
-static uint64_t gVerifyCacheHit = 0;
-static uint64_t gVerifyCacheMiss = 0;
+static_assert((PubKeyUtils::VERIFY_SIG_CACHE_SHARDS &
+               (PubKeyUtils::VERIFY_SIG_CACHE_SHARDS - 1)) == 0,
+              "shard count must be a power of two");
+
+static size_t
+verifySigCacheShard(Hash const& cacheKey)
+{
+    return cacheKey[0] & (PubKeyUtils::VERIFY_SIG_CACHE_SHARDS - 1);
+}
 
 static Hash
 verifySigCacheKey(PublicKey const& key, Signature const& signature,
@@ -228,6 +258,44 @@ SecretKey::benchmarkOpsPerSecond(size_t& sign, size_t& verify,
         1000000 / std::max(size_t(1), size_t(verifyUsec.count() / iterations));
 }
 
+void
+SecretKey::benchmarkBatchVerifyOpsPerSecond(size_t& verify, size_t iterations,
+                                            size_t batchSize)
+{
+    namespace ch = std::chrono;
+    using clock = ch::high_resolution_clock;
+    using usec = ch::microseconds;
+
+    releaseAssert(batchSize > 0);
+    std::vector<PubKeyUtils::SignatureToVerify> items;
+    items.reserve(iterations);
+    for (size_t i = 0; i < iterations; ++i)
+    {
+        auto key = SecretKey::random();
+        Hash hash;
+        randombytes_buf(hash.data(), hash.size());
+        items.push_back({key.getPublicKey(), key.sign(hash), hash});
+    }
+
+    std::vector<PubKeyUtils::SignatureToVerify> batch;
+    batch.reserve(batchSize);
+    auto verifyStart = clock::now();
+    for (size_t i = 0; i < items.size(); i += batchSize)
+    {
+        auto end = std::min(items.size(), i + batchSize);
+        batch.assign(items.begin() + i, items.begin() + end);
+        if (!PubKeyUtils::verifySigBatch(batch))
+        {
+            throw std::runtime_error("batch verify failed");
+        }
+    }
+    auto verifyEnd = clock::now();
+
+    auto verifyUsec = ch::duration_cast<usec>(verifyEnd - verifyStart);
+    verify =
+        1000000 / std::max(size_t(1), size_t(verifyUsec.count() / iterations));
+}
+
 #ifdef BUILD_TESTS
 static std::vector<uint8_t>
 getPRNGBytes(size_t n, stellar_default_random_engine& engine)
@@ -310,18 +378,54 @@ SecretKey::fromStrKeySeed(std::string const& strKeySeed)
 void
 PubKeyUtils::clearVerifySigCache()
 {
-    std::lock_guard<std::mutex> guard(gVerifySigCacheMutex);
-    gVerifySigCache.clear();
+    for (auto& shard : gVerifySigCache)
+    {
+        std::lock_guard<std::mutex> guard(shard.mMutex);
+        shard.mCache->clear();
+    }
+}
+
+void
+PubKeyUtils::setVerifySigCacheSize(size_t size)
+{
+    auto shardSize = std::max<size_t>(1, size / VERIFY_SIG_CACHE_SHARDS);
+    for (auto& shard : gVerifySigCache)
+    {
+        std::lock_guard<std::mutex> guard(shard.mMutex);
+        if (shard.mCache->maxSize() != shardSize)
+        {
+            shard.mCache =
+                std::make_unique<RandomEvictionCache<Hash, bool>>(shardSize);
+        }
+    }
 }
 
 void
 PubKeyUtils::flushVerifySigCacheCounts(uint64_t& hits, uint64_t& misses)
 {
-    std::lock_guard<std::mutex> guard(gVerifySigCacheMutex);
-    hits = gVerifyCacheHit;
-    misses = gVerifyCacheMiss;
-    gVerifyCacheHit = 0;
-    gVerifyCacheMiss = 0;
+    std::vector<VerifySigCacheCounts> shardCounts;
+    flushVerifySigCacheCounts(shardCounts);
+    hits = 0;
+    misses = 0;
+    for (auto const& c : shardCounts)
+    {
+        hits += c.mHits;
+        misses += c.mMisses;
+    }
+}
+
+void
+PubKeyUtils::flushVerifySigCacheCounts(
+    std::vector<VerifySigCacheCounts>& shardCounts)
+{
+    shardCounts.clear();
+    for (auto& shard : gVerifySigCache)
+    {
+        std::lock_guard<std::mutex> guard(shard.mMutex);
+        shardCounts.push_back({shard.mHits, shard.mMisses});
+        shard.mHits = 0;
+        shard.mMisses = 0;
+    }
 }
 
 std::string
@@ -403,15 +507,16 @@ PubKeyUtils::verifySig(PublicKey const& key, Signature const& signature,
     }
 
     auto cacheKey = verifySigCacheKey(key, signature, bin);
+    auto& shard = gVerifySigCache[verifySigCacheShard(cacheKey)];
 
     {
-        std::lock_guard<std::mutex> guard(gVerifySigCacheMutex);
-        if (gVerifySigCache.exists(cacheKey))
+        std::lock_guard<std::mutex> guard(shard.mMutex);
+        if (shard.mCache->exists(cacheKey))
         {
-            ++gVerifyCacheHit;
+            ++shard.mHits;
             std::string hitStr("hit");
             ZoneText(hitStr.c_str(), hitStr.size());
-            return gVerifySigCache.get(cacheKey);
+            return shard.mCache->get(cacheKey);
         }
     }
 
@@ -420,12 +525,112 @@ PubKeyUtils::verifySig(PublicKey const& key, Signature const& signature,
     bool ok =
         (crypto_sign_verify_detached(signature.data(), bin.data(), bin.size(),
                                      key.ed25519().data()) == 0);
-    std::lock_guard<std::mutex> guard(gVerifySigCacheMutex);
-    ++gVerifyCacheMiss;
-    gVerifySigCache.put(cacheKey, ok);
+    std::lock_guard<std::mutex> guard(shard.mMutex);
+    ++shard.mMisses;
+    shard.mCache->put(cacheKey, ok);
     return ok;
 }
 
+bool
+PubKeyUtils::verifySigBatch(std::vector<SignatureToVerify> const& items,
+                            std::vector<bool>& results)
+{
+    ZoneScoped;
+    results.assign(items.size(), false);
+
+    // Cache keys of the items that still need an answer, indexed like items;
+    // items with a malformed signature are answered (negatively) right away.
+    std::vector<std::optional<Hash>> cacheKeys(items.size());
+    for (size_t i = 0; i < items.size(); ++i)
+    {
+        auto const& item = items[i];
+        releaseAssert(item.key.type() == PUBLIC_KEY_TYPE_ED25519);
+        if (item.signature.size() == 64)
+        {
+            cacheKeys[i] =
+                verifySigCacheKey(item.key, item.signature, item.hash);
+        }
+    }
+
+    // Group the items by shard so each shard is locked at most once.
+    std::array<std::vector<size_t>, VERIFY_SIG_CACHE_SHARDS> byShard;
+    for (size_t i = 0; i < items.size(); ++i)
+    {
+        if (cacheKeys[i])
+        {
+            byShard[verifySigCacheShard(*cacheKeys[i])].push_back(i);
+        }
+    }
+    for (size_t s = 0; s < VERIFY_SIG_CACHE_SHARDS; ++s)
+    {
+        if (byShard[s].empty())
+        {
+            continue;
+        }
+        auto& shard = gVerifySigCache[s];
+        std::lock_guard<std::mutex> guard(shard.mMutex);
+        for (auto i : byShard[s])
+        {
+            if (shard.mCache->exists(*cacheKeys[i]))
+            {
+                ++shard.mHits;
+                results[i] = shard.mCache->get(*cacheKeys[i]);
+                cacheKeys[i].reset();
+            }
+        }
+    }
+
+    UnorderedMap<Hash, bool> verified;
+    for (size_t i = 0; i < items.size(); ++i)
+    {
+        if (!cacheKeys[i])
+        {
+            continue;
+        }
+        auto it = verified.find(*cacheKeys[i]);
+        if (it == verified.end())
+        {
+            auto const& item = items[i];
+            bool ok = (crypto_sign_verify_detached(
+                           item.signature.data(), item.hash.data(),
+                           item.hash.size(), item.key.ed25519().data()) == 0);
+            it = verified.emplace(*cacheKeys[i], ok).first;
+        }
+        results[i] = it->second;
+    }
+
+    std::array<std::vector<std::pair<Hash, bool>>, VERIFY_SIG_CACHE_SHARDS>
+        newByShard;
+    for (auto const& kv : verified)
+    {
+        newByShard[verifySigCacheShard(kv.first)].emplace_back(kv);
+    }
+    for (size_t s = 0; s < VERIFY_SIG_CACHE_SHARDS; ++s)
+    {
+        if (newByShard[s].empty())
+        {
+            continue;
+        }
+        auto& shard = gVerifySigCache[s];
+        std::lock_guard<std::mutex> guard(shard.mMutex);
+        shard.mMisses += newByShard[s].size();
+        for (auto const& kv : newByShard[s])
+        {
+            shard.mCache->put(kv.first, kv.second);
+        }
+    }
+
+    return std::all_of(results.begin(), results.end(),
+                       [](bool ok) { return ok; });
+}
+
+bool
+PubKeyUtils::verifySigBatch(std::vector<SignatureToVerify> const& items)
+{
+    std::vector<bool> results;
+    return verifySigBatch(items, results);
+}
+
 PublicKey
 PubKeyUtils::random()
 {
@@ -11,6 +11,7 @@
 #include <array>
 #include <functional>
 #include <ostream>
+#include <vector>
 
 namespace stellar
 {
@@ -63,6 +64,12 @@ class SecretKey
                                       size_t iterations,
                                       size_t cachedVerifyPasses = 1);
 
+    // Measure the speed of verify ops issued through
+    // PubKeyUtils::verifySigBatch in batches of `batchSize`.
+    static void benchmarkBatchVerifyOpsPerSecond(size_t& verify,
+                                                 size_t iterations,
+                                                 size_t batchSize);
+
 #ifdef BUILD_TESTS
     // Create a new, pseudo-random secret key drawn from the global weak
     // non-cryptographic PRNG (which itself is seeded from command-line or
@@ -130,12 +137,45 @@ template <> struct KeyFunctions<PublicKey>
 // public key utility functions
 namespace PubKeyUtils
 {
+// A pending signature verification. All fields are held by value so that the
+// verification can be carried out on a thread other than the one that
+// assembled it.
+struct SignatureToVerify
+{
+    PublicKey key;
+    Signature signature;
+    Hash hash;
+};
+
 // Return true iff `signature` is valid for `bin` under `key`.
 bool verifySig(PublicKey const& key, Signature const& signature,
                ByteSlice const& bin);
 
+// Verify a batch of signatures, writing the outcome for `items[i]` into
+// `results[i]`; returns true iff every signature in the batch is valid.
+// Results are identical to calling verifySig on each item, but each cache
+// shard is locked at most once for lookups and once for updates, and items
+// repeated within the batch are only verified once.
+bool verifySigBatch(std::vector<SignatureToVerify> const& items,
+                    std::vector<bool>& results);
+bool verifySigBatch(std::vector<SignatureToVerify> const& items);
+
+// Number of independently-locked shards the verification cache is split into.
+size_t constexpr VERIFY_SIG_CACHE_SHARDS = 16;
+
+struct VerifySigCacheCounts
+{
+    uint64_t mHits;
+    uint64_t mMisses;
+};
+
 void clearVerifySigCache();
+// Set the total number of entries kept by the verification cache (split
+// evenly across shards). Clears the cache if the size changes.
+void setVerifySigCacheSize(size_t size);
+// Report the hits and misses since the last flush, summed or per shard.
 void flushVerifySigCacheCounts(uint64_t& hits, uint64_t& misses);
+void flushVerifySigCacheCounts(std::vector<VerifySigCacheCounts>& shardCounts);
 
 PublicKey random();
 #ifdef BUILD_TESTS
@@ -19,6 +19,7 @@
 #include <regex>
 #include <sodium.h>
 #include <stdexcept>
+#include <thread>
 
 using namespace stellar;
 
@@ -254,6 +255,20 @@ TEST_CASE("HMAC test vector", "[crypto]")
     REQUIRE(hmacSha256Verify(v, k, s));
 }
 
+TEST_CASE("Stateful HMAC test vector", "[crypto]")
+{
+    HmacSha256Key k;
+    k.key[0] = 'k';
+    k.key[1] = 'e';
+    k.key[2] = 'y';
+    auto h = hexToBin256(
+        "f7bc83f430538424b13298e6aa6fb143ef4d59a14946175997479dbc2d1a3cd8");
+    HmacSha256 hmac(k);
+    hmac.add("The quick brown fox ");
+    hmac.add("jumps over the lazy dog");
+    REQUIRE(h == hmac.finish().mac);
+}
+
 TEST_CASE("HKDF test vector", "[crypto]")
 {
     auto ikm = hexToBin("0b0b0b0b0b0b0b0b0b0b0b0b0b0b0b0b0b0b0b0b0b0b");
@@ -294,6 +309,102 @@ TEST_CASE("sign tests", "[crypto]")
     CHECK(!PubKeyUtils::verifySig(pk, sig, msg));
 }
 
+TEST_CASE("batch verify tests", "[crypto]")
+{
+    PubKeyUtils::clearVerifySigCache();
+    std::vector<PubKeyUtils::SignatureToVerify> items;
+    for (size_t i = 0; i < 8; ++i)
+    {
+        auto sk = SecretKey::random();
+        auto hash = HashUtils::random();
+        items.push_back({sk.getPublicKey(), sk.sign(hash), hash});
+    }
+    // Repeat one item so the batch contains a duplicate.
+    items.push_back(items[3]);
+
+    std::vector<bool> results;
+    REQUIRE(PubKeyUtils::verifySigBatch(items, results));
+    REQUIRE(results == std::vector<bool>(items.size(), true));
+
+    SECTION("bad signature is identified")
+    {
+        items[5].signature[4] ^= 1;
+        REQUIRE(!PubKeyUtils::verifySigBatch(items, results));
+        for (size_t i = 0; i < items.size(); ++i)
+        {
+            REQUIRE(results[i] == (i != 5));
+            REQUIRE(results[i] == PubKeyUtils::verifySig(
+                                      items[i].key, items[i].signature,
+                                      items[i].hash));
+        }
+    }
+
+    SECTION("malformed signature is rejected")
+    {
+        items[2].signature.resize(10);
+        REQUIRE(!PubKeyUtils::verifySigBatch(items, results));
+        REQUIRE(!results[2]);
+        REQUIRE(results[1]);
+    }
+
+    SECTION("empty batch")
+    {
+        items.clear();
+        REQUIRE(PubKeyUtils::verifySigBatch(items, results));
+        REQUIRE(results.empty());
+    }
+}
+
+TEST_CASE("verify cache counts per shard", "[crypto]")
+{
+    std::vector<PubKeyUtils::SignatureToVerify> items;
+    for (size_t i = 0; i < 64; ++i)
+    {
+        auto sk = SecretKey::random();
+        auto hash = HashUtils::random();
+        items.push_back({sk.getPublicKey(), sk.sign(hash), hash});
+    }
+
+    auto verifyAll = [&]() {
+        for (auto const& item : items)
+        {
+            REQUIRE(
+                PubKeyUtils::verifySig(item.key, item.signature, item.hash));
+        }
+    };
+
+    auto checkCounts = [&](uint64_t expectedHits, uint64_t expectedMisses) {
+        std::vector<PubKeyUtils::VerifySigCacheCounts> shardCounts;
+        PubKeyUtils::flushVerifySigCacheCounts(shardCounts);
+        REQUIRE(shardCounts.size() == PubKeyUtils::VERIFY_SIG_CACHE_SHARDS);
+        uint64_t hits = 0, misses = 0;
+        for (auto const& c : shardCounts)
+        {
+            hits += c.mHits;
+            misses += c.mMisses;
+        }
+        REQUIRE(hits == expectedHits);
+        REQUIRE(misses == expectedMisses);
+    };
+
+    PubKeyUtils::clearVerifySigCache();
+    uint64_t ignoredHits, ignoredMisses;
+    PubKeyUtils::flushVerifySigCacheCounts(ignoredHits, ignoredMisses);
+
+    verifyAll();
+    checkCounts(0, items.size());
+    verifyAll();
+    checkCounts(items.size(), 0);
+
+    SECTION("resizing clears the cache")
+    {
+        PubKeyUtils::setVerifySigCacheSize(0xffff * 2);
+        verifyAll();
+        checkCounts(0, items.size());
+        PubKeyUtils::setVerifySigCacheSize(0xffff);
+    }
+}
+
 TEST_CASE("sign and verify benchmarking", "[crypto-bench][bench][!hide]")
 {
     size_t signPerSec = 0, verifyPerSec = 0;
@@ -301,6 +412,67 @@ TEST_CASE("sign and verify benchmarking", "[crypto-bench][bench][!hide]")
     SecretKey::benchmarkOpsPerSecond(signPerSec, verifyPerSec, 10000);
     LOG_INFO(DEFAULT_LOG, "Benchmarked {} signatures / sec", signPerSec);
     LOG_INFO(DEFAULT_LOG, "Benchmarked {} verifications / sec", verifyPerSec);
+
+    for (size_t batchSize : {1, 16, 256})
+    {
+        size_t batchVerifyPerSec = 0;
+        PubKeyUtils::clearVerifySigCache();
+        SecretKey::benchmarkBatchVerifyOpsPerSecond(batchVerifyPerSec, 10000,
+                                                    batchSize);
+        LOG_INFO(DEFAULT_LOG,
+                 "Benchmarked {} batch verifications / sec (batch size {})",
+                 batchVerifyPerSec, batchSize);
+    }
+}
+
+TEST_CASE("verify cache contention benchmarking",
+          "[crypto-bench][bench][!hide]")
+{
+    namespace ch = std::chrono;
+    using clock = ch::high_resolution_clock;
+
+    size_t const numSigs = 1000;
+    size_t const passes = 100;
+    std::vector<PubKeyUtils::SignatureToVerify> items;
+    for (size_t i = 0; i < numSigs; ++i)
+    {
+        auto sk = SecretKey::random();
+        auto hash = HashUtils::random();
+        items.push_back({sk.getPublicKey(), sk.sign(hash), hash});
+    }
+    PubKeyUtils::clearVerifySigCache();
+    REQUIRE(PubKeyUtils::verifySigBatch(items));
+
+    LOG_INFO(DEFAULT_LOG,
+             "Benchmarking verify cache-hits with concurrent verifiers");
+    for (size_t numThreads : {1, 2, 4, 8, 16})
+    {
+        std::vector<std::thread> threads;
+        auto start = clock::now();
+        for (size_t t = 0; t < numThreads; ++t)
+        {
+            threads.emplace_back([&]() {
+                for (size_t pass = 0; pass < passes; ++pass)
+                {
+                    for (auto const& item : items)
+                    {
+                        PubKeyUtils::verifySig(item.key, item.signature,
+                                               item.hash);
+                    }
+                }
+            });
+        }
+        for (auto& t : threads)
+        {
+            t.join();
+        }
+        auto usec = ch::duration_cast<ch::microseconds>(clock::now() - start);
+        auto total = numThreads * passes * numSigs;
+        LOG_INFO(DEFAULT_LOG,
+                 "Benchmarked {} verification cache-hits / sec with {} threads",
+                 total * 1000000 / std::max<size_t>(1, usec.count()),
+                 numThreads);
+    }
 }
 
 TEST_CASE("verify-hit benchmarking", "[crypto-bench][bench][!hide]")
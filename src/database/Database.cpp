@@ -62,7 +62,7 @@ bool Database::gDriversRegistered = false;
 
 // smallest schema version supported
 static unsigned long const MIN_SCHEMA_VERSION = 13;
-static unsigned long const SCHEMA_VERSION = 16;
+static unsigned long const SCHEMA_VERSION = 17;
 
 // These should always match our compiled version precisely, since we are
 // using a bundled version to get access to carray(). But in case someone
@@ -215,6 +215,10 @@ Database::applySchemaUpgrade(unsigned long vers)
     case 16:
         mApp.getPersistentState().setRebuildForType(LIQUIDITY_POOL);
         break;
+    case 17:
+        // trustlines are keyed by binary account and asset columns
+        mApp.getPersistentState().setRebuildForType(TRUSTLINE);
+        break;
     default:
         throw std::runtime_error("Unknown DB schema version");
     }
@@ -285,10 +289,17 @@ Database::getAppSchemaVersion()
     return SCHEMA_VERSION;
 }
 
+void
+Database::recordEntityType(std::string const& entityName)
+{
+    std::lock_guard<std::mutex> lock(mEntityTypesMutex);
+    mEntityTypes.insert(entityName);
+}
+
 medida::TimerContext
 Database::getInsertTimer(std::string const& entityName)
 {
-    mEntityTypes.insert(entityName);
+    recordEntityType(entityName);
     mQueryMeter.Mark();
     return mApp.getMetrics()
         .NewTimer({"database", "insert", entityName})
@@ -298,7 +309,7 @@ Database::getInsertTimer(std::string const& entityName)
 medida::TimerContext
 Database::getSelectTimer(std::string const& entityName)
 {
-    mEntityTypes.insert(entityName);
+    recordEntityType(entityName);
     mQueryMeter.Mark();
     return mApp.getMetrics()
         .NewTimer({"database", "select", entityName})
@@ -308,7 +319,7 @@ Database::getSelectTimer(std::string const& entityName)
 medida::TimerContext
 Database::getDeleteTimer(std::string const& entityName)
 {
-    mEntityTypes.insert(entityName);
+    recordEntityType(entityName);
     mQueryMeter.Mark();
     return mApp.getMetrics()
         .NewTimer({"database", "delete", entityName})
@@ -318,7 +329,7 @@ Database::getDeleteTimer(std::string const& entityName)
 medida::TimerContext
 Database::getUpdateTimer(std::string const& entityName)
 {
-    mEntityTypes.insert(entityName);
+    recordEntityType(entityName);
     mQueryMeter.Mark();
     return mApp.getMetrics()
         .NewTimer({"database", "update", entityName})
@@ -328,7 +339,7 @@ Database::getUpdateTimer(std::string const& entityName)
 medida::TimerContext
 Database::getUpsertTimer(std::string const& entityName)
 {
-    mEntityTypes.insert(entityName);
+    recordEntityType(entityName);
     mQueryMeter.Mark();
     return mApp.getMetrics()
         .NewTimer({"database", "upsert", entityName})
@@ -420,6 +431,22 @@ Database::getSession()
     return mSession;
 }
 
+std::unique_ptr<soci::session>
+Database::openDedicatedSession()
+{
+    auto const& c = mApp.getConfig().DATABASE;
+    if (!canUsePool())
+    {
+        std::string s("Can't open a dedicated session to ");
+        s += removePasswordFromConnectionString(c.value);
+        throw std::runtime_error(s);
+    }
+    auto sess = std::make_unique<soci::session>(c.value);
+    DatabaseConfigureSessionOp op(*sess);
+    stellar::doDatabaseTypeSpecificOperation(*sess, op);
+    return sess;
+}
+
 soci::connection_pool&
 Database::getPool()
 {
@@ -444,6 +471,7 @@ Database::getPool()
             DatabaseConfigureSessionOp op(sess);
             stellar::doDatabaseTypeSpecificOperation(sess, op);
         }
+        mPoolSize = n;
     }
     releaseAssert(mPool);
     return *mPool;
@@ -506,6 +534,21 @@ Database::getPreparedStatement(std::string const& query)
     return sc;
 }
 
+StatementContext
+Database::getPreparedStatement(std::string const& query,
+                               soci::session& session)
+{
+    if (&session == &mSession)
+    {
+        return getPreparedStatement(query);
+    }
+    auto p = std::make_shared<soci::statement>(session);
+    p->alloc();
+    p->prepare(query);
+    StatementContext sc(p);
+    return sc;
+}
+
 std::shared_ptr<SQLLogContext>
 Database::captureAndLogSQL(std::string contextName)
 {
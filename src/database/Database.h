@@ -11,6 +11,7 @@
 #include "util/NonCopyable.h"
 #include "util/Timer.h"
 #include <functional>
+#include <mutex>
 #include <set>
 #include <soci.h>
 #include <string>
@@ -90,15 +91,20 @@ class Database : NonMovableOrCopyable
     medida::Meter& mQueryMeter;
     soci::session mSession;
     std::unique_ptr<soci::connection_pool> mPool;
+    size_t mPoolSize{0};
 
     std::map<std::string, std::shared_ptr<soci::statement>> mStatements;
     medida::Counter& mStatementsSize;
 
+    // The timers below may also be used from the write-behind thread of
+    // LedgerTxnRoot.
+    std::mutex mEntityTypesMutex;
     std::set<std::string> mEntityTypes;
 
     static bool gDriversRegistered;
     static void registerDrivers();
     void applySchemaUpgrade(unsigned long vers);
+    void recordEntityType(std::string const& entityName);
 
   public:
     // Instantiate object and connect to app.getConfig().DATABASE;
@@ -120,6 +126,12 @@ class Database : NonMovableOrCopyable
     // when the statement context is destroyed.
     StatementContext getPreparedStatement(std::string const& query);
 
+    // Like above, but for a statement on the given session. Only statements
+    // on the main connection are cached, those on any other session are
+    // prepared anew on each call.
+    StatementContext getPreparedStatement(std::string const& query,
+                                          soci::session& session);
+
     // Purge all cached prepared statements, closing their handles with the
     // database.
     void clearPreparedStatementCache();
@@ -178,6 +190,19 @@ class Database : NonMovableOrCopyable
     // Access the optional SOCI connection pool available for worker
     // threads. Throws an error if !canUsePool().
     soci::connection_pool& getPool();
+
+    // Opens a new session, set up like the main one, for a thread that keeps
+    // it for its lifetime rather than leasing one from the pool. Throws an
+    // error if !canUsePool().
+    std::unique_ptr<soci::session> openDedicatedSession();
+
+    // Number of sessions in the pool returned by getPool(), 0 until it is
+    // first called.
+    size_t
+    getPoolSize() const
+    {
+        return mPoolSize;
+    }
 };
 
 template <typename T>
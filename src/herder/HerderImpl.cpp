@@ -1060,10 +1060,11 @@ HerderImpl::triggerNextLedger(uint32_t ledgerSeqToTrigger,
         return;
     }
 
-    // our first choice for this round's set is all the tx we have collected
-    // during last few ledger closes
+    // our first choice for this round's set is the best paying of the tx we
+    // have collected during last few ledger closes
     auto const& lcl = mLedgerManager.getLastClosedLedgerHeader();
-    auto proposedSet = mTransactionQueue.toTxSet(lcl);
+    auto const maxOps = mLedgerManager.getLastMaxTxSetSizeOps();
+    auto proposedSet = mTransactionQueue.toSurgePricedTxSet(lcl, maxOps);
 
     // We pick as next close time the current time unless it's before the last
     // close time. We don't know how much time it will take to reach consensus
@@ -1098,6 +1099,15 @@ HerderImpl::triggerNextLedger(uint32_t ledgerSeqToTrigger,
 
     auto removed = proposedSet->trimInvalid(mApp, lowerBoundCloseTimeOffset,
                                             upperBoundCloseTimeOffset);
+    if (!removed.empty())
+    {
+        // invalid transactions left room in the set; once they are banned
+        // (and dropped from the queue), build it again to use that room
+        mTransactionQueue.ban(removed);
+        proposedSet = mTransactionQueue.toSurgePricedTxSet(lcl, maxOps);
+        removed = proposedSet->trimInvalid(mApp, lowerBoundCloseTimeOffset,
+                                           upperBoundCloseTimeOffset);
+    }
     mTransactionQueue.ban(removed);
 
     proposedSet->surgePricingFilter(mApp);
@@ -18,6 +18,7 @@
 #include "util/BitSet.h"
 #include "util/GlobalChecks.h"
 #include "util/HashOfHash.h"
+#include "util/Logging.h"
 #include "util/Math.h"
 #include "util/TarjanSCCCalculator.h"
 #include "util/XDROperators.h"
@@ -33,6 +34,7 @@
 #include <medida/timer.h>
 #include <numeric>
 #include <optional>
+#include <queue>
 #include <random>
 
 namespace stellar
@@ -48,6 +50,8 @@ TransactionQueue::TransactionQueue(Application& app, uint32 pendingDepth,
                                    uint32 banDepth, uint32 poolLedgerMultiplier)
     : mApp(app)
     , mPendingDepth(pendingDepth)
+    , mFeeRateIndex(FeeRateIndexComparator{static_cast<size_t>(
+          rand_uniform<uint64>(0, std::numeric_limits<uint64>::max()))})
     , mBannedTransactions(banDepth)
     , mLedgerVersion(app.getLedgerManager()
                          .getLastClosedLedgerHeader()
@@ -296,6 +300,33 @@ TransactionQueue::releaseFeeMaybeEraseAccountState(TransactionFrameBasePtr tx)
     }
 }
 
+bool
+TransactionQueue::FeeRateIndexComparator::operator()(
+    AccountState const* l, AccountState const* r) const
+{
+    return lessThanXored(l->mTransactions.front().mTx,
+                         r->mTransactions.front().mTx, mSeed);
+}
+
+void
+TransactionQueue::addToFeeRateIndex(AccountState const& as)
+{
+    if (!as.mTransactions.empty())
+    {
+        mFeeRateIndex.emplace(&as);
+    }
+}
+
+void
+TransactionQueue::removeFromFeeRateIndex(AccountState const& as)
+{
+    if (!as.mTransactions.empty())
+    {
+        auto erased = mFeeRateIndex.erase(&as);
+        releaseAssert(erased == 1);
+    }
+}
+
 void
 TransactionQueue::prepareDropTransaction(AccountState& as, TimestampedTx& tstx)
 {
@@ -436,6 +467,10 @@ TransactionQueue::tryAdd(TransactionFrameBasePtr tx)
             mAccountStates.emplace(tx->getSourceID(), AccountState{}).first;
         oldTxIter = stateIter->second.mTransactions.end();
     }
+    else
+    {
+        removeFromFeeRateIndex(stateIter->second);
+    }
 
     if (oldTxIter != stateIter->second.mTransactions.end())
     {
@@ -449,6 +484,7 @@ TransactionQueue::tryAdd(TransactionFrameBasePtr tx)
         oldTxIter = --stateIter->second.mTransactions.end();
         mSizeByAge[stateIter->second.mAge]->inc();
     }
+    addToFeeRateIndex(stateIter->second);
     auto ops = tx->getNumOperations();
     stateIter->second.mQueueSizeOps += ops;
     stateIter->second.mBroadcastQueueOps += ops;
@@ -482,6 +518,7 @@ TransactionQueue::dropTransactions(AccountStates::iterator stateIter,
     // Note prepareDropTransaction may erase other iterators from
     // mAccountStates, but it will not erase stateIter because it has at least
     // one transaction (otherwise we couldn't reach that line).
+    removeFromFeeRateIndex(stateIter->second);
     for (auto iter = begin; iter != end; ++iter)
     {
         prepareDropTransaction(stateIter->second, *iter);
@@ -503,6 +540,10 @@ TransactionQueue::dropTransactions(AccountStates::iterator stateIter,
             stateIter->second.mAge = 0;
         }
     }
+    else
+    {
+        addToFeeRateIndex(stateIter->second);
+    }
 }
 
 void
@@ -511,7 +552,7 @@ TransactionQueue::removeApplied(Transactions const& appliedTxs)
     ZoneScoped;
     // Find the highest sequence number that was applied for each source account
     std::map<AccountID, int64_t> seqByAccount;
-    UnorderedSet<Hash> appliedHashes;
+    FlatSet<Hash> appliedHashes;
     appliedHashes.reserve(appliedTxs.size());
     for (auto const& tx : appliedTxs)
     {
@@ -716,6 +757,7 @@ TransactionQueue::shift()
 
         if (mPendingDepth == it->second.mAge)
         {
+            removeFromFeeRateIndex(it->second);
             for (auto& toBan : it->second.mTransactions)
             {
                 // This never invalidates it because
@@ -765,7 +807,7 @@ TransactionQueue::isBanned(Hash const& hash) const
 {
     return std::any_of(
         std::begin(mBannedTransactions), std::end(mBannedTransactions),
-        [&](UnorderedSet<Hash> const& transactions) {
+        [&](FlatSet<Hash> const& transactions) {
             return transactions.find(hash) != std::end(transactions);
         });
 }
@@ -800,9 +842,90 @@ TransactionQueue::toTxSet(LedgerHeaderHistoryEntry const& lcl) const
     return result;
 }
 
+std::shared_ptr<TxSetFrame>
+TransactionQueue::toSurgePricedTxSet(LedgerHeaderHistoryEntry const& lcl,
+                                     size_t maxOps) const
+{
+    ZoneScoped;
+    auto result = std::make_shared<TxSetFrame>(lcl.hash);
+
+    uint32_t const nextLedgerSeq = lcl.header.ledgerSeq + 1;
+    int64_t const startingSeq = getStartingSequenceNumber(nextLedgerSeq);
+    bool const maxIsOps = lcl.header.ledgerVersion >= 11;
+
+    // Accounts are picked from mFeeRateIndex, highest fee rate first. Once
+    // a transaction of an account is taken, the account competes with its
+    // next transaction from `next` instead, so that only accounts we took
+    // transactions from are ever in the heap.
+    struct Cursor
+    {
+        TimestampedTransactions::const_iterator mCur;
+        AccountState const* mAccountState;
+    };
+    auto const seed = mFeeRateIndex.key_comp().mSeed;
+    auto cursorLess = [seed](Cursor const& l, Cursor const& r) {
+        return lessThanXored(l.mCur->mTx, r.mCur->mTx, seed);
+    };
+    std::priority_queue<Cursor, std::vector<Cursor>, decltype(cursorLess)>
+        next(cursorLess);
+    auto indexIt = mFeeRateIndex.rbegin();
+
+    size_t opsLeft = maxOps;
+    while (opsLeft > 0)
+    {
+        Cursor cur;
+        bool const fromIndex = indexIt != mFeeRateIndex.rend();
+        if (fromIndex)
+        {
+            cur = {(*indexIt)->mTransactions.begin(), *indexIt};
+        }
+        if (!next.empty() && (!fromIndex || cursorLess(cur, next.top())))
+        {
+            cur = next.top();
+            next.pop();
+        }
+        else if (fromIndex)
+        {
+            ++indexIt;
+        }
+        else
+        {
+            break;
+        }
+
+        auto const& tx = cur.mCur->mTx;
+        // Stop at startingSeq like toTxSet does, and at a transaction that
+        // doesn't fit like TxSetFrame::surgePricingFilter does: either way,
+        // the later transactions of the account are left out too.
+        if (tx->getSeqNum() == startingSeq)
+        {
+            continue;
+        }
+        size_t opsCount = maxIsOps ? tx->getNumOperations() : MAX_OPS_PER_TX;
+        if (opsCount > opsLeft)
+        {
+            continue;
+        }
+        result->add(tx);
+        opsLeft -= opsCount;
+        if (++cur.mCur != cur.mAccountState->mTransactions.end())
+        {
+            next.push(cur);
+        }
+    }
+
+    if (indexIt != mFeeRateIndex.rend() || !next.empty())
+    {
+        CLOG_WARNING(Herder, "surge pricing in effect! {} > {}",
+                     mTxQueueLimiter->size(), maxOps);
+    }
+    return result;
+}
+
 void
 TransactionQueue::clearAll()
 {
+    mFeeRateIndex.clear();
     mAccountStates.clear();
     for (auto& b : mBannedTransactions)
     {
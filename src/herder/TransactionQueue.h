@@ -8,6 +8,7 @@
 #include "herder/TxSetFrame.h"
 #include "ledger/LedgerTxn.h"
 #include "transactions/TransactionFrame.h"
+#include "util/FlatMap.h"
 #include "util/HashOfHash.h"
 #include "util/Timer.h"
 #include "util/XDROperators.h"
@@ -18,6 +19,7 @@
 #include <chrono>
 #include <deque>
 #include <memory>
+#include <set>
 #include <vector>
 
 namespace medida
@@ -56,6 +58,10 @@ class TxQueueLimiter;
  *   pendingDepth, all transactions for that source account are banned. It also
  *   unbans any transactions that have been banned for more than banDepth
  *   ledgers.
+ *
+ * Accounts with transactions in the queue are also kept in a fee rate index,
+ * ordered by their first transaction, that toSurgePricedTxSet uses to build
+ * a transaction set without sorting the whole queue.
  */
 class TransactionQueue
 {
@@ -145,6 +151,17 @@ class TransactionQueue
     std::shared_ptr<TxSetFrame>
     toTxSet(LedgerHeaderHistoryEntry const& lcl) const;
 
+    /**
+     * Builds the transaction set that TxSetFrame::surgePricingFilter would
+     * keep out of toTxSet(lcl) with a limit of maxOps operations: transactions
+     * are taken in surge pricing order (highest fee rate first, and in
+     * sequence number order within an account) until maxOps is reached. Only
+     * looks at the transactions it takes, and at most one more per account.
+     */
+    std::shared_ptr<TxSetFrame>
+    toSurgePricedTxSet(LedgerHeaderHistoryEntry const& lcl,
+                       size_t maxOps) const;
+
     struct ReplacedTransaction
     {
         TransactionFrameBasePtr mOld;
@@ -169,14 +186,29 @@ class TransactionQueue
 
     /**
      * Banned transactions are stored in deque of depth banDepth, so it is easy
-     * to unban all transactions that were banned for long enough.
+     * to unban all transactions that were banned for long enough. Every
+     * transaction received is looked up in all of them, so they are flat sets.
      */
-    using BannedTransactions = std::deque<UnorderedSet<Hash>>;
+    using BannedTransactions = std::deque<FlatSet<Hash>>;
+
+    /**
+     * Orders accounts by the fee rate of their first transaction (see
+     * lessThanXored); only accounts with at least one transaction are in
+     * the index. An account must be removed from the index before its first
+     * transaction changes, and added back after.
+     */
+    struct FeeRateIndexComparator
+    {
+        size_t mSeed;
+        bool operator()(AccountState const* l, AccountState const* r) const;
+    };
+    using FeeRateIndex = std::set<AccountState const*, FeeRateIndexComparator>;
 
     Application& mApp;
     uint32 const mPendingDepth;
 
     AccountStates mAccountStates;
+    FeeRateIndex mFeeRateIndex;
     BannedTransactions mBannedTransactions;
     uint32_t mLedgerVersion;
 
@@ -212,6 +244,9 @@ class TransactionQueue
 
     void releaseFeeMaybeEraseAccountState(TransactionFrameBasePtr tx);
 
+    void addToFeeRateIndex(AccountState const& as);
+    void removeFromFeeRateIndex(AccountState const& as);
+
     void prepareDropTransaction(AccountState& as, TimestampedTx& tstx);
     void dropTransactions(AccountStates::iterator stateIter,
                           TimestampedTransactions::iterator begin,
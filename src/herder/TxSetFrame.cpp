@@ -7,8 +7,10 @@
 #include "crypto/Hex.h"
 #include "crypto/Random.h"
 #include "crypto/SHA.h"
+#include "crypto/SecretKey.h"
 #include "database/Database.h"
 #include "herder/SurgePricingUtils.h"
+#include "ledger/InMemoryLedgerTxnRoot.h"
 #include "ledger/LedgerManager.h"
 #include "ledger/LedgerTxn.h"
 #include "ledger/LedgerTxnEntry.h"
@@ -24,7 +26,10 @@
 
 #include <Tracy.hpp>
 #include <algorithm>
+#include <atomic>
+#include <condition_variable>
 #include <list>
+#include <mutex>
 #include <numeric>
 
 namespace stellar
@@ -277,6 +282,191 @@ TxSetFrame::surgePricingFilter(Application& app)
     }
 }
 
+namespace
+{
+// Account queues of a transaction set pending validation, drained
+// cooperatively by the main thread and any worker threads that pick up a
+// helper job. Each of them validates the queues it takes against its own
+// LedgerTxn, on an InMemoryLedgerTxnRoot, holding copies of the entries the
+// queues need. It is shared by pointer since helpers may only get scheduled
+// once the main thread has already finished the work and moved on.
+struct TxSetValidationState
+{
+    std::vector<std::vector<TransactionFrameBasePtr>> mQueues;
+    // entries the transactions of each queue load
+    std::vector<std::vector<LedgerEntry>> mEntries;
+    LedgerHeader mHeader;
+    uint64_t mLowerBoundCloseTimeOffset{0};
+    uint64_t mUpperBoundCloseTimeOffset{0};
+
+    // whether all transactions of each queue are valid, set once done
+    std::vector<uint8_t> mValid;
+    std::atomic<size_t> mNext{0};
+    std::atomic<size_t> mDone{0};
+    std::mutex mMutex;
+    std::condition_variable mDoneCV;
+
+    bool
+    checkValid(AbstractLedgerTxn& ltx,
+               std::vector<TransactionFrameBasePtr> const& queue) const
+    {
+        int64_t lastSeq = 0;
+        for (auto const& tx : queue)
+        {
+            if (!tx->checkValid(ltx, lastSeq, mLowerBoundCloseTimeOffset,
+                                mUpperBoundCloseTimeOffset))
+            {
+                return false;
+            }
+            lastSeq = tx->getSeqNum();
+        }
+        return true;
+    }
+
+    void
+    drain()
+    {
+        std::unique_ptr<InMemoryLedgerTxnRoot> root;
+        std::unique_ptr<LedgerTxn> snapshot;
+        UnorderedSet<LedgerKey> loaded;
+        size_t i;
+        while ((i = mNext.fetch_add(1)) < mQueues.size())
+        {
+            bool valid = false;
+            try
+            {
+                if (!snapshot)
+                {
+                    root = std::make_unique<InMemoryLedgerTxnRoot>(
+#ifdef BEST_OFFER_DEBUGGING
+                        false
+#endif
+                    );
+                    snapshot = std::make_unique<LedgerTxn>(*root);
+                    snapshot->loadHeader().current() = mHeader;
+                }
+                for (auto const& le : mEntries[i])
+                {
+                    if (loaded.emplace(LedgerEntryKey(le)).second)
+                    {
+                        snapshot->createWithoutLoading(le);
+                    }
+                }
+                valid = checkValid(*snapshot, mQueues[i]);
+            }
+            catch (std::exception const& e)
+            {
+                // the queue gets checked again on the main thread
+                CLOG_DEBUG(Herder, "Error validating tx set queue: {}",
+                           e.what());
+            }
+            mValid[i] = valid;
+            if (mDone.fetch_add(1) + 1 == mQueues.size())
+            {
+                std::lock_guard<std::mutex> guard(mMutex);
+                mDoneCV.notify_all();
+            }
+        }
+    }
+};
+
+// Below this many account queues per helper, posting to the worker threads
+// costs more than it saves.
+size_t const MIN_ACCOUNTS_PER_VALIDATION_HELPER = 16;
+}
+
+UnorderedSet<AccountID>
+TxSetFrame::checkValidInParallel(
+    Application& app, AbstractLedgerTxn& ltx,
+    UnorderedMap<AccountID, AccountTransactionQueue> const& accountTxMap,
+    uint64_t lowerBoundCloseTimeOffset, uint64_t upperBoundCloseTimeOffset)
+{
+    ZoneScoped;
+    UnorderedSet<AccountID> validAccounts;
+    auto helpers = std::min<size_t>(
+        static_cast<size_t>(app.getConfig().WORKER_THREADS),
+        accountTxMap.size() / MIN_ACCOUNTS_PER_VALIDATION_HELPER);
+    if (!app.getConfig().PARALLEL_TX_SET_VALIDATION || helpers == 0)
+    {
+        return validAccounts;
+    }
+
+    // Validation only loads the header and the accounts involved in each
+    // transaction: its source, fee source and operation sources.
+    auto state = std::make_shared<TxSetValidationState>();
+    std::vector<AccountID const*> accounts;
+    std::vector<UnorderedSet<LedgerKey>> queueKeys;
+    UnorderedSet<LedgerKey> keys;
+    for (auto const& kv : accountTxMap)
+    {
+        accounts.emplace_back(&kv.first);
+        state->mQueues.emplace_back(kv.second.begin(), kv.second.end());
+        auto& qk = queueKeys.emplace_back();
+        for (auto const& tx : kv.second)
+        {
+            qk.emplace(accountKey(tx->getSourceID()));
+            qk.emplace(accountKey(tx->getFeeSourceID()));
+            for (auto const& op : tx->getRawOperations())
+            {
+                if (op.sourceAccount)
+                {
+                    qk.emplace(accountKey(toAccountID(*op.sourceAccount)));
+                }
+            }
+        }
+        keys.insert(qk.begin(), qk.end());
+    }
+    app.getLedgerTxnRoot().prefetch(keys);
+
+    UnorderedMap<LedgerKey, LedgerEntry> entries;
+    for (auto const& key : keys)
+    {
+        auto entry = ltx.loadWithoutRecord(key);
+        if (entry)
+        {
+            entries.emplace(key, entry.current());
+        }
+    }
+    for (auto const& qk : queueKeys)
+    {
+        auto& queueEntries = state->mEntries.emplace_back();
+        for (auto const& key : qk)
+        {
+            auto it = entries.find(key);
+            if (it != entries.end())
+            {
+                queueEntries.emplace_back(it->second);
+            }
+        }
+    }
+    state->mHeader = ltx.loadHeader().current();
+    state->mLowerBoundCloseTimeOffset = lowerBoundCloseTimeOffset;
+    state->mUpperBoundCloseTimeOffset = upperBoundCloseTimeOffset;
+    state->mValid.resize(state->mQueues.size());
+
+    for (size_t i = 0; i < helpers; ++i)
+    {
+        app.postOnBackgroundThread([state]() { state->drain(); },
+                                   "TxSetFrame: validate account queues");
+    }
+    state->drain();
+    {
+        std::unique_lock<std::mutex> lock(state->mMutex);
+        state->mDoneCV.wait(lock, [&]() {
+            return state->mDone == state->mQueues.size();
+        });
+    }
+
+    for (size_t i = 0; i < accounts.size(); ++i)
+    {
+        if (state->mValid[i])
+        {
+            validAccounts.emplace(*accounts[i]);
+        }
+    }
+    return validAccounts;
+}
+
 bool
 TxSetFrame::checkOrTrim(Application& app,
                         std::vector<TransactionFrameBasePtr>& trimmed,
@@ -287,9 +477,57 @@ TxSetFrame::checkOrTrim(Application& app,
     LedgerTxn ltx(app.getLedgerTxnRoot());
 
     UnorderedMap<AccountID, int64_t> accountFeeMap;
+    auto addFee = [&](TransactionFrameBasePtr const& tx) {
+        int64_t& accFee = accountFeeMap[tx->getFeeSourceID()];
+        if (INT64_MAX - accFee < tx->getFeeBid())
+        {
+            accFee = INT64_MAX;
+        }
+        else
+        {
+            accFee += tx->getFeeBid();
+        }
+    };
     auto accountTxMap = buildAccountTxQueues();
+
+    // Verify the signatures of the whole set in one batch, so that checkValid
+    // below only consults the signature cache. Transactions failing the
+    // checks made before signatures are skipped, so that they cost no more
+    // verifications than in checkValid.
+    {
+        std::vector<PubKeyUtils::SignatureToVerify> sigs;
+        for (auto const& kv : accountTxMap)
+        {
+            int64_t lastSeq = 0;
+            for (auto const& tx : kv.second)
+            {
+                if (tx->insertSignaturesForTxValidation(
+                        ltx, lastSeq, lowerBoundCloseTimeOffset,
+                        upperBoundCloseTimeOffset, sigs))
+                {
+                    lastSeq = tx->getSeqNum();
+                }
+            }
+        }
+        PubKeyUtils::verifySigBatch(sigs);
+    }
+    // Queues found valid in parallel are valid against ltx as well. Those
+    // that weren't are checked again below, so that trimming and the results
+    // set on transactions are the same as when checking sequentially.
+    auto validAccounts =
+        checkValidInParallel(app, ltx, accountTxMap, lowerBoundCloseTimeOffset,
+                             upperBoundCloseTimeOffset);
     for (auto& kv : accountTxMap)
     {
+        if (validAccounts.find(kv.first) != validAccounts.end())
+        {
+            for (auto const& tx : kv.second)
+            {
+                addFee(tx);
+            }
+            continue;
+        }
+
         int64_t lastSeq = 0;
         auto iter = kv.second.begin();
         while (iter != kv.second.end())
@@ -316,15 +554,7 @@ TxSetFrame::checkOrTrim(Application& app,
             else
             {
                 lastSeq = tx->getSeqNum();
-                int64_t& accFee = accountFeeMap[tx->getFeeSourceID()];
-                if (INT64_MAX - accFee < tx->getFeeBid())
-                {
-                    accFee = INT64_MAX;
-                }
-                else
-                {
-                    accFee += tx->getFeeBid();
-                }
+                addFee(tx);
                 ++iter;
             }
         }
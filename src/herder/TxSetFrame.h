@@ -8,6 +8,7 @@
 #include "overlay/StellarXDR.h"
 #include "transactions/TransactionFrame.h"
 #include "util/UnorderedMap.h"
+#include "util/UnorderedSet.h"
 #include <deque>
 #include <functional>
 #include <optional>
@@ -57,6 +58,16 @@ class TxSetFrame : public AbstractTxSetFrameForApply
                      uint64_t upperBoundCloseTimeOffset);
 
     UnorderedMap<AccountID, AccountTransactionQueue> buildAccountTxQueues();
+
+    // Validates the queues of accountTxMap concurrently on the worker threads
+    // and the main thread, against in-memory copies of the accounts they use
+    // as loaded from ltx. Returns the accounts whose transactions were all
+    // valid; the others need checking against ltx itself.
+    static UnorderedSet<AccountID> checkValidInParallel(
+        Application& app, AbstractLedgerTxn& ltx,
+        UnorderedMap<AccountID, AccountTransactionQueue> const& accountTxMap,
+        uint64_t lowerBoundCloseTimeOffset,
+        uint64_t upperBoundCloseTimeOffset);
     friend struct SurgeCompare;
 
   public:
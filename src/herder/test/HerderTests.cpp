@@ -14,6 +14,7 @@
 #include "test/test.h"
 
 #include "crypto/SHA.h"
+#include "crypto/SecretKey.h"
 #include "database/Database.h"
 #include "ledger/LedgerHeaderUtils.h"
 #include "ledger/LedgerManager.h"
@@ -36,6 +37,7 @@
 #include <algorithm>
 #include <fmt/format.h>
 #include <optional>
+#include <set>
 
 using namespace stellar;
 using namespace stellar::txbridge;
@@ -652,6 +654,92 @@ TEST_CASE("txset", "[herder][txset]")
     }
 }
 
+TEST_CASE("txset parallel validation", "[herder][txset]")
+{
+    // hashes of the transactions trimmed from the same transaction set
+    auto trim = [](bool parallel) {
+        Config cfg(getTestConfig());
+        cfg.TESTING_UPGRADE_MAX_TX_SET_SIZE = 1000;
+        cfg.PARALLEL_TX_SET_VALIDATION = parallel;
+        VirtualClock clock;
+        Application::pointer app = createTestApplication(clock, cfg);
+
+        auto root = TestAccount::createRoot(*app);
+        auto const minBalance2 = app->getLedgerManager().getLastMinBalance(2);
+        std::vector<TestAccount> accounts;
+        for (int i = 0; i < 64; ++i)
+        {
+            accounts.emplace_back(
+                root.create(fmt::format("A{}", i), minBalance2));
+        }
+
+        TxSetFramePtr txSet = std::make_shared<TxSetFrame>(
+            app->getLedgerManager().getLastClosedLedgerHeader().hash);
+        for (size_t i = 0; i < accounts.size(); ++i)
+        {
+            auto& account = accounts[i];
+            for (int j = 0; j < 3; ++j)
+            {
+                auto tx = account.tx({payment(account.getPublicKey(), 1)});
+                if (i % 10 == 3 && j == 1)
+                {
+                    // sequence gap: invalidates this one and the next one
+                    setSeqNum(tx, tx->getSeqNum() + 5);
+                }
+                txSet->add(tx);
+            }
+        }
+        auto newUser = TestAccount{*app, getAccount("doesnotexist")};
+        txSet->add(newUser.tx({payment(root, 1)}));
+        txSet->sortForHash();
+        REQUIRE(!txSet->checkValid(*app, 0, 0));
+
+        auto removed = txSet->trimInvalid(*app, 0, 0);
+        REQUIRE(txSet->checkValid(*app, 0, 0));
+        std::set<Hash> hashes;
+        for (auto const& tx : removed)
+        {
+            hashes.emplace(tx->getFullHash());
+        }
+        return hashes;
+    };
+
+    auto trimmed = trim(true);
+    REQUIRE(trimmed.size() == 7 * 2 + 1);
+    REQUIRE(trimmed == trim(false));
+}
+
+TEST_CASE("txset skips signatures of invalid transactions", "[herder][txset]")
+{
+    VirtualClock clock;
+    Application::pointer app = createTestApplication(clock, getTestConfig());
+
+    auto root = TestAccount::createRoot(*app);
+    auto const minBalance2 = app->getLedgerManager().getLastMinBalance(2);
+    auto account1 = root.create("A1", minBalance2);
+    auto account2 = root.create("A2", minBalance2);
+
+    TxSetFramePtr txSet = std::make_shared<TxSetFrame>(
+        app->getLedgerManager().getLastClosedLedgerHeader().hash);
+    auto valid = account1.tx({payment(root, 1)});
+    txSet->add(valid);
+    auto badSeq = account2.tx({payment(root, 1)});
+    setSeqNum(badSeq, badSeq->getSeqNum() + 5);
+    txSet->add(badSeq);
+
+    PubKeyUtils::clearVerifySigCache();
+    uint64_t hits, misses;
+    PubKeyUtils::flushVerifySigCacheCounts(hits, misses);
+
+    // Only the signature of the transaction with a valid sequence number is
+    // verified, once.
+    auto removed = txSet->trimInvalid(*app, 0, 0);
+    REQUIRE(removed.size() == 1);
+    REQUIRE(removed[0] == badSeq);
+    PubKeyUtils::flushVerifySigCacheCounts(hits, misses);
+    REQUIRE(misses == 1);
+}
+
 TEST_CASE("txset base fee", "[herder][txset]")
 {
     Config cfg(getTestConfig());
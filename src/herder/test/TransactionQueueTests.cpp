@@ -201,6 +201,10 @@ class TransactionQueueTest
         REQUIRE(totOps == mTransactionQueue.getQueueSizeOps());
 
         REQUIRE(txSet->sortForApply() == expectedTxSet.sortForApply());
+        // without a limit, the fee rate index yields the whole queue
+        auto surgeTxSet = mTransactionQueue.toSurgePricedTxSet(
+            {}, std::numeric_limits<size_t>::max());
+        REQUIRE(surgeTxSet->sortForApply() == txSet->sortForApply());
         REQUIRE(state.mBannedState.mBanned0.size() ==
                 mTransactionQueue.countBanned(0));
         REQUIRE(state.mBannedState.mBanned1.size() ==
@@ -951,6 +955,83 @@ TEST_CASE("transaction queue starting sequence boundary",
     }
 }
 
+TEST_CASE("transaction queue surge priced tx set",
+          "[herder][transactionqueue]")
+{
+    VirtualClock clock;
+    auto cfg = getTestConfig();
+    cfg.TESTING_UPGRADE_MAX_TX_SET_SIZE = 5;
+    auto app = createTestApplication(clock, cfg);
+    auto const minBalance2 = app->getLedgerManager().getLastMinBalance(2);
+    auto const maxOps = app->getLedgerManager().getLastMaxTxSetSizeOps();
+    REQUIRE(maxOps == 5);
+
+    auto root = TestAccount::createRoot(*app);
+    auto a1 = root.create("a1", minBalance2);
+    auto a2 = root.create("a2", minBalance2);
+    auto a3 = root.create("a3", minBalance2);
+    auto a4 = root.create("a4", minBalance2);
+
+    TransactionQueue tq(*app, 4, 2, 4);
+    auto add = [&](TransactionFrameBasePtr tx) {
+        REQUIRE(tq.tryAdd(tx) ==
+                TransactionQueue::AddResult::ADD_STATUS_PENDING);
+        return tx;
+    };
+    // fee rates, in queue order: a1 300, 100; a2 500 (2 ops), 150;
+    // a3 200, 250; a4 50
+    auto a1T1 = add(transaction(*app, a1, 1, 1, 300));
+    auto a1T2 = add(transaction(*app, a1, 2, 1, 100));
+    auto a2T1 = add(transaction(*app, a2, 1, 1, 1000, 2));
+    auto a2T2 = add(transaction(*app, a2, 2, 1, 150));
+    auto a3T1 = add(transaction(*app, a3, 1, 1, 200));
+    auto a3T2 = add(transaction(*app, a3, 2, 1, 250));
+    auto a4T1 = add(transaction(*app, a4, 1, 1, 50));
+
+    auto const lcl = app->getLedgerManager().getLastClosedLedgerHeader();
+    auto checkTxSet = [&](std::vector<TransactionFrameBasePtr> const& txs) {
+        auto txSet = tq.toSurgePricedTxSet(lcl, maxOps);
+        TxSetFrame expected(lcl.hash);
+        for (auto const& tx : txs)
+        {
+            expected.add(tx);
+        }
+        REQUIRE(txSet->sortForApply() == expected.sortForApply());
+
+        // same as filtering the whole queue
+        auto filtered = tq.toTxSet(lcl);
+        filtered->surgePricingFilter(*app);
+        REQUIRE(txSet->sortForApply() == filtered->sortForApply());
+    };
+
+    checkTxSet({a2T1, a1T1, a3T1, a3T2});
+
+    SECTION("removed applied")
+    {
+        tq.removeApplied({a2T1});
+        checkTxSet({a1T1, a3T1, a3T2, a2T2, a1T2});
+    }
+    SECTION("banned")
+    {
+        tq.ban({a3T1});
+        checkTxSet({a2T1, a1T1, a2T2, a1T2});
+    }
+    SECTION("replaced by fee")
+    {
+        // 2 ops at a fee rate of 5000
+        auto a4Bump = add(feeBump(*app, a4, a4T1, 10 * 1000));
+        checkTxSet({a4Bump, a2T1, a1T1});
+    }
+    SECTION("aged out")
+    {
+        for (int i = 0; i < 4; ++i)
+        {
+            tq.shift();
+        }
+        checkTxSet({});
+    }
+}
+
 TEST_CASE("transaction queue with fee-bump", "[herder][transactionqueue]")
 {
     VirtualClock clock;
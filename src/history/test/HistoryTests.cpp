@@ -4,16 +4,19 @@
 
 #include "bucket/BucketManager.h"
 #include "bucket/BucketTests.h"
+#include "crypto/SHA.h"
 #include "catchup/test/CatchupWorkTests.h"
 #include "history/FileTransferInfo.h"
 #include "history/HistoryArchiveManager.h"
 #include "history/HistoryManager.h"
 #include "history/test/HistoryTestsUtils.h"
 #include "historywork/GetHistoryArchiveStateWork.h"
+#include "historywork/GunzipAndVerifyFileWork.h"
 #include "historywork/GunzipFileWork.h"
 #include "historywork/GzipFileWork.h"
 #include "historywork/PutHistoryArchiveStateWork.h"
 #include "ledger/LedgerManager.h"
+#include "ledger/test/LedgerTestUtils.h"
 #include "main/ExternalQueue.h"
 #include "main/PersistentState.h"
 #include "process/ProcessManager.h"
@@ -22,15 +25,21 @@
 #include "test/TxTests.h"
 #include "test/test.h"
 #include "util/Fs.h"
+#include "util/Gzip.h"
 #include "util/Logging.h"
+#include "util/Math.h"
 #include "work/WorkScheduler.h"
 
 #include "historywork/BatchDownloadWork.h"
 #include "historywork/DownloadBucketsWork.h"
 #include "historywork/DownloadVerifyTxResultsWork.h"
+#include "historywork/VerifyBucketsWork.h"
 #include "historywork/VerifyTxResultsWork.h"
 #include <fmt/format.h>
+#include <fstream>
 #include <lib/catch.hpp>
+#include <medida/meter.h>
+#include <medida/metrics_registry.h>
 
 using namespace stellar;
 using namespace historytestutils;
@@ -103,6 +112,83 @@ TEST_CASE("HistoryManager compress", "[history]")
     REQUIRE(!fs::exists(compressed));
 }
 
+TEST_CASE("HistoryManager compress in-process", "[history]")
+{
+    CatchupSimulation catchupSimulation{};
+    HistoryManager& hm = catchupSimulation.getApp().getHistoryManager();
+    auto& wm = catchupSimulation.getApp().getWorkScheduler();
+
+    // Several buffers' worth of mostly-compressible data.
+    std::string contents;
+    for (size_t i = 0; contents.size() < 3 * fs::bufsz(); ++i)
+    {
+        contents += fmt::format("entry {} {}\n", i, rand_uniform<int>(0, 9));
+    }
+    auto writeFile = [](std::string const& name, std::string const& data) {
+        std::ofstream out;
+        out.exceptions(std::ios::failbit | std::ios::badbit);
+        out.open(name, std::ofstream::binary);
+        out.write(data.data(), data.size());
+    };
+    auto readFile = [](std::string const& name) {
+        std::ifstream in(name, std::ifstream::binary);
+        return std::string(std::istreambuf_iterator<char>(in),
+                           std::istreambuf_iterator<char>());
+    };
+
+    std::string fname = hm.localFilename("compressme-big");
+    std::string compressed = fname + ".gz";
+    writeFile(fname, contents);
+
+    SECTION("round trip keeping inputs")
+    {
+        auto g = wm.executeWork<GzipFileWork>(fname, true);
+        REQUIRE(g->getState() == BasicWork::State::WORK_SUCCESS);
+        REQUIRE(fs::exists(fname));
+        REQUIRE(fs::exists(compressed));
+        REQUIRE(fs::size(compressed) < contents.size());
+
+        std::remove(fname.c_str());
+        auto u = wm.executeWork<GunzipFileWork>(compressed, true);
+        REQUIRE(u->getState() == BasicWork::State::WORK_SUCCESS);
+        REQUIRE(fs::exists(compressed));
+        REQUIRE(readFile(fname) == contents);
+    }
+
+    SECTION("concatenated members and hashing")
+    {
+        gzipFile(fname, compressed);
+        std::string twice = readFile(compressed);
+        twice += twice;
+        writeFile(compressed, twice);
+        std::remove(fname.c_str());
+
+        SHA256 hasher;
+        gunzipFile(compressed, fname, &hasher);
+        REQUIRE(readFile(fname) == contents + contents);
+        REQUIRE(hasher.finish() == sha256(contents + contents));
+    }
+
+    SECTION("truncated input fails")
+    {
+        gzipFile(fname, compressed);
+        std::string gz = readFile(compressed);
+        writeFile(compressed, gz.substr(0, gz.size() / 2));
+        std::remove(fname.c_str());
+
+        auto u = wm.executeWork<GunzipFileWork>(compressed);
+        REQUIRE(u->getState() == BasicWork::State::WORK_FAILURE);
+        REQUIRE(fs::exists(compressed));
+    }
+
+    SECTION("corrupt input fails")
+    {
+        writeFile(compressed, "this is not gzip data");
+        std::remove(fname.c_str());
+        REQUIRE_THROWS(gunzipFile(compressed, fname));
+    }
+}
+
 TEST_CASE("HistoryArchiveState get_put", "[history]")
 {
     CatchupSimulation catchupSimulation{};
@@ -195,6 +281,39 @@ TEST_CASE("History bucket verification", "[history][catchup]")
     }
 }
 
+TEST_CASE("Local bucket verification", "[history][bucket]")
+{
+    Config cfg(getTestConfig());
+    cfg.WORKER_THREADS = 2;
+    VirtualClock clock;
+    Application::pointer app = createTestApplication(clock, cfg);
+    auto& wm = app->getWorkScheduler();
+
+    // More buckets than the concurrency limit of WORKER_THREADS.
+    std::vector<std::pair<std::string, uint256>> buckets;
+    for (int i = 0; i < 5; ++i)
+    {
+        auto b = Bucket::fresh(
+            app->getBucketManager(), BucketTests::getAppLedgerVersion(app), {},
+            LedgerTestUtils::generateValidLedgerEntries(100), {},
+            /*countMergeEvents=*/true, clock.getIOContext(),
+            /*doFsync=*/false);
+        buckets.emplace_back(b->getFilename(), b->getHash());
+    }
+
+    SECTION("all hashes match")
+    {
+        auto verify = wm.executeWork<VerifyBucketsWork>(buckets);
+        REQUIRE(verify->getState() == BasicWork::State::WORK_SUCCESS);
+    }
+    SECTION("one hash mismatch")
+    {
+        buckets[3].second = HashUtils::random();
+        auto verify = wm.executeWork<VerifyBucketsWork>(buckets);
+        REQUIRE(verify->getState() == BasicWork::State::WORK_FAILURE);
+    }
+}
+
 TEST_CASE("Ledger chain verification", "[ledgerheaderverification]")
 {
     Config cfg(getTestConfig(0));
@@ -321,6 +440,124 @@ TEST_CASE("Ledger chain verification", "[ledgerheaderverification]")
     }
 }
 
+TEST_CASE("Downloaded files are verified as they are decompressed",
+          "[history][ledgerheaderverification]")
+{
+    Config cfg(getTestConfig(0));
+    VirtualClock clock;
+    auto cg = std::make_shared<TmpDirHistoryConfigurator>();
+    cg->configure(cfg, true);
+    Application::pointer app = createTestApplication(clock, cfg);
+    auto& wm = app->getWorkScheduler();
+    auto& hm = app->getHistoryManager();
+    auto tmpDir = app->getTmpDirManager().tmpDir("tmp-gunzip-verify-test");
+
+    uint32_t checkpoint = hm.checkpointContainingLedger(127);
+    CheckpointRange range{LedgerRange::inclusive(checkpoint, checkpoint), hm};
+    auto ledgerChainGenerator = TestLedgerChainGenerator{
+        *app,
+        app->getHistoryArchiveManager().getHistoryArchive(
+            cg->getArchiveDirName()),
+        range, tmpDir};
+    FileTransferInfo ft(tmpDir, HISTORY_FILE_TYPE_LEDGER, checkpoint);
+
+    // Leaves a gzipped ledger file for the checkpoint where
+    // GetAndUnzipRemoteFileWork would have downloaded it.
+    auto makeGzippedLedgerFile =
+        [&](HistoryManager::LedgerVerificationStatus state) {
+            ledgerChainGenerator.makeOneLedgerFile(
+                checkpoint, HashUtils::random(), state);
+            gzipFile(ft.localPath_nogz(), ft.localPath_gz());
+            std::remove(ft.localPath_nogz().c_str());
+        };
+    auto checkExpectedBehavior = [&](BasicWork::State expectedState) {
+        auto w = wm.executeWork<GunzipAndVerifyFileWork>(ft);
+        REQUIRE(w->getState() == expectedState);
+        if (expectedState == BasicWork::State::WORK_SUCCESS)
+        {
+            REQUIRE(fs::exists(ft.localPath_nogz()));
+            REQUIRE(!fs::exists(ft.localPath_gz()));
+        }
+    };
+
+    auto verifyMeter = [&](std::string const& outcome) -> medida::Meter& {
+        return app->getMetrics().NewMeter({"history", "verify-ledger", outcome},
+                                          "event");
+    };
+
+    SECTION("valid ledger chain")
+    {
+        makeGzippedLedgerFile(HistoryManager::VERIFY_STATUS_OK);
+        checkExpectedBehavior(BasicWork::State::WORK_SUCCESS);
+        REQUIRE(verifyMeter("success").count() == 1);
+        REQUIRE(verifyMeter("failure").count() == 0);
+    }
+    SECTION("truncated file")
+    {
+        ledgerChainGenerator.makeOneLedgerFile(
+            checkpoint, HashUtils::random(), HistoryManager::VERIFY_STATUS_OK);
+        std::string contents;
+        {
+            std::ifstream in(ft.localPath_nogz(), std::ios::binary);
+            contents.assign(std::istreambuf_iterator<char>(in), {});
+        }
+        {
+            // cuts the last header short
+            std::ofstream out(ft.localPath_nogz(),
+                              std::ios::binary | std::ios::trunc);
+            out.write(contents.data(), contents.size() - 10);
+        }
+        gzipFile(ft.localPath_nogz(), ft.localPath_gz());
+        std::remove(ft.localPath_nogz().c_str());
+        checkExpectedBehavior(BasicWork::State::WORK_FAILURE);
+        REQUIRE(verifyMeter("failure").count() == 1);
+    }
+    SECTION("bad hash")
+    {
+        makeGzippedLedgerFile(HistoryManager::VERIFY_STATUS_ERR_BAD_HASH);
+        checkExpectedBehavior(BasicWork::State::WORK_FAILURE);
+    }
+    SECTION("undershot")
+    {
+        makeGzippedLedgerFile(HistoryManager::VERIFY_STATUS_ERR_UNDERSHOT);
+        checkExpectedBehavior(BasicWork::State::WORK_FAILURE);
+    }
+    SECTION("overshot")
+    {
+        makeGzippedLedgerFile(HistoryManager::VERIFY_STATUS_ERR_OVERSHOT);
+        checkExpectedBehavior(BasicWork::State::WORK_FAILURE);
+    }
+    SECTION("left to chain verification")
+    {
+        // Neither needs other files to be detected, but both are reported by
+        // VerifyLedgerChainWork, which knows the range being verified and
+        // tells the operator to upgrade.
+        makeGzippedLedgerFile(
+            HistoryManager::VERIFY_STATUS_ERR_BAD_LEDGER_VERSION);
+        checkExpectedBehavior(BasicWork::State::WORK_SUCCESS);
+        makeGzippedLedgerFile(HistoryManager::VERIFY_STATUS_ERR_MISSING_ENTRIES);
+        checkExpectedBehavior(BasicWork::State::WORK_SUCCESS);
+    }
+    SECTION("results out of checkpoint")
+    {
+        FileTransferInfo rft(tmpDir, HISTORY_FILE_TYPE_RESULTS, checkpoint);
+        {
+            XDROutputFileStream out(clock.getIOContext(), /*doFsync=*/false);
+            out.open(rft.localPath_nogz());
+            TransactionHistoryResultEntry e;
+            e.ledgerSeq = checkpoint - 1;
+            out.writeOne(e);
+            e.ledgerSeq = checkpoint + 1;
+            out.writeOne(e);
+            out.close();
+        }
+        gzipFile(rft.localPath_nogz(), rft.localPath_gz());
+        std::remove(rft.localPath_nogz().c_str());
+        auto w = wm.executeWork<GunzipAndVerifyFileWork>(rft);
+        REQUIRE(w->getState() == BasicWork::State::WORK_FAILURE);
+    }
+}
+
 TEST_CASE("Tx results verification", "[batching][resultsverification]")
 {
     CatchupSimulation catchupSimulation{};
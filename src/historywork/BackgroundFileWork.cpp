@@ -0,0 +1,91 @@
+// Copyright 2022 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include "historywork/BackgroundFileWork.h"
+#include "main/Application.h"
+#include "util/Logging.h"
+#include <Tracy.hpp>
+
+namespace stellar
+{
+
+BackgroundFileWork::BackgroundFileWork(Application& app,
+                                       std::string const& name,
+                                       size_t maxRetries)
+    : BasicWork(app, name, maxRetries)
+{
+}
+
+BasicWork::State
+BackgroundFileWork::onRun()
+{
+    ZoneScoped;
+    if (mDone)
+    {
+        return mFailed ? State::WORK_FAILURE : State::WORK_SUCCESS;
+    }
+    if (mRunning)
+    {
+        return State::WORK_WAITING;
+    }
+
+    mRunning = true;
+    mCancel = std::make_shared<std::atomic<bool>>(false);
+    Job job = makeJob();
+    auto cancel = mCancel;
+    auto name = getName();
+    Application& app = mApp;
+    std::weak_ptr<BackgroundFileWork> weak(
+        std::static_pointer_cast<BackgroundFileWork>(shared_from_this()));
+    app.postOnBackgroundThread(
+        [&app, job, cancel, name, weak]() {
+            bool failed = false;
+            try
+            {
+                ZoneNamedN(jobZone, "background file work", true);
+                job(*cancel);
+            }
+            catch (std::exception const& e)
+            {
+                CLOG_WARNING(History, "{} failed: {}", name, e.what());
+                failed = true;
+            }
+
+            // BasicWork's state is not thread-safe, so report back on the
+            // main thread.
+            app.postOnMainThread(
+                [weak, failed]() {
+                    auto self = weak.lock();
+                    if (self)
+                    {
+                        self->mRunning = false;
+                        self->mDone = true;
+                        self->mFailed = failed;
+                        self->wakeUp();
+                    }
+                },
+                "BackgroundFileWork: finish");
+        },
+        name);
+    return State::WORK_WAITING;
+}
+
+void
+BackgroundFileWork::onReset()
+{
+    mDone = false;
+    mFailed = false;
+}
+
+bool
+BackgroundFileWork::onAbort()
+{
+    ZoneScoped;
+    if (mCancel)
+    {
+        *mCancel = true;
+    }
+    return !mRunning;
+}
+}
@@ -0,0 +1,48 @@
+// Copyright 2022 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#pragma once
+
+#include "work/BasicWork.h"
+
+#include <atomic>
+#include <functional>
+#include <memory>
+
+namespace stellar
+{
+
+/**
+ * Base for works that process files with a blocking function run on the
+ * worker threads (rather than, say, in a subprocess). Like RunCommandWork,
+ * the work waits while the job runs and is woken up when it finishes.
+ *
+ * Aborting sets the flag passed to the job, which should give up at its next
+ * convenient point; the abort completes once the job has returned, so that a
+ * retry never runs concurrently with a previous attempt.
+ */
+class BackgroundFileWork : public BasicWork
+{
+    bool mRunning{false};
+    bool mDone{false};
+    bool mFailed{false};
+    std::shared_ptr<std::atomic<bool>> mCancel;
+
+  public:
+    BackgroundFileWork(Application& app, std::string const& name,
+                       size_t maxRetries);
+    ~BackgroundFileWork() = default;
+
+  protected:
+    using Job = std::function<void(std::atomic<bool> const& cancel)>;
+
+    // Returns the job to run on a worker thread. It must only use state it
+    // captures by value, and should throw on failure.
+    virtual Job makeJob() = 0;
+
+    void onReset() override;
+    BasicWork::State onRun() override;
+    bool onAbort() override;
+};
+}
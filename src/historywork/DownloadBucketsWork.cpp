@@ -8,7 +8,7 @@
 #include "history/FileTransferInfo.h"
 #include "history/HistoryArchive.h"
 #include "historywork/GetAndUnzipRemoteFileWork.h"
-#include "historywork/VerifyBucketWork.h"
+#include "work/WorkSequence.h"
 #include "work/WorkWithCallback.h"
 #include <Tracy.hpp>
 #include <fmt/format.h>
@@ -74,19 +74,6 @@ DownloadBucketsWork::yieldMoreWork()
     FileTransferInfo ft(mDownloadDir, HISTORY_FILE_TYPE_BUCKET, hash);
     auto w1 = std::make_shared<GetAndUnzipRemoteFileWork>(mApp, ft, mArchive);
 
-    auto getFileWeak = std::weak_ptr<GetAndUnzipRemoteFileWork>(w1);
-    OnFailureCallback failureCb = [getFileWeak, hash]() {
-        auto getFile = getFileWeak.lock();
-        if (getFile)
-        {
-            auto ar = getFile->getArchive();
-            if (ar)
-            {
-                CLOG_INFO(History, "Bucket {} from archive {}", hash,
-                          ar->getName());
-            }
-        }
-    };
     std::weak_ptr<DownloadBucketsWork> weak(
         std::static_pointer_cast<DownloadBucketsWork>(shared_from_this()));
     auto successCb = [weak, ft, hash](Application& app) -> bool {
@@ -102,15 +89,15 @@ DownloadBucketsWork::yieldMoreWork()
         }
         return true;
     };
-    auto w2 = std::make_shared<VerifyBucketWork>(mApp, ft.localPath_nogz(),
-                                                 hexToBin256(hash), failureCb);
-    auto w3 = std::make_shared<WorkWithCallback>(mApp, "adopt-verified-bucket",
+    // GetAndUnzipRemoteFileWork checks the bucket's hash as it decompresses
+    // it, so it can be adopted right away.
+    auto w2 = std::make_shared<WorkWithCallback>(mApp, "adopt-verified-bucket",
                                                  successCb);
-    std::vector<std::shared_ptr<BasicWork>> seq{w1, w2, w3};
-    auto w4 = std::make_shared<WorkSequence>(
+    std::vector<std::shared_ptr<BasicWork>> seq{w1, w2};
+    auto w3 = std::make_shared<WorkSequence>(
         mApp, "download-verify-sequence-" + hash, seq);
 
     ++mNextBucketIter;
-    return w4;
+    return w3;
 }
 }
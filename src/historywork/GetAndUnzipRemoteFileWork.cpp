@@ -6,7 +6,8 @@
 #include "catchup/CatchupManager.h"
 #include "history/HistoryArchive.h"
 #include "historywork/GetRemoteFileWork.h"
-#include "historywork/GunzipFileWork.h"
+#include "historywork/GunzipAndVerifyFileWork.h"
+#include "main/ErrorMessages.h"
 #include "util/GlobalChecks.h"
 #include "util/Logging.h"
 #include <Tracy.hpp>
@@ -85,6 +86,13 @@ GetAndUnzipRemoteFileWork::doWork()
                        mFt.remoteName());
             return State::WORK_FAILURE;
         }
+        if (state == State::WORK_FAILURE)
+        {
+            auto ar = getArchive();
+            CLOG_WARNING(History, "FAILED verifying {} from archive {}",
+                         mFt.remoteName(), ar ? ar->getName() : "<unknown>");
+            CLOG_WARNING(History, "{}", POSSIBLY_CORRUPTED_HISTORY);
+        }
         return state;
     }
     else if (mGetRemoteFileWork)
@@ -97,8 +105,10 @@ GetAndUnzipRemoteFileWork::doWork()
             {
                 return State::WORK_FAILURE;
             }
-            mGunzipFileWork = addWork<GunzipFileWork>(mFt.localPath_gz(), false,
-                                                      BasicWork::RETRY_NEVER);
+            // Decompress and check the file in one pass; a file that fails
+            // the check is downloaded again (maybe from another archive).
+            mGunzipFileWork = addWork<GunzipAndVerifyFileWork>(
+                mFt, BasicWork::RETRY_NEVER);
             return State::WORK_RUNNING;
         }
         return state;
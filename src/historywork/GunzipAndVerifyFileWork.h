@@ -0,0 +1,59 @@
+// Copyright 2022 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#pragma once
+
+#include "history/FileTransferInfo.h"
+#include "historywork/BackgroundFileWork.h"
+
+namespace medida
+{
+class Meter;
+}
+
+namespace stellar
+{
+
+/**
+ * Decompresses a downloaded history file (ft.localPath_gz()) to
+ * ft.localPath_nogz() and checks its contents in the same pass, so that a bad
+ * file is caught -- and the download retried, possibly from another archive --
+ * without reading it back from disk:
+ *
+ *   - buckets must hash to the hash they're named after (replacing a separate
+ *     VerifyBucketWork pass over the decompressed file),
+ *   - ledger headers must hash to their recorded hashes and form a gap-free
+ *     hash chain within the file's checkpoint,
+ *   - transaction, result and SCP entries must be in strictly increasing ledger
+ *     order within the file's checkpoint.
+ *
+ * Checks that need other files (trusted hashes, links across checkpoints,
+ * result hashes against headers) are still done by VerifyLedgerChainWork and
+ * VerifyTxResultsWork. Entries this build can't decode (unknown union arms or
+ * enum values), or headers of a newer protocol, aren't checked here, leaving
+ * it to those works to report that core needs upgrading; truncated or
+ * malformed files fail.
+ *
+ * Outcomes are counted by the history.verify-<type>.success and .failure
+ * meters.
+ */
+class GunzipAndVerifyFileWork : public BackgroundFileWork
+{
+    FileTransferInfo const mFt;
+    medida::Meter& mVerifySuccess;
+    medida::Meter& mVerifyFailure;
+    Job makeJob() override;
+
+  public:
+    GunzipAndVerifyFileWork(Application& app, FileTransferInfo const& ft,
+                            size_t maxRetries = Work::RETRY_NEVER);
+    ~GunzipAndVerifyFileWork() = default;
+
+  protected:
+    void onReset() override;
+    void onSuccess() override;
+    void onFailureRetry() override;
+    void onFailureRaise() override;
+};
+}
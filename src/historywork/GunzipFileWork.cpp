@@ -4,36 +4,38 @@
 
 #include "historywork/GunzipFileWork.h"
 #include "util/Fs.h"
+#include "util/Gzip.h"
 
 namespace stellar
 {
 
 GunzipFileWork::GunzipFileWork(Application& app, std::string const& filenameGz,
                                bool keepExisting, size_t maxRetries)
-    : RunCommandWork(app, std::string("gunzip-file ") + filenameGz, maxRetries)
+    : BackgroundFileWork(app, std::string("gunzip-file ") + filenameGz,
+                         maxRetries)
     , mFilenameGz(filenameGz)
     , mKeepExisting(keepExisting)
 {
     fs::checkGzipSuffix(mFilenameGz);
 }
 
-CommandInfo
-GunzipFileWork::getCommand()
+BackgroundFileWork::Job
+GunzipFileWork::makeJob()
 {
-    std::string cmdLine, outFile;
-    cmdLine = "gzip -d ";
-    if (mKeepExisting)
-    {
-        cmdLine += "-c ";
-        outFile = mFilenameGz.substr(0, mFilenameGz.size() - 3);
-    }
-    cmdLine += mFilenameGz;
-    return CommandInfo{cmdLine, outFile};
+    return [in = mFilenameGz,
+            keepExisting = mKeepExisting](std::atomic<bool> const& cancel) {
+        gunzipFile(in, in.substr(0, in.size() - 3), nullptr, &cancel);
+        if (!keepExisting)
+        {
+            std::remove(in.c_str());
+        }
+    };
 }
 
 void
 GunzipFileWork::onReset()
 {
+    BackgroundFileWork::onReset();
     std::string filenameNoGz = mFilenameGz.substr(0, mFilenameGz.size() - 3);
     std::remove(filenameNoGz.c_str());
 }
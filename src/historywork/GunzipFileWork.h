@@ -4,16 +4,18 @@
 
 #pragma once
 
-#include "historywork/RunCommandWork.h"
+#include "historywork/BackgroundFileWork.h"
 
 namespace stellar
 {
 
-class GunzipFileWork : public RunCommandWork
+// Decompresses `filenameGz` (which must end in .gz) next to itself on a worker
+// thread (see gunzipFile), removing the original unless `keepExisting`.
+class GunzipFileWork : public BackgroundFileWork
 {
     std::string const mFilenameGz;
     bool const mKeepExisting;
-    CommandInfo getCommand() override;
+    Job makeJob() override;
 
   public:
     GunzipFileWork(Application& app, std::string const& filenameGz,
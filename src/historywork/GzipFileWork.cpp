@@ -4,14 +4,15 @@
 
 #include "historywork/GzipFileWork.h"
 #include "util/Fs.h"
+#include "util/Gzip.h"
 
 namespace stellar
 {
 
 GzipFileWork::GzipFileWork(Application& app, std::string const& filenameNoGz,
                            bool keepExisting)
-    : RunCommandWork(app, std::string("gzip-file ") + filenameNoGz,
-                     BasicWork::RETRY_A_LOT)
+    : BackgroundFileWork(app, std::string("gzip-file ") + filenameNoGz,
+                         BasicWork::RETRY_A_LOT)
     , mFilenameNoGz(filenameNoGz)
     , mKeepExisting(keepExisting)
 {
@@ -21,22 +22,21 @@ GzipFileWork::GzipFileWork(Application& app, std::string const& filenameNoGz,
 void
 GzipFileWork::onReset()
 {
+    BackgroundFileWork::onReset();
     std::string filenameGz = mFilenameNoGz + ".gz";
     std::remove(filenameGz.c_str());
 }
 
-CommandInfo
-GzipFileWork::getCommand()
+BackgroundFileWork::Job
+GzipFileWork::makeJob()
 {
-    std::string cmdLine = "gzip ";
-    std::string outFile;
-    if (mKeepExisting)
-    {
-        cmdLine += "-c ";
-        outFile = mFilenameNoGz + ".gz";
-    }
-    cmdLine += mFilenameNoGz;
-
-    return CommandInfo{cmdLine, outFile};
+    return [in = mFilenameNoGz,
+            keepExisting = mKeepExisting](std::atomic<bool> const& cancel) {
+        gzipFile(in, in + ".gz", &cancel);
+        if (!keepExisting)
+        {
+            std::remove(in.c_str());
+        }
+    };
 }
 }
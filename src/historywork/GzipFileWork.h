@@ -4,16 +4,18 @@
 
 #pragma once
 
-#include "historywork/RunCommandWork.h"
+#include "historywork/BackgroundFileWork.h"
 
 namespace stellar
 {
 
-class GzipFileWork : public RunCommandWork
+// Compresses `filenameNoGz` to `filenameNoGz`.gz on a worker thread (see
+// gzipFile), removing the original unless `keepExisting`.
+class GzipFileWork : public BackgroundFileWork
 {
     std::string const mFilenameNoGz;
     bool const mKeepExisting;
-    CommandInfo getCommand() override;
+    Job makeJob() override;
 
   public:
     GzipFileWork(Application& app, std::string const& filenameNoGz,
@@ -15,7 +15,7 @@
 #include <medida/meter.h>
 #include <medida/metrics_registry.h>
 
-#include <fstream>
+#include <algorithm>
 
 namespace stellar
 {
@@ -65,20 +65,16 @@ VerifyBucketWork::spawnVerifier()
                 ZoneNamedN(verifyZone, "bucket verify", true);
                 CLOG_INFO(History, "Verifying bucket {}", binToHex(hash));
 
-                // ensure that the stream gets its own scope to avoid race with
-                // main thread
-                std::ifstream in(filename, std::ifstream::binary);
-                if (!in)
+                // ensure that the mapping gets its own scope to avoid race
+                // with main thread
                 {
-                    throw std::runtime_error(fmt::format(
-                        FMT_STRING("Error opening file {}"), filename));
-                }
-                in.exceptions(std::ios::badbit);
-                char buf[4096];
-                while (in)
-                {
-                    in.read(buf, sizeof(buf));
-                    hasher.add(ByteSlice(buf, in.gcount()));
+                    fs::MappedFile in(filename);
+                    for (size_t off = 0; off < in.size(); off += fs::bufsz())
+                    {
+                        hasher.add(ByteSlice(
+                            in.data() + off,
+                            std::min(fs::bufsz(), in.size() - off)));
+                    }
                 }
                 uint256 vHash = hasher.finish();
                 if (vHash == hash)
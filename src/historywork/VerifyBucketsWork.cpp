@@ -0,0 +1,60 @@
+// Copyright 2022 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include "historywork/VerifyBucketsWork.h"
+#include "historywork/VerifyBucketWork.h"
+#include "main/Application.h"
+#include <Tracy.hpp>
+#include <fmt/format.h>
+
+namespace stellar
+{
+
+VerifyBucketsWork::VerifyBucketsWork(
+    Application& app, std::vector<std::pair<std::string, uint256>> buckets)
+    : BatchWork{app, "verify-buckets",
+                static_cast<size_t>(
+                    std::max(1, app.getConfig().WORKER_THREADS / 2))}
+    , mBuckets{std::move(buckets)}
+{
+}
+
+std::string
+VerifyBucketsWork::getStatus() const
+{
+    if (!isDone() && !isAborting() && !mBuckets.empty())
+    {
+        auto numDone = mNextBucket - getNumWorksInBatch();
+        auto total = mBuckets.size();
+        return fmt::format(FMT_STRING("verifying buckets: {:d}/{:d} ({:d}%)"),
+                           numDone, total, (100 * numDone) / total);
+    }
+    return BatchWork::getStatus();
+}
+
+bool
+VerifyBucketsWork::hasNext() const
+{
+    return mNextBucket < mBuckets.size();
+}
+
+void
+VerifyBucketsWork::resetIter()
+{
+    mNextBucket = 0;
+}
+
+std::shared_ptr<BasicWork>
+VerifyBucketsWork::yieldMoreWork()
+{
+    ZoneScoped;
+    if (!hasNext())
+    {
+        throw std::runtime_error("Nothing to iterate over!");
+    }
+    auto const& b = mBuckets[mNextBucket++];
+    return std::make_shared<VerifyBucketWork>(mApp, b.first, b.second,
+                                              nullptr);
+}
+}
@@ -0,0 +1,35 @@
+// Copyright 2022 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+#pragma once
+
+#include "work/BatchWork.h"
+#include "xdr/Stellar-types.h"
+
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace stellar
+{
+
+// Verifies the hashes of a set of bucket files concurrently, running one
+// VerifyBucketWork per file on the worker threads with at most half of them
+// in flight (so that a large batch can't crowd out bucket merges).
+class VerifyBucketsWork : public BatchWork
+{
+    std::vector<std::pair<std::string, uint256>> mBuckets;
+    size_t mNextBucket{0};
+
+  public:
+    VerifyBucketsWork(Application& app,
+                      std::vector<std::pair<std::string, uint256>> buckets);
+    ~VerifyBucketsWork() = default;
+    std::string getStatus() const override;
+
+  protected:
+    bool hasNext() const override;
+    std::shared_ptr<BasicWork> yieldMoreWork() override;
+    void resetIter() override;
+};
+}
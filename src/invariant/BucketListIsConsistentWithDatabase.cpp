@@ -7,6 +7,7 @@
 #include "bucket/BucketInputIterator.h"
 #include "bucket/BucketManager.h"
 #include "crypto/Hex.h"
+#include "database/Database.h"
 #include "history/HistoryArchive.h"
 #include "invariant/InvariantManager.h"
 #include "ledger/LedgerManager.h"
@@ -14,20 +15,24 @@
 #include "ledger/LedgerTxn.h"
 #include "ledger/LedgerTxnEntry.h"
 #include "main/Application.h"
-#include "medida/timer.h"
+#include "util/StatusManager.h"
+#include "util/Thread.h"
 #include "util/XDRCereal.h"
+#include <atomic>
 #include <chrono>
-#include <fmt/chrono.h>
+#include <condition_variable>
 #include <fmt/format.h>
 #include <map>
+#include <mutex>
+#include <soci.h>
+#include <thread>
 
 namespace stellar
 {
 
 static std::string
-checkAgainstDatabase(AbstractLedgerTxn& ltx, LedgerEntry const& entry)
+checkAgainstDatabase(LedgerEntry const* fromDb, LedgerEntry const& entry)
 {
-    auto fromDb = ltx.loadWithoutRecord(LedgerEntryKey(entry));
     if (!fromDb)
     {
         std::string s{
@@ -36,19 +41,26 @@ checkAgainstDatabase(AbstractLedgerTxn& ltx, LedgerEntry const& entry)
         return s;
     }
 
-    if (fromDb.current() == entry)
+    if (*fromDb == entry)
     {
         return {};
     }
     else
     {
         std::string s{"Inconsistent state between objects: "};
-        s += xdr_to_string(fromDb.current(), "db");
+        s += xdr_to_string(*fromDb, "db");
         s += xdr_to_string(entry, "live");
         return s;
     }
 }
 
+static std::string
+checkAgainstDatabase(AbstractLedgerTxn& ltx, LedgerEntry const& entry)
+{
+    auto fromDb = ltx.loadWithoutRecord(LedgerEntryKey(entry));
+    return checkAgainstDatabase(fromDb ? &fromDb.current() : nullptr, entry);
+}
+
 static std::string
 checkAgainstDatabase(AbstractLedgerTxn& ltx, LedgerKey const& key)
 {
@@ -160,42 +172,101 @@ struct EntryCounts
     }
 };
 
+// Entries checked per bulk load from the database by checkEntireBucketlist.
+static size_t const ENTIRE_BUCKETLIST_BATCH_SIZE = 1000;
+
+using BucketLedgerMap = std::map<LedgerKey, LedgerEntry>;
+
+// Checks the live entries in [begin, end), which are consecutive in key
+// order and so mostly of one type, with one bulk load per entry type.
+static std::string
+checkBatchAgainstDatabase(LedgerTxnRoot const& root, soci::session& session,
+                          BucketLedgerMap::const_iterator begin,
+                          BucketLedgerMap::const_iterator end)
+{
+    UnorderedSet<LedgerKey> keys;
+    for (auto iter = begin; iter != end; ++iter)
+    {
+        keys.emplace(iter->first);
+    }
+    auto fromDb = root.loadFromDatabase(keys, session);
+    for (auto iter = begin; iter != end; ++iter)
+    {
+        auto s = checkAgainstDatabase(fromDb.at(iter->first).get(),
+                                      iter->second);
+        if (!s.empty())
+        {
+            return s;
+        }
+    }
+    return {};
+}
+
 void
 BucketListIsConsistentWithDatabase::checkEntireBucketlist()
 {
     auto& lm = mApp.getLedgerManager();
     auto& bm = mApp.getBucketManager();
     HistoryArchiveState has = lm.getLastClosedLedgerHAS();
-    std::map<LedgerKey, LedgerEntry> bucketLedgerMap =
-        bm.loadCompleteLedgerState(has);
+    BucketLedgerMap bucketLedgerMap = bm.loadCompleteLedgerState(has);
     EntryCounts counts;
-    medida::Timer timer(std::chrono::microseconds(1));
+    for (auto const& pair : bucketLedgerMap)
+    {
+        counts.countLiveEntry(pair.second);
+    }
+
+    auto& statusManager = mApp.getStatusManager();
+    auto lastProgress = std::chrono::steady_clock::now();
+    auto reportProgress = [&](size_t checked, bool force) {
+        auto now = std::chrono::steady_clock::now();
+        if (!force && now - lastProgress < std::chrono::seconds(5))
+        {
+            return;
+        }
+        lastProgress = now;
+        auto msg = fmt::format(
+            FMT_STRING("Checked bucket-vs-DB consistency for {:d}/{:d} "
+                       "entries"),
+            checked, bucketLedgerMap.size());
+        CLOG_INFO(Ledger, "{}", msg);
+        statusManager.setStatusMessage(
+            StatusCategory::BUCKETLIST_CONSISTENCY_CHECK, msg);
+    };
 
+    try
     {
-        LedgerTxn ltx(mApp.getLedgerTxnRoot());
-        for (auto const& pair : bucketLedgerMap)
+        // An in-memory ledger is not in the database, so it is only
+        // reachable through LedgerTxns.
+        auto root = dynamic_cast<LedgerTxnRoot*>(&mApp.getLedgerTxnRoot());
+        if (root)
         {
-            counts.countLiveEntry(pair.second);
-            std::string s;
-            timer.Time([&]() { s = checkAgainstDatabase(ltx, pair.second); });
-            if (!s.empty())
-            {
-                throw std::runtime_error(s);
-            }
-            auto i = counts.totalEntries();
-            if ((i & 0x7ffff) == 0)
+            checkEntriesAgainstDatabase(*root, bucketLedgerMap,
+                                        reportProgress);
+        }
+        else
+        {
+            LedgerTxn ltx(mApp.getLedgerTxnRoot());
+            size_t checked = 0;
+            for (auto const& pair : bucketLedgerMap)
             {
-                using namespace std::chrono;
-                nanoseconds ns = timer.duration_unit() *
-                                 static_cast<nanoseconds::rep>(timer.mean());
-                microseconds us = duration_cast<microseconds>(ns);
-                CLOG_INFO(Ledger,
-                          "Checked bucket-vs-DB consistency for "
-                          "{} entries (mean {}/entry)",
-                          i, us);
+                auto s = checkAgainstDatabase(ltx, pair.second);
+                if (!s.empty())
+                {
+                    throw std::runtime_error(s);
+                }
+                reportProgress(++checked, false);
             }
         }
+        reportProgress(bucketLedgerMap.size(), true);
+    }
+    catch (...)
+    {
+        statusManager.removeStatusMessage(
+            StatusCategory::BUCKETLIST_CONSISTENCY_CHECK);
+        throw;
     }
+    statusManager.removeStatusMessage(
+        StatusCategory::BUCKETLIST_CONSISTENCY_CHECK);
 
     // Count functionality does not support in-memory LedgerTxn
     if (!mApp.getConfig().isInMemoryMode())
@@ -211,6 +282,123 @@ BucketListIsConsistentWithDatabase::checkEntireBucketlist()
     }
 }
 
+void
+BucketListIsConsistentWithDatabase::checkEntriesAgainstDatabase(
+    LedgerTxnRoot& root, BucketLedgerMap const& entries,
+    std::function<void(size_t, bool)> const& reportProgress)
+{
+    root.waitForWriteBehind();
+
+    std::vector<BucketLedgerMap::const_iterator> batchStarts;
+    size_t i = 0;
+    for (auto iter = entries.begin(); iter != entries.end(); ++iter, ++i)
+    {
+        if (i % ENTIRE_BUCKETLIST_BATCH_SIZE == 0)
+        {
+            batchStarts.emplace_back(iter);
+        }
+    }
+    batchStarts.emplace_back(entries.end());
+
+    // Batches are claimed in order by whichever thread is free, and the
+    // first inconsistency found stops all threads.
+    std::atomic<size_t> nextBatch{0};
+    std::atomic<size_t> checked{0};
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::string error;
+    auto setError = [&](std::string const& s) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (error.empty())
+        {
+            error = s;
+        }
+    };
+    auto checkBatches = [&](soci::session& session,
+                            std::function<void()> const& afterBatch) {
+        while (true)
+        {
+            size_t batch = nextBatch++;
+            if (batch + 1 >= batchStarts.size())
+            {
+                return;
+            }
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (!error.empty())
+                {
+                    return;
+                }
+            }
+            auto s = checkBatchAgainstDatabase(root, session,
+                                               batchStarts[batch],
+                                               batchStarts[batch + 1]);
+            if (!s.empty())
+            {
+                setError(s);
+                return;
+            }
+            checked += static_cast<size_t>(
+                std::distance(batchStarts[batch], batchStarts[batch + 1]));
+            afterBatch();
+        }
+    };
+
+    // The pool is created lazily and not thread-safe to create, so do it
+    // here. A single session is better used from this thread.
+    auto& db = mApp.getDatabase();
+    auto pool = db.canUsePool() ? &db.getPool() : nullptr;
+    if (!pool || db.getPoolSize() <= 1)
+    {
+        checkBatches(db.getSession(),
+                     [&]() { reportProgress(checked, false); });
+    }
+    else
+    {
+        size_t nThreads = db.getPoolSize();
+        size_t running = nThreads;
+        std::vector<std::thread> threads;
+        for (size_t t = 0; t < nThreads; ++t)
+        {
+            threads.emplace_back([&]() {
+                runCurrentThreadWithLowPriority();
+                try
+                {
+                    soci::session session(*pool);
+                    checkBatches(session, []() {});
+                }
+                catch (std::exception& e)
+                {
+                    setError(e.what());
+                }
+                std::lock_guard<std::mutex> lock(mutex);
+                --running;
+                cv.notify_all();
+            });
+        }
+
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            while (!cv.wait_for(lock, std::chrono::seconds(1),
+                                [&]() { return running == 0; }))
+            {
+                lock.unlock();
+                reportProgress(checked, false);
+                lock.lock();
+            }
+        }
+        for (auto& thread : threads)
+        {
+            thread.join();
+        }
+    }
+
+    if (!error.empty())
+    {
+        throw std::runtime_error(error);
+    }
+}
+
 std::string
 BucketListIsConsistentWithDatabase::checkOnBucketApply(
     std::shared_ptr<Bucket const> bucket, uint32_t oldestLedger,
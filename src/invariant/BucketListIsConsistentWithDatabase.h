@@ -5,11 +5,15 @@
 // of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
 
 #include "invariant/Invariant.h"
+#include <map>
 
 namespace stellar
 {
 
 class Application;
+struct LedgerEntry;
+struct LedgerKey;
+class LedgerTxnRoot;
 
 // This Invariant is used to validate that the BucketList and Database are
 // in a consistent state after a bucket apply, such as during catchup-minimal.
@@ -40,9 +44,16 @@ class BucketListIsConsistentWithDatabase : public Invariant
 
     // Secondary entrypoint to database-vs-bucket consistency checking, designed
     // to be run offline via self-check. Throws an exception on any error.
+    // Entries are compared in batches of consecutive keys, bulk loaded from
+    // the database by worker threads, and progress is reported through the
+    // StatusManager.
     void checkEntireBucketlist();
 
   private:
     Application& mApp;
+
+    void checkEntriesAgainstDatabase(
+        LedgerTxnRoot& root, std::map<LedgerKey, LedgerEntry> const& entries,
+        std::function<void(size_t, bool)> const& reportProgress);
 };
 }
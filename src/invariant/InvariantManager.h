@@ -44,6 +44,18 @@ class InvariantManager
                                        OperationResult const& opres,
                                        LedgerTxnDelta const& ltxDelta) = 0;
 
+    // From now on, check operations on background threads, one per enabled
+    // invariant, rather than in checkOnOperationApply. Failures are then
+    // reported by a later call to checkOnOperationApply (or to
+    // waitForOperationChecks, which ledger close calls once its transactions
+    // are applied): checkOnOperationApply blocks while maxBacklog operations
+    // are still waiting to be checked.
+    virtual void enableAsyncOperationChecks(size_t maxBacklog) = 0;
+
+    // Wait until every operation passed to checkOnOperationApply so far is
+    // checked, and report failures.
+    virtual void waitForOperationChecks() = 0;
+
     virtual void registerInvariant(std::shared_ptr<Invariant> invariant) = 0;
 
     virtual void enableInvariant(std::string const& name) = 0;
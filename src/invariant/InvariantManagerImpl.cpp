@@ -13,12 +13,15 @@
 #include "main/Application.h"
 #include "main/ErrorMessages.h"
 #include "util/Logging.h"
+#include "util/Thread.h"
 #include "util/XDRCereal.h"
 #include <fmt/format.h>
 
 #include "medida/counter.h"
 #include "medida/metrics_registry.h"
+#include "medida/timer.h"
 
+#include <algorithm>
 #include <memory>
 #include <numeric>
 #include <regex>
@@ -33,11 +36,33 @@ InvariantManager::create(Application& app)
 }
 
 InvariantManagerImpl::InvariantManagerImpl(medida::MetricsRegistry& registry)
-    : mInvariantFailureCount(
+    : mMetrics(registry)
+    , mInvariantFailureCount(
           registry.NewCounter({"ledger", "invariant", "failure"}))
+    , mOperationCheckBacklog(
+          registry.NewCounter({"ledger", "invariant", "backlog"}))
 {
 }
 
+InvariantManagerImpl::~InvariantManagerImpl()
+{
+    {
+        std::lock_guard<std::mutex> lock(mAsyncMutex);
+        mAsyncStopping = true;
+    }
+    mAsyncCV.notify_all();
+    for (auto& checker : mAsyncCheckers)
+    {
+        checker->mThread.join();
+    }
+    // Failures can't be thrown from here, they were normally reported by
+    // waitForOperationChecks when shutting down.
+    for (auto const& failure : mAsyncFailures)
+    {
+        CLOG_ERROR(Invariant, "{}", failure.mMessage);
+    }
+}
+
 Json::Value
 InvariantManagerImpl::getJsonInfo()
 {
@@ -79,6 +104,10 @@ InvariantManagerImpl::checkOnBucketApply(
     uint32_t newestLedger = oldestLedger - 1 +
                             (isCurr ? BucketList::sizeOfCurr(ledger, level)
                                     : BucketList::sizeOfSnap(ledger, level));
+
+    // Invariants are only ever run by one thread at a time.
+    waitForOperationChecks();
+
     for (auto invariant : mEnabled)
     {
         auto result = invariant->checkOnBucketApply(
@@ -107,21 +136,193 @@ InvariantManagerImpl::checkOnOperationApply(Operation const& operation,
         return;
     }
 
-    for (auto invariant : mEnabled)
+    if (mAsyncMaxBacklog == 0 || mEnabled.empty())
     {
-        auto result =
-            invariant->checkOnOperationApply(operation, opres, ltxDelta);
-        if (result.empty())
+        for (size_t i = 0; i < mEnabled.size(); ++i)
         {
-            continue;
+            auto message = checkOperation(*mEnabled[i], *mCheckTimers[i],
+                                          operation, opres, ltxDelta);
+            if (!message.empty())
+            {
+                onInvariantFailure(mEnabled[i], message,
+                                   ltxDelta.header.current.ledgerSeq);
+            }
         }
+        return;
+    }
 
-        auto message = fmt::format(
-            FMT_STRING(R"(Invariant "{}" does not hold on operation: {}{}{})"),
-            invariant->getName(), result, "\n",
-            xdr_to_string(operation, "Operation"));
-        onInvariantFailure(invariant, message,
-                           ltxDelta.header.current.ledgerSeq);
+    // The checker threads get their own copies of the entries, which the
+    // LedgerTxn hierarchy could otherwise modify while they are checked.
+    auto check = std::make_shared<OperationCheck>();
+    check->mOperation = operation;
+    check->mResult = opres;
+    check->mDelta.header = ltxDelta.header;
+    for (auto const& kv : ltxDelta.entry)
+    {
+        auto& entryDelta = check->mDelta.entry[kv.first];
+        if (kv.second.current)
+        {
+            entryDelta.current =
+                std::make_shared<InternalLedgerEntry const>(*kv.second.current);
+        }
+        if (kv.second.previous)
+        {
+            entryDelta.previous = std::make_shared<InternalLedgerEntry const>(
+                *kv.second.previous);
+        }
+    }
+
+    std::vector<AsyncFailure> failures;
+    {
+        std::unique_lock<std::mutex> lock(mAsyncMutex);
+        mAsyncCV.wait(lock, [this]() {
+            return getAsyncBacklog() < mAsyncMaxBacklog;
+        });
+        for (auto& checker : mAsyncCheckers)
+        {
+            checker->mQueue.emplace_back(check);
+        }
+        mOperationCheckBacklog.set_count(getAsyncBacklog());
+        failures.swap(mAsyncFailures);
+    }
+    mAsyncCV.notify_all();
+    reportAsyncFailures(failures);
+}
+
+std::string
+InvariantManagerImpl::checkOperation(Invariant& invariant,
+                                     medida::Timer& timer,
+                                     Operation const& operation,
+                                     OperationResult const& opres,
+                                     LedgerTxnDelta const& ltxDelta)
+{
+    std::string result;
+    {
+        auto timeScope = timer.TimeScope();
+        result = invariant.checkOnOperationApply(operation, opres, ltxDelta);
+    }
+    if (result.empty())
+    {
+        return result;
+    }
+    return fmt::format(
+        FMT_STRING(R"(Invariant "{}" does not hold on operation: {}{}{})"),
+        invariant.getName(), result, "\n",
+        xdr_to_string(operation, "Operation"));
+}
+
+void
+InvariantManagerImpl::enableAsyncOperationChecks(size_t maxBacklog)
+{
+    if (maxBacklog == 0)
+    {
+        throw std::invalid_argument(
+            "Backlog of asynchronous invariant checks must be positive");
+    }
+    if (mAsyncMaxBacklog != 0)
+    {
+        throw std::runtime_error(
+            "Asynchronous invariant checks already enabled");
+    }
+
+    mAsyncMaxBacklog = maxBacklog;
+    for (size_t i = 0; i < mEnabled.size(); ++i)
+    {
+        mAsyncCheckers.emplace_back(std::make_unique<AsyncChecker>(
+            AsyncChecker{mEnabled[i], *mCheckTimers[i], {}, {}}));
+    }
+    for (auto& checker : mAsyncCheckers)
+    {
+        auto c = checker.get();
+        c->mThread = std::thread([this, c]() {
+            runCurrentThreadWithLowPriority();
+            runAsyncChecker(*c);
+        });
+    }
+    CLOG_INFO(Invariant,
+              "Checking invariants on operations asynchronously, at most {} "
+              "operations behind",
+              maxBacklog);
+}
+
+void
+InvariantManagerImpl::waitForOperationChecks()
+{
+    std::vector<AsyncFailure> failures;
+    {
+        std::unique_lock<std::mutex> lock(mAsyncMutex);
+        mAsyncCV.wait(lock, [this]() { return getAsyncBacklog() == 0; });
+        mOperationCheckBacklog.set_count(0);
+        failures.swap(mAsyncFailures);
+    }
+    reportAsyncFailures(failures);
+}
+
+size_t
+InvariantManagerImpl::getAsyncBacklog() const
+{
+    size_t backlog = 0;
+    for (auto const& checker : mAsyncCheckers)
+    {
+        backlog = std::max(backlog, checker->mQueue.size());
+    }
+    return backlog;
+}
+
+void
+InvariantManagerImpl::runAsyncChecker(AsyncChecker& checker)
+{
+    std::unique_lock<std::mutex> lock(mAsyncMutex);
+    while (true)
+    {
+        mAsyncCV.wait(lock, [&]() {
+            return mAsyncStopping || !checker.mQueue.empty();
+        });
+        // Queued operations are still checked when stopping.
+        if (checker.mQueue.empty())
+        {
+            return;
+        }
+
+        // The operation stays queued, and so counts towards the backlog,
+        // until it is checked.
+        auto check = checker.mQueue.front();
+        lock.unlock();
+        std::string message;
+        try
+        {
+            message =
+                checkOperation(*checker.mInvariant, checker.mTimer,
+                               check->mOperation, check->mResult, check->mDelta);
+        }
+        catch (std::exception& e)
+        {
+            message = fmt::format(
+                FMT_STRING(R"(Invariant "{}" threw on operation: {})"),
+                checker.mInvariant->getName(), e.what());
+        }
+        lock.lock();
+
+        checker.mQueue.pop_front();
+        mOperationCheckBacklog.set_count(getAsyncBacklog());
+        if (!message.empty())
+        {
+            mAsyncFailures.emplace_back(
+                AsyncFailure{checker.mInvariant, std::move(message),
+                             check->mDelta.header.current.ledgerSeq});
+        }
+        mAsyncCV.notify_all();
+    }
+}
+
+void
+InvariantManagerImpl::reportAsyncFailures(
+    std::vector<AsyncFailure> const& failures)
+{
+    for (auto const& failure : failures)
+    {
+        onInvariantFailure(failure.mInvariant, failure.mMessage,
+                           failure.mLedger);
     }
 }
 
@@ -161,6 +362,12 @@ InvariantManagerImpl::enableInvariant(std::string const& invPattern)
                         invPattern, e.what()));
     }
 
+    if (mAsyncMaxBacklog != 0)
+    {
+        throw std::runtime_error("Cannot enable invariants once they are "
+                                 "checked asynchronously");
+    }
+
     bool enabledSome = false;
     for (auto const& inv : mInvariants)
     {
@@ -172,6 +379,8 @@ InvariantManagerImpl::enableInvariant(std::string const& invPattern)
             {
                 enabledSome = true;
                 mEnabled.push_back(inv.second);
+                mCheckTimers.push_back(&mMetrics.NewTimer(
+                    {"ledger", "invariant", "check-" + name}));
                 CLOG_INFO(Invariant, "Enabled invariant '{}'", name);
             }
             else
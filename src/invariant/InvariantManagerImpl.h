@@ -5,13 +5,19 @@
 // of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
 
 #include "invariant/InvariantManager.h"
+#include "ledger/LedgerTxn.h"
+#include <condition_variable>
+#include <deque>
 #include <map>
+#include <mutex>
+#include <thread>
 #include <vector>
 
 namespace medida
 {
 class MetricsRegistry;
 class Counter;
+class Timer;
 }
 
 namespace stellar
@@ -19,9 +25,13 @@ namespace stellar
 
 class InvariantManagerImpl : public InvariantManager
 {
+    medida::MetricsRegistry& mMetrics;
     std::map<std::string, std::shared_ptr<Invariant>> mInvariants;
     std::vector<std::shared_ptr<Invariant>> mEnabled;
+    // Timers of operation checks, parallel to mEnabled.
+    std::vector<medida::Timer*> mCheckTimers;
     medida::Counter& mInvariantFailureCount;
+    medida::Counter& mOperationCheckBacklog;
 
     struct InvariantFailureInformation
     {
@@ -30,8 +40,42 @@ class InvariantManagerImpl : public InvariantManager
     };
     std::map<std::string, InvariantFailureInformation> mFailureInformation;
 
+    // State of asynchronous operation checks (see enableAsyncOperationChecks).
+    // Each checker thread checks the operations in its queue, in order, with
+    // one invariant; the operations, copied along with their deltas, are
+    // shared by all queues. Failures are handed back to the main thread in
+    // mAsyncFailures. Once mAsyncStopping is set, the threads exit after
+    // emptying their queues. The queues, mAsyncFailures and mAsyncStopping are
+    // guarded by mAsyncMutex.
+    struct OperationCheck
+    {
+        Operation mOperation;
+        OperationResult mResult;
+        LedgerTxnDelta mDelta;
+    };
+    struct AsyncChecker
+    {
+        std::shared_ptr<Invariant> mInvariant;
+        medida::Timer& mTimer;
+        std::deque<std::shared_ptr<OperationCheck const>> mQueue;
+        std::thread mThread;
+    };
+    struct AsyncFailure
+    {
+        std::shared_ptr<Invariant> mInvariant;
+        std::string mMessage;
+        uint32_t mLedger;
+    };
+    std::vector<std::unique_ptr<AsyncChecker>> mAsyncCheckers;
+    size_t mAsyncMaxBacklog{0};
+    std::mutex mAsyncMutex;
+    std::condition_variable mAsyncCV;
+    std::vector<AsyncFailure> mAsyncFailures;
+    bool mAsyncStopping{false};
+
   public:
     InvariantManagerImpl(medida::MetricsRegistry& registry);
+    ~InvariantManagerImpl();
 
     virtual Json::Value getJsonInfo() override;
 
@@ -41,6 +85,10 @@ class InvariantManagerImpl : public InvariantManager
                                        OperationResult const& opres,
                                        LedgerTxnDelta const& ltxDelta) override;
 
+    virtual void enableAsyncOperationChecks(size_t maxBacklog) override;
+
+    virtual void waitForOperationChecks() override;
+
     virtual void checkOnBucketApply(
         std::shared_ptr<Bucket const> bucket, uint32_t ledger, uint32_t level,
         bool isCurr,
@@ -57,6 +105,15 @@ class InvariantManagerImpl : public InvariantManager
 #endif // BUILD_TESTS
 
   private:
+    std::string checkOperation(Invariant& invariant, medida::Timer& timer,
+                               Operation const& operation,
+                               OperationResult const& opres,
+                               LedgerTxnDelta const& ltxDelta);
+
+    size_t getAsyncBacklog() const;
+    void runAsyncChecker(AsyncChecker& checker);
+    void reportAsyncFailures(std::vector<AsyncFailure> const& failures);
+
     void onInvariantFailure(std::shared_ptr<Invariant> invariant,
                             std::string const& message, uint32_t ledger);
 
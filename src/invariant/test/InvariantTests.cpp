@@ -216,3 +216,42 @@ TEST_CASE("onOperationApply fail succeed", "[invariant]")
             {}, res, ltx.getDelta()));
     }
 }
+
+TEST_CASE("onOperationApply asynchronous", "[invariant]")
+{
+    VirtualClock clock;
+    Config cfg = getTestConfig();
+    Application::pointer app = createTestApplication(clock, cfg);
+    auto& im = app->getInvariantManager();
+
+    OperationResult res;
+    im.registerInvariant<TestInvariant>(0, false);
+    im.enableInvariant(TestInvariant::toString(0, false));
+    SECTION("Fail")
+    {
+        im.registerInvariant<TestInvariant>(1, true);
+        im.enableInvariant(TestInvariant::toString(1, true));
+        im.enableAsyncOperationChecks(2);
+
+        LedgerTxn ltx(app->getLedgerTxnRoot());
+        // The first operation is only checked after it is queued, so its
+        // failure is reported later.
+        REQUIRE_NOTHROW(im.checkOnOperationApply({}, res, ltx.getDelta()));
+        REQUIRE_THROWS_AS(im.waitForOperationChecks(), InvariantDoesNotHold);
+        REQUIRE_NOTHROW(im.waitForOperationChecks());
+    }
+    SECTION("Succeed")
+    {
+        im.registerInvariant<TestInvariant>(1, true);
+        im.enableAsyncOperationChecks(2);
+        REQUIRE_THROWS_AS(im.enableInvariant(TestInvariant::toString(1, true)),
+                          std::runtime_error);
+
+        LedgerTxn ltx(app->getLedgerTxnRoot());
+        for (int i = 0; i < 100; ++i)
+        {
+            REQUIRE_NOTHROW(im.checkOnOperationApply({}, res, ltx.getDelta()));
+        }
+        REQUIRE_NOTHROW(im.waitForOperationChecks());
+    }
+}
@@ -16,6 +16,7 @@
 #include "herder/TxSetFrame.h"
 #include "herder/Upgrades.h"
 #include "history/HistoryManager.h"
+#include "invariant/InvariantManager.h"
 #include "ledger/FlushAndRotateMetaDebugWork.h"
 #include "ledger/LedgerHeaderUtils.h"
 #include "ledger/LedgerRange.h"
@@ -50,7 +51,10 @@
 #include "medida/timer.h"
 #include <Tracy.hpp>
 
+#include <atomic>
 #include <chrono>
+#include <condition_variable>
+#include <mutex>
 #include <numeric>
 #include <regex>
 #include <sstream>
@@ -122,6 +126,8 @@ LedgerManagerImpl::LedgerManagerImpl(Application& app)
     : mApp(app)
     , mTransactionApply(
           app.getMetrics().NewTimer({"ledger", "transaction", "apply"}))
+    , mSignaturePreVerify(app.getMetrics().NewTimer(
+          {"ledger", "transaction", "sig-preverify"}))
     , mTransactionCount(
           app.getMetrics().NewHistogram({"ledger", "transaction", "count"}))
     , mOperationCount(
@@ -664,6 +670,9 @@ LedgerManagerImpl::closeLedger(LedgerCloseData const& ledgerData)
     TransactionResultSet txResultSet;
     txResultSet.results.reserve(txs.size());
     applyTransactions(txs, ltx, txResultSet, ledgerCloseMeta, curBaseFee);
+    // Operations may have been checked in the background: report any failure
+    // before this ledger is committed.
+    mApp.getInvariantManager().waitForOperationChecks();
 
     ltx.loadHeader().current().txSetResultHash = xdrSha256(txResultSet);
 
@@ -1080,6 +1089,80 @@ LedgerManagerImpl::prefetchTransactionData(
     }
 }
 
+namespace
+{
+// Signatures pending pre-verification, drained cooperatively by the main
+// thread and any worker threads that pick up a helper job. It is shared by
+// pointer since helpers may only get scheduled once the main thread has
+// already finished the work and moved on.
+struct SignaturePreVerifyState
+{
+    std::vector<PubKeyUtils::SignatureToVerify> mSigs;
+    std::atomic<size_t> mNext{0};
+    std::atomic<size_t> mDone{0};
+    std::mutex mMutex;
+    std::condition_variable mDoneCV;
+
+    void
+    drain()
+    {
+        size_t i;
+        while ((i = mNext.fetch_add(1)) < mSigs.size())
+        {
+            auto const& s = mSigs[i];
+            PubKeyUtils::verifySig(s.key, s.signature, s.hash);
+            if (mDone.fetch_add(1) + 1 == mSigs.size())
+            {
+                std::lock_guard<std::mutex> guard(mMutex);
+                mDoneCV.notify_all();
+            }
+        }
+    }
+};
+
+// Below this many signatures per helper, posting to the worker threads costs
+// more than it saves.
+size_t const MIN_SIGNATURES_PER_PREVERIFY_HELPER = 16;
+}
+
+void
+LedgerManagerImpl::preVerifyTransactionSignatures(
+    std::vector<TransactionFrameBasePtr>& txs, AbstractLedgerTxn& ltx)
+{
+    ZoneScoped;
+    auto timer = mSignaturePreVerify.TimeScope();
+
+    auto state = std::make_shared<SignaturePreVerifyState>();
+    for (auto const& tx : txs)
+    {
+        tx->insertSignaturesForTxApply(ltx, state->mSigs);
+    }
+    auto const numSigs = state->mSigs.size();
+    if (numSigs == 0)
+    {
+        return;
+    }
+
+    // Verification only populates the process-wide signature cache, so the
+    // results themselves are discarded here; the apply loop below will then
+    // find every signature it checks in the cache.
+    auto helpers = std::min<size_t>(
+        static_cast<size_t>(mApp.getConfig().WORKER_THREADS),
+        numSigs / MIN_SIGNATURES_PER_PREVERIFY_HELPER);
+    for (size_t i = 0; i < helpers; ++i)
+    {
+        mApp.postOnBackgroundThread([state]() { state->drain(); },
+                                    "LedgerManager: pre-verify signatures");
+    }
+
+    // The main thread takes part in the work too, so it never waits on a
+    // helper that is queued behind a long-running job such as a merge: at
+    // worst it waits for the few verifications already in flight.
+    state->drain();
+    std::unique_lock<std::mutex> lock(state->mMutex);
+    state->mDoneCV.wait(lock, [&]() { return state->mDone == numSigs; });
+}
+
 void
 LedgerManagerImpl::applyTransactions(
     std::vector<TransactionFrameBasePtr>& txs, AbstractLedgerTxn& ltx,
@@ -1109,6 +1192,10 @@ LedgerManagerImpl::applyTransactions(
     }
 
     prefetchTransactionData(txs);
+    if (mApp.getConfig().PARALLEL_SIGNATURE_PREVERIFICATION)
+    {
+        preVerifyTransactionSignatures(txs, ltx);
+    }
 
     for (auto tx : txs)
     {
@@ -49,6 +49,7 @@ class LedgerManagerImpl : public LedgerManager
 
   private:
     medida::Timer& mTransactionApply;
+    medida::Timer& mSignaturePreVerify;
     medida::Histogram& mTransactionCount;
     medida::Histogram& mOperationCount;
     medida::Histogram& mPrefetchHitRate;
@@ -79,6 +80,9 @@ class LedgerManagerImpl : public LedgerManager
     void storeCurrentLedger(LedgerHeader const& header);
     void prefetchTransactionData(std::vector<TransactionFrameBasePtr>& txs);
     void prefetchTxSourceIds(std::vector<TransactionFrameBasePtr>& txs);
+    void
+    preVerifyTransactionSignatures(std::vector<TransactionFrameBasePtr>& txs,
+                                   AbstractLedgerTxn& ltx);
     void closeLedgerIf(LedgerCloseData const& ledgerData);
 
     State mState;
@@ -3,6 +3,7 @@
 // of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
 
 #include "ledger/LedgerTxn.h"
+#include "bucket/BucketList.h"
 #include "crypto/Hex.h"
 #include "crypto/KeyUtils.h"
 #include "crypto/SecretKey.h"
@@ -249,6 +250,12 @@ AbstractLedgerTxnParent::~AbstractLedgerTxnParent()
 {
 }
 
+std::shared_ptr<Arena>
+AbstractLedgerTxnParent::getArena() const
+{
+    return nullptr;
+}
+
 // Implementation of EntryIterator --------------------------------------------
 EntryIterator::EntryIterator(std::unique_ptr<AbstractImpl>&& impl)
     : mImpl(std::move(impl))
@@ -335,7 +342,9 @@ LedgerTxn::Impl::Impl(LedgerTxn& self, AbstractLedgerTxnParent& parent,
                       bool shouldUpdateLastModified, TransactionMode mode)
     : mParent(parent)
     , mChild(nullptr)
+    , mArena(mParent.getArena())
     , mHeader(std::make_unique<LedgerHeader>(mParent.getHeader()))
+    , mEntry(EntryMap::allocator_type(mArena))
     , mShouldUpdateLastModified(shouldUpdateLastModified)
     , mIsSealed(false)
     , mConsistency(LedgerTxnConsistency::EXACT)
@@ -426,6 +435,13 @@ LedgerTxn::Impl::throwIfNotExactConsistency() const
     }
 }
 
+std::shared_ptr<InternalLedgerEntry>
+LedgerTxn::Impl::makeEntry(InternalLedgerEntry const& entry) const
+{
+    return std::allocate_shared<InternalLedgerEntry>(
+        ArenaAllocator<InternalLedgerEntry>(mArena), entry);
+}
+
 void
 LedgerTxn::commit() noexcept
 {
@@ -593,7 +609,7 @@ LedgerTxn::Impl::create(LedgerTxn& self, InternalLedgerEntry const& entry)
         throw std::runtime_error("Key already exists");
     }
 
-    auto current = std::make_shared<InternalLedgerEntry>(entry);
+    auto current = makeEntry(entry);
     auto impl = LedgerTxnEntry::makeSharedImpl(self, *current);
 
     // Set the key to active before constructing the LedgerTxnEntry, as this
@@ -639,7 +655,7 @@ LedgerTxn::Impl::createWithoutLoading(InternalLedgerEntry const& entry)
     // INIT instead, the key would've been annihilated.
     updateEntry(
         key, /* keyHint */ nullptr,
-        LedgerEntryPtr::Init(std::make_shared<InternalLedgerEntry>(entry)),
+        LedgerEntryPtr::Init(makeEntry(entry)),
         /* effectiveActive */ false);
 }
 
@@ -664,7 +680,7 @@ LedgerTxn::Impl::updateWithoutLoading(InternalLedgerEntry const& entry)
 
     updateEntry(
         key, /* keyHint */ nullptr,
-        LedgerEntryPtr::Live(std::make_shared<InternalLedgerEntry>(entry)),
+        LedgerEntryPtr::Live(makeEntry(entry)),
         /* effectiveActive */ false);
 }
 
@@ -1565,7 +1581,7 @@ LedgerTxn::Impl::load(LedgerTxn& self, InternalLedgerKey const& key)
     else
     {
         currentEntryPtr = LedgerEntryPtr::Live(
-            std::make_shared<InternalLedgerEntry>(*newest.first));
+            makeEntry(*newest.first));
     }
 
     releaseAssert(currentEntryPtr.has_value());
@@ -2274,6 +2290,18 @@ LedgerTxn::Impl::prepareNewObjects(size_t s)
     mEntry.reserve(newSize);
 }
 
+std::shared_ptr<Arena>
+LedgerTxn::getArena() const
+{
+    return getImpl()->getArena();
+}
+
+std::shared_ptr<Arena>
+LedgerTxn::Impl::getArena() const
+{
+    return mArena;
+}
+
 #ifdef BUILD_TESTS
 UnorderedMap<AssetPair,
              std::map<OfferDescriptor, LedgerKey, IsBetterOfferComparator>,
@@ -2387,6 +2415,7 @@ LedgerTxnRoot::Impl::Impl(Database& db, size_t entryCacheSize,
     , mEntryCache(entryCacheSize)
     , mBulkLoadBatchSize(prefetchBatchSize)
     , mChild(nullptr)
+    , mArena(std::make_shared<Arena>())
 #ifdef BEST_OFFER_DEBUGGING
     , mBestOfferDebuggingEnabled(bestOfferDebuggingEnabled)
 #endif
@@ -2403,13 +2432,14 @@ LedgerTxnRoot::Impl::~Impl()
     {
         mChild->rollback();
     }
+    disableWriteBehind();
 }
 
 #ifdef BUILD_TESTS
 void
 LedgerTxnRoot::Impl::resetForFuzzer()
 {
-    mBestOffers.clear();
+    clearOrderBooks();
     mEntryCache.clear();
 }
 
@@ -2436,6 +2466,9 @@ LedgerTxnRoot::Impl::addChild(AbstractLedgerTxn& child, TransactionMode mode)
 
     if (mode == TransactionMode::READ_WRITE_WITH_SQL_TXN)
     {
+        // The snapshot of the new SQL transaction must include everything
+        // committed before it.
+        drainWriteBehind();
         mTransaction =
             std::make_unique<soci::transaction>(mDatabase.getSession());
     }
@@ -2613,6 +2646,14 @@ LedgerTxnRoot::Impl::commitChild(EntryIterator iter,
     {
         while ((bool)iter)
         {
+            if (mWriteBehindSession &&
+                iter.key().type() == InternalLedgerEntryType::LEDGER_ENTRY)
+            {
+                mWriteBehindEntries[iter.key().ledgerKey()] =
+                    iter.entryExists() ? std::make_shared<LedgerEntry const>(
+                                             iter.entry().ledgerEntry())
+                                       : nullptr;
+            }
             bleca.accumulate(iter);
             ++iter;
             ++counter;
@@ -2631,6 +2672,21 @@ LedgerTxnRoot::Impl::commitChild(EntryIterator iter,
         mDatabase.clearPreparedStatementCache();
         ZoneNamedN(commitZone, "SOCI commit", true);
         mTransaction->commit();
+
+        if (mWriteBehindSession)
+        {
+            // Hand the entries over even if there are none, so that the
+            // ledger is marked flushed.
+            auto batch = std::make_unique<WriteBehindBatch>();
+            batch->mLedgerSeq = childHeader->ledgerSeq;
+            batch->mOps.swap(mPendingWrites);
+            {
+                std::lock_guard<std::mutex> lock(mWriteBehindMutex);
+                releaseAssert(!mWriteBehindBatch);
+                mWriteBehindBatch = std::move(batch);
+            }
+            mWriteBehindCV.notify_all();
+        }
     }
     catch (std::exception& e)
     {
@@ -2644,7 +2700,6 @@ LedgerTxnRoot::Impl::commitChild(EntryIterator iter,
     }
 
     // Clearing the cache does not throw
-    mBestOffers.clear();
     mEntryCache.clear();
 
     // std::unique_ptr<...>::reset does not throw
@@ -2691,6 +2746,7 @@ LedgerTxnRoot::Impl::countObjects(LedgerEntryType let) const
 {
     using namespace soci;
     throwIfChild();
+    drainWriteBehind();
 
     std::string query =
         "SELECT COUNT(*) FROM " + tableFromLedgerEntryType(let) + ";";
@@ -2712,6 +2768,7 @@ LedgerTxnRoot::Impl::countObjects(LedgerEntryType let,
 {
     using namespace soci;
     throwIfChild();
+    drainWriteBehind();
 
     std::string query = "SELECT COUNT(*) FROM " +
                         tableFromLedgerEntryType(let) +
@@ -2734,8 +2791,9 @@ LedgerTxnRoot::Impl::deleteObjectsModifiedOnOrAfterLedger(uint32_t ledger) const
 {
     using namespace soci;
     throwIfChild();
+    drainWriteBehind();
     mEntryCache.clear();
-    mBestOffers.clear();
+    clearOrderBooks();
 
     for (auto let : xdr::xdr_traits<LedgerEntryType>::enum_values())
     {
@@ -2813,7 +2871,17 @@ LedgerTxnRoot::Impl::prefetch(UnorderedSet<LedgerKey> const& keys)
 
     auto insertIfNotLoaded = [&](UnorderedSet<LedgerKey>& keys,
                                  LedgerKey const& key) {
-        if (!mEntryCache.exists(key, false))
+        if (mEntryCache.exists(key, false))
+        {
+            return;
+        }
+        auto wb = mWriteBehindEntries.find(key);
+        if (wb != mWriteBehindEntries.end())
+        {
+            putInEntryCache(key, wb->second, LoadType::PREFETCH);
+            ++total;
+        }
+        else
         {
             keys.insert(key);
         }
@@ -2827,7 +2895,8 @@ LedgerTxnRoot::Impl::prefetch(UnorderedSet<LedgerKey> const& keys)
             insertIfNotLoaded(accounts, key);
             if (accounts.size() == mBulkLoadBatchSize)
             {
-                cacheResult(bulkLoadAccounts(accounts));
+                cacheResult(mBucketList ? bulkLoadFromBucketList(accounts)
+                                        : bulkLoadAccounts(accounts));
                 accounts.clear();
             }
             break;
@@ -2843,7 +2912,8 @@ LedgerTxnRoot::Impl::prefetch(UnorderedSet<LedgerKey> const& keys)
             insertIfNotLoaded(trustlines, key);
             if (trustlines.size() == mBulkLoadBatchSize)
             {
-                cacheResult(bulkLoadTrustLines(trustlines));
+                cacheResult(mBucketList ? bulkLoadFromBucketList(trustlines)
+                                        : bulkLoadTrustLines(trustlines));
                 trustlines.clear();
             }
             break;
@@ -2875,9 +2945,11 @@ LedgerTxnRoot::Impl::prefetch(UnorderedSet<LedgerKey> const& keys)
     }
 
     //  Prefetch whatever is remaining
-    cacheResult(bulkLoadAccounts(accounts));
+    cacheResult(mBucketList ? bulkLoadFromBucketList(accounts)
+                            : bulkLoadAccounts(accounts));
     cacheResult(bulkLoadOffers(offers));
-    cacheResult(bulkLoadTrustLines(trustlines));
+    cacheResult(mBucketList ? bulkLoadFromBucketList(trustlines)
+                            : bulkLoadTrustLines(trustlines));
     cacheResult(bulkLoadData(data));
     cacheResult(bulkLoadClaimableBalance(claimablebalance));
     cacheResult(bulkLoadLiquidityPool(liquiditypool));
@@ -2912,6 +2984,257 @@ void LedgerTxnRoot::Impl::prepareNewObjects(size_t)
 {
 }
 
+std::shared_ptr<Arena>
+LedgerTxnRoot::getArena() const
+{
+    return mImpl->getArena();
+}
+
+std::shared_ptr<Arena>
+LedgerTxnRoot::Impl::getArena() const
+{
+    return mArena;
+}
+
+void
+LedgerTxnRoot::loadAccountsAndTrustLinesFromBucketList(
+    BucketList const& bucketList)
+{
+    mImpl->loadAccountsAndTrustLinesFromBucketList(bucketList);
+}
+
+void
+LedgerTxnRoot::Impl::loadAccountsAndTrustLinesFromBucketList(
+    BucketList const& bucketList)
+{
+    throwIfChild();
+    mEntryCache.clear();
+    mBucketList = &bucketList;
+}
+
+void
+LedgerTxnRoot::enableWriteBehind(
+    std::function<void(soci::session&, uint32_t)> markFlushed)
+{
+    mImpl->enableWriteBehind(std::move(markFlushed));
+}
+
+void
+LedgerTxnRoot::Impl::enableWriteBehind(
+    std::function<void(soci::session&, uint32_t)> markFlushed)
+{
+    throwIfChild();
+    if (mWriteBehindSession)
+    {
+        throw std::runtime_error("write-behind is already enabled");
+    }
+    // Not leased from the pool, which would shrink it for the process
+    // lifetime.
+    mWriteBehindSession = mDatabase.openDedicatedSession();
+    mMarkFlushed = std::move(markFlushed);
+    mWriteBehindStopping = false;
+    mWriteBehindThread = std::thread([this]() { runWriteBehind(); });
+}
+
+void
+LedgerTxnRoot::disableWriteBehind()
+{
+    mImpl->disableWriteBehind();
+}
+
+void
+LedgerTxnRoot::waitForWriteBehind() const
+{
+    mImpl->waitForWriteBehind();
+}
+
+void
+LedgerTxnRoot::Impl::waitForWriteBehind() const
+{
+    throwIfChild();
+    drainWriteBehind();
+}
+
+UnorderedMap<LedgerKey, std::shared_ptr<LedgerEntry const>>
+LedgerTxnRoot::loadFromDatabase(UnorderedSet<LedgerKey> const& keys,
+                                soci::session& session) const
+{
+    return mImpl->loadFromDatabase(keys, session);
+}
+
+UnorderedMap<LedgerKey, std::shared_ptr<LedgerEntry const>>
+LedgerTxnRoot::Impl::loadFromDatabase(UnorderedSet<LedgerKey> const& keys,
+                                      soci::session& session) const
+{
+    ZoneScoped;
+    std::map<LedgerEntryType, UnorderedSet<LedgerKey>> keysByType;
+    for (auto const& key : keys)
+    {
+        keysByType[key.type()].emplace(key);
+    }
+
+    UnorderedMap<LedgerKey, std::shared_ptr<LedgerEntry const>> res;
+    for (auto const& kv : keysByType)
+    {
+        UnorderedMap<LedgerKey, std::shared_ptr<LedgerEntry const>> loaded;
+        switch (kv.first)
+        {
+        case ACCOUNT:
+            loaded = bulkLoadAccounts(kv.second, session);
+            break;
+        case TRUSTLINE:
+            loaded = bulkLoadTrustLines(kv.second, session);
+            break;
+        case OFFER:
+            loaded = bulkLoadOffers(kv.second, session);
+            break;
+        case DATA:
+            loaded = bulkLoadData(kv.second, session);
+            break;
+        case CLAIMABLE_BALANCE:
+            loaded = bulkLoadClaimableBalance(kv.second, session);
+            break;
+        case LIQUIDITY_POOL:
+            loaded = bulkLoadLiquidityPool(kv.second, session);
+            break;
+        default:
+            throw std::runtime_error("Unknown key type");
+        }
+        res.insert(loaded.begin(), loaded.end());
+    }
+    return res;
+}
+
+void
+LedgerTxnRoot::Impl::disableWriteBehind()
+{
+    throwIfChild();
+    if (!mWriteBehindSession)
+    {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mWriteBehindMutex);
+        mWriteBehindStopping = true;
+    }
+    mWriteBehindCV.notify_all();
+    mWriteBehindThread.join();
+    mWriteBehindEntries.clear();
+    mWriteBehindSession.reset();
+    mMarkFlushed = nullptr;
+}
+
+soci::session&
+LedgerTxnRoot::Impl::getWriteSession()
+{
+    return mWriteBehindSession ? *mWriteBehindSession
+                               : mDatabase.getSession();
+}
+
+void
+LedgerTxnRoot::Impl::executeWrite(
+    std::unique_ptr<DatabaseTypeSpecificOperation<void>> op)
+{
+    if (mWriteBehindSession)
+    {
+        mPendingWrites.emplace_back(std::move(op));
+    }
+    else
+    {
+        mDatabase.doDatabaseTypeSpecificOperation(*op);
+    }
+}
+
+void
+LedgerTxnRoot::Impl::drainWriteBehind() const
+{
+    if (!mWriteBehindSession)
+    {
+        return;
+    }
+    ZoneScoped;
+    {
+        std::unique_lock<std::mutex> lock(mWriteBehindMutex);
+        mWriteBehindCV.wait(lock, [this]() { return !mWriteBehindBatch; });
+    }
+    mWriteBehindEntries.clear();
+}
+
+void
+LedgerTxnRoot::Impl::runWriteBehind()
+{
+    while (true)
+    {
+        WriteBehindBatch* batch;
+        {
+            std::unique_lock<std::mutex> lock(mWriteBehindMutex);
+            mWriteBehindCV.wait(lock, [this]() {
+                return mWriteBehindBatch || mWriteBehindStopping;
+            });
+            if (!mWriteBehindBatch)
+            {
+                return;
+            }
+            // The batch stays pending, so that the main thread keeps serving
+            // its entries from memory, until it is written.
+            batch = mWriteBehindBatch.get();
+        }
+
+        try
+        {
+            ZoneNamedN(writeBehindZone, "write-behind commit", true);
+            soci::transaction tx(*mWriteBehindSession);
+            for (auto& op : batch->mOps)
+            {
+                stellar::doDatabaseTypeSpecificOperation(*mWriteBehindSession,
+                                                         *op);
+            }
+            mMarkFlushed(*mWriteBehindSession, batch->mLedgerSeq);
+            tx.commit();
+        }
+        catch (std::exception& e)
+        {
+            printErrorAndAbort(
+                "fatal error during write-behind commit to LedgerTxnRoot: ",
+                e.what());
+        }
+        catch (...)
+        {
+            printErrorAndAbort("unknown fatal error during write-behind "
+                               "commit to LedgerTxnRoot");
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mWriteBehindMutex);
+            mWriteBehindBatch.reset();
+        }
+        mWriteBehindCV.notify_all();
+    }
+}
+
+UnorderedMap<LedgerKey, std::shared_ptr<LedgerEntry const>>
+LedgerTxnRoot::Impl::bulkLoadFromBucketList(
+    UnorderedSet<LedgerKey> const& keys) const
+{
+    ZoneScoped;
+    ZoneValue(static_cast<int64_t>(keys.size()));
+    releaseAssert(mBucketList);
+    if (keys.empty())
+    {
+        return {};
+    }
+    std::set<LedgerKey, LedgerEntryIdCmp> sortedKeys(keys.begin(), keys.end());
+    return populateLoadedEntries(keys, mBucketList->loadKeys(sortedKeys));
+}
+
+std::shared_ptr<LedgerEntry const>
+LedgerTxnRoot::Impl::loadFromBucketList(LedgerKey const& key) const
+{
+    auto res = bulkLoadFromBucketList({key});
+    auto iter = res.find(key);
+    return iter == res.end() ? nullptr : iter->second;
+}
+
 UnorderedMap<LedgerKey, LedgerEntry>
 LedgerTxnRoot::getAllOffers()
 {
@@ -2922,10 +3245,9 @@ UnorderedMap<LedgerKey, LedgerEntry>
 LedgerTxnRoot::Impl::getAllOffers()
 {
     ZoneScoped;
-    std::vector<LedgerEntry> offers;
     try
     {
-        offers = loadAllOffers();
+        loadOrderBooks();
     }
     catch (std::exception& e)
     {
@@ -2939,10 +3261,10 @@ LedgerTxnRoot::Impl::getAllOffers()
             "unknown fatal error when getting all offers from LedgerTxnRoot");
     }
 
-    UnorderedMap<LedgerKey, LedgerEntry> offersByKey(offers.size());
-    for (auto const& offer : offers)
+    UnorderedMap<LedgerKey, LedgerEntry> offersByKey(mOffersByID.size());
+    for (auto const& kv : mOffersByID)
     {
-        offersByKey.emplace(LedgerEntryKey(offer), offer);
+        offersByKey.emplace(LedgerEntryKey(*kv.second), *kv.second);
     }
     return offersByKey;
 }
@@ -2973,6 +3295,7 @@ LedgerTxnRoot::Impl::getBestOfferSlow(Asset const& buying, Asset const& selling,
                                       OfferDescriptor const* worseThan,
                                       std::unordered_set<int64_t>& exclude)
 {
+    drainWriteBehind();
     size_t const BATCH_SIZE = 1024;
     size_t nOffers = 0;
     std::deque<LedgerEntry> offers;
@@ -3041,76 +3364,14 @@ LedgerTxnRoot::getBestOffer(Asset const& buying, Asset const& selling,
 #endif
 }
 
-static std::deque<LedgerEntry>::const_iterator
-findIncludedOffer(std::deque<LedgerEntry>::const_iterator iter,
-                  std::deque<LedgerEntry>::const_iterator const& end,
-                  OfferDescriptor const* worseThan)
-{
-    if (worseThan)
-    {
-        iter = std::upper_bound(
-            iter, end, *worseThan,
-            static_cast<bool (*)(OfferDescriptor const&, LedgerEntry const&)>(
-                isBetterOffer));
-    }
-    return iter;
-}
-
-std::deque<LedgerEntry>::const_iterator
-LedgerTxnRoot::Impl::loadNextBestOffersIntoCache(BestOffersEntryPtr cached,
-                                                 Asset const& buying,
-                                                 Asset const& selling)
-{
-    auto& offers = cached->bestOffers;
-    if (cached->allLoaded)
-    {
-        return offers.cend();
-    }
-
-    size_t const BATCH_SIZE =
-        std::min(mMaxBestOffersBatchSize,
-                 std::max(MIN_BEST_OFFERS_BATCH_SIZE, offers.size()));
-
-    std::deque<LedgerEntry>::const_iterator iter;
-    try
-    {
-        if (offers.empty())
-        {
-            iter = loadBestOffers(offers, buying, selling, BATCH_SIZE);
-        }
-        else
-        {
-            auto const& oe = offers.back().data.offer();
-            iter = loadBestOffers(offers, buying, selling,
-                                  {oe.price, oe.offerID}, BATCH_SIZE);
-        }
-    }
-    catch (std::exception& e)
-    {
-        printErrorAndAbort(
-            "fatal error when getting best offer from LedgerTxnRoot: ",
-            e.what());
-    }
-    catch (...)
-    {
-        printErrorAndAbort("unknown fatal error when getting best offer "
-                           "from LedgerTxnRoot");
-    }
-
-    cached->allLoaded =
-        static_cast<size_t>(std::distance(iter, offers.cend())) < BATCH_SIZE;
-    return iter;
-}
-
 void
 LedgerTxnRoot::Impl::populateEntryCacheFromBestOffers(
-    std::deque<LedgerEntry>::const_iterator iter,
-    std::deque<LedgerEntry>::const_iterator const& end)
+    OrderBook::const_iterator iter, OrderBook::const_iterator const& end)
 {
     UnorderedSet<LedgerKey> toPrefetch;
-    for (; iter != end; ++iter)
+    for (size_t n = 0; iter != end && n < mMaxBestOffersBatchSize; ++iter, ++n)
     {
-        auto const& oe = iter->data.offer();
+        auto const& oe = iter->second->data.offer();
         toPrefetch.emplace(accountKey(oe.sellerID));
         if (oe.buying.type() != ASSET_TYPE_NATIVE)
         {
@@ -3155,62 +3416,48 @@ LedgerTxnRoot::Impl::getBestOffer(Asset const& buying, Asset const& selling,
 {
     ZoneScoped;
 
-    // Note: Elements of mBestOffers are properly sorted lists of the best
-    // offers for a certain asset pair. This function maintaints the invariant
-    // that the lists of best offers remain properly sorted. The sort order is
-    // that determined by loadBestOffers and isBetterOffer (both induce the same
-    // order).
-    auto cached = getFromBestOffers(buying, selling);
-    auto& offers = cached->bestOffers;
-
-    // Batch-load best offers until an offer worse than *worseThan is found
-    // (or until any offer is found if !worseThan)
-    size_t initialBestOffersSize = offers.size();
-    auto iter = findIncludedOffer(offers.cbegin(), offers.cend(), worseThan);
-    while (iter == offers.cend() && !cached->allLoaded)
+    try
     {
-        iter = loadNextBestOffersIntoCache(cached, buying, selling);
-        iter = findIncludedOffer(iter, offers.cend(), worseThan);
+        loadOrderBooks();
     }
-
-    bool newOffersLoaded = offers.size() != initialBestOffersSize;
-    // Populate entry cache with upcoming best offers and prefetch associated
-    // accounts and trust lines
-    if (newOffersLoaded)
+    catch (std::exception& e)
     {
-        // At this point, we know that new offers were loaded. But new offers
-        // will only be loaded if there were no offers worse than *worseThan
-        // in the original list (or if the original list was empty if
-        // !worseThan). In that case, iter must point into the newly loaded
-        // offers so we will never try to prefetch the offers that had been
-        // previously loaded.
-        populateEntryCacheFromBestOffers(iter, offers.cend());
+        printErrorAndAbort(
+            "fatal error when getting best offer from LedgerTxnRoot: ",
+            e.what());
     }
-
-    if (iter != offers.cend())
+    catch (...)
     {
-        releaseAssert(!worseThan || isBetterOffer(*worseThan, *iter));
+        printErrorAndAbort("unknown fatal error when getting best offer "
+                           "from LedgerTxnRoot");
+    }
 
-        // Check if we didn't prefetch and that we're missing
-        // accounts/trustlines for this offer in the cache. If we are, batch
-        // load for this offer and the next 999
-        if (!newOffersLoaded &&
-            areEntriesMissingInCacheForOffer(iter->data.offer()))
-        {
-            bool fullBatch =
-                static_cast<size_t>(std::distance(iter, offers.cend())) >
-                mMaxBestOffersBatchSize;
-            auto lastOfferIter =
-                fullBatch ? iter + mMaxBestOffersBatchSize : offers.cend();
-            populateEntryCacheFromBestOffers(iter, lastOfferIter);
-        }
+    auto booksIter = mOrderBooks.find(AssetPair{buying, selling});
+    if (booksIter == mOrderBooks.end())
+    {
+        return nullptr;
+    }
+    auto const& book = booksIter->second;
 
-        auto le = std::make_shared<LedgerEntry const>(*iter);
-        putInEntryCache(LedgerEntryKey(*iter), le, LoadType::IMMEDIATE);
+    // The order books are sorted by isBetterOffer, so this is the first offer
+    // worse than *worseThan (or the best offer if !worseThan)
+    auto iter = worseThan ? book.upper_bound(*worseThan) : book.begin();
+    if (iter == book.end())
+    {
+        return nullptr;
+    }
 
-        return le;
+    // Offers are crossed best first, so if the accounts and trust lines of
+    // this offer are not in the cache, batch load them along with those of
+    // the offers after it
+    if (areEntriesMissingInCacheForOffer(iter->second->data.offer()))
+    {
+        populateEntryCacheFromBestOffers(iter, book.end());
     }
-    return nullptr;
+
+    putInEntryCache(LedgerEntryKey(*iter->second), iter->second,
+                    LoadType::IMMEDIATE);
+    return iter->second;
 }
 
 UnorderedMap<LedgerKey, LedgerEntry>
@@ -3225,6 +3472,7 @@ LedgerTxnRoot::Impl::getOffersByAccountAndAsset(AccountID const& account,
                                                 Asset const& asset)
 {
     ZoneScoped;
+    drainWriteBehind();
     std::vector<LedgerEntry> offers;
     try
     {
@@ -3279,6 +3527,7 @@ LedgerTxnRoot::Impl::getPoolShareTrustLinesByAccountAndAsset(
     AccountID const& account, Asset const& asset)
 {
     ZoneScoped;
+    drainWriteBehind();
     std::vector<LedgerEntry> trustLines;
     try
     {
@@ -3333,6 +3582,7 @@ LedgerTxnRoot::getInflationWinners(size_t maxWinners, int64_t minVotes)
 std::vector<InflationWinner>
 LedgerTxnRoot::Impl::getInflationWinners(size_t maxWinners, int64_t minVotes)
 {
+    drainWriteBehind();
     try
     {
         return loadInflationWinners(maxWinners, minVotes);
@@ -3380,13 +3630,24 @@ LedgerTxnRoot::Impl::getNewestVersion(InternalLedgerKey const& gkey) const
         ++mPrefetchMisses;
     }
 
+    // Entries not yet written by the write-behind thread are newer than the
+    // database's.
+    auto wb = mWriteBehindEntries.find(key);
+    if (wb != mWriteBehindEntries.end())
+    {
+        putInEntryCache(key, wb->second, LoadType::IMMEDIATE);
+        return wb->second
+                   ? std::make_shared<InternalLedgerEntry const>(*wb->second)
+                   : nullptr;
+    }
+
     std::shared_ptr<LedgerEntry const> entry;
     try
     {
         switch (key.type())
         {
         case ACCOUNT:
-            entry = loadAccount(key);
+            entry = mBucketList ? loadFromBucketList(key) : loadAccount(key);
             break;
         case DATA:
             entry = loadData(key);
@@ -3395,7 +3656,8 @@ LedgerTxnRoot::Impl::getNewestVersion(InternalLedgerKey const& gkey) const
             entry = loadOffer(key);
             break;
         case TRUSTLINE:
-            entry = loadTrustLine(key);
+            entry =
+                mBucketList ? loadFromBucketList(key) : loadTrustLine(key);
             break;
         case CLAIMABLE_BALANCE:
             entry = loadClaimableBalance(key);
@@ -3510,30 +3772,4 @@ LedgerTxnRoot::Impl::putInEntryCache(
         throw;
     }
 }
-
-LedgerTxnRoot::Impl::BestOffersEntryPtr
-LedgerTxnRoot::Impl::getFromBestOffers(Asset const& buying,
-                                       Asset const& selling) const
-{
-    try
-    {
-        BestOffersKey offersKey{buying, selling};
-        auto it = mBestOffers.find(offersKey);
-
-        if (it != mBestOffers.end())
-        {
-            return it->second;
-        }
-
-        auto emptyPtr =
-            std::make_shared<BestOffersEntry>(BestOffersEntry{{}, false});
-        mBestOffers.emplace(offersKey, emptyPtr);
-        return emptyPtr;
-    }
-    catch (...)
-    {
-        mBestOffers.clear();
-        throw;
-    }
-}
 }
@@ -16,6 +16,11 @@
 #include <memory>
 #include <set>
 
+namespace soci
+{
+class session;
+}
+
 /////////////////////////////////////////////////////////////////////////////
 //  Overview
 /////////////////////////////////////////////////////////////////////////////
@@ -267,6 +272,8 @@ enum class TransactionMode
     READ_WRITE_WITH_SQL_TXN
 };
 
+class Arena;
+class BucketList;
 class Database;
 struct InflationVotes;
 struct LedgerEntry;
@@ -487,6 +494,12 @@ class AbstractLedgerTxnParent
     // prepares to increase the capacity of pending changes by up to "s" changes
     virtual void prepareNewObjects(size_t s) = 0;
 
+    // Returns the Arena that a child LedgerTxn should allocate its entries
+    // from, or nullptr if it should allocate them from the heap. A LedgerTxn
+    // shares the arena of its parent, so a whole ledger close allocates from
+    // the one arena of the LedgerTxnRoot.
+    virtual std::shared_ptr<Arena> getArena() const;
+
 #ifdef BUILD_TESTS
     virtual void resetForFuzzer() = 0;
 #endif // BUILD_TESTS
@@ -774,6 +787,8 @@ class LedgerTxn : public AbstractLedgerTxn
     uint32_t prefetch(UnorderedSet<LedgerKey> const& keys) override;
     void prepareNewObjects(size_t s) override;
 
+    std::shared_ptr<Arena> getArena() const override;
+
     bool hasSponsorshipEntry() const override;
 
 #ifdef BUILD_TESTS
@@ -864,6 +879,42 @@ class LedgerTxnRoot : public AbstractLedgerTxnParent
 
     void prepareNewObjects(size_t s) override;
 
+    std::shared_ptr<Arena> getArena() const override;
+
+    // Serve loads of accounts and trustlines that miss the entry cache from
+    // `bucketList` (which must outlive this LedgerTxnRoot, and whose buckets
+    // should be indexed) rather than from SQL. The BucketList and the database
+    // hold the same state between ledger closes, since the BucketList batch is
+    // added before the closing ledger is committed to the root.
+    void loadAccountsAndTrustLinesFromBucketList(BucketList const& bucketList);
+
+    // Write committed entries to the database on a background thread, through
+    // a dedicated session outside the connection pool. Until that thread has
+    // written the entries of a commit, loads are served from memory, and the
+    // next SQL transaction (or any query that is not a lookup by key) first
+    // waits for it. `markFlushed` is called on that thread, inside the SQL transaction
+    // that writes the entries of a ledger, with the sequence number of that
+    // ledger.
+    void
+    enableWriteBehind(std::function<void(soci::session&, uint32_t)> markFlushed);
+
+    // Wait until everything committed so far is written, then go back to
+    // writing entries in the SQL transaction of the commit.
+    void disableWriteBehind();
+
+    // Wait until everything committed so far is written, so that other
+    // sessions see it.
+    void waitForWriteBehind() const;
+
+    // Load `keys` from SQL through `session`, bypassing the entry cache, the
+    // resident order books and the BucketList. This does not use the state
+    // of this LedgerTxnRoot, so it may be called from other threads with
+    // sessions leased from the connection pool, as long as nothing is
+    // committed meanwhile. Keys that are not found map to nullptr.
+    UnorderedMap<LedgerKey, std::shared_ptr<LedgerEntry const>>
+    loadFromDatabase(UnorderedSet<LedgerKey> const& keys,
+                     soci::session& session) const;
+
 #ifdef BEST_OFFER_DEBUGGING
     bool bestOfferDebuggingEnabled() const override;
 
@@ -132,6 +132,7 @@ LedgerTxnRoot::Impl::loadInflationWinners(size_t maxWinners,
 class BulkUpsertAccountsOperation : public DatabaseTypeSpecificOperation<void>
 {
     Database& mDB;
+    soci::session& mSession;
     std::vector<std::string> mAccountIDs;
     std::vector<int64_t> mBalances;
     std::vector<int64_t> mSeqNums;
@@ -149,9 +150,9 @@ class BulkUpsertAccountsOperation : public DatabaseTypeSpecificOperation<void>
     std::vector<std::string> mLedgerExtensions;
 
   public:
-    BulkUpsertAccountsOperation(Database& DB,
+    BulkUpsertAccountsOperation(Database& DB, soci::session& session,
                                 std::vector<EntryIterator> const& entries)
-        : mDB(DB)
+        : mDB(DB), mSession(session)
     {
         mAccountIDs.reserve(entries.size());
         mBalances.reserve(entries.size());
@@ -249,7 +250,7 @@ class BulkUpsertAccountsOperation : public DatabaseTypeSpecificOperation<void>
             "lastmodified = excluded.lastmodified, "
             "extension = excluded.extension, "
             "ledgerext = excluded.ledgerext";
-        auto prep = mDB.getPreparedStatement(sql);
+        auto prep = mDB.getPreparedStatement(sql, mSession);
         soci::statement& st = prep.statement();
         st.exchange(soci::use(mAccountIDs));
         st.exchange(soci::use(mBalances));
@@ -336,7 +337,7 @@ class BulkUpsertAccountsOperation : public DatabaseTypeSpecificOperation<void>
                           "lastmodified = excluded.lastmodified, "
                           "extension = excluded.extension, "
                           "ledgerext = excluded.ledgerext";
-        auto prep = mDB.getPreparedStatement(sql);
+        auto prep = mDB.getPreparedStatement(sql, mSession);
         soci::statement& st = prep.statement();
         st.exchange(soci::use(strAccountIDs));
         st.exchange(soci::use(strBalances));
@@ -366,13 +367,15 @@ class BulkUpsertAccountsOperation : public DatabaseTypeSpecificOperation<void>
 class BulkDeleteAccountsOperation : public DatabaseTypeSpecificOperation<void>
 {
     Database& mDB;
+    soci::session& mSession;
     LedgerTxnConsistency mCons;
     std::vector<std::string> mAccountIDs;
 
   public:
-    BulkDeleteAccountsOperation(Database& DB, LedgerTxnConsistency cons,
+    BulkDeleteAccountsOperation(Database& DB, soci::session& session,
+                                LedgerTxnConsistency cons,
                                 std::vector<EntryIterator> const& entries)
-        : mDB(DB), mCons(cons)
+        : mDB(DB), mSession(session), mCons(cons)
     {
         for (auto const& e : entries)
         {
@@ -389,7 +392,7 @@ class BulkDeleteAccountsOperation : public DatabaseTypeSpecificOperation<void>
     doSociGenericOperation()
     {
         std::string sql = "DELETE FROM accounts WHERE accountid = :id";
-        auto prep = mDB.getPreparedStatement(sql);
+        auto prep = mDB.getPreparedStatement(sql, mSession);
         soci::statement& st = prep.statement();
         st.exchange(soci::use(mAccountIDs));
         st.define_and_bind();
@@ -420,7 +423,7 @@ class BulkDeleteAccountsOperation : public DatabaseTypeSpecificOperation<void>
         std::string sql =
             "WITH r AS (SELECT unnest(:ids::TEXT[])) "
             "DELETE FROM accounts WHERE accountid IN (SELECT * FROM r)";
-        auto prep = mDB.getPreparedStatement(sql);
+        auto prep = mDB.getPreparedStatement(sql, mSession);
         soci::statement& st = prep.statement();
         st.exchange(soci::use(strAccountIDs));
         st.define_and_bind();
@@ -443,8 +446,8 @@ LedgerTxnRoot::Impl::bulkUpsertAccounts(
 {
     ZoneScoped;
     ZoneValue(static_cast<int64_t>(entries.size()));
-    BulkUpsertAccountsOperation op(mDatabase, entries);
-    mDatabase.doDatabaseTypeSpecificOperation(op);
+    executeWrite(std::make_unique<BulkUpsertAccountsOperation>(
+        mDatabase, getWriteSession(), entries));
 }
 
 void
@@ -453,16 +456,16 @@ LedgerTxnRoot::Impl::bulkDeleteAccounts(
 {
     ZoneScoped;
     ZoneValue(static_cast<int64_t>(entries.size()));
-    BulkDeleteAccountsOperation op(mDatabase, cons, entries);
-    mDatabase.doDatabaseTypeSpecificOperation(op);
+    executeWrite(std::make_unique<BulkDeleteAccountsOperation>(
+        mDatabase, getWriteSession(), cons, entries));
 }
 
 void
 LedgerTxnRoot::Impl::dropAccounts()
 {
     throwIfChild();
+    drainWriteBehind();
     mEntryCache.clear();
-    mBestOffers.clear();
 
     mDatabase.getSession() << "DROP TABLE IF EXISTS accounts;";
     mDatabase.getSession() << "DROP TABLE IF EXISTS signers;";
@@ -500,6 +503,7 @@ class BulkLoadAccountsOperation
     : public DatabaseTypeSpecificOperation<std::vector<LedgerEntry>>
 {
     Database& mDb;
+    soci::session& mSession;
     std::vector<std::string> mAccountIDs;
 
     std::vector<LedgerEntry>
@@ -587,8 +591,9 @@ class BulkLoadAccountsOperation
     }
 
   public:
-    BulkLoadAccountsOperation(Database& db, UnorderedSet<LedgerKey> const& keys)
-        : mDb(db)
+    BulkLoadAccountsOperation(Database& db, soci::session& session,
+                              UnorderedSet<LedgerKey> const& keys)
+        : mDb(db), mSession(session)
     {
         mAccountIDs.reserve(keys.size());
         for (auto const& k : keys)
@@ -615,7 +620,7 @@ class BulkLoadAccountsOperation
             " FROM accounts "
             "WHERE accountid IN carray(?, ?, 'char*')";
 
-        auto prep = mDb.getPreparedStatement(sql);
+        auto prep = mDb.getPreparedStatement(sql, mSession);
         auto be = prep.statement().get_backend();
         if (be == nullptr)
         {
@@ -646,7 +651,7 @@ class BulkLoadAccountsOperation
             " FROM accounts "
             "WHERE accountid IN (SELECT * FROM r)";
 
-        auto prep = mDb.getPreparedStatement(sql);
+        auto prep = mDb.getPreparedStatement(sql, mSession);
         auto& st = prep.statement();
         st.exchange(soci::use(strAccountIDs));
         return executeAndFetch(st);
@@ -656,14 +661,21 @@ class BulkLoadAccountsOperation
 
 UnorderedMap<LedgerKey, std::shared_ptr<LedgerEntry const>>
 LedgerTxnRoot::Impl::bulkLoadAccounts(UnorderedSet<LedgerKey> const& keys) const
+{
+    return bulkLoadAccounts(keys, mDatabase.getSession());
+}
+
+UnorderedMap<LedgerKey, std::shared_ptr<LedgerEntry const>>
+LedgerTxnRoot::Impl::bulkLoadAccounts(UnorderedSet<LedgerKey> const& keys,
+                                      soci::session& session) const
 {
     ZoneScoped;
     ZoneValue(static_cast<int64_t>(keys.size()));
     if (!keys.empty())
     {
-        BulkLoadAccountsOperation op(mDatabase, keys);
+        BulkLoadAccountsOperation op(mDatabase, session, keys);
         return populateLoadedEntries(
-            keys, mDatabase.doDatabaseTypeSpecificOperation(op));
+            keys, doDatabaseTypeSpecificOperation(session, op));
     }
     else
     {
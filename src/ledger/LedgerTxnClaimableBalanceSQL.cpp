@@ -41,6 +41,7 @@ class BulkLoadClaimableBalanceOperation
     : public DatabaseTypeSpecificOperation<std::vector<LedgerEntry>>
 {
     Database& mDb;
+    soci::session& mSession;
     std::vector<std::string> mBalanceIDs;
 
     std::vector<LedgerEntry>
@@ -71,9 +72,9 @@ class BulkLoadClaimableBalanceOperation
     }
 
   public:
-    BulkLoadClaimableBalanceOperation(Database& db,
+    BulkLoadClaimableBalanceOperation(Database& db, soci::session& session,
                                       UnorderedSet<LedgerKey> const& keys)
-        : mDb(db)
+        : mDb(db), mSession(session)
     {
         mBalanceIDs.reserve(keys.size());
         for (auto const& k : keys)
@@ -99,7 +100,7 @@ class BulkLoadClaimableBalanceOperation
                           "FROM claimablebalance "
                           "WHERE balanceid IN r";
 
-        auto prep = mDb.getPreparedStatement(sql);
+        auto prep = mDb.getPreparedStatement(sql, mSession);
         auto be = prep.statement().get_backend();
         if (be == nullptr)
         {
@@ -127,7 +128,7 @@ class BulkLoadClaimableBalanceOperation
                           "FROM claimablebalance "
                           "WHERE balanceid IN (SELECT * from r)";
 
-        auto prep = mDb.getPreparedStatement(sql);
+        auto prep = mDb.getPreparedStatement(sql, mSession);
         auto& st = prep.statement();
         st.exchange(soci::use(strBalanceIDs));
         return executeAndFetch(st);
@@ -139,11 +140,20 @@ UnorderedMap<LedgerKey, std::shared_ptr<LedgerEntry const>>
 LedgerTxnRoot::Impl::bulkLoadClaimableBalance(
     UnorderedSet<LedgerKey> const& keys) const
 {
+    return bulkLoadClaimableBalance(keys, mDatabase.getSession());
+}
+
+UnorderedMap<LedgerKey, std::shared_ptr<LedgerEntry const>>
+LedgerTxnRoot::Impl::bulkLoadClaimableBalance(
+    UnorderedSet<LedgerKey> const& keys, soci::session& session) const
+{
+    ZoneScoped;
+    ZoneValue(static_cast<int64_t>(keys.size()));
     if (!keys.empty())
     {
-        BulkLoadClaimableBalanceOperation op(mDatabase, keys);
+        BulkLoadClaimableBalanceOperation op(mDatabase, session, keys);
         return populateLoadedEntries(
-            keys, mDatabase.doDatabaseTypeSpecificOperation(op));
+            keys, doDatabaseTypeSpecificOperation(session, op));
     }
     else
     {
@@ -155,14 +165,15 @@ class BulkDeleteClaimableBalanceOperation
     : public DatabaseTypeSpecificOperation<void>
 {
     Database& mDb;
+    soci::session& mSession;
     LedgerTxnConsistency mCons;
     std::vector<std::string> mBalanceIDs;
 
   public:
     BulkDeleteClaimableBalanceOperation(
-        Database& db, LedgerTxnConsistency cons,
+        Database& db, soci::session& session, LedgerTxnConsistency cons,
         std::vector<EntryIterator> const& entries)
-        : mDb(db), mCons(cons)
+        : mDb(db), mSession(session), mCons(cons)
     {
         mBalanceIDs.reserve(entries.size());
         for (auto const& e : entries)
@@ -178,7 +189,7 @@ class BulkDeleteClaimableBalanceOperation
     doSociGenericOperation()
     {
         std::string sql = "DELETE FROM claimablebalance WHERE balanceid = :id";
-        auto prep = mDb.getPreparedStatement(sql);
+        auto prep = mDb.getPreparedStatement(sql, mSession);
         auto& st = prep.statement();
         st.exchange(soci::use(mBalanceIDs));
         st.define_and_bind();
@@ -210,7 +221,7 @@ class BulkDeleteClaimableBalanceOperation
                           "DELETE FROM claimablebalance "
                           "WHERE balanceid IN (SELECT * FROM r)";
 
-        auto prep = mDb.getPreparedStatement(sql);
+        auto prep = mDb.getPreparedStatement(sql, mSession);
         auto& st = prep.statement();
         st.exchange(soci::use(strBalanceIDs));
         st.define_and_bind();
@@ -231,14 +242,15 @@ void
 LedgerTxnRoot::Impl::bulkDeleteClaimableBalance(
     std::vector<EntryIterator> const& entries, LedgerTxnConsistency cons)
 {
-    BulkDeleteClaimableBalanceOperation op(mDatabase, cons, entries);
-    mDatabase.doDatabaseTypeSpecificOperation(op);
+    executeWrite(std::make_unique<BulkDeleteClaimableBalanceOperation>(
+        mDatabase, getWriteSession(), cons, entries));
 }
 
 class BulkUpsertClaimableBalanceOperation
     : public DatabaseTypeSpecificOperation<void>
 {
     Database& mDb;
+    soci::session& mSession;
     std::vector<std::string> mBalanceIDs;
     std::vector<std::string> mClaimableBalanceEntrys;
     std::vector<int32_t> mLastModifieds;
@@ -256,8 +268,9 @@ class BulkUpsertClaimableBalanceOperation
 
   public:
     BulkUpsertClaimableBalanceOperation(
-        Database& Db, std::vector<EntryIterator> const& entryIter)
-        : mDb(Db)
+        Database& Db, soci::session& session,
+        std::vector<EntryIterator> const& entryIter)
+        : mDb(Db), mSession(session)
     {
         for (auto const& e : entryIter)
         {
@@ -278,7 +291,7 @@ class BulkUpsertClaimableBalanceOperation
                           "excluded.ledgerentry, lastmodified = "
                           "excluded.lastmodified";
 
-        auto prep = mDb.getPreparedStatement(sql);
+        auto prep = mDb.getPreparedStatement(sql, mSession);
         soci::statement& st = prep.statement();
         st.exchange(soci::use(mBalanceIDs));
         st.exchange(soci::use(mClaimableBalanceEntrys));
@@ -323,7 +336,7 @@ class BulkUpsertClaimableBalanceOperation
                           "excluded.ledgerentry, "
                           "lastmodified = excluded.lastmodified";
 
-        auto prep = mDb.getPreparedStatement(sql);
+        auto prep = mDb.getPreparedStatement(sql, mSession);
         soci::statement& st = prep.statement();
         st.exchange(soci::use(strBalanceIDs));
         st.exchange(soci::use(strClaimableBalanceEntry));
@@ -345,16 +358,16 @@ void
 LedgerTxnRoot::Impl::bulkUpsertClaimableBalance(
     std::vector<EntryIterator> const& entries)
 {
-    BulkUpsertClaimableBalanceOperation op(mDatabase, entries);
-    mDatabase.doDatabaseTypeSpecificOperation(op);
+    executeWrite(std::make_unique<BulkUpsertClaimableBalanceOperation>(
+        mDatabase, getWriteSession(), entries));
 }
 
 void
 LedgerTxnRoot::Impl::dropClaimableBalances()
 {
     throwIfChild();
+    drainWriteBehind();
     mEntryCache.clear();
-    mBestOffers.clear();
 
     std::string coll = mDatabase.getSimpleCollationClause();
 
@@ -72,6 +72,7 @@ LedgerTxnRoot::Impl::loadData(LedgerKey const& key) const
 class BulkUpsertDataOperation : public DatabaseTypeSpecificOperation<void>
 {
     Database& mDB;
+    soci::session& mSession;
     std::vector<std::string> mAccountIDs;
     std::vector<std::string> mDataNames;
     std::vector<std::string> mDataValues;
@@ -96,9 +97,9 @@ class BulkUpsertDataOperation : public DatabaseTypeSpecificOperation<void>
     }
 
   public:
-    BulkUpsertDataOperation(Database& DB,
+    BulkUpsertDataOperation(Database& DB, soci::session& session,
                             std::vector<LedgerEntry> const& entries)
-        : mDB(DB)
+        : mDB(DB), mSession(session)
     {
         for (auto const& e : entries)
         {
@@ -106,9 +107,9 @@ class BulkUpsertDataOperation : public DatabaseTypeSpecificOperation<void>
         }
     }
 
-    BulkUpsertDataOperation(Database& DB,
+    BulkUpsertDataOperation(Database& DB, soci::session& session,
                             std::vector<EntryIterator> const& entryIter)
-        : mDB(DB)
+        : mDB(DB), mSession(session)
     {
         for (auto const& e : entryIter)
         {
@@ -133,7 +134,7 @@ class BulkUpsertDataOperation : public DatabaseTypeSpecificOperation<void>
             "lastmodified = excluded.lastmodified, "
             "extension = excluded.extension, "
             "ledgerext = excluded.ledgerext";
-        auto prep = mDB.getPreparedStatement(sql);
+        auto prep = mDB.getPreparedStatement(sql, mSession);
         soci::statement& st = prep.statement();
         st.exchange(soci::use(mAccountIDs));
         st.exchange(soci::use(mDataNames));
@@ -189,7 +190,7 @@ class BulkUpsertDataOperation : public DatabaseTypeSpecificOperation<void>
             "lastmodified = excluded.lastmodified, "
             "extension = excluded.extension, "
             "ledgerext = excluded.ledgerext";
-        auto prep = mDB.getPreparedStatement(sql);
+        auto prep = mDB.getPreparedStatement(sql, mSession);
         soci::statement& st = prep.statement();
         st.exchange(soci::use(strAccountIDs));
         st.exchange(soci::use(strDataNames));
@@ -213,14 +214,16 @@ class BulkUpsertDataOperation : public DatabaseTypeSpecificOperation<void>
 class BulkDeleteDataOperation : public DatabaseTypeSpecificOperation<void>
 {
     Database& mDB;
+    soci::session& mSession;
     LedgerTxnConsistency mCons;
     std::vector<std::string> mAccountIDs;
     std::vector<std::string> mDataNames;
 
   public:
-    BulkDeleteDataOperation(Database& DB, LedgerTxnConsistency cons,
+    BulkDeleteDataOperation(Database& DB, soci::session& session,
+                            LedgerTxnConsistency cons,
                             std::vector<EntryIterator> const& entries)
-        : mDB(DB), mCons(cons)
+        : mDB(DB), mSession(session), mCons(cons)
     {
         for (auto const& e : entries)
         {
@@ -239,7 +242,7 @@ class BulkDeleteDataOperation : public DatabaseTypeSpecificOperation<void>
     {
         std::string sql = "DELETE FROM accountdata WHERE accountid = :id AND "
                           " dataname = :v1 ";
-        auto prep = mDB.getPreparedStatement(sql);
+        auto prep = mDB.getPreparedStatement(sql, mSession);
         soci::statement& st = prep.statement();
         st.exchange(soci::use(mAccountIDs));
         st.exchange(soci::use(mDataNames));
@@ -277,7 +280,7 @@ class BulkDeleteDataOperation : public DatabaseTypeSpecificOperation<void>
             " ) "
             "DELETE FROM accountdata WHERE (accountid, dataname) IN "
             "(SELECT * FROM r)";
-        auto prep = mDB.getPreparedStatement(sql);
+        auto prep = mDB.getPreparedStatement(sql, mSession);
         soci::statement& st = prep.statement();
         st.exchange(soci::use(strAccountIDs));
         st.exchange(soci::use(strDataNames));
@@ -301,8 +304,8 @@ LedgerTxnRoot::Impl::bulkUpsertAccountData(
 {
     ZoneScoped;
     ZoneValue(static_cast<int64_t>(entries.size()));
-    BulkUpsertDataOperation op(mDatabase, entries);
-    mDatabase.doDatabaseTypeSpecificOperation(op);
+    executeWrite(std::make_unique<BulkUpsertDataOperation>(
+        mDatabase, getWriteSession(), entries));
 }
 
 void
@@ -311,16 +314,16 @@ LedgerTxnRoot::Impl::bulkDeleteAccountData(
 {
     ZoneScoped;
     ZoneValue(static_cast<int64_t>(entries.size()));
-    BulkDeleteDataOperation op(mDatabase, cons, entries);
-    mDatabase.doDatabaseTypeSpecificOperation(op);
+    executeWrite(std::make_unique<BulkDeleteDataOperation>(
+        mDatabase, getWriteSession(), cons, entries));
 }
 
 void
 LedgerTxnRoot::Impl::dropData()
 {
     throwIfChild();
+    drainWriteBehind();
     mEntryCache.clear();
-    mBestOffers.clear();
 
     std::string coll = mDatabase.getSimpleCollationClause();
 
@@ -351,6 +354,7 @@ class BulkLoadDataOperation
     : public DatabaseTypeSpecificOperation<std::vector<LedgerEntry>>
 {
     Database& mDb;
+    soci::session& mSession;
     std::vector<std::string> mAccountIDs;
     std::vector<std::string> mDataNames;
 
@@ -399,8 +403,9 @@ class BulkLoadDataOperation
     }
 
   public:
-    BulkLoadDataOperation(Database& db, UnorderedSet<LedgerKey> const& keys)
-        : mDb(db)
+    BulkLoadDataOperation(Database& db, soci::session& session,
+                          UnorderedSet<LedgerKey> const& keys)
+        : mDb(db), mSession(session)
     {
         mAccountIDs.reserve(keys.size());
         mDataNames.reserve(keys.size());
@@ -439,7 +444,7 @@ class BulkLoadDataOperation
                           "ledgerext "
                           "FROM accountdata WHERE (accountid, dataname) IN r";
 
-        auto prep = mDb.getPreparedStatement(sql);
+        auto prep = mDb.getPreparedStatement(sql, mSession);
         auto be = prep.statement().get_backend();
         if (be == nullptr)
         {
@@ -474,7 +479,7 @@ class BulkLoadDataOperation
             "ledgerext "
             "FROM accountdata WHERE (accountid, dataname) IN (SELECT * FROM r)";
 
-        auto prep = mDb.getPreparedStatement(sql);
+        auto prep = mDb.getPreparedStatement(sql, mSession);
         auto& st = prep.statement();
         st.exchange(soci::use(strAccountIDs));
         st.exchange(soci::use(strDataNames));
@@ -485,14 +490,21 @@ class BulkLoadDataOperation
 
 UnorderedMap<LedgerKey, std::shared_ptr<LedgerEntry const>>
 LedgerTxnRoot::Impl::bulkLoadData(UnorderedSet<LedgerKey> const& keys) const
+{
+    return bulkLoadData(keys, mDatabase.getSession());
+}
+
+UnorderedMap<LedgerKey, std::shared_ptr<LedgerEntry const>>
+LedgerTxnRoot::Impl::bulkLoadData(UnorderedSet<LedgerKey> const& keys,
+                                  soci::session& session) const
 {
     ZoneScoped;
     ZoneValue(static_cast<int64_t>(keys.size()));
     if (!keys.empty())
     {
-        BulkLoadDataOperation op(mDatabase, keys);
+        BulkLoadDataOperation op(mDatabase, session, keys);
         return populateLoadedEntries(
-            keys, mDatabase.doDatabaseTypeSpecificOperation(op));
+            keys, doDatabaseTypeSpecificOperation(session, op));
     }
     else
     {
@@ -4,10 +4,16 @@
 // under the Apache License, Version 2.0. See the COPYING file at the root
 // of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
 
+#include "crypto/Hex.h"
 #include "database/Database.h"
 #include "ledger/LedgerTxn.h"
+#include "util/Arena.h"
+#include "util/FlatMap.h"
 #include "util/RandomEvictionCache.h"
+#include <condition_variable>
 #include <list>
+#include <mutex>
+#include <thread>
 #ifdef USE_POSTGRES
 #include <iomanip>
 #include <libpq-fe.h>
@@ -160,14 +166,26 @@ class LedgerTxn::Impl
 {
     class EntryIteratorImpl;
 
-    typedef UnorderedMap<InternalLedgerKey, LedgerEntryPtr> EntryMap;
+    // Allocates its nodes from mArena.
+    typedef std::unordered_map<
+        InternalLedgerKey, LedgerEntryPtr, RandHasher<InternalLedgerKey>,
+        std::equal_to<InternalLedgerKey>,
+        ArenaAllocator<std::pair<InternalLedgerKey const, LedgerEntryPtr>>>
+        EntryMap;
 
     AbstractLedgerTxnParent& mParent;
     AbstractLedgerTxn* mChild;
+    // Shared with the parent (see AbstractLedgerTxnParent::getArena), declared
+    // before mEntry, which allocates from it.
+    std::shared_ptr<Arena> mArena;
     std::unique_ptr<LedgerHeader> mHeader;
     std::shared_ptr<LedgerTxnHeader::Impl> mActiveHeader;
+    // mEntry stays node-based: its nodes come from mArena, and iterators into
+    // it are handed out as key hints and through EntryIterator. mActive is
+    // looked up on every load and create, and nothing refers to its elements,
+    // so it is a flat map.
     EntryMap mEntry;
-    UnorderedMap<InternalLedgerKey, std::shared_ptr<EntryImplBase>> mActive;
+    FlatMap<InternalLedgerKey, std::shared_ptr<EntryImplBase>> mActive;
     bool const mShouldUpdateLastModified;
     bool mIsSealed;
     LedgerTxnConsistency mConsistency;
@@ -346,6 +364,10 @@ class LedgerTxn::Impl
     void throwIfSealed() const;
     void throwIfNotExactConsistency() const;
 
+    // Allocates a copy of entry from mArena.
+    std::shared_ptr<InternalLedgerEntry>
+    makeEntry(InternalLedgerEntry const& entry) const;
+
     // getDeltaVotes has the basic exception safety guarantee. If it throws an
     // exception, then
     // - the prepared statement cache may be, but is not guaranteed to be,
@@ -591,6 +613,8 @@ class LedgerTxn::Impl
 
     void prepareNewObjects(size_t s);
 
+    std::shared_ptr<Arena> getArena() const;
+
     // hasSponsorshipEntry has the strong exception safety guarantee
     bool hasSponsorshipEntry() const;
 
@@ -666,17 +690,11 @@ class LedgerTxnRoot::Impl
 
     typedef RandomEvictionCache<LedgerKey, CacheEntry> EntryCache;
 
-    typedef AssetPair BestOffersKey;
-
-    struct BestOffersEntry
-    {
-        std::deque<LedgerEntry> bestOffers;
-        bool allLoaded;
-    };
-    typedef std::shared_ptr<BestOffersEntry> BestOffersEntryPtr;
-
-    typedef UnorderedMap<BestOffersKey, BestOffersEntryPtr, AssetPairHash>
-        BestOffers;
+    // The offers of one asset pair, best first.
+    typedef std::map<OfferDescriptor, std::shared_ptr<LedgerEntry const>,
+                     IsBetterOfferComparator>
+        OrderBook;
+    typedef UnorderedMap<AssetPair, OrderBook, AssetPairHash> OrderBooks;
 
     static size_t const MIN_BEST_OFFERS_BATCH_SIZE;
     size_t const mMaxBestOffersBatchSize;
@@ -684,13 +702,61 @@ class LedgerTxnRoot::Impl
     Database& mDatabase;
     std::unique_ptr<LedgerHeader> mHeader;
     mutable EntryCache mEntryCache;
-    mutable BestOffers mBestOffers;
+
+    // mOrderBooks holds every offer in the database, grouped by asset pair, so
+    // that getBestOffer never has to query the database. mOffersByID indexes
+    // the same entries by offer ID.
+    //
+    //  - They are loaded from the offers table the first time they are needed
+    //    (see loadOrderBooks).
+    //
+    //  - Once loaded, bulkUpsertOffers and bulkDeleteOffers apply every
+    //    change committed to the offers table to them as well.
+    //
+    //  - They are unloaded whenever the offers table is modified in some other
+    //    way (see clearOrderBooks).
+    mutable OrderBooks mOrderBooks;
+    mutable UnorderedMap<int64_t, std::shared_ptr<LedgerEntry const>>
+        mOffersByID;
+    mutable bool mOrderBooksLoaded{false};
     mutable uint64_t mPrefetchHits{0};
     mutable uint64_t mPrefetchMisses{0};
 
     size_t mBulkLoadBatchSize;
     std::unique_ptr<soci::transaction> mTransaction;
     AbstractLedgerTxn* mChild;
+    BucketList const* mBucketList{nullptr};
+    // Entries of the child LedgerTxn and its descendants are allocated from
+    // mArena, which rewinds once they are all gone after the child commits or
+    // rolls back, so that every ledger close reuses the same blocks.
+    std::shared_ptr<Arena> mArena;
+
+    // Write-behind state (see LedgerTxnRoot::enableWriteBehind). The bulk
+    // operations of a commit are collected in mPendingWrites, then handed as
+    // one batch to mWriteBehindThread once the SQL transaction of the commit
+    // (which still holds the header and the rest of the ledger close) has
+    // committed. The entries of that batch stay in mWriteBehindEntries, where
+    // nullptr marks a deleted entry, until drainWriteBehind waits for the
+    // batch; at most one batch is ever outstanding since every SQL
+    // transaction drains first.
+    struct WriteBehindBatch
+    {
+        uint32_t mLedgerSeq;
+        std::vector<std::unique_ptr<DatabaseTypeSpecificOperation<void>>> mOps;
+    };
+    std::vector<std::unique_ptr<DatabaseTypeSpecificOperation<void>>>
+        mPendingWrites;
+    mutable UnorderedMap<LedgerKey, std::shared_ptr<LedgerEntry const>>
+        mWriteBehindEntries;
+    std::unique_ptr<soci::session> mWriteBehindSession;
+    std::function<void(soci::session&, uint32_t)> mMarkFlushed;
+    std::thread mWriteBehindThread;
+    // mWriteBehindBatch and mWriteBehindStopping are guarded by
+    // mWriteBehindMutex.
+    mutable std::mutex mWriteBehindMutex;
+    mutable std::condition_variable mWriteBehindCV;
+    std::unique_ptr<WriteBehindBatch> mWriteBehindBatch;
+    bool mWriteBehindStopping{false};
 
 #ifdef BEST_OFFER_DEBUGGING
     bool const mBestOfferDebuggingEnabled;
@@ -707,10 +773,6 @@ class LedgerTxnRoot::Impl
     std::deque<LedgerEntry>::const_iterator
     loadBestOffers(std::deque<LedgerEntry>& offers, Asset const& buying,
                    Asset const& selling, size_t numOffers) const;
-    std::deque<LedgerEntry>::const_iterator
-    loadBestOffers(std::deque<LedgerEntry>& offers, Asset const& buying,
-                   Asset const& selling, OfferDescriptor const& worseThan,
-                   size_t numOffers) const;
     std::vector<LedgerEntry>
     loadOffersByAccountAndAsset(AccountID const& accountID,
                                 Asset const& asset) const;
@@ -729,6 +791,12 @@ class LedgerTxnRoot::Impl
 
     void bulkApply(BulkLedgerEntryChangeAccumulator& bleca,
                    size_t bufferThreshold, LedgerTxnConsistency cons);
+    // Session that bulk operations write through, and how they are run:
+    // immediately on the main session, or queued for the write-behind thread.
+    soci::session& getWriteSession();
+    void executeWrite(std::unique_ptr<DatabaseTypeSpecificOperation<void>> op);
+    void drainWriteBehind() const;
+    void runWriteBehind();
     void bulkUpsertAccounts(std::vector<EntryIterator> const& entries);
     void bulkDeleteAccounts(std::vector<EntryIterator> const& entries,
                             LedgerTxnConsistency cons);
@@ -769,8 +837,12 @@ class LedgerTxnRoot::Impl
                          std::shared_ptr<LedgerEntry const> const& entry,
                          LoadType type) const;
 
-    BestOffersEntryPtr getFromBestOffers(Asset const& buying,
-                                         Asset const& selling) const;
+    // loadOrderBooks has the basic exception safety guarantee. If it throws
+    // an exception, then the order books are left unloaded.
+    void loadOrderBooks() const;
+    void clearOrderBooks() const noexcept;
+    void addToOrderBooks(std::shared_ptr<LedgerEntry const> const& entry) const;
+    void removeFromOrderBooks(int64_t offerID) const;
 
     UnorderedMap<LedgerKey, std::shared_ptr<LedgerEntry const>>
     bulkLoadAccounts(UnorderedSet<LedgerKey> const& keys) const;
@@ -784,13 +856,33 @@ class LedgerTxnRoot::Impl
     bulkLoadClaimableBalance(UnorderedSet<LedgerKey> const& keys) const;
     UnorderedMap<LedgerKey, std::shared_ptr<LedgerEntry const>>
     bulkLoadLiquidityPool(UnorderedSet<LedgerKey> const& keys) const;
+    // Same, but always from SQL through the given session, which may be used
+    // by another thread than the main one.
+    UnorderedMap<LedgerKey, std::shared_ptr<LedgerEntry const>>
+    bulkLoadAccounts(UnorderedSet<LedgerKey> const& keys,
+                     soci::session& session) const;
+    UnorderedMap<LedgerKey, std::shared_ptr<LedgerEntry const>>
+    bulkLoadTrustLines(UnorderedSet<LedgerKey> const& keys,
+                       soci::session& session) const;
+    UnorderedMap<LedgerKey, std::shared_ptr<LedgerEntry const>>
+    bulkLoadOffers(UnorderedSet<LedgerKey> const& keys,
+                   soci::session& session) const;
+    UnorderedMap<LedgerKey, std::shared_ptr<LedgerEntry const>>
+    bulkLoadData(UnorderedSet<LedgerKey> const& keys,
+                 soci::session& session) const;
+    UnorderedMap<LedgerKey, std::shared_ptr<LedgerEntry const>>
+    bulkLoadClaimableBalance(UnorderedSet<LedgerKey> const& keys,
+                             soci::session& session) const;
+    UnorderedMap<LedgerKey, std::shared_ptr<LedgerEntry const>>
+    bulkLoadLiquidityPool(UnorderedSet<LedgerKey> const& keys,
+                          soci::session& session) const;
+    UnorderedMap<LedgerKey, std::shared_ptr<LedgerEntry const>>
+    bulkLoadFromBucketList(UnorderedSet<LedgerKey> const& keys) const;
+    std::shared_ptr<LedgerEntry const>
+    loadFromBucketList(LedgerKey const& key) const;
 
-    std::deque<LedgerEntry>::const_iterator
-    loadNextBestOffersIntoCache(BestOffersEntryPtr cached, Asset const& buying,
-                                Asset const& selling);
-    void populateEntryCacheFromBestOffers(
-        std::deque<LedgerEntry>::const_iterator iter,
-        std::deque<LedgerEntry>::const_iterator const& end);
+    void populateEntryCacheFromBestOffers(OrderBook::const_iterator iter,
+                                          OrderBook::const_iterator const& end);
 
     bool areEntriesMissingInCacheForOffer(OfferEntry const& oe);
 
@@ -843,8 +935,7 @@ class LedgerTxnRoot::Impl
     //   modified
     // - the entry cache may be, but is not guaranteed to be, modified or even
     //   cleared
-    // - the best offers cache may be, but is not guaranteed to be, modified or
-    //   even cleared
+    // - the order books may be, but are not guaranteed to be, unloaded
     std::shared_ptr<LedgerEntry const>
     getBestOffer(Asset const& buying, Asset const& selling,
                  OfferDescriptor const* worseThan);
@@ -893,6 +984,21 @@ class LedgerTxnRoot::Impl
 
     void prepareNewObjects(size_t s);
 
+    std::shared_ptr<Arena> getArena() const;
+
+    void loadAccountsAndTrustLinesFromBucketList(BucketList const& bucketList);
+
+    void
+    enableWriteBehind(std::function<void(soci::session&, uint32_t)> markFlushed);
+
+    void disableWriteBehind();
+
+    void waitForWriteBehind() const;
+
+    UnorderedMap<LedgerKey, std::shared_ptr<LedgerEntry const>>
+    loadFromDatabase(UnorderedSet<LedgerKey> const& keys,
+                     soci::session& session) const;
+
 #ifdef BEST_OFFER_DEBUGGING
     bool bestOfferDebuggingEnabled() const;
 
@@ -924,6 +1030,14 @@ fromOpaqueBase64(T& res, std::string const& opaqueBase64)
     xdr::xdr_from_opaque(opaque, res);
 }
 
+template <typename T>
+std::vector<uint8_t>
+toOpaque(T const& input)
+{
+    auto opaque = xdr::xdr_to_opaque(input);
+    return std::vector<uint8_t>(opaque.begin(), opaque.end());
+}
+
 #ifdef USE_POSTGRES
 template <typename T>
 inline void
@@ -954,6 +1068,16 @@ marshalToPGArrayItem<std::string>(PGconn* conn, std::ostringstream& oss,
     oss << '"';
 }
 
+// BYTEA values are marshaled in hex format.
+template <>
+inline void
+marshalToPGArrayItem<std::vector<uint8_t>>(PGconn* conn,
+                                           std::ostringstream& oss,
+                                           const std::vector<uint8_t>& item)
+{
+    oss << "\"\\\\x" << binToHex(item) << '"';
+}
+
 template <typename T>
 inline void
 marshalToPGArray(PGconn* conn, std::string& out, const std::vector<T>& v,
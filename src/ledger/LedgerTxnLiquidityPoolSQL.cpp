@@ -62,6 +62,7 @@ class BulkLoadLiquidityPoolOperation
     : public DatabaseTypeSpecificOperation<std::vector<LedgerEntry>>
 {
     Database& mDb;
+    soci::session& mSession;
     std::vector<std::string> mPoolAssets;
 
     std::vector<LedgerEntry>
@@ -91,9 +92,9 @@ class BulkLoadLiquidityPoolOperation
     }
 
   public:
-    BulkLoadLiquidityPoolOperation(Database& db,
+    BulkLoadLiquidityPoolOperation(Database& db, soci::session& session,
                                    UnorderedSet<LedgerKey> const& keys)
-        : mDb(db)
+        : mDb(db), mSession(session)
     {
         mPoolAssets.reserve(keys.size());
         for (auto const& k : keys)
@@ -119,7 +120,7 @@ class BulkLoadLiquidityPoolOperation
                           "FROM liquiditypool "
                           "WHERE poolasset IN r";
 
-        auto prep = mDb.getPreparedStatement(sql);
+        auto prep = mDb.getPreparedStatement(sql, mSession);
         auto be = prep.statement().get_backend();
         if (be == nullptr)
         {
@@ -147,7 +148,7 @@ class BulkLoadLiquidityPoolOperation
                           "FROM liquiditypool "
                           "WHERE poolasset IN (SELECT * from r)";
 
-        auto prep = mDb.getPreparedStatement(sql);
+        auto prep = mDb.getPreparedStatement(sql, mSession);
         auto& st = prep.statement();
         st.exchange(soci::use(strPoolAssets));
         return executeAndFetch(st);
@@ -159,11 +160,20 @@ UnorderedMap<LedgerKey, std::shared_ptr<LedgerEntry const>>
 LedgerTxnRoot::Impl::bulkLoadLiquidityPool(
     UnorderedSet<LedgerKey> const& keys) const
 {
+    return bulkLoadLiquidityPool(keys, mDatabase.getSession());
+}
+
+UnorderedMap<LedgerKey, std::shared_ptr<LedgerEntry const>>
+LedgerTxnRoot::Impl::bulkLoadLiquidityPool(UnorderedSet<LedgerKey> const& keys,
+                                           soci::session& session) const
+{
+    ZoneScoped;
+    ZoneValue(static_cast<int64_t>(keys.size()));
     if (!keys.empty())
     {
-        BulkLoadLiquidityPoolOperation op(mDatabase, keys);
+        BulkLoadLiquidityPoolOperation op(mDatabase, session, keys);
         return populateLoadedEntries(
-            keys, mDatabase.doDatabaseTypeSpecificOperation(op));
+            keys, doDatabaseTypeSpecificOperation(session, op));
     }
     else
     {
@@ -175,13 +185,15 @@ class BulkDeleteLiquidityPoolOperation
     : public DatabaseTypeSpecificOperation<void>
 {
     Database& mDb;
+    soci::session& mSession;
     LedgerTxnConsistency mCons;
     std::vector<std::string> mPoolAssets;
 
   public:
-    BulkDeleteLiquidityPoolOperation(Database& db, LedgerTxnConsistency cons,
+    BulkDeleteLiquidityPoolOperation(Database& db, soci::session& session,
+                                     LedgerTxnConsistency cons,
                                      std::vector<EntryIterator> const& entries)
-        : mDb(db), mCons(cons)
+        : mDb(db), mSession(session), mCons(cons)
     {
         mPoolAssets.reserve(entries.size());
         for (auto const& e : entries)
@@ -197,7 +209,7 @@ class BulkDeleteLiquidityPoolOperation
     doSociGenericOperation()
     {
         std::string sql = "DELETE FROM liquiditypool WHERE poolasset = :id";
-        auto prep = mDb.getPreparedStatement(sql);
+        auto prep = mDb.getPreparedStatement(sql, mSession);
         auto& st = prep.statement();
         st.exchange(soci::use(mPoolAssets));
         st.define_and_bind();
@@ -229,7 +241,7 @@ class BulkDeleteLiquidityPoolOperation
                           "DELETE FROM liquiditypool "
                           "WHERE poolasset IN (SELECT * FROM r)";
 
-        auto prep = mDb.getPreparedStatement(sql);
+        auto prep = mDb.getPreparedStatement(sql, mSession);
         auto& st = prep.statement();
         st.exchange(soci::use(strPoolAssets));
         st.define_and_bind();
@@ -250,14 +262,15 @@ void
 LedgerTxnRoot::Impl::bulkDeleteLiquidityPool(
     std::vector<EntryIterator> const& entries, LedgerTxnConsistency cons)
 {
-    BulkDeleteLiquidityPoolOperation op(mDatabase, cons, entries);
-    mDatabase.doDatabaseTypeSpecificOperation(op);
+    executeWrite(std::make_unique<BulkDeleteLiquidityPoolOperation>(
+        mDatabase, getWriteSession(), cons, entries));
 }
 
 class BulkUpsertLiquidityPoolOperation
     : public DatabaseTypeSpecificOperation<void>
 {
     Database& mDb;
+    soci::session& mSession;
     std::vector<std::string> mPoolAssets;
     std::vector<std::string> mAssetAs;
     std::vector<std::string> mAssetBs;
@@ -281,8 +294,9 @@ class BulkUpsertLiquidityPoolOperation
 
   public:
     BulkUpsertLiquidityPoolOperation(
-        Database& Db, std::vector<EntryIterator> const& entryIter)
-        : mDb(Db)
+        Database& Db, soci::session& session,
+        std::vector<EntryIterator> const& entryIter)
+        : mDb(Db), mSession(session)
     {
         for (auto const& e : entryIter)
         {
@@ -305,7 +319,7 @@ class BulkUpsertLiquidityPoolOperation
             "ledgerentry = excluded.ledgerentry, "
             "lastmodified = excluded.lastmodified";
 
-        auto prep = mDb.getPreparedStatement(sql);
+        auto prep = mDb.getPreparedStatement(sql, mSession);
         soci::statement& st = prep.statement();
         st.exchange(soci::use(mPoolAssets));
         st.exchange(soci::use(mAssetAs));
@@ -357,7 +371,7 @@ class BulkUpsertLiquidityPoolOperation
             "ledgerentry = excluded.ledgerentry, "
             "lastmodified = excluded.lastmodified";
 
-        auto prep = mDb.getPreparedStatement(sql);
+        auto prep = mDb.getPreparedStatement(sql, mSession);
         soci::statement& st = prep.statement();
         st.exchange(soci::use(strPoolAssets));
         st.exchange(soci::use(strAssetAs));
@@ -381,16 +395,16 @@ void
 LedgerTxnRoot::Impl::bulkUpsertLiquidityPool(
     std::vector<EntryIterator> const& entries)
 {
-    BulkUpsertLiquidityPoolOperation op(mDatabase, entries);
-    mDatabase.doDatabaseTypeSpecificOperation(op);
+    executeWrite(std::make_unique<BulkUpsertLiquidityPoolOperation>(
+        mDatabase, getWriteSession(), entries));
 }
 
 void
 LedgerTxnRoot::Impl::dropLiquidityPools()
 {
     throwIfChild();
+    drainWriteBehind();
     mEntryCache.clear();
-    mBestOffers.clear();
 
     std::string coll = mDatabase.getSimpleCollationClause();
 
@@ -30,6 +30,17 @@ LedgerTxnRoot::Impl::loadOffer(LedgerKey const& key) const
         return nullptr;
     }
 
+    if (mOrderBooksLoaded)
+    {
+        auto iter = mOffersByID.find(offerID);
+        if (iter == mOffersByID.end() ||
+            !(iter->second->data.offer().sellerID == key.offer().sellerID))
+        {
+            return nullptr;
+        }
+        return iter->second;
+    }
+
     std::string actIDStrKey = KeyUtils::toStrKey(key.offer().sellerID);
 
     std::string sql = "SELECT sellerid, offerid, sellingasset, buyingasset, "
@@ -99,69 +110,6 @@ LedgerTxnRoot::Impl::loadBestOffers(std::deque<LedgerEntry>& offers,
     }
 }
 
-std::deque<LedgerEntry>::const_iterator
-LedgerTxnRoot::Impl::loadBestOffers(std::deque<LedgerEntry>& offers,
-                                    Asset const& buying, Asset const& selling,
-                                    OfferDescriptor const& worseThan,
-                                    size_t numOffers) const
-{
-    ZoneScoped;
-    // ManageOffer and related operations won't work correctly with an offerID
-    // equal to or exceeding INT64_MAX, so there is no reason to support it
-    // here. We are far from this limit anyway.
-    if (worseThan.offerID == INT64_MAX)
-    {
-        throw std::runtime_error("maximum offerID encountered");
-    }
-
-    // price is an approximation of the actual n/d (truncated math, 15 digits)
-    // ordering by offerid gives precedence to older offers for fairness
-    std::string sql =
-        "WITH r1 AS "
-        "(SELECT sellerid, offerid, sellingasset, buyingasset, amount, price, "
-        "pricen, priced, flags, lastmodified, extension, "
-        "ledgerext FROM offers "
-        "WHERE sellingasset = :v1 AND buyingasset = :v2 AND price > :v3 "
-        "ORDER BY price, offerid LIMIT :v4), "
-        "r2 AS "
-        "(SELECT sellerid, offerid, sellingasset, buyingasset, amount, price, "
-        "pricen, priced, flags, lastmodified, extension, "
-        "ledgerext FROM offers "
-        "WHERE sellingasset = :v5 AND buyingasset = :v6 AND price = :v7 "
-        "AND offerid >= :v8 ORDER BY price, offerid LIMIT :v9) "
-        "SELECT sellerid, offerid, sellingasset, buyingasset, "
-        "amount, pricen, priced, flags, lastmodified, extension, "
-        "ledgerext "
-        "FROM (SELECT * FROM r1 UNION ALL SELECT * FROM r2) AS res "
-        "ORDER BY price, offerid LIMIT :v10";
-
-    std::string buyingAsset, sellingAsset;
-    buyingAsset = decoder::encode_b64(xdr::xdr_to_opaque(buying));
-    sellingAsset = decoder::encode_b64(xdr::xdr_to_opaque(selling));
-
-    double worseThanPrice =
-        (double)worseThan.price.n / (double)worseThan.price.d;
-    int64_t worseThanOfferID = worseThan.offerID + 1;
-
-    auto prep = mDatabase.getPreparedStatement(sql);
-    auto& st = prep.statement();
-    st.exchange(soci::use(sellingAsset));
-    st.exchange(soci::use(buyingAsset));
-    st.exchange(soci::use(worseThanPrice));
-    st.exchange(soci::use(numOffers));
-    st.exchange(soci::use(sellingAsset));
-    st.exchange(soci::use(buyingAsset));
-    st.exchange(soci::use(worseThanPrice));
-    st.exchange(soci::use(worseThanOfferID));
-    st.exchange(soci::use(numOffers));
-    st.exchange(soci::use(numOffers));
-
-    {
-        auto timer = mDatabase.getSelectTimer("offer");
-        return loadOffers(prep, offers);
-    }
-}
-
 bool
 isBetterOffer(OfferDescriptor const& lhs, OfferDescriptor const& rhs)
 {
@@ -189,7 +137,8 @@ isBetterOffer(OfferDescriptor const& lhs, LedgerEntry const& rhsEntry)
 }
 
 // Note: The order induced by this function must match the order used in the
-// SQL query for loadBestOffers above.
+// SQL query for loadBestOffers above, as it is also the order of the order
+// books kept by LedgerTxnRoot.
 bool
 isBetterOffer(LedgerEntry const& lhsEntry, LedgerEntry const& rhsEntry)
 {
@@ -325,6 +274,7 @@ LedgerTxnRoot::Impl::loadOffers(StatementContext& prep) const
 class BulkUpsertOffersOperation : public DatabaseTypeSpecificOperation<void>
 {
     Database& mDB;
+    soci::session& mSession;
     std::vector<std::string> mSellerIDs;
     std::vector<int64_t> mOfferIDs;
     std::vector<std::string> mSellingAssets;
@@ -368,9 +318,9 @@ class BulkUpsertOffersOperation : public DatabaseTypeSpecificOperation<void>
     }
 
   public:
-    BulkUpsertOffersOperation(Database& DB,
+    BulkUpsertOffersOperation(Database& DB, soci::session& session,
                               std::vector<LedgerEntry> const& entries)
-        : mDB(DB)
+        : mDB(DB), mSession(session)
     {
         mSellerIDs.reserve(entries.size());
         mOfferIDs.reserve(entries.size());
@@ -391,9 +341,9 @@ class BulkUpsertOffersOperation : public DatabaseTypeSpecificOperation<void>
         }
     }
 
-    BulkUpsertOffersOperation(Database& DB,
+    BulkUpsertOffersOperation(Database& DB, soci::session& session,
                               std::vector<EntryIterator> const& entries)
-        : mDB(DB)
+        : mDB(DB), mSession(session)
     {
         mSellerIDs.reserve(entries.size());
         mOfferIDs.reserve(entries.size());
@@ -439,7 +389,7 @@ class BulkUpsertOffersOperation : public DatabaseTypeSpecificOperation<void>
             "lastmodified = excluded.lastmodified, "
             "extension = excluded.extension, "
             "ledgerext = excluded.ledgerext";
-        auto prep = mDB.getPreparedStatement(sql);
+        auto prep = mDB.getPreparedStatement(sql, mSession);
         soci::statement& st = prep.statement();
         st.exchange(soci::use(mSellerIDs));
         st.exchange(soci::use(mOfferIDs));
@@ -527,7 +477,7 @@ class BulkUpsertOffersOperation : public DatabaseTypeSpecificOperation<void>
             "lastmodified = excluded.lastmodified, "
             "extension = excluded.extension, "
             "ledgerext = excluded.ledgerext";
-        auto prep = mDB.getPreparedStatement(sql);
+        auto prep = mDB.getPreparedStatement(sql, mSession);
         soci::statement& st = prep.statement();
         st.exchange(soci::use(strSellerIDs));
         st.exchange(soci::use(strOfferIDs));
@@ -557,13 +507,15 @@ class BulkUpsertOffersOperation : public DatabaseTypeSpecificOperation<void>
 class BulkDeleteOffersOperation : public DatabaseTypeSpecificOperation<void>
 {
     Database& mDB;
+    soci::session& mSession;
     LedgerTxnConsistency mCons;
     std::vector<int64_t> mOfferIDs;
 
   public:
-    BulkDeleteOffersOperation(Database& DB, LedgerTxnConsistency cons,
+    BulkDeleteOffersOperation(Database& DB, soci::session& session,
+                              LedgerTxnConsistency cons,
                               std::vector<EntryIterator> const& entries)
-        : mDB(DB), mCons(cons)
+        : mDB(DB), mSession(session), mCons(cons)
     {
         for (auto const& e : entries)
         {
@@ -580,7 +532,7 @@ class BulkDeleteOffersOperation : public DatabaseTypeSpecificOperation<void>
     doSociGenericOperation()
     {
         std::string sql = "DELETE FROM offers WHERE offerid = :id";
-        auto prep = mDB.getPreparedStatement(sql);
+        auto prep = mDB.getPreparedStatement(sql, mSession);
         soci::statement& st = prep.statement();
         st.exchange(soci::use(mOfferIDs));
         st.define_and_bind();
@@ -613,7 +565,7 @@ class BulkDeleteOffersOperation : public DatabaseTypeSpecificOperation<void>
                           ") "
                           "DELETE FROM offers WHERE "
                           "offerid IN (SELECT * FROM r)";
-        auto prep = mDB.getPreparedStatement(sql);
+        auto prep = mDB.getPreparedStatement(sql, mSession);
         soci::statement& st = prep.statement();
         st.exchange(soci::use(strOfferIDs));
         st.define_and_bind();
@@ -635,8 +587,25 @@ LedgerTxnRoot::Impl::bulkUpsertOffers(std::vector<EntryIterator> const& entries)
 {
     ZoneScoped;
     ZoneValue(static_cast<int64_t>(entries.size()));
-    BulkUpsertOffersOperation op(mDatabase, entries);
-    mDatabase.doDatabaseTypeSpecificOperation(op);
+    executeWrite(std::make_unique<BulkUpsertOffersOperation>(
+        mDatabase, getWriteSession(), entries));
+
+    if (mOrderBooksLoaded)
+    {
+        try
+        {
+            for (auto const& e : entries)
+            {
+                addToOrderBooks(std::make_shared<LedgerEntry const>(
+                    e.entry().ledgerEntry()));
+            }
+        }
+        catch (...)
+        {
+            clearOrderBooks();
+            throw;
+        }
+    }
 }
 
 void
@@ -645,16 +614,91 @@ LedgerTxnRoot::Impl::bulkDeleteOffers(std::vector<EntryIterator> const& entries,
 {
     ZoneScoped;
     ZoneValue(static_cast<int64_t>(entries.size()));
-    BulkDeleteOffersOperation op(mDatabase, cons, entries);
-    mDatabase.doDatabaseTypeSpecificOperation(op);
+    executeWrite(std::make_unique<BulkDeleteOffersOperation>(
+        mDatabase, getWriteSession(), cons, entries));
+
+    if (mOrderBooksLoaded)
+    {
+        for (auto const& e : entries)
+        {
+            removeFromOrderBooks(e.key().ledgerKey().offer().offerID);
+        }
+    }
+}
+
+void
+LedgerTxnRoot::Impl::loadOrderBooks() const
+{
+    ZoneScoped;
+    if (mOrderBooksLoaded)
+    {
+        return;
+    }
+
+    drainWriteBehind();
+    try
+    {
+        for (auto& offer : loadAllOffers())
+        {
+            addToOrderBooks(
+                std::make_shared<LedgerEntry const>(std::move(offer)));
+        }
+        mOrderBooksLoaded = true;
+    }
+    catch (...)
+    {
+        clearOrderBooks();
+        throw;
+    }
+}
+
+void
+LedgerTxnRoot::Impl::clearOrderBooks() const noexcept
+{
+    mOrderBooks.clear();
+    mOffersByID.clear();
+    mOrderBooksLoaded = false;
+}
+
+void
+LedgerTxnRoot::Impl::addToOrderBooks(
+    std::shared_ptr<LedgerEntry const> const& entry) const
+{
+    auto const& oe = entry->data.offer();
+    removeFromOrderBooks(oe.offerID);
+
+    auto& book = mOrderBooks[AssetPair{oe.buying, oe.selling}];
+    book.emplace(OfferDescriptor{oe.price, oe.offerID}, entry);
+    mOffersByID.emplace(oe.offerID, entry);
+}
+
+void
+LedgerTxnRoot::Impl::removeFromOrderBooks(int64_t offerID) const
+{
+    auto iter = mOffersByID.find(offerID);
+    if (iter == mOffersByID.end())
+    {
+        return;
+    }
+
+    auto const& oe = iter->second->data.offer();
+    auto booksIter = mOrderBooks.find(AssetPair{oe.buying, oe.selling});
+    releaseAssert(booksIter != mOrderBooks.end());
+    booksIter->second.erase(OfferDescriptor{oe.price, oe.offerID});
+    if (booksIter->second.empty())
+    {
+        mOrderBooks.erase(booksIter);
+    }
+    mOffersByID.erase(iter);
 }
 
 void
 LedgerTxnRoot::Impl::dropOffers()
 {
     throwIfChild();
+    drainWriteBehind();
     mEntryCache.clear();
-    mBestOffers.clear();
+    clearOrderBooks();
 
     std::string coll = mDatabase.getSimpleCollationClause();
 
@@ -694,6 +738,7 @@ class BulkLoadOffersOperation
     : public DatabaseTypeSpecificOperation<std::vector<LedgerEntry>>
 {
     Database& mDb;
+    soci::session& mSession;
     std::vector<int64_t> mOfferIDs;
     UnorderedSet<LedgerKey> mKeys;
 
@@ -756,8 +801,9 @@ class BulkLoadOffersOperation
     }
 
   public:
-    BulkLoadOffersOperation(Database& db, UnorderedSet<LedgerKey> const& keys)
-        : mDb(db)
+    BulkLoadOffersOperation(Database& db, soci::session& session,
+                            UnorderedSet<LedgerKey> const& keys)
+        : mDb(db), mSession(session)
     {
         mOfferIDs.reserve(keys.size());
         for (auto const& k : keys)
@@ -779,7 +825,7 @@ class BulkLoadOffersOperation
             "ledgerext "
             "FROM offers WHERE offerid IN carray(?, ?, 'int64')";
 
-        auto prep = mDb.getPreparedStatement(sql);
+        auto prep = mDb.getPreparedStatement(sql, mSession);
         auto be = prep.statement().get_backend();
         if (be == nullptr)
         {
@@ -808,7 +854,7 @@ class BulkLoadOffersOperation
             "amount, pricen, priced, flags, lastmodified, extension, "
             "ledgerext "
             "FROM offers WHERE offerid IN (SELECT * FROM r)";
-        auto prep = mDb.getPreparedStatement(sql);
+        auto prep = mDb.getPreparedStatement(sql, mSession);
         auto& st = prep.statement();
         st.exchange(soci::use(strOfferIDs));
         return executeAndFetch(st);
@@ -818,14 +864,35 @@ class BulkLoadOffersOperation
 
 UnorderedMap<LedgerKey, std::shared_ptr<LedgerEntry const>>
 LedgerTxnRoot::Impl::bulkLoadOffers(UnorderedSet<LedgerKey> const& keys) const
+{
+    ZoneScoped;
+    ZoneValue(static_cast<int64_t>(keys.size()));
+    if (mOrderBooksLoaded)
+    {
+        UnorderedMap<LedgerKey, std::shared_ptr<LedgerEntry const>> res;
+        for (auto const& key : keys)
+        {
+            res.emplace(key, loadOffer(key));
+        }
+        return res;
+    }
+    else
+    {
+        return bulkLoadOffers(keys, mDatabase.getSession());
+    }
+}
+
+UnorderedMap<LedgerKey, std::shared_ptr<LedgerEntry const>>
+LedgerTxnRoot::Impl::bulkLoadOffers(UnorderedSet<LedgerKey> const& keys,
+                                    soci::session& session) const
 {
     ZoneScoped;
     ZoneValue(static_cast<int64_t>(keys.size()));
     if (!keys.empty())
     {
-        BulkLoadOffersOperation op(mDatabase, keys);
+        BulkLoadOffersOperation op(mDatabase, session, keys);
         return populateLoadedEntries(
-            keys, mDatabase.doDatabaseTypeSpecificOperation(op));
+            keys, doDatabaseTypeSpecificOperation(session, op));
     }
     else
     {
@@ -2,7 +2,6 @@
 // under the Apache License, Version 2.0. See the COPYING file at the root
 // of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
 
-#include "crypto/KeyUtils.h"
 #include "crypto/SecretKey.h"
 #include "database/Database.h"
 #include "database/DatabaseTypeSpecificOperation.h"
@@ -36,44 +35,64 @@ validateTrustLineKey(uint32_t ledgerVersion, LedgerKey const& key)
     }
 }
 
-std::shared_ptr<LedgerEntry const>
-LedgerTxnRoot::Impl::loadTrustLine(LedgerKey const& key) const
-{
-    ZoneScoped;
-
-    validateTrustLineKey(mHeader->ledgerVersion, key);
-
-    std::string accountIDStr = KeyUtils::toStrKey(key.trustLine().accountID);
-    auto asset = toOpaqueBase64(key.trustLine().asset);
-
-    std::string trustLineEntryStr;
+// The key columns of the trustlines table hold the XDR of the account and of
+// the asset, as BLOB (SQLite) or BYTEA (PostgreSQL) values. Neither soci's
+// string binding nor carray() can carry binary values on SQLite, so SQLite
+// statements on this table bind through the sqlite3 API, one row at a time.
 
-    auto prep = mDatabase.getPreparedStatement(
-        "SELECT ledgerentry "
-        " FROM trustlines "
-        "WHERE accountid= :id AND asset= :asset");
-    auto& st = prep.statement();
-    st.exchange(soci::into(trustLineEntryStr));
-    st.exchange(soci::use(accountIDStr));
-    st.exchange(soci::use(asset));
-    st.define_and_bind();
+static sqlite_api::sqlite3_stmt*
+getSqliteStatement(StatementContext& prep)
+{
+    auto be = prep.statement().get_backend();
+    if (be == nullptr)
     {
-        auto timer = mDatabase.getSelectTimer("trust");
-        st.execute(true);
+        throw std::runtime_error("no sql backend");
     }
-    if (!st.got_data())
+    auto sqliteStatement = dynamic_cast<soci::sqlite3_statement_backend*>(be);
+    auto st = sqliteStatement->stmt_;
+    sqlite3_reset(st);
+    return st;
+}
+
+static void
+bindSqliteBlob(sqlite_api::sqlite3_stmt* st, int pos,
+               std::vector<uint8_t> const& value)
+{
+    sqlite3_bind_blob(st, pos, value.data(), static_cast<int>(value.size()),
+                      SQLITE_STATIC);
+}
+
+// Runs a statement that returns no rows and resets it. Returns the number of
+// rows it changed.
+static int
+stepSqliteStatement(sqlite_api::sqlite3* db, sqlite_api::sqlite3_stmt* st)
+{
+    int rc = sqlite3_step(st);
+    if (rc != SQLITE_DONE)
     {
-        return nullptr;
+        std::string msg = sqlite3_errmsg(db);
+        sqlite3_reset(st);
+        throw std::runtime_error("Could not update data in SQL: " + msg);
     }
+    sqlite3_reset(st);
+    return sqlite3_changes(db);
+}
 
-    LedgerEntry le;
+static void
+fromTrustLineEntryStr(LedgerEntry& le, std::string const& trustLineEntryStr)
+{
     fromOpaqueBase64(le, trustLineEntryStr);
-    if (le.data.type() != TRUSTLINE)
-    {
-        throw NonSociRelatedException("Loaded non-trustline entry");
-    }
+    releaseAssert(le.data.type() == TRUSTLINE);
+    releaseAssert(le.data.trustLine().asset.type() != ASSET_TYPE_NATIVE);
+}
 
-    return std::make_shared<LedgerEntry const>(std::move(le));
+std::shared_ptr<LedgerEntry const>
+LedgerTxnRoot::Impl::loadTrustLine(LedgerKey const& key) const
+{
+    ZoneScoped;
+
+    validateTrustLineKey(mHeader->ledgerVersion, key);
+    return bulkLoadTrustLines({key}).at(key);
 }
 
 std::vector<LedgerEntry>
@@ -82,39 +101,43 @@ LedgerTxnRoot::Impl::loadPoolShareTrustLinesByAccountAndAsset(
 {
     ZoneScoped;
 
-    std::string accountIDStr = KeyUtils::toStrKey(accountID);
+    // The pools are found by their base64-encoded assets, then the pool share
+    // trustlines of accountID by their binary keys.
     auto assetStr = toOpaqueBase64(asset);
-
-    std::string trustLineEntryStr;
-
-    auto prep = mDatabase.getPreparedStatement(
-        "SELECT trustlines.ledgerentry "
-        "FROM trustlines "
-        "INNER JOIN liquiditypool "
-        "ON trustlines.asset = liquiditypool.poolasset "
-        "AND trustlines.accountid = :v1 "
-        "AND (liquiditypool.asseta = :v2 OR liquiditypool.assetb = :v3)");
-    auto& st = prep.statement();
-    st.exchange(soci::into(trustLineEntryStr));
-    st.exchange(soci::use(accountIDStr));
-    st.exchange(soci::use(assetStr));
-    st.exchange(soci::use(assetStr));
-    st.define_and_bind();
+    UnorderedSet<LedgerKey> keys;
     {
-        auto timer = mDatabase.getSelectTimer("trust");
-        st.execute(true);
+        std::string poolAssetStr;
+        auto prep = mDatabase.getPreparedStatement(
+            "SELECT poolasset "
+            "FROM liquiditypool "
+            "WHERE asseta = :v1 OR assetb = :v2");
+        auto& st = prep.statement();
+        st.exchange(soci::into(poolAssetStr));
+        st.exchange(soci::use(assetStr));
+        st.exchange(soci::use(assetStr));
+        st.define_and_bind();
+        {
+            auto timer = mDatabase.getSelectTimer("liquiditypool");
+            st.execute(true);
+        }
+
+        while (st.got_data())
+        {
+            LedgerKey key(TRUSTLINE);
+            key.trustLine().accountID = accountID;
+            fromOpaqueBase64(key.trustLine().asset, poolAssetStr);
+            keys.emplace(key);
+            st.fetch();
+        }
     }
 
     std::vector<LedgerEntry> trustLines;
-    while (st.got_data())
+    for (auto const& kv : bulkLoadTrustLines(keys))
     {
-        trustLines.emplace_back();
-        fromOpaqueBase64(trustLines.back(), trustLineEntryStr);
-        if (trustLines.back().data.type() != TRUSTLINE)
+        if (kv.second)
         {
-            throw NonSociRelatedException("Loaded non-trustline entry");
+            trustLines.emplace_back(*kv.second);
         }
-        st.fetch();
     }
     return trustLines;
 }
@@ -122,16 +145,17 @@ LedgerTxnRoot::Impl::loadPoolShareTrustLinesByAccountAndAsset(
 class BulkUpsertTrustLinesOperation : public DatabaseTypeSpecificOperation<void>
 {
     Database& mDB;
-    std::vector<std::string> mAccountIDs;
-    std::vector<std::string> mAssets;
+    soci::session& mSession;
+    std::vector<std::vector<uint8_t>> mAccountIDs;
+    std::vector<std::vector<uint8_t>> mAssets;
     std::vector<std::string> mTrustLineEntries;
     std::vector<int32_t> mLastModifieds;
 
   public:
-    BulkUpsertTrustLinesOperation(Database& DB,
+    BulkUpsertTrustLinesOperation(Database& DB, soci::session& session,
                                   std::vector<EntryIterator> const& entries,
                                   uint32_t ledgerVersion)
-        : mDB(DB)
+        : mDB(DB), mSession(session)
     {
         mAccountIDs.reserve(entries.size());
         mAssets.reserve(entries.size());
@@ -150,8 +174,8 @@ class BulkUpsertTrustLinesOperation : public DatabaseTypeSpecificOperation<void>
 
             validateTrustLineKey(ledgerVersion, e.key().ledgerKey());
 
-            mAccountIDs.emplace_back(KeyUtils::toStrKey(tl.accountID));
-            mAssets.emplace_back(toOpaqueBase64(tl.asset));
+            mAccountIDs.emplace_back(toOpaque(tl.accountID));
+            mAssets.emplace_back(toOpaque(tl.asset));
             mTrustLineEntries.emplace_back(toOpaqueBase64(le));
             mLastModifieds.emplace_back(
                 unsignedToSigned(le.lastModifiedLedgerSeq));
@@ -159,38 +183,33 @@ class BulkUpsertTrustLinesOperation : public DatabaseTypeSpecificOperation<void>
     }
 
     void
-    doSociGenericOperation()
+    doSqliteSpecificOperation(soci::sqlite3_session_backend* sq) override
     {
         std::string sql = "INSERT INTO trustlines ( "
                           "accountid, asset, ledgerentry, lastmodified)"
                           "VALUES ( "
-                          ":id, :v1, :v2, :v3 "
+                          "?, ?, ?, ? "
                           ") ON CONFLICT (accountid, asset) DO UPDATE SET "
                           "ledgerentry = excluded.ledgerentry, "
                           "lastmodified = excluded.lastmodified";
-        auto prep = mDB.getPreparedStatement(sql);
-        soci::statement& st = prep.statement();
-        st.exchange(soci::use(mAccountIDs));
-        st.exchange(soci::use(mAssets));
-        st.exchange(soci::use(mTrustLineEntries));
-        st.exchange(soci::use(mLastModifieds));
-        st.define_and_bind();
-        {
-            auto timer = mDB.getUpsertTimer("trustline");
-            st.execute(true);
-        }
-        if (static_cast<size_t>(st.get_affected_rows()) != mAccountIDs.size())
+        auto prep = mDB.getPreparedStatement(sql, mSession);
+        auto st = getSqliteStatement(prep);
+        auto timer = mDB.getUpsertTimer("trustline");
+        for (size_t i = 0; i < mAccountIDs.size(); ++i)
         {
-            throw std::runtime_error("Could not update data in SQL");
+            bindSqliteBlob(st, 1, mAccountIDs[i]);
+            bindSqliteBlob(st, 2, mAssets[i]);
+            sqlite3_bind_text(st, 3, mTrustLineEntries[i].c_str(),
+                              static_cast<int>(mTrustLineEntries[i].size()),
+                              SQLITE_STATIC);
+            sqlite3_bind_int(st, 4, mLastModifieds[i]);
+            if (stepSqliteStatement(sq->conn_, st) != 1)
+            {
+                throw std::runtime_error("Could not update data in SQL");
+            }
         }
     }
 
-    void
-    doSqliteSpecificOperation(soci::sqlite3_session_backend* sq) override
-    {
-        doSociGenericOperation();
-    }
-
 #ifdef USE_POSTGRES
     void
     doPostgresSpecificOperation(soci::postgresql_session_backend* pg) override
@@ -206,8 +225,8 @@ class BulkUpsertTrustLinesOperation : public DatabaseTypeSpecificOperation<void>
         marshalToPGArray(conn, strLastModifieds, mLastModifieds);
 
         std::string sql = "WITH r AS (SELECT "
-                          "unnest(:ids::TEXT[]), "
-                          "unnest(:v1::TEXT[]), "
+                          "unnest(:ids::BYTEA[]), "
+                          "unnest(:v1::BYTEA[]), "
                           "unnest(:v2::TEXT[]), "
                           "unnest(:v3::INT[])) "
                           "INSERT INTO trustlines ( "
@@ -216,7 +235,7 @@ class BulkUpsertTrustLinesOperation : public DatabaseTypeSpecificOperation<void>
                           "ON CONFLICT (accountid, asset) DO UPDATE SET "
                           "ledgerentry = excluded.ledgerentry, "
                           "lastmodified = excluded.lastmodified";
-        auto prep = mDB.getPreparedStatement(sql);
+        auto prep = mDB.getPreparedStatement(sql, mSession);
         soci::statement& st = prep.statement();
         st.exchange(soci::use(strAccountIDs));
         st.exchange(soci::use(strAssets));
@@ -238,15 +257,17 @@ class BulkUpsertTrustLinesOperation : public DatabaseTypeSpecificOperation<void>
 class BulkDeleteTrustLinesOperation : public DatabaseTypeSpecificOperation<void>
 {
     Database& mDB;
+    soci::session& mSession;
     LedgerTxnConsistency mCons;
-    std::vector<std::string> mAccountIDs;
-    std::vector<std::string> mAssets;
+    std::vector<std::vector<uint8_t>> mAccountIDs;
+    std::vector<std::vector<uint8_t>> mAssets;
 
   public:
-    BulkDeleteTrustLinesOperation(Database& DB, LedgerTxnConsistency cons,
+    BulkDeleteTrustLinesOperation(Database& DB, soci::session& session,
+                                  LedgerTxnConsistency cons,
                                   std::vector<EntryIterator> const& entries,
                                   uint32_t ledgerVersion)
-        : mDB(DB), mCons(cons)
+        : mDB(DB), mSession(session), mCons(cons)
     {
         mAccountIDs.reserve(entries.size());
         mAssets.reserve(entries.size());
@@ -260,38 +281,35 @@ class BulkDeleteTrustLinesOperation : public DatabaseTypeSpecificOperation<void>
 
             validateTrustLineKey(ledgerVersion, e.key().ledgerKey());
 
-            mAccountIDs.emplace_back(KeyUtils::toStrKey(tl.accountID));
-            mAssets.emplace_back(toOpaqueBase64(tl.asset));
+            mAccountIDs.emplace_back(toOpaque(tl.accountID));
+            mAssets.emplace_back(toOpaque(tl.asset));
         }
     }
 
     void
-    doSociGenericOperation()
+    doSqliteSpecificOperation(soci::sqlite3_session_backend* sq) override
     {
-        std::string sql = "DELETE FROM trustlines WHERE accountid = :id "
-                          "AND asset = :v1";
-        auto prep = mDB.getPreparedStatement(sql);
-        soci::statement& st = prep.statement();
-        st.exchange(soci::use(mAccountIDs));
-        st.exchange(soci::use(mAssets));
-        st.define_and_bind();
+        std::string sql = "DELETE FROM trustlines WHERE accountid = ? "
+                          "AND asset = ?";
+        auto prep = mDB.getPreparedStatement(sql, mSession);
+        auto st = getSqliteStatement(prep);
+        size_t deleted = 0;
         {
             auto timer = mDB.getDeleteTimer("trustline");
-            st.execute(true);
+            for (size_t i = 0; i < mAccountIDs.size(); ++i)
+            {
+                bindSqliteBlob(st, 1, mAccountIDs[i]);
+                bindSqliteBlob(st, 2, mAssets[i]);
+                deleted += stepSqliteStatement(sq->conn_, st);
+            }
         }
-        if (static_cast<size_t>(st.get_affected_rows()) != mAccountIDs.size() &&
+        if (deleted != mAccountIDs.size() &&
             mCons == LedgerTxnConsistency::EXACT)
         {
             throw std::runtime_error("Could not update data in SQL");
         }
     }
 
-    void
-    doSqliteSpecificOperation(soci::sqlite3_session_backend* sq) override
-    {
-        doSociGenericOperation();
-    }
-
 #ifdef USE_POSTGRES
     void
     doPostgresSpecificOperation(soci::postgresql_session_backend* pg) override
@@ -301,12 +319,12 @@ class BulkDeleteTrustLinesOperation : public DatabaseTypeSpecificOperation<void>
         marshalToPGArray(conn, strAccountIDs, mAccountIDs);
         marshalToPGArray(conn, strAssets, mAssets);
         std::string sql = "WITH r AS (SELECT "
-                          "unnest(:ids::TEXT[]), "
-                          "unnest(:v1::TEXT[])"
+                          "unnest(:ids::BYTEA[]), "
+                          "unnest(:v1::BYTEA[])"
                           ") "
                           "DELETE FROM trustlines WHERE "
                           "(accountid, asset) IN (SELECT * FROM r)";
-        auto prep = mDB.getPreparedStatement(sql);
+        auto prep = mDB.getPreparedStatement(sql, mSession);
         soci::statement& st = prep.statement();
         st.exchange(soci::use(strAccountIDs));
         st.exchange(soci::use(strAssets));
@@ -330,9 +348,8 @@ LedgerTxnRoot::Impl::bulkUpsertTrustLines(
 {
     ZoneScoped;
     ZoneValue(static_cast<int64_t>(entries.size()));
-    BulkUpsertTrustLinesOperation op(mDatabase, entries,
-                                     mHeader->ledgerVersion);
-    mDatabase.doDatabaseTypeSpecificOperation(op);
+    executeWrite(std::make_unique<BulkUpsertTrustLinesOperation>(
+        mDatabase, getWriteSession(), entries, mHeader->ledgerVersion));
 }
 
 void
@@ -341,26 +358,24 @@ LedgerTxnRoot::Impl::bulkDeleteTrustLines(
 {
     ZoneScoped;
     ZoneValue(static_cast<int64_t>(entries.size()));
-    BulkDeleteTrustLinesOperation op(mDatabase, cons, entries,
-                                     mHeader->ledgerVersion);
-    mDatabase.doDatabaseTypeSpecificOperation(op);
+    executeWrite(std::make_unique<BulkDeleteTrustLinesOperation>(
+        mDatabase, getWriteSession(), cons, entries, mHeader->ledgerVersion));
 }
 
 void
 LedgerTxnRoot::Impl::dropTrustLines()
 {
     throwIfChild();
+    drainWriteBehind();
     mEntryCache.clear();
-    mBestOffers.clear();
 
-    std::string coll = mDatabase.getSimpleCollationClause();
+    std::string binary = mDatabase.isSqlite() ? "BLOB" : "BYTEA";
 
     mDatabase.getSession() << "DROP TABLE IF EXISTS trustlines;";
     mDatabase.getSession() << "CREATE TABLE trustlines"
                            << "("
-                           << "accountid    VARCHAR(56) " << coll
-                           << " NOT NULL,"
-                           << "asset        TEXT " << coll << " NOT NULL,"
+                           << "accountid    " << binary << " NOT NULL,"
+                           << "asset        " << binary << " NOT NULL,"
                            << "ledgerentry  TEXT NOT NULL,"
                            << "lastmodified INT  NOT NULL,"
                            << "PRIMARY KEY  (accountid, asset));";
@@ -370,43 +385,14 @@ class BulkLoadTrustLinesOperation
     : public DatabaseTypeSpecificOperation<std::vector<LedgerEntry>>
 {
     Database& mDb;
-    std::vector<std::string> mAccountIDs;
-    std::vector<std::string> mAssets;
-
-    std::vector<LedgerEntry>
-    executeAndFetch(soci::statement& st)
-    {
-        std::string accountID, asset, trustLineEntryStr;
-
-        st.exchange(soci::into(accountID));
-        st.exchange(soci::into(asset));
-        st.exchange(soci::into(trustLineEntryStr));
-        st.define_and_bind();
-        {
-            auto timer = mDb.getSelectTimer("trust");
-            st.execute(true);
-        }
-
-        std::vector<LedgerEntry> res;
-        while (st.got_data())
-        {
-            res.emplace_back();
-            auto& le = res.back();
-
-            fromOpaqueBase64(le, trustLineEntryStr);
-            releaseAssert(le.data.type() == TRUSTLINE);
-            releaseAssert(le.data.trustLine().asset.type() !=
-                          ASSET_TYPE_NATIVE);
-
-            st.fetch();
-        }
-        return res;
-    }
+    soci::session& mSession;
+    std::vector<std::vector<uint8_t>> mAccountIDs;
+    std::vector<std::vector<uint8_t>> mAssets;
 
   public:
-    BulkLoadTrustLinesOperation(Database& db,
+    BulkLoadTrustLinesOperation(Database& db, soci::session& session,
                                 UnorderedSet<LedgerKey> const& keys)
-        : mDb(db)
+        : mDb(db), mSession(session)
     {
         mAccountIDs.reserve(keys.size());
         mAssets.reserve(keys.size());
@@ -420,9 +406,8 @@ class BulkLoadTrustLinesOperation
                     "TrustLine asset can't be native");
             }
 
-            mAccountIDs.emplace_back(
-                KeyUtils::toStrKey(k.trustLine().accountID));
-            mAssets.emplace_back(toOpaqueBase64(k.trustLine().asset));
+            mAccountIDs.emplace_back(toOpaque(k.trustLine().accountID));
+            mAssets.emplace_back(toOpaque(k.trustLine().asset));
         }
     }
 
@@ -431,43 +416,39 @@ class BulkLoadTrustLinesOperation
     {
         releaseAssert(mAccountIDs.size() == mAssets.size());
 
-        std::vector<char const*> cstrAccountIDs;
-        std::vector<char const*> cstrAssets;
-        cstrAccountIDs.reserve(mAccountIDs.size());
-        cstrAssets.reserve(mAssets.size());
-        for (size_t i = 0; i < mAccountIDs.size(); ++i)
-        {
-            cstrAccountIDs.emplace_back(mAccountIDs[i].c_str());
-            cstrAssets.emplace_back(mAssets[i].c_str());
-        }
+        auto prep = mDb.getPreparedStatement("SELECT ledgerentry "
+                                             "FROM trustlines "
+                                             "WHERE accountid = ? "
+                                             "AND asset = ?",
+                                             mSession);
+        auto st = getSqliteStatement(prep);
 
-        std::string sqlJoin = "SELECT x.value, y.value FROM "
-                              "(SELECT rowid, value FROM carray(?, ?, "
-                              "'char*') ORDER BY rowid) "
-                              "AS x "
-                              "INNER JOIN (SELECT rowid, value FROM "
-                              "carray(?, ?, 'char*') ORDER "
-                              "BY rowid) AS y ON x.rowid = y.rowid ";
-        std::string sql = "WITH r AS (" + sqlJoin +
-                          ") SELECT accountid, asset, ledgerentry "
-                          "FROM trustlines WHERE (accountid, asset) IN r";
-
-        auto prep = mDb.getPreparedStatement(sql);
-        auto be = prep.statement().get_backend();
-        if (be == nullptr)
+        std::vector<LedgerEntry> res;
+        auto timer = mDb.getSelectTimer("trust");
+        for (size_t i = 0; i < mAccountIDs.size(); ++i)
         {
-            throw std::runtime_error("no sql backend");
+            bindSqliteBlob(st, 1, mAccountIDs[i]);
+            bindSqliteBlob(st, 2, mAssets[i]);
+            int rc = sqlite3_step(st);
+            if (rc == SQLITE_ROW)
+            {
+                auto text = reinterpret_cast<char const*>(
+                    sqlite3_column_text(st, 0));
+                std::string trustLineEntryStr(text,
+                                              sqlite3_column_bytes(st, 0));
+                res.emplace_back();
+                fromTrustLineEntryStr(res.back(), trustLineEntryStr);
+            }
+            else if (rc != SQLITE_DONE)
+            {
+                std::string msg = sqlite3_errmsg(sq->conn_);
+                sqlite3_reset(st);
+                throw std::runtime_error("Could not load data from SQL: " +
+                                         msg);
+            }
+            sqlite3_reset(st);
         }
-        auto sqliteStatement =
-            dynamic_cast<soci::sqlite3_statement_backend*>(be);
-        auto st = sqliteStatement->stmt_;
-
-        sqlite3_reset(st);
-        sqlite3_bind_pointer(st, 1, cstrAccountIDs.data(), "carray", 0);
-        sqlite3_bind_int(st, 2, static_cast<int>(cstrAccountIDs.size()));
-        sqlite3_bind_pointer(st, 3, cstrAssets.data(), "carray", 0);
-        sqlite3_bind_int(st, 4, static_cast<int>(cstrAssets.size()));
-        return executeAndFetch(prep.statement());
+        return res;
     }
 
 #ifdef USE_POSTGRES
@@ -482,16 +463,31 @@ class BulkLoadTrustLinesOperation
         marshalToPGArray(pg->conn_, strAssets, mAssets);
 
         auto prep = mDb.getPreparedStatement(
-            "WITH r AS (SELECT unnest(:v1::TEXT[]), "
-            "unnest(:v2::TEXT[])) SELECT accountid, asset, "
-            "ledgerentry "
+            "WITH r AS (SELECT unnest(:v1::BYTEA[]), "
+            "unnest(:v2::BYTEA[])) SELECT ledgerentry "
             " FROM trustlines "
             "WHERE (accountid, asset) IN (SELECT * "
-            "FROM r)");
+            "FROM r)",
+            mSession);
         auto& st = prep.statement();
+        std::string trustLineEntryStr;
+        st.exchange(soci::into(trustLineEntryStr));
         st.exchange(soci::use(strAccountIDs));
         st.exchange(soci::use(strAssets));
-        return executeAndFetch(st);
+        st.define_and_bind();
+        {
+            auto timer = mDb.getSelectTimer("trust");
+            st.execute(true);
+        }
+
+        std::vector<LedgerEntry> res;
+        while (st.got_data())
+        {
+            res.emplace_back();
+            fromTrustLineEntryStr(res.back(), trustLineEntryStr);
+            st.fetch();
+        }
+        return res;
     }
 #endif
 };
@@ -499,14 +495,21 @@ class BulkLoadTrustLinesOperation
 UnorderedMap<LedgerKey, std::shared_ptr<LedgerEntry const>>
 LedgerTxnRoot::Impl::bulkLoadTrustLines(
     UnorderedSet<LedgerKey> const& keys) const
+{
+    return bulkLoadTrustLines(keys, mDatabase.getSession());
+}
+
+UnorderedMap<LedgerKey, std::shared_ptr<LedgerEntry const>>
+LedgerTxnRoot::Impl::bulkLoadTrustLines(UnorderedSet<LedgerKey> const& keys,
+                                        soci::session& session) const
 {
     ZoneScoped;
     ZoneValue(static_cast<int64_t>(keys.size()));
     if (!keys.empty())
     {
-        BulkLoadTrustLinesOperation op(mDatabase, keys);
+        BulkLoadTrustLinesOperation op(mDatabase, session, keys);
         return populateLoadedEntries(
-            keys, mDatabase.doDatabaseTypeSpecificOperation(op));
+            keys, doDatabaseTypeSpecificOperation(session, op));
     }
     else
     {
@@ -6,11 +6,19 @@
 #include "ledger/LedgerManager.h"
 #include "ledger/LedgerTxn.h"
 #include "main/Application.h"
+#include "test/TestAccount.h"
+#include "test/TestUtils.h"
+#include "test/TxTests.h"
 #include "test/test.h"
+#include "transactions/TransactionFrame.h"
 
+#include "medida/meter.h"
+#include "medida/metrics_registry.h"
+#include <fmt/format.h>
 #include <lib/catch.hpp>
 
 using namespace stellar;
+using namespace stellar::txtest;
 
 TEST_CASE("cannot close ledger with unsupported ledger version", "[ledger]")
 {
@@ -46,3 +54,54 @@ TEST_CASE("cannot close ledger with unsupported ledger version", "[ledger]")
     }
     REQUIRE_THROWS_AS(applyEmptyLedger(), std::runtime_error);
 }
+
+TEST_CASE("signatures are pre-verified before applying a tx set", "[ledger]")
+{
+    VirtualClock clock;
+    auto cfg = getTestConfig();
+    bool preVerify = true;
+    SECTION("pre-verification enabled")
+    {
+        preVerify = true;
+    }
+    SECTION("pre-verification disabled")
+    {
+        preVerify = false;
+    }
+    cfg.PARALLEL_SIGNATURE_PREVERIFICATION = preVerify;
+    auto app = createTestApplication(clock, cfg);
+
+    auto root = TestAccount::createRoot(*app);
+    auto const minBalance = app->getLedgerManager().getLastMinBalance(2);
+    std::vector<TransactionFrameBasePtr> txs;
+    for (int i = 0; i < 64; ++i)
+    {
+        auto account = root.create(fmt::format("A{}", i), minBalance);
+        txs.emplace_back(account.tx({payment(root, 1)}));
+    }
+
+    auto& hits =
+        app->getMetrics().NewMeter({"crypto", "verify", "hit"}, "signature");
+    app->syncOwnMetrics();
+    auto hitsBefore = hits.count();
+
+    // Apply in the given order, skipping validation: it would verify the
+    // signatures itself and warm the cache.
+    auto const ledgerSeq = app->getLedgerManager().getLastClosedLedgerNum() + 1;
+    closeLedgerOn(*app, ledgerSeq, 1, 1, 2016, txs, true);
+    app->syncOwnMetrics();
+
+    for (auto const& tx : txs)
+    {
+        REQUIRE(tx->getResultCode() == txSUCCESS);
+    }
+    auto newHits = static_cast<size_t>(hits.count() - hitsBefore);
+    if (preVerify)
+    {
+        REQUIRE(newHits >= txs.size());
+    }
+    else
+    {
+        REQUIRE(newHits < txs.size());
+    }
+}
@@ -2,6 +2,7 @@
 // under the Apache License, Version 2.0. See the COPYING file at the root
 // of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
 
+#include "ledger/LedgerManager.h"
 #include "ledger/LedgerTxn.h"
 #include "ledger/LedgerTxnEntry.h"
 #include "ledger/LedgerTxnHeader.h"
@@ -10,16 +11,19 @@
 #include "lib/catch.hpp"
 #include "lib/util/stdrandom.h"
 #include "main/Application.h"
+#include "main/PersistentState.h"
 #include "test/TestAccount.h"
 #include "test/TestUtils.h"
 #include "test/TxTests.h"
 #include "test/test.h"
 #include "transactions/TransactionUtils.h"
+#include "util/Arena.h"
 #include "util/Math.h"
 #include "util/XDROperators.h"
 #include <algorithm>
 #include <fmt/format.h>
 #include <functional>
+#include <future>
 #include <map>
 #include <memory>
 #include <queue>
@@ -2510,6 +2514,61 @@ TEST_CASE("LedgerTxnEntry and LedgerTxnHeader move assignment", "[ledgertxn]")
     }
 }
 
+TEST_CASE("LedgerTxn entries are allocated from the root arena",
+          "[ledgertxn][arena]")
+{
+    VirtualClock clock;
+    auto app = createTestApplication(clock, getTestConfig());
+    auto& root = app->getLedgerTxnRoot();
+    auto arena = root.getArena();
+    REQUIRE(arena);
+    REQUIRE(arena->getLiveAllocations() == 0);
+
+    UnorderedMap<LedgerKey, LedgerEntry> entries;
+    while (entries.size() < 10)
+    {
+        auto le = LedgerTestUtils::generateValidLedgerEntry();
+        le.lastModifiedLedgerSeq = 1;
+        entries.emplace(LedgerEntryKey(le), le);
+    }
+
+    auto createInChild = [&](AbstractLedgerTxn& ltx1) {
+        LedgerTxn ltx2(ltx1);
+        REQUIRE(ltx2.getArena() == arena);
+        for (auto const& kv : entries)
+        {
+            REQUIRE(ltx2.create(kv.second));
+        }
+        ltx2.commit();
+    };
+
+    SECTION("rollback")
+    {
+        LedgerTxn ltx1(root);
+        REQUIRE(ltx1.getArena() == arena);
+        createInChild(ltx1);
+        REQUIRE(arena->getLiveAllocations() > 0);
+    }
+
+    SECTION("commit")
+    {
+        {
+            LedgerTxn ltx1(root);
+            createInChild(ltx1);
+            ltx1.commit();
+        }
+        LedgerTxn ltx1(root, false);
+        for (auto const& kv : entries)
+        {
+            auto ltxe = ltx1.loadWithoutRecord(kv.first);
+            REQUIRE(ltxe);
+            REQUIRE(ltxe.current() == kv.second);
+        }
+    }
+
+    REQUIRE(arena->getLiveAllocations() == 0);
+}
+
 TEST_CASE("LedgerTxnRoot prefetch", "[ledgertxn]")
 {
     auto runTest = [&](Config::TestDbMode mode) {
@@ -3780,6 +3839,92 @@ TEST_CASE("LedgerTxn best offers cache eviction", "[ledgertxn]")
     }
 }
 
+TEST_CASE("LedgerTxn order books follow commits", "[ledgertxn]")
+{
+    VirtualClock clock;
+    auto cfg = getTestConfig(0);
+    auto app = createTestApplication(clock, cfg);
+
+    auto buying = autocheck::generator<Asset>()(UINT32_MAX);
+    auto selling = autocheck::generator<Asset>()(UINT32_MAX);
+    while (buying == selling)
+    {
+        selling = autocheck::generator<Asset>()(UINT32_MAX);
+    }
+
+    auto makeOffer = [&](int64_t offerID, Price const& price) {
+        LedgerEntry le;
+        le.data.type(OFFER);
+        auto& oe = le.data.offer();
+        oe.offerID = offerID;
+        oe.price = price;
+        oe.amount = 1;
+        oe.buying = buying;
+        oe.selling = selling;
+        return le;
+    };
+
+    auto checkBestOffers = [&](std::vector<int64_t> const& expected) {
+        LedgerTxn ltx(app->getLedgerTxnRoot());
+        for (auto offerID : expected)
+        {
+            auto ltxe = ltx.loadBestOffer(buying, selling);
+            REQUIRE(ltxe);
+            REQUIRE(ltxe.current().data.offer().offerID == offerID);
+            ltxe.erase();
+        }
+        REQUIRE(!ltx.loadBestOffer(buying, selling));
+    };
+
+    {
+        LedgerTxn ltx(app->getLedgerTxnRoot());
+        ltx.create(makeOffer(1, Price{2, 1}));
+        ltx.create(makeOffer(2, Price{1, 1}));
+        ltx.create(makeOffer(3, Price{1, 1}));
+        ltx.commit();
+    }
+    checkBestOffers({2, 3, 1});
+
+    SECTION("price changes")
+    {
+        {
+            LedgerTxn ltx(app->getLedgerTxnRoot());
+            auto ltxe = ltx.load(LedgerEntryKey(makeOffer(1, Price{1, 1})));
+            ltxe.current().data.offer().price = Price{1, 2};
+            ltx.commit();
+        }
+        checkBestOffers({1, 2, 3});
+    }
+
+    SECTION("offers are deleted and created")
+    {
+        {
+            LedgerTxn ltx(app->getLedgerTxnRoot());
+            ltx.load(LedgerEntryKey(makeOffer(2, Price{1, 1}))).erase();
+            ltx.create(makeOffer(4, Price{3, 2}));
+            ltx.commit();
+        }
+        checkBestOffers({3, 4, 1});
+
+        // Loading all offers and loading by key see the same changes
+        auto offers = app->getLedgerTxnRoot().getAllOffers();
+        REQUIRE(offers.size() == 3);
+        REQUIRE(offers.count(LedgerEntryKey(makeOffer(4, Price{3, 2}))) == 1);
+        LedgerTxn ltx(app->getLedgerTxnRoot());
+        REQUIRE(!ltx.load(LedgerEntryKey(makeOffer(2, Price{1, 1}))));
+    }
+
+    SECTION("rolled back changes are not applied")
+    {
+        {
+            LedgerTxn ltx(app->getLedgerTxnRoot());
+            ltx.load(LedgerEntryKey(makeOffer(2, Price{1, 1}))).erase();
+            ltx.create(makeOffer(4, Price{1, 2}));
+        }
+        checkBestOffers({2, 3, 1});
+    }
+}
+
 typedef std::map<std::tuple<AccountID, Asset, Asset>, int64_t> PoolShareUpdates;
 typedef std::map<std::pair<Asset, Asset>, int64_t> LiquidityPoolUpdates;
 
@@ -3966,6 +4111,274 @@ testPoolShareTrustLinesByAccountAndAsset(
     }
 }
 
+#ifdef USE_POSTGRES
+TEST_CASE("LedgerTxnRoot write-behind commit", "[ledgertxn]")
+{
+    VirtualClock clock;
+    auto cfg = getTestConfig(0, Config::TESTDB_POSTGRESQL);
+    cfg.EXPERIMENTAL_WRITE_BEHIND_COMMIT = true;
+    auto app = createTestApplication(clock, cfg);
+    auto& root = app->getLedgerTxnRoot();
+    auto& ps = app->getPersistentState();
+    auto lcl = app->getLedgerManager().getLastClosedLedgerNum();
+
+    auto initialCount = root.countObjects(ACCOUNT);
+    std::vector<LedgerKey> keys;
+    {
+        LedgerTxn ltx(root);
+        for (auto const& ae : LedgerTestUtils::generateValidAccountEntries(50))
+        {
+            LedgerEntry le;
+            le.data.type(ACCOUNT);
+            le.data.account() = ae;
+            auto key = LedgerEntryKey(le);
+            if (std::find(keys.begin(), keys.end(), key) == keys.end())
+            {
+                ltx.create(le);
+                keys.emplace_back(key);
+            }
+        }
+        ltx.commit();
+    }
+
+    auto checkLoads = [&](bool exist) {
+        // Read-only LedgerTxns do not wait for the write-behind thread, so
+        // these loads may be served before the entries reach the database.
+        LedgerTxn ltx(root, false, TransactionMode::READ_ONLY_WITHOUT_SQL_TXN);
+        for (auto const& key : keys)
+        {
+            REQUIRE(static_cast<bool>(ltx.loadWithoutRecord(key)) == exist);
+        }
+    };
+
+    checkLoads(true);
+    REQUIRE(root.countObjects(ACCOUNT) == initialCount + keys.size());
+    REQUIRE(ps.getState(PersistentState::kWriteBehindLedger) ==
+            std::to_string(lcl));
+
+    {
+        LedgerTxn ltx(root);
+        for (auto const& key : keys)
+        {
+            ltx.erase(key);
+        }
+        ltx.commit();
+    }
+    checkLoads(false);
+    REQUIRE(root.countObjects(ACCOUNT) == initialCount);
+}
+
+TEST_CASE("LedgerTxnRoot write-behind serves unwritten entries",
+          "[ledgertxn]")
+{
+    VirtualClock clock;
+    auto cfg = getTestConfig(0, Config::TESTDB_POSTGRESQL);
+    cfg.EXPERIMENTAL_WRITE_BEHIND_COMMIT = true;
+    auto app = createTestApplication(clock, cfg);
+    auto& root = app->getLedgerTxnRoot();
+
+    // Hold the write-behind thread inside the SQL transaction of the next
+    // commit, so that its entries are only in memory.
+    std::promise<void> release;
+    auto released = release.get_future().share();
+    root.disableWriteBehind();
+    root.enableWriteBehind(
+        [released](soci::session&, uint32_t) { released.wait(); });
+
+    UnorderedMap<LedgerKey, LedgerEntry> committed;
+    {
+        LedgerTxn ltx(root);
+        for (auto const& ae : LedgerTestUtils::generateValidAccountEntries(50))
+        {
+            LedgerEntry le;
+            le.data.type(ACCOUNT);
+            le.data.account() = ae;
+            if (committed.emplace(LedgerEntryKey(le), le).second)
+            {
+                ltx.create(le);
+            }
+        }
+        ltx.commit();
+    }
+    UnorderedSet<LedgerKey> keys;
+    for (auto const& kv : committed)
+    {
+        keys.emplace(kv.first);
+    }
+
+    auto checkLoads = [&]() {
+        LedgerTxn ltx(root, false, TransactionMode::READ_ONLY_WITHOUT_SQL_TXN);
+        for (auto const& kv : committed)
+        {
+            auto entry = ltx.loadWithoutRecord(kv.first);
+            REQUIRE(entry);
+            REQUIRE(entry.current() == kv.second);
+        }
+    };
+
+    auto check = [&]() {
+        // Other sessions do not see the entries yet.
+        soci::session session(app->getDatabase().getPool());
+        for (auto const& kv : root.loadFromDatabase(keys, session))
+        {
+            REQUIRE(!kv.second);
+        }
+
+        SECTION("loads")
+        {
+            checkLoads();
+        }
+        SECTION("prefetch")
+        {
+            REQUIRE(root.prefetch(keys) == keys.size());
+            checkLoads();
+        }
+    };
+
+    // The write-behind thread must be released before the application is
+    // destroyed, which joins it.
+    try
+    {
+        check();
+    }
+    catch (...)
+    {
+        release.set_value();
+        throw;
+    }
+    release.set_value();
+
+    root.waitForWriteBehind();
+    soci::session session(app->getDatabase().getPool());
+    for (auto const& kv : root.loadFromDatabase(keys, session))
+    {
+        REQUIRE(kv.second);
+        REQUIRE(*kv.second == committed.at(kv.first));
+    }
+}
+
+TEST_CASE("LedgerTxnRoot write-behind rebuilds unwritten ledgers on restart",
+          "[ledgertxn]")
+{
+    auto cfg = getTestConfig(0, Config::TESTDB_POSTGRESQL);
+    cfg.EXPERIMENTAL_WRITE_BEHIND_COMMIT = true;
+
+    auto restartWithMarkerBehind = [&](uint32_t behind) {
+        {
+            VirtualClock clock;
+            auto app = createTestApplication(clock, cfg);
+            auto& root = app->getLedgerTxnRoot();
+            auto lcl = app->getLedgerManager().getLastClosedLedgerNum();
+
+            // Lose the entries of the BucketList, as if the node had
+            // stopped before writing them.
+            root.waitForWriteBehind();
+            root.dropAccounts();
+            REQUIRE(root.countObjects(ACCOUNT) == 0);
+            app->getPersistentState().setState(
+                PersistentState::kWriteBehindLedger,
+                std::to_string(lcl - behind));
+        }
+
+        VirtualClock clock;
+        auto app = createTestApplication(clock, cfg, /*newDB=*/false);
+        auto lcl = app->getLedgerManager().getLastClosedLedgerNum();
+        REQUIRE(app->getPersistentState().getState(
+                    PersistentState::kWriteBehindLedger) ==
+                std::to_string(lcl));
+
+        auto rootKey =
+            accountKey(txtest::getRoot(app->getNetworkID()).getPublicKey());
+        LedgerTxn ltx(app->getLedgerTxnRoot());
+        return static_cast<bool>(ltx.load(rootKey));
+    };
+
+    SECTION("marker at the last closed ledger")
+    {
+        REQUIRE(!restartWithMarkerBehind(0));
+    }
+    SECTION("marker behind the last closed ledger")
+    {
+        REQUIRE(restartWithMarkerBehind(1));
+    }
+}
+#endif
+
+TEST_CASE("LedgerTxnRoot trustline keys round trip", "[ledgertxn]")
+{
+    auto runTest = [&](Config::TestDbMode mode) {
+        VirtualClock clock;
+        auto app = createTestApplication(clock, getTestConfig(0, mode));
+
+        // The binary keys of these trustlines only differ after NUL bytes.
+        auto account = txtest::getAccount("account").getPublicKey();
+        std::vector<LedgerKey> keys;
+        for (auto const& issuer : {"issuer1", "issuer2"})
+        {
+            for (auto const& code : {"A", "AB"})
+            {
+                LedgerKey key(TRUSTLINE);
+                key.trustLine().accountID = account;
+                key.trustLine().asset = assetToTrustLineAsset(
+                    txtest::makeAsset(txtest::getAccount(issuer), code));
+                keys.emplace_back(key);
+            }
+        }
+
+        {
+            LedgerTxn ltx(app->getLedgerTxnRoot());
+            int64_t balance = 0;
+            for (auto const& key : keys)
+            {
+                LedgerEntry le;
+                le.data.type(TRUSTLINE);
+                le.data.trustLine().accountID = key.trustLine().accountID;
+                le.data.trustLine().asset = key.trustLine().asset;
+                le.data.trustLine().limit = INT64_MAX;
+                le.data.trustLine().balance = ++balance;
+                ltx.create(le);
+            }
+            ltx.commit();
+        }
+
+        auto check = [&](size_t erased) {
+            LedgerTxn ltx(app->getLedgerTxnRoot());
+            for (size_t i = 0; i < keys.size(); ++i)
+            {
+                auto ltxe = ltx.load(keys[i]);
+                REQUIRE(static_cast<bool>(ltxe) == (i >= erased));
+                if (ltxe)
+                {
+                    REQUIRE(ltxe.current().data.trustLine().balance ==
+                            static_cast<int64_t>(i + 1));
+                }
+            }
+        };
+        check(0);
+
+        {
+            LedgerTxn ltx(app->getLedgerTxnRoot());
+            ltx.erase(keys[0]);
+            ltx.commit();
+        }
+        check(1);
+        REQUIRE(app->getLedgerTxnRoot().countObjects(TRUSTLINE) ==
+                keys.size() - 1);
+    };
+
+    SECTION("default")
+    {
+        runTest(Config::TESTDB_DEFAULT);
+    }
+
+#ifdef USE_POSTGRES
+    SECTION("postgresql")
+    {
+        runTest(Config::TESTDB_POSTGRESQL);
+    }
+#endif
+}
+
 TEST_CASE("LedgerTxn loadPoolShareTrustLinesByAccountAndAsset", "[ledgertxn]")
 {
     auto a1 = LedgerTestUtils::generateValidAccountEntry().accountID;
@@ -121,6 +121,10 @@ void validateNetworkPassphrase(std::shared_ptr<Application> app);
  * sub-objects (with a couple exceptions, in the BucketManager and BucketList
  * objects).
  *
+ * When BACKGROUND_OVERLAY_PROCESSING is set, a third io_context is run by a
+ * single "overlay" thread, on which TCPPeers decode and authenticate incoming
+ * messages in order before handing them to the main thread.
+ *
  * Completed "worker" tasks typically post their results back to the main
  * thread's io_context (held in the VirtualClock), or else deliver their results
  * to the Application through std::futures or similar standard
@@ -231,6 +235,11 @@ class Application
         Scheduler::ActionType type = Scheduler::ActionType::NORMAL_ACTION) = 0;
     virtual void postOnBackgroundThread(std::function<void()>&& f,
                                         std::string jobName) = 0;
+    // Runs `f` on the overlay thread, a single thread that runs posted tasks
+    // one at a time in the order they were posted. Only available when
+    // BACKGROUND_OVERLAY_PROCESSING is set.
+    virtual void postOnOverlayThread(std::function<void()>&& f,
+                                     std::string jobName) = 0;
 
     // Perform actions necessary to transition from BOOTING_STATE to other
     // states. In particular: either reload or reinitialize the database, and
@@ -20,6 +20,7 @@
 #include "database/Database.h"
 #include "herder/Herder.h"
 #include "herder/HerderPersistence.h"
+#include "history/HistoryArchive.h"
 #include "history/HistoryArchiveManager.h"
 #include "history/HistoryArchiveReportWork.h"
 #include "history/HistoryManager.h"
@@ -51,6 +52,7 @@
 #include "process/ProcessManager.h"
 #include "scp/LocalNode.h"
 #include "scp/QuorumSetUtils.h"
+#include "util/Arena.h"
 #include "util/GlobalChecks.h"
 #include "util/LogSlowExecution.h"
 #include "util/Logging.h"
@@ -80,6 +82,8 @@ ApplicationImpl::ApplicationImpl(VirtualClock& clock, Config const& cfg)
     , mConfig(cfg)
     , mWorkerIOContext(mConfig.WORKER_THREADS)
     , mWork(std::make_unique<asio::io_context::work>(mWorkerIOContext))
+    , mOverlayIOContext(1)
+    , mOverlayWork(std::make_unique<asio::io_context::work>(mOverlayIOContext))
     , mWorkerThreads()
     , mStopSignals(clock.getIOContext(), SIGINT)
     , mStarted(false)
@@ -92,6 +96,8 @@ ApplicationImpl::ApplicationImpl(VirtualClock& clock, Config const& cfg)
           mMetrics->NewTimer({"app", "post-on-main-thread", "delay"}))
     , mPostOnBackgroundThreadDelay(
           mMetrics->NewTimer({"app", "post-on-background-thread", "delay"}))
+    , mPostOnOverlayThreadDelay(
+          mMetrics->NewTimer({"app", "post-on-overlay-thread", "delay"}))
     , mStartedOn(clock.system_now())
 {
 #ifdef SIGQUIT
@@ -105,6 +111,10 @@ ApplicationImpl::ApplicationImpl(VirtualClock& clock, Config const& cfg)
 
     mNetworkID = sha256(mConfig.NETWORK_PASSPHRASE);
 
+    // The verification cache is process-wide; the size is only changed (and
+    // the cache only cleared) if this config asks for a different one.
+    PubKeyUtils::setVerifySigCacheSize(mConfig.SIGNATURE_CACHE_SIZE);
+
     TracyAppInfo(STELLAR_CORE_VERSION.c_str(), STELLAR_CORE_VERSION.size());
     TracyAppInfo(mConfig.NETWORK_PASSPHRASE.c_str(),
                  mConfig.NETWORK_PASSPHRASE.size());
@@ -140,6 +150,26 @@ ApplicationImpl::ApplicationImpl(VirtualClock& clock, Config const& cfg)
         }};
         mWorkerThreads.emplace_back(std::move(thread));
     }
+
+    if (mConfig.BACKGROUND_OVERLAY_PROCESSING)
+    {
+        // Not lowered in priority: it feeds the main thread.
+        mOverlayThread = std::make_unique<std::thread>(
+            [this]() { mOverlayIOContext.run(); });
+    }
+}
+
+static std::optional<uint32_t>
+lastClosedLedgerSeq(PersistentState& ps)
+{
+    auto hasString = ps.getState(PersistentState::kHistoryArchiveState);
+    if (hasString.empty())
+    {
+        return std::nullopt;
+    }
+    HistoryArchiveState has;
+    has.fromString(hasString);
+    return has.currentLedger;
 }
 
 static void
@@ -274,6 +304,19 @@ ApplicationImpl::initialize(bool createNewDB, bool forceRebuild)
             mConfig.BEST_OFFER_DEBUGGING_ENABLED
 #endif
         );
+        if (mConfig.EXPERIMENTAL_BUCKETLIST_DB &&
+            mConfig.MODE_ENABLES_BUCKETLIST)
+        {
+            mLedgerTxnRoot->loadAccountsAndTrustLinesFromBucketList(
+                mBucketManager->getBucketList());
+        }
+        if (mConfig.EXPERIMENTAL_WRITE_BEHIND_COMMIT &&
+            (mDatabase->isSqlite() || !mConfig.MODE_ENABLES_BUCKETLIST))
+        {
+            throw std::invalid_argument(
+                "EXPERIMENTAL_WRITE_BEHIND_COMMIT requires a PostgreSQL "
+                "database and the BucketList");
+        }
 
         BucketListIsConsistentWithDatabase::registerInvariant(*this);
     }
@@ -294,6 +337,22 @@ ApplicationImpl::initialize(bool createNewDB, bool forceRebuild)
         upgradeToCurrentSchemaAndMaybeRebuildLedger(true, forceRebuild);
     }
 
+    if (mLedgerTxnRoot && mConfig.EXPERIMENTAL_WRITE_BEHIND_COMMIT)
+    {
+        // kWriteBehindLedger is the last ledger whose entries are all in the
+        // database; it is checked against the last closed ledger on the next
+        // start.
+        auto lcl = lastClosedLedgerSeq(getPersistentState());
+        getPersistentState().setState(PersistentState::kWriteBehindLedger,
+                                      lcl ? std::to_string(*lcl) : "");
+        mLedgerTxnRoot->enableWriteBehind(
+            [this](soci::session& session, uint32_t ledgerSeq) {
+                getPersistentState().setState(
+                    PersistentState::kWriteBehindLedger,
+                    std::to_string(ledgerSeq), session);
+            });
+    }
+
     // Subtle: process manager should come to existence _after_ BucketManager
     // initialization and newDB run, as it relies on tmp dir created in the
     // constructor
@@ -348,6 +407,29 @@ ApplicationImpl::upgradeToCurrentSchemaAndMaybeRebuildLedger(bool applyBuckets,
     }
 
     mDatabase->upgradeToCurrentSchema();
+
+    // If the node stopped before the write-behind thread of LedgerTxnRoot
+    // wrote the entries of its last closed ledger, the ledger tables are
+    // incomplete and must be rebuilt.
+    auto& ps = getPersistentState();
+    auto flushed = ps.getState(PersistentState::kWriteBehindLedger);
+    if (!flushed.empty())
+    {
+        auto lcl = lastClosedLedgerSeq(ps);
+        if (!lcl || flushed != std::to_string(*lcl))
+        {
+            LOG_WARNING(DEFAULT_LOG,
+                        "Ledger entries were written up to ledger {} only, "
+                        "rebuilding ledger tables",
+                        flushed);
+            for (auto let : xdr::xdr_traits<LedgerEntryType>::enum_values())
+            {
+                ps.setRebuildForType(static_cast<LedgerEntryType>(let));
+            }
+        }
+        ps.setState(PersistentState::kWriteBehindLedger, "");
+    }
+
     maybeRebuildLedger(*this, applyBuckets);
 }
 
@@ -569,6 +651,10 @@ ApplicationImpl::~ApplicationImpl()
     LOG_INFO(DEFAULT_LOG, "Application destructing");
     try
     {
+        if (mLedgerTxnRoot)
+        {
+            mLedgerTxnRoot->disableWriteBehind();
+        }
         shutdownWorkScheduler();
         if (mProcessManager)
         {
@@ -755,6 +841,10 @@ ApplicationImpl::gracefulStop()
     {
         mHerder->shutdown();
     }
+    if (mInvariantManager)
+    {
+        mInvariantManager->waitForOperationChecks();
+    }
 
     mStoppingTimer.expires_from_now(
         std::chrono::seconds(SHUTDOWN_DELAY_SECONDS));
@@ -806,6 +896,16 @@ ApplicationImpl::joinAllThreads()
         w.join();
     }
     LOG_DEBUG(DEFAULT_LOG, "Joined all {} threads", mWorkerThreads.size());
+    if (mOverlayWork)
+    {
+        mOverlayWork.reset();
+    }
+    if (mOverlayThread)
+    {
+        LOG_DEBUG(DEFAULT_LOG, "Joining overlay thread");
+        mOverlayThread->join();
+        mOverlayThread.reset();
+    }
 }
 
 std::string
@@ -1114,13 +1214,36 @@ ApplicationImpl::syncOwnMetrics()
     // Flush crypto pure-global-cache stats. They don't belong
     // to a single app instance but first one to flush will claim
     // them.
+    std::vector<PubKeyUtils::VerifySigCacheCounts> shardCounts;
+    PubKeyUtils::flushVerifySigCacheCounts(shardCounts);
     uint64_t vhit = 0, vmiss = 0;
-    PubKeyUtils::flushVerifySigCacheCounts(vhit, vmiss);
+    for (size_t i = 0; i < shardCounts.size(); ++i)
+    {
+        auto shard = fmt::format(FMT_STRING("shard-{:d}"), i);
+        mMetrics->NewMeter({"crypto", "verify-hit", shard}, "signature")
+            .Mark(shardCounts[i].mHits);
+        mMetrics->NewMeter({"crypto", "verify-miss", shard}, "signature")
+            .Mark(shardCounts[i].mMisses);
+        vhit += shardCounts[i].mHits;
+        vmiss += shardCounts[i].mMisses;
+    }
     mMetrics->NewMeter({"crypto", "verify", "hit"}, "signature").Mark(vhit);
     mMetrics->NewMeter({"crypto", "verify", "miss"}, "signature").Mark(vmiss);
     mMetrics->NewMeter({"crypto", "verify", "total"}, "signature")
         .Mark(vhit + vmiss);
 
+    // Likewise for the stats of LedgerTxn entry arenas.
+    Arena::Counts arenaCounts;
+    Arena::flushCounts(arenaCounts);
+    mMetrics->NewMeter({"ledger", "arena", "allocate"}, "allocation")
+        .Mark(arenaCounts.mAllocations);
+    mMetrics->NewMeter({"ledger", "arena", "heap-allocate"}, "allocation")
+        .Mark(arenaCounts.mHeapAllocations);
+    mMetrics->NewMeter({"ledger", "arena", "block-bytes"}, "byte")
+        .Mark(arenaCounts.mBlockBytes);
+    mMetrics->NewMeter({"ledger", "arena", "rewind"}, "rewind")
+        .Mark(arenaCounts.mRewinds);
+
     // Similarly, flush global process-table stats.
     mMetrics->NewCounter({"process", "memory", "handles"})
         .set_count(mProcessManager->getNumRunningProcesses());
@@ -1296,6 +1419,19 @@ ApplicationImpl::postOnBackgroundThread(std::function<void()>&& f,
     });
 }
 
+void
+ApplicationImpl::postOnOverlayThread(std::function<void()>&& f,
+                                     std::string jobName)
+{
+    releaseAssert(mOverlayThread);
+    LogSlowExecution isSlow{std::move(jobName), LogSlowExecution::Mode::MANUAL,
+                            "executed after"};
+    asio::post(mOverlayIOContext, [this, f = std::move(f), isSlow]() {
+        mPostOnOverlayThreadDelay.Update(isSlow.checkElapsedTime());
+        f();
+    });
+}
+
 void
 ApplicationImpl::enableInvariantsFromConfig()
 {
@@ -1303,6 +1439,11 @@ ApplicationImpl::enableInvariantsFromConfig()
     {
         mInvariantManager->enableInvariant(name);
     }
+    if (mConfig.EXPERIMENTAL_ASYNC_INVARIANT_CHECKS)
+    {
+        mInvariantManager->enableAsyncOperationChecks(
+            mConfig.ASYNC_INVARIANT_CHECKS_MAX_BACKLOG);
+    }
 }
 
 std::unique_ptr<Herder>
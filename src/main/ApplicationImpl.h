@@ -82,6 +82,8 @@ class ApplicationImpl : public Application
                                   Scheduler::ActionType type) override;
     virtual void postOnBackgroundThread(std::function<void()>&& f,
                                         std::string jobName) override;
+    virtual void postOnOverlayThread(std::function<void()>&& f,
+                                     std::string jobName) override;
 
     virtual void start() override;
 
@@ -151,6 +153,8 @@ class ApplicationImpl : public Application
 
     asio::io_context mWorkerIOContext;
     std::unique_ptr<asio::io_context::work> mWork;
+    asio::io_context mOverlayIOContext;
+    std::unique_ptr<asio::io_context::work> mOverlayWork;
 
     std::unique_ptr<BucketManager> mBucketManager;
     std::unique_ptr<Database> mDatabase;
@@ -189,6 +193,7 @@ class ApplicationImpl : public Application
 #endif
 
     std::vector<std::thread> mWorkerThreads;
+    std::unique_ptr<std::thread> mOverlayThread;
 
     asio::signal_set mStopSignals;
 
@@ -201,6 +206,7 @@ class ApplicationImpl : public Application
     std::unique_ptr<medida::MetricsRegistry> mMetrics;
     medida::Timer& mPostOnMainThreadDelay;
     medida::Timer& mPostOnBackgroundThreadDelay;
+    medida::Timer& mPostOnOverlayThreadDelay;
     VirtualClock::system_time_point mStartedOn;
 
     Hash mNetworkID;
@@ -290,6 +290,10 @@ CommandHandler::peers(std::string const& params, std::string& retStr)
                 peerNode["olver"] = (int)peer.second->getRemoteOverlayVersion();
                 peerNode["id"] =
                     mApp.getConfig().toStrKey(peer.first, fullKeys);
+                if (auto flowControl = peer.second->getFlowControl())
+                {
+                    peerNode["flow_control"] = flowControl->getJsonInfo();
+                }
             }
         };
     addAuthenticatedPeers(
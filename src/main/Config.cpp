@@ -123,7 +123,7 @@ Config::Config() : NODE_SEED(SecretKey::random())
     MAXIMUM_LEDGER_CLOSETIME_DRIFT = 50;
 
     OVERLAY_PROTOCOL_MIN_VERSION = 18;
-    OVERLAY_PROTOCOL_VERSION = 19;
+    OVERLAY_PROTOCOL_VERSION = 20;
 
     VERSION_STR = STELLAR_CORE_VERSION;
 
@@ -133,6 +133,10 @@ Config::Config() : NODE_SEED(SecretKey::random())
     CATCHUP_COMPLETE = false;
     CATCHUP_RECENT = 0;
     EXPERIMENTAL_PRECAUTION_DELAY_META = false;
+    EXPERIMENTAL_BUCKETLIST_DB = false;
+    EXPERIMENTAL_WRITE_BEHIND_COMMIT = false;
+    EXPERIMENTAL_ASYNC_INVARIANT_CHECKS = false;
+    ASYNC_INVARIANT_CHECKS_MAX_BACKLOG = 10000;
     // automatic maintenance settings:
     // short and prime with 1 hour which will cause automatic maintenance to
     // rarely conflict with any other scheduled tasks on a machine (that tend to
@@ -186,6 +190,12 @@ Config::Config() : NODE_SEED(SecretKey::random())
 
     FLOOD_OP_RATE_PER_LEDGER = 1.0;
     FLOOD_TX_PERIOD_MS = 200;
+    ENABLE_PULL_MODE = true;
+    FLOOD_ADVERT_PERIOD_MS = 100;
+    FLOOD_DEMAND_PERIOD_MS = 200;
+    FLOOD_DEMAND_BACKOFF_DELAY_MS = 500;
+    PEER_FLOOD_READING_CAPACITY = 200;
+    FLOW_CONTROL_SEND_MORE_BATCH_SIZE = 40;
     FLOOD_ARB_TX_BASE_ALLOWANCE = 5;
     FLOOD_ARB_TX_DAMPING_FACTOR = 0.8;
 
@@ -206,6 +216,14 @@ Config::Config() : NODE_SEED(SecretKey::random())
     //
     // Worst case = 10 concurrent merges + 1 quorum intersection calculation.
     WORKER_THREADS = 11;
+    PARALLEL_SIGNATURE_PREVERIFICATION = true;
+    PARALLEL_TX_SET_VALIDATION = true;
+    // Leaves most of WORKER_THREADS to the merges of the top levels, which
+    // are never queued.
+    MAX_CONCURRENT_BUCKET_MERGES = 4;
+    BUCKET_MERGE_MEMORY_BUDGET_MB = 0;
+    BUCKET_MERGE_PARTITIONS = 1;
+    BACKGROUND_OVERLAY_PROCESSING = true;
     MAX_CONCURRENT_SUBPROCESSES = 16;
     NODE_IS_VALIDATOR = false;
     QUORUM_INTERSECTION_CHECKER = true;
@@ -213,6 +231,7 @@ Config::Config() : NODE_SEED(SecretKey::random())
 
     ENTRY_CACHE_SIZE = 100000;
     PREFETCH_BATCH_SIZE = 1000;
+    SIGNATURE_CACHE_SIZE = 0xffff;
 
     HISTOGRAM_WINDOW_SIZE = std::chrono::seconds(30);
 
@@ -936,6 +955,14 @@ Config::processConfig(std::shared_ptr<cpptoml::table> t)
             {
                 EXPERIMENTAL_PRECAUTION_DELAY_META = readBool(item);
             }
+            else if (item.first == "EXPERIMENTAL_BUCKETLIST_DB")
+            {
+                EXPERIMENTAL_BUCKETLIST_DB = readBool(item);
+            }
+            else if (item.first == "EXPERIMENTAL_WRITE_BEHIND_COMMIT")
+            {
+                EXPERIMENTAL_WRITE_BEHIND_COMMIT = readBool(item);
+            }
             else if (item.first == "METADATA_DEBUG_LEDGERS")
             {
                 METADATA_DEBUG_LEDGERS = readInt<uint32_t>(item);
@@ -1099,6 +1126,30 @@ Config::processConfig(std::shared_ptr<cpptoml::table> t)
             {
                 FLOOD_TX_PERIOD_MS = readInt<int>(item, 1);
             }
+            else if (item.first == "ENABLE_PULL_MODE")
+            {
+                ENABLE_PULL_MODE = readBool(item);
+            }
+            else if (item.first == "FLOOD_ADVERT_PERIOD_MS")
+            {
+                FLOOD_ADVERT_PERIOD_MS = readInt<int>(item, 1);
+            }
+            else if (item.first == "FLOOD_DEMAND_PERIOD_MS")
+            {
+                FLOOD_DEMAND_PERIOD_MS = readInt<int>(item, 1);
+            }
+            else if (item.first == "FLOOD_DEMAND_BACKOFF_DELAY_MS")
+            {
+                FLOOD_DEMAND_BACKOFF_DELAY_MS = readInt<int>(item, 1);
+            }
+            else if (item.first == "PEER_FLOOD_READING_CAPACITY")
+            {
+                PEER_FLOOD_READING_CAPACITY = readInt<uint32_t>(item, 1);
+            }
+            else if (item.first == "FLOW_CONTROL_SEND_MORE_BATCH_SIZE")
+            {
+                FLOW_CONTROL_SEND_MORE_BATCH_SIZE = readInt<uint32_t>(item, 1);
+            }
             else if (item.first == "FLOOD_ARB_TX_BASE_ALLOWANCE")
             {
                 FLOOD_ARB_TX_BASE_ALLOWANCE = readInt<int32_t>(item, -1);
@@ -1143,6 +1194,30 @@ Config::processConfig(std::shared_ptr<cpptoml::table> t)
             {
                 WORKER_THREADS = readInt<int>(item, 1, 1000);
             }
+            else if (item.first == "PARALLEL_SIGNATURE_PREVERIFICATION")
+            {
+                PARALLEL_SIGNATURE_PREVERIFICATION = readBool(item);
+            }
+            else if (item.first == "PARALLEL_TX_SET_VALIDATION")
+            {
+                PARALLEL_TX_SET_VALIDATION = readBool(item);
+            }
+            else if (item.first == "MAX_CONCURRENT_BUCKET_MERGES")
+            {
+                MAX_CONCURRENT_BUCKET_MERGES = readInt<size_t>(item);
+            }
+            else if (item.first == "BUCKET_MERGE_MEMORY_BUDGET_MB")
+            {
+                BUCKET_MERGE_MEMORY_BUDGET_MB = readInt<size_t>(item);
+            }
+            else if (item.first == "BUCKET_MERGE_PARTITIONS")
+            {
+                BUCKET_MERGE_PARTITIONS = readInt<size_t>(item, 1);
+            }
+            else if (item.first == "BACKGROUND_OVERLAY_PROCESSING")
+            {
+                BACKGROUND_OVERLAY_PROCESSING = readBool(item);
+            }
             else if (item.first == "MAX_CONCURRENT_SUBPROCESSES")
             {
                 MAX_CONCURRENT_SUBPROCESSES = readInt<size_t>(item, 1);
@@ -1215,6 +1290,15 @@ Config::processConfig(std::shared_ptr<cpptoml::table> t)
             {
                 INVARIANT_CHECKS = readArray<std::string>(item);
             }
+            else if (item.first == "EXPERIMENTAL_ASYNC_INVARIANT_CHECKS")
+            {
+                EXPERIMENTAL_ASYNC_INVARIANT_CHECKS = readBool(item);
+            }
+            else if (item.first == "ASYNC_INVARIANT_CHECKS_MAX_BACKLOG")
+            {
+                ASYNC_INVARIANT_CHECKS_MAX_BACKLOG =
+                    readInt<uint32_t>(item, 1);
+            }
             else if (item.first == "ENTRY_CACHE_SIZE")
             {
                 ENTRY_CACHE_SIZE = readInt<uint32_t>(item);
@@ -1223,6 +1307,10 @@ Config::processConfig(std::shared_ptr<cpptoml::table> t)
             {
                 PREFETCH_BATCH_SIZE = readInt<uint32_t>(item);
             }
+            else if (item.first == "SIGNATURE_CACHE_SIZE")
+            {
+                SIGNATURE_CACHE_SIZE = readInt<uint32_t>(item, 1);
+            }
             else if (item.first == "MAXIMUM_LEDGER_CLOSETIME_DRIFT")
             {
                 MAXIMUM_LEDGER_CLOSETIME_DRIFT = readInt<int64_t>(item, 0);
@@ -1381,6 +1469,13 @@ Config::processConfig(std::shared_ptr<cpptoml::table> t)
                     : ValidationThresholdLevels::SIMPLE_MAJORITY;
         }
 
+        if (FLOW_CONTROL_SEND_MORE_BATCH_SIZE > PEER_FLOOD_READING_CAPACITY)
+        {
+            throw std::invalid_argument(
+                "FLOW_CONTROL_SEND_MORE_BATCH_SIZE can't be greater than "
+                "PEER_FLOOD_READING_CAPACITY");
+        }
+
         adjust();
         validateConfig(thresholdLevel);
     }
@@ -234,6 +234,16 @@ class Config : public std::enable_shared_from_this<Config>
     // configuration) to delay emitting metadata by one ledger.
     bool EXPERIMENTAL_PRECAUTION_DELAY_META;
 
+    // A config parameter that indexes every bucket file and serves
+    // LedgerTxnRoot point loads of accounts and trustlines from the BucketList
+    // instead of SQL.
+    bool EXPERIMENTAL_BUCKETLIST_DB;
+
+    // When set to true (PostgreSQL only), LedgerTxnRoot writes the entries of
+    // each closed ledger to the database on a background thread, and serves
+    // them from memory until they are written.
+    bool EXPERIMENTAL_WRITE_BEHIND_COMMIT;
+
     // A config parameter that stores historical data, such as transactions,
     // fees, and scp history in the database
     bool MODE_STORES_HISTORY_MISC;
@@ -356,6 +366,20 @@ class Config : public std::enable_shared_from_this<Config>
     int MAX_BATCH_WRITE_BYTES;
     double FLOOD_OP_RATE_PER_LEDGER;
     int FLOOD_TX_PERIOD_MS;
+    // Pull-mode transaction flooding (with peers that also request it during
+    // the handshake): whether to request it, how long
+    // tx hashes are batched before being advertised to a peer, how often
+    // advertised hashes are demanded, and how long to wait for a demanded tx
+    // before demanding it from another peer (grows with each retry).
+    bool ENABLE_PULL_MODE;
+    int FLOOD_ADVERT_PERIOD_MS;
+    int FLOOD_DEMAND_PERIOD_MS;
+    int FLOOD_DEMAND_BACKOFF_DELAY_MS;
+    // Flow control (overlay version 20 and later): how many flooded messages
+    // a peer may send us before we've processed them, and how many we must
+    // process before granting the peer that many more.
+    uint32_t PEER_FLOOD_READING_CAPACITY;
+    uint32_t FLOW_CONTROL_SEND_MORE_BATCH_SIZE;
     int32_t FLOOD_ARB_TX_BASE_ALLOWANCE;
     double FLOOD_ARB_TX_DAMPING_FACTOR;
     static constexpr size_t const POSSIBLY_PREFERRED_EXTRA = 2;
@@ -385,6 +409,33 @@ class Config : public std::enable_shared_from_this<Config>
     // thread-management config
     int WORKER_THREADS;
 
+    // Whether to verify the signatures of a transaction set on the worker
+    // threads (alongside the main thread) before applying it, so that the
+    // serial apply loop only hits the signature-verification cache.
+    bool PARALLEL_SIGNATURE_PREVERIFICATION;
+
+    // Whether to validate the account queues of a transaction set on the
+    // worker threads (alongside the main thread), against an in-memory
+    // snapshot of the accounts it uses. See TxSetFrame::checkOrTrim.
+    bool PARALLEL_TX_SET_VALIDATION;
+
+    // Limits on how many merges of deep BucketList levels (which can take
+    // minutes) may run on the worker threads at once, and on the total size
+    // of their inputs. 0 means no limit; the size of inputs is not limited
+    // by default, as they are mapped and so only use reclaimable page cache.
+    // See BucketMergeScheduler.
+    size_t MAX_CONCURRENT_BUCKET_MERGES;
+    size_t BUCKET_MERGE_MEMORY_BUDGET_MB;
+
+    // Number of key ranges (each merged on its own thread) that merges with
+    // at least Bucket::MIN_PARTITIONED_MERGE_BYTES of input are split into.
+    // 1 merges serially.
+    size_t BUCKET_MERGE_PARTITIONS;
+
+    // Whether authenticated peers' messages are unmarshaled and have their
+    // MACs checked on a dedicated overlay thread rather than the main thread.
+    bool BACKGROUND_OVERLAY_PROCESSING;
+
     // process-management config
     size_t MAX_CONCURRENT_SUBPROCESSES;
 
@@ -400,6 +451,10 @@ class Config : public std::enable_shared_from_this<Config>
 
     // Invariants
     std::vector<std::string> INVARIANT_CHECKS;
+    // Whether to check invariants on operations on background threads, and
+    // how many operations the checks may fall behind operation apply.
+    bool EXPERIMENTAL_ASYNC_INVARIANT_CHECKS;
+    uint32_t ASYNC_INVARIANT_CHECKS_MAX_BACKLOG;
 
     std::map<std::string, std::string> VALIDATOR_NAMES;
 
@@ -417,6 +472,10 @@ class Config : public std::enable_shared_from_this<Config>
     //   that will be stored in the cache
     size_t ENTRY_CACHE_SIZE;
 
+    // Total number of entries kept by the process-wide signature verification
+    // cache, which is split evenly across independently-locked shards.
+    size_t SIGNATURE_CACHE_SIZE;
+
     // Data layer prefetcher configuration
     // - PREFETCH_BATCH_SIZE determines how many records we'll prefetch per
     // SQL load. Note that it should be significantly smaller than size of
@@ -19,7 +19,7 @@ using namespace std;
 std::string PersistentState::mapping[kLastEntry] = {
     "lastclosedledger", "historyarchivestate", "lastscpdata",
     "databaseschema",   "networkpassphrase",   "ledgerupgrades",
-    "rebuildledger"};
+    "rebuildledger",    "writebehindledger"};
 
 std::string PersistentState::kSQLCreateStatement =
     "CREATE TABLE IF NOT EXISTS storestate ("
@@ -70,6 +70,14 @@ PersistentState::setState(PersistentState::Entry entry,
     updateDb(getStoreStateName(entry), value);
 }
 
+void
+PersistentState::setState(PersistentState::Entry entry,
+                          std::string const& value, soci::session& session)
+{
+    ZoneScoped;
+    updateDb(getStoreStateName(entry), value, session);
+}
+
 std::vector<std::string>
 PersistentState::getSCPStateAllSlots()
 {
@@ -120,10 +128,17 @@ PersistentState::setRebuildForType(LedgerEntryType let)
 
 void
 PersistentState::updateDb(std::string const& entry, std::string const& value)
+{
+    updateDb(entry, value, mApp.getDatabase().getSession());
+}
+
+void
+PersistentState::updateDb(std::string const& entry, std::string const& value,
+                          soci::session& session)
 {
     ZoneScoped;
     auto prep = mApp.getDatabase().getPreparedStatement(
-        "UPDATE storestate SET state = :v WHERE statename = :n;");
+        "UPDATE storestate SET state = :v WHERE statename = :n;", session);
 
     auto& st = prep.statement();
     st.exchange(soci::use(value));
@@ -134,11 +149,12 @@ PersistentState::updateDb(std::string const& entry, std::string const& value)
         st.execute(true);
     }
 
-    if (st.get_affected_rows() != 1 && getFromDb(entry).empty())
+    if (st.get_affected_rows() != 1 && getFromDb(entry, session).empty())
     {
         ZoneNamedN(insertStoreStateZone, "insert storestate", true);
         auto prep2 = mApp.getDatabase().getPreparedStatement(
-            "INSERT INTO storestate (statename, state) VALUES (:n, :v);");
+            "INSERT INTO storestate (statename, state) VALUES (:n, :v);",
+            session);
         auto& st2 = prep2.statement();
         st2.exchange(soci::use(entry));
         st2.exchange(soci::use(value));
@@ -153,13 +169,19 @@ PersistentState::updateDb(std::string const& entry, std::string const& value)
 
 std::string
 PersistentState::getFromDb(std::string const& entry)
+{
+    return getFromDb(entry, mApp.getDatabase().getSession());
+}
+
+std::string
+PersistentState::getFromDb(std::string const& entry, soci::session& session)
 {
     ZoneScoped;
     std::string res;
 
     auto& db = mApp.getDatabase();
     auto prep = db.getPreparedStatement(
-        "SELECT state FROM storestate WHERE statename = :n;");
+        "SELECT state FROM storestate WHERE statename = :n;", session);
     auto& st = prep.statement();
     st.exchange(soci::into(res));
     st.exchange(soci::use(entry));
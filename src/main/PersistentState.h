@@ -7,6 +7,11 @@
 #include "main/Application.h"
 #include <string>
 
+namespace soci
+{
+class session;
+}
+
 namespace stellar
 {
 
@@ -24,6 +29,7 @@ class PersistentState
         kNetworkPassphrase,
         kLedgerUpgrades,
         kRebuildLedger,
+        kWriteBehindLedger,
         kLastEntry,
     };
 
@@ -31,6 +37,10 @@ class PersistentState
 
     std::string getState(Entry stateName);
     void setState(Entry stateName, std::string const& value);
+    // Same, but through the given session, which may be used by another
+    // thread than the main one.
+    void setState(Entry stateName, std::string const& value,
+                  soci::session& session);
 
     // Special methods for SCP state (multiple slots)
     std::vector<std::string> getSCPStateAllSlots();
@@ -48,6 +58,9 @@ class PersistentState
 
     std::string getStoreStateName(Entry n, uint32 subscript = 0);
     void updateDb(std::string const& entry, std::string const& value);
+    void updateDb(std::string const& entry, std::string const& value,
+                  soci::session& session);
     std::string getFromDb(std::string const& entry);
+    std::string getFromDb(std::string const& entry, soci::session& session);
 };
 }
@@ -3,6 +3,7 @@
 // of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
 
 #include "crypto/Random.h"
+#include "database/Database.h"
 #include "history/HistoryArchiveManager.h"
 #include "history/test/HistoryTestsUtils.h"
 #include "invariant/BucketListIsConsistentWithDatabase.h"
@@ -18,6 +19,7 @@
 #include "test/test.h"
 #include "transactions/TransactionUtils.h"
 #include "util/Logging.h"
+#include "util/StatusManager.h"
 #include <filesystem>
 #include <fstream>
 
@@ -179,6 +181,32 @@ TEST_CASE("application setup", "[applicationutils]")
         auto app = setupApp(cfg, clock, 0, "");
         REQUIRE(checkState(*app));
     }
+    SECTION("on-disk database")
+    {
+        // Entries are then checked by worker threads, through the connection
+        // pool, unless it has a single session.
+        auto cfg = getTestConfig(0, Config::TESTDB_ON_DISK_SQLITE);
+        auto app = setupApp(cfg, clock, 0, "");
+        REQUIRE(app->getDatabase().canUsePool());
+        SECTION("consistent")
+        {
+            REQUIRE(checkState(*app));
+        }
+        SECTION("inconsistent")
+        {
+            auto rootID =
+                txtest::getRoot(app->getNetworkID()).getStrKeyPublic();
+            app->getDatabase().getSession()
+                << "UPDATE accounts SET balance = balance - 1 "
+                   "WHERE accountid = :id",
+                soci::use(rootID, "id");
+            REQUIRE(!checkState(*app));
+        }
+        REQUIRE(app->getStatusManager()
+                    .getStatusMessage(
+                        StatusCategory::BUCKETLIST_CONSISTENCY_CHECK)
+                    .empty());
+    }
     SECTION("in memory mode")
     {
         auto networkID = sha256(getTestConfig().NETWORK_PASSPHRASE);
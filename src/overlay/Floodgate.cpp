@@ -5,6 +5,7 @@
 #include "overlay/Floodgate.h"
 #include "crypto/BLAKE2.h"
 #include "crypto/Hex.h"
+#include "crypto/SHA.h"
 #include "herder/Herder.h"
 #include "main/Application.h"
 #include "medida/counter.h"
@@ -16,44 +17,164 @@
 #include "xdrpp/marshal.h"
 #include <Tracy.hpp>
 #include <fmt/format.h>
+#include <limits>
 
 namespace stellar
 {
-Floodgate::FloodRecord::FloodRecord(StellarMessage const& msg, uint32_t ledger,
-                                    Peer::pointer peer)
-    : mLedgerSeq(ledger), mMessage(msg)
-{
-    if (peer)
-        mPeersTold.insert(peer->toString());
-}
-
 Floodgate::Floodgate(Application& app)
     : mApp(app)
     , mFloodMapSize(
           app.getMetrics().NewCounter({"overlay", "memory", "flood-known"}))
     , mSendFromBroadcast(app.getMetrics().NewMeter(
           {"overlay", "flood", "broadcast"}, "message"))
+    , mAdvertised(app.getMetrics().NewMeter({"overlay", "flood", "advertised"},
+                                            "message"))
     , mShuttingDown(false)
 {
 }
 
-// remove old flood records
+std::pair<Floodgate::FloodGeneration*, Floodgate::FloodRecord*>
+Floodgate::findRecord(Hash const& h)
+{
+    // most lookups are for recent messages
+    for (auto it = mGenerations.rbegin(); it != mGenerations.rend(); ++it)
+    {
+        auto record = it->second.mRecords.find(h);
+        if (record != it->second.mRecords.end())
+        {
+            return std::make_pair(&it->second, &record->second);
+        }
+    }
+    return std::make_pair(nullptr, nullptr);
+}
+
+Floodgate::FloodGeneration&
+Floodgate::currentGeneration()
+{
+    return mGenerations[mApp.getHerder().trackingConsensusLedgerIndex()];
+}
+
+Floodgate::FloodRecord&
+Floodgate::insertRecord(FloodGeneration& generation, Hash const& h,
+                        StellarMessage const& msg)
+{
+    auto& record = generation.mRecords[h];
+    record.mMessage = std::make_shared<StellarMessage const>(msg);
+    if (msg.type() == TRANSACTION)
+    {
+        // same as TransactionFrameBase::getFullHash
+        record.mTxHash = xdrSha256(msg.transaction());
+        generation.mTxMsgIDs[record.mTxHash] = h;
+    }
+    ++mRecordCount;
+    updateSize();
+    return record;
+}
+
 void
-Floodgate::clearBelow(uint32_t maxLedger)
+Floodgate::eraseRecord(FloodGeneration& generation, Hash const& h)
 {
-    ZoneScoped;
-    for (auto it = mFloodMap.cbegin(); it != mFloodMap.cend();)
+    auto it = generation.mRecords.find(h);
+    if (it == generation.mRecords.end())
     {
-        if (it->second->mLedgerSeq < maxLedger)
+        return;
+    }
+    if (it->second.mMessage->type() == TRANSACTION)
+    {
+        generation.mTxMsgIDs.erase(it->second.mTxHash);
+    }
+    generation.mRecords.erase(it);
+    --mRecordCount;
+    updateSize();
+}
+
+size_t
+Floodgate::getPeerSlot(NodeID const& peerID)
+{
+    auto it = mPeerSlots.find(peerID);
+    if (it != mPeerSlots.end())
+    {
+        return it->second;
+    }
+    size_t slot;
+    if (mFreeSlots.empty())
+    {
+        slot = mNextSlot++;
+    }
+    else
+    {
+        slot = mFreeSlots.back();
+        mFreeSlots.pop_back();
+    }
+    mPeerSlots.emplace(peerID, slot);
+    return slot;
+}
+
+void
+Floodgate::releasePeerSlots()
+{
+    // records in purged generations can't carry the bits of released slots
+    // anymore
+    auto oldest = mGenerations.empty() ? std::numeric_limits<uint32_t>::max()
+                                       : mGenerations.begin()->first;
+    for (auto it = mReleasedSlots.begin(); it != mReleasedSlots.end();)
+    {
+        if (it->second < oldest)
         {
-            it = mFloodMap.erase(it);
+            mFreeSlots.emplace_back(it->first);
+            it = mReleasedSlots.erase(it);
         }
         else
         {
             ++it;
         }
     }
-    mFloodMapSize.set_count(mFloodMap.size());
+
+    // release the slots of peers we're no longer connected to; records
+    // created from now on won't carry their bits
+    auto newest = mGenerations.empty() ? 0 : mGenerations.rbegin()->first;
+    auto const& peers = mApp.getOverlayManager().getAuthenticatedPeers();
+    for (auto it = mPeerSlots.begin(); it != mPeerSlots.end();)
+    {
+        if (peers.find(it->first) == peers.end())
+        {
+            if (mGenerations.empty())
+            {
+                mFreeSlots.emplace_back(it->second);
+            }
+            else
+            {
+                mReleasedSlots.emplace_back(it->second, newest);
+            }
+            it = mPeerSlots.erase(it);
+        }
+        else
+        {
+            ++it;
+        }
+    }
+}
+
+void
+Floodgate::updateSize()
+{
+    mFloodMapSize.set_count(mRecordCount);
+    TracyPlot("overlay.memory.flood-known", static_cast<int64_t>(mRecordCount));
+}
+
+// remove old flood records
+void
+Floodgate::clearBelow(uint32_t maxLedger)
+{
+    ZoneScoped;
+    auto end = mGenerations.lower_bound(maxLedger);
+    for (auto it = mGenerations.begin(); it != end; ++it)
+    {
+        mRecordCount -= it->second.mRecords.size();
+    }
+    mGenerations.erase(mGenerations.begin(), end);
+    updateSize();
+    releasePeerSlots();
 }
 
 bool
@@ -65,21 +186,17 @@ Floodgate::addRecord(StellarMessage const& msg, Peer::pointer peer, Hash& index)
     {
         return false;
     }
-    auto result = mFloodMap.find(index);
-    if (result == mFloodMap.end())
+    auto record = findRecord(index).second;
+    bool isNew = record == nullptr;
+    if (isNew)
     { // we have never seen this message
-        mFloodMap[index] = std::make_shared<FloodRecord>(
-            msg, mApp.getHerder().trackingConsensusLedgerIndex(), peer);
-        mFloodMapSize.set_count(mFloodMap.size());
-        TracyPlot("overlay.memory.flood-known",
-                  static_cast<int64_t>(mFloodMap.size()));
-        return true;
+        record = &insertRecord(currentGeneration(), index, msg);
     }
-    else
+    if (peer)
     {
-        result->second->mPeersTold.insert(peer->toString());
-        return false;
+        record->mPeersTold.set(getPeerSlot(peer->getPeerID()));
     }
+    return isNew;
 }
 
 // send message to anyone you haven't gotten it from
@@ -93,19 +210,15 @@ Floodgate::broadcast(StellarMessage const& msg, bool force)
     }
     Hash index = xdrBlake2(msg);
 
-    FloodRecord::pointer fr;
-    auto result = mFloodMap.find(index);
-    if (result == mFloodMap.end() || force)
+    auto found = findRecord(index);
+    FloodRecord* fr = found.second;
+    if (fr == nullptr || force)
     { // no one has sent us this message / start from scratch
-        fr = std::make_shared<FloodRecord>(
-            msg, mApp.getHerder().trackingConsensusLedgerIndex(),
-            Peer::pointer());
-        mFloodMap[index] = fr;
-        mFloodMapSize.set_count(mFloodMap.size());
-    }
-    else
-    {
-        fr = result->second;
+        if (fr != nullptr)
+        {
+            eraseRecord(*found.first, index);
+        }
+        fr = &insertRecord(currentGeneration(), index, msg);
     }
     // send it to people that haven't sent it to us
     auto& peersTold = fr->mPeersTold;
@@ -114,22 +227,45 @@ Floodgate::broadcast(StellarMessage const& msg, bool force)
     auto peers = mApp.getOverlayManager().getAuthenticatedPeers();
 
     bool broadcasted = false;
-    std::shared_ptr<StellarMessage> smsg =
-        std::make_shared<StellarMessage>(msg);
+    auto smsg = fr->mMessage;
+    // serialized once, when first sent to a peer
+    SharedMessageBody body;
+    bool advertise = msg.type() == TRANSACTION;
     for (auto peer : peers)
     {
         releaseAssert(peer.second->isAuthenticated());
-        if (peersTold.insert(peer.second->toString()).second)
+        auto slot = getPeerSlot(peer.first);
+        if (!peersTold.get(slot))
         {
+            peersTold.set(slot);
+            auto adverts = advertise ? peer.second->getTxAdverts() : nullptr;
+            if (adverts)
+            {
+                // Pull mode: let the peer demand the transaction, unless it
+                // told us it has it already (or was told about it, outside of
+                // a forced rebroadcast).
+                if (force || !adverts->seenAdvert(fr->mTxHash))
+                {
+                    mAdvertised.Mark();
+                    adverts->queueOutgoingAdvert(fr->mTxHash);
+                    broadcasted = true;
+                }
+                continue;
+            }
             mSendFromBroadcast.Mark();
+            if (!body)
+            {
+                body = std::make_shared<xdr::opaque_vec<> const>(
+                    xdr::xdr_to_opaque(*smsg));
+            }
             std::weak_ptr<Peer> weak(
                 std::static_pointer_cast<Peer>(peer.second));
             mApp.postOnMainThread(
-                [smsg, weak, log = !broadcasted]() {
+                [smsg, body, weak, log = !broadcasted]() {
                     auto strong = weak.lock();
                     if (strong)
                     {
-                        strong->sendMessage(*smsg, log);
+                        strong->sendMessage(*smsg, body, log);
                     }
                 },
                 fmt::format(FMT_STRING("broadcast to {}"),
@@ -138,22 +274,51 @@ Floodgate::broadcast(StellarMessage const& msg, bool force)
         }
     }
     CLOG_TRACE(Overlay, "broadcast {} told {}", hexAbbrev(index),
-               peersTold.size());
+               peersTold.count());
     return broadcasted;
 }
 
+std::shared_ptr<StellarMessage const>
+Floodgate::getMessage(Hash const& msgID) const
+{
+    for (auto it = mGenerations.rbegin(); it != mGenerations.rend(); ++it)
+    {
+        auto record = it->second.mRecords.find(msgID);
+        if (record != it->second.mRecords.end())
+        {
+            return record->second.mMessage;
+        }
+    }
+    return nullptr;
+}
+
+std::shared_ptr<StellarMessage const>
+Floodgate::getTransaction(Hash const& txHash) const
+{
+    for (auto it = mGenerations.rbegin(); it != mGenerations.rend(); ++it)
+    {
+        auto msgID = it->second.mTxMsgIDs.find(txHash);
+        if (msgID != it->second.mTxMsgIDs.end())
+        {
+            return it->second.mRecords.at(msgID->second).mMessage;
+        }
+    }
+    return nullptr;
+}
+
 std::set<Peer::pointer>
 Floodgate::getPeersKnows(Hash const& h)
 {
     std::set<Peer::pointer> res;
-    auto record = mFloodMap.find(h);
-    if (record != mFloodMap.end())
+    auto record = findRecord(h).second;
+    if (record)
     {
-        auto& ids = record->second->mPeersTold;
+        auto const& peersTold = record->mPeersTold;
         auto const& peers = mApp.getOverlayManager().getAuthenticatedPeers();
         for (auto& p : peers)
         {
-            if (ids.find(p.second->toString()) != ids.end())
+            auto slot = mPeerSlots.find(p.first);
+            if (slot != mPeerSlots.end() && peersTold.get(slot->second))
             {
                 res.insert(p.second);
             }
@@ -166,13 +331,21 @@ void
 Floodgate::shutdown()
 {
     mShuttingDown = true;
-    mFloodMap.clear();
+    mGenerations.clear();
+    mRecordCount = 0;
+    mPeerSlots.clear();
+    mReleasedSlots.clear();
+    mFreeSlots.clear();
 }
 
 void
 Floodgate::forgetRecord(Hash const& h)
 {
-    mFloodMap.erase(h);
+    auto generation = findRecord(h).first;
+    if (generation)
+    {
+        eraseRecord(*generation, h);
+    }
 }
 
 void
@@ -183,14 +356,22 @@ Floodgate::updateRecord(StellarMessage const& oldMsg,
     Hash oldHash = xdrBlake2(oldMsg);
     Hash newHash = xdrBlake2(newMsg);
 
-    auto oldIter = mFloodMap.find(oldHash);
-    if (oldIter != mFloodMap.end())
+    auto found = findRecord(oldHash);
+    if (found.second)
     {
-        auto record = oldIter->second;
-        record->mMessage = newMsg;
-
-        mFloodMap.erase(oldIter);
-        mFloodMap.emplace(newHash, record);
+        // The record keeps the ledger of the old one. Any record of newMsg,
+        // which may be in another generation, is merged into it, so that
+        // there is only one.
+        auto& generation = *found.first;
+        auto peersTold = found.second->mPeersTold;
+        eraseRecord(generation, oldHash);
+        for (auto existing = findRecord(newHash); existing.second;
+             existing = findRecord(newHash))
+        {
+            peersTold |= existing.second->mPeersTold;
+            eraseRecord(*existing.first, newHash);
+        }
+        insertRecord(generation, newHash, newMsg).mPeersTold = peersTold;
     }
 }
 }
@@ -4,9 +4,14 @@
 // under the Apache License, Version 2.0. See the COPYING file at the root
 // of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
 
+#include "crypto/SecretKey.h"
 #include "overlay/Peer.h"
 #include "overlay/StellarXDR.h"
+#include "util/BitSet.h"
+#include "util/HashOfHash.h"
+#include "util/UnorderedMap.h"
 #include <map>
+#include <vector>
 
 /**
  * FloodGate keeps track of which peers have sent us which broadcast messages,
@@ -16,9 +21,22 @@
  *
  * The broadcast message types are TRANSACTION and SCP_MESSAGE.
  *
+ * Peers for which Peer::isPullModeEnabled() are not sent TRANSACTION messages
+ * directly: the full hashes of the transactions are advertised to them
+ * instead, and the messages are looked up here by that hash when the peer
+ * demands them.
+ *
  * All messages are marked with the ledger sequence number to which they
  * relate, and all flood-management information for a given ledger number
- * is purged from the FloodGate when the ledger closes.
+ * is purged from the FloodGate when the ledger closes. Records are kept in
+ * one hash map per ledger (a "generation") so that purging a ledger drops its
+ * whole map without walking the records of the other ledgers.
+ *
+ * Peers are tracked as bits in a per-record BitSet, indexed by a slot that
+ * the FloodGate assigns to each peer (by NodeID) the first time it sees it.
+ * The slot of a peer that is no longer authenticated is released when ledgers
+ * are purged, and only reused once every record that may carry its bit is
+ * gone.
  */
 
 namespace medida
@@ -31,25 +49,49 @@ namespace stellar
 
 class Floodgate
 {
-    class FloodRecord
+    struct FloodRecord
     {
-      public:
-        typedef std::shared_ptr<FloodRecord> pointer;
+        std::shared_ptr<StellarMessage const> mMessage;
+        // slots of the peers that sent us the message, or that we sent it to
+        BitSet mPeersTold;
+        // full hash of the transaction, for TRANSACTION messages
+        Hash mTxHash;
+    };
+    struct FloodGeneration
+    {
+        UnorderedMap<Hash, FloodRecord> mRecords;
+        // message IDs of the TRANSACTION records, by mTxHash
+        UnorderedMap<Hash, Hash> mTxMsgIDs;
+    };
 
-        uint32_t mLedgerSeq;
-        StellarMessage mMessage;
-        std::set<std::string> mPeersTold;
+    // generations by ledger sequence number
+    std::map<uint32_t, FloodGeneration> mGenerations;
+    size_t mRecordCount{0};
 
-        FloodRecord(StellarMessage const& msg, uint32_t ledger,
-                    Peer::pointer peer);
-    };
+    UnorderedMap<NodeID, size_t> mPeerSlots;
+    // slots released while the newest generation was the one given, waiting
+    // for older generations to be purged
+    std::vector<std::pair<size_t, uint32_t>> mReleasedSlots;
+    std::vector<size_t> mFreeSlots;
+    size_t mNextSlot{0};
 
-    std::map<Hash, FloodRecord::pointer> mFloodMap;
     Application& mApp;
     medida::Counter& mFloodMapSize;
     medida::Meter& mSendFromBroadcast;
+    medida::Meter& mAdvertised;
     bool mShuttingDown;
 
+    // Generation and record holding `msgID`, if any.
+    std::pair<FloodGeneration*, FloodRecord*> findRecord(Hash const& msgID);
+    // Generation of the ledger being tracked, where new records go.
+    FloodGeneration& currentGeneration();
+    FloodRecord& insertRecord(FloodGeneration& generation, Hash const& msgID,
+                              StellarMessage const& msg);
+    void eraseRecord(FloodGeneration& generation, Hash const& msgID);
+    size_t getPeerSlot(NodeID const& peerID);
+    void releasePeerSlots();
+    void updateSize();
+
   public:
     Floodgate(Application& app);
     // forget data strictly older than `maxLedger`
@@ -62,6 +104,14 @@ class Floodgate
     // returns true if msg was sent to at least one peer
     bool broadcast(StellarMessage const& msg, bool force);
 
+    // returns the message with hash `msgID`, or null if it isn't recorded
+    std::shared_ptr<StellarMessage const> getMessage(Hash const& msgID) const;
+
+    // returns the TRANSACTION message whose transaction has the full hash
+    // `txHash` (as advertised in pull mode), or null if it isn't recorded
+    std::shared_ptr<StellarMessage const>
+    getTransaction(Hash const& txHash) const;
+
     // returns the list of peers that sent us the item with hash `msgID`
     // NB: `msgID` is the hash of a `StellarMessage`
     std::set<Peer::pointer> getPeersKnows(Hash const& msgID);
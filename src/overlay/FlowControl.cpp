@@ -0,0 +1,196 @@
+// Copyright 2022 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include "overlay/FlowControl.h"
+#include "lib/json/json.h"
+#include "main/Application.h"
+#include "main/Config.h"
+#include "overlay/OverlayManager.h"
+#include "overlay/OverlayMetrics.h"
+#include "util/GlobalChecks.h"
+#include "util/Logging.h"
+#include <Tracy.hpp>
+
+#include "medida/meter.h"
+#include "medida/timer.h"
+
+namespace stellar
+{
+
+bool
+FlowControl::isFlowControlled(StellarMessage const& msg)
+{
+    switch (msg.type())
+    {
+    case TRANSACTION:
+    case SCP_MESSAGE:
+    case FLOOD_ADVERT:
+    case FLOOD_DEMAND:
+        return true;
+    default:
+        return false;
+    }
+}
+
+FlowControl::FlowControl(Application& app) : mApp(app)
+{
+}
+
+void
+FlowControl::start(SendFunc send)
+{
+    releaseAssert(!mSend);
+    mSend = std::move(send);
+    sendMore(mApp.getConfig().PEER_FLOOD_READING_CAPACITY);
+}
+
+void
+FlowControl::sendMore(uint32_t numMessages)
+{
+    StellarMessage msg;
+    msg.type(SEND_MORE);
+    msg.sendMoreMessage().numMessages = numMessages;
+    mInboundCapacity += numMessages;
+    mSend(msg, nullptr);
+}
+
+void
+FlowControl::sendMessage(StellarMessage const& msg, SharedMessageBody body)
+{
+    ZoneScoped;
+    releaseAssert(isFlowControlled(msg));
+    auto& queue = mOutboundQueues[msg.type() == SCP_MESSAGE ? 0 : 1];
+    if (mOutboundCapacity > 0 && mOutboundQueues[0].empty() &&
+        mOutboundQueues[1].empty())
+    {
+        --mOutboundCapacity;
+        mSend(msg, body);
+        return;
+    }
+
+    auto now = mApp.getClock().now();
+    if (mOutboundCapacity == 0 && !mNoCapacitySince)
+    {
+        mNoCapacitySince = std::make_optional(now);
+    }
+    queue.emplace_back(QueuedMessage{
+        std::make_shared<StellarMessage const>(msg), std::move(body), now});
+    if (&queue == &mOutboundQueues[1] && queue.size() > MAX_TX_QUEUE_SIZE)
+    {
+        queue.pop_front();
+        ++mOutboundQueueDrops;
+        mApp.getOverlayManager()
+            .getOverlayMetrics()
+            .mOutboundQueueDropTxs.Mark();
+    }
+    maybeSendQueuedMessages();
+}
+
+void
+FlowControl::recvSendMore(uint32_t numMessages)
+{
+    ZoneScoped;
+    mOutboundCapacity += numMessages;
+    mNoCapacitySince.reset();
+    maybeSendQueuedMessages();
+}
+
+void
+FlowControl::maybeSendQueuedMessages()
+{
+    auto& metrics = mApp.getOverlayManager().getOverlayMetrics();
+    while (mOutboundCapacity > 0)
+    {
+        size_t i = mOutboundQueues[0].empty() ? 1 : 0;
+        auto& queue = mOutboundQueues[i];
+        if (queue.empty())
+        {
+            break;
+        }
+        auto front = std::move(queue.front());
+        queue.pop_front();
+        auto& delay = i == 0 ? metrics.mOutboundQueueDelaySCP
+                             : metrics.mOutboundQueueDelayTxs;
+        delay.Update(mApp.getClock().now() - front.mTimeEmplaced);
+        --mOutboundCapacity;
+        mSend(*front.mMessage, front.mBody);
+    }
+    if (mOutboundCapacity == 0 && getOutboundQueueSize() != 0 &&
+        !mNoCapacitySince)
+    {
+        mNoCapacitySince = std::make_optional(mApp.getClock().now());
+    }
+}
+
+std::optional<VirtualClock::time_point>
+FlowControl::getNoCapacitySince() const
+{
+    return mNoCapacitySince;
+}
+
+bool
+FlowControl::beginMessageProcessing()
+{
+    if (mInboundCapacity == 0)
+    {
+        return false;
+    }
+    --mInboundCapacity;
+    ++mInProcessing;
+    return true;
+}
+
+void
+FlowControl::endMessageProcessing()
+{
+    releaseAssert(mInProcessing > 0);
+    --mInProcessing;
+    ++mProcessedSinceGrant;
+    auto batchSize = mApp.getConfig().FLOW_CONTROL_SEND_MORE_BATCH_SIZE;
+    if (mProcessedSinceGrant >= batchSize)
+    {
+        mProcessedSinceGrant -= batchSize;
+        sendMore(batchSize);
+    }
+}
+
+uint64_t
+FlowControl::getOutboundCapacity() const
+{
+    return mOutboundCapacity;
+}
+
+size_t
+FlowControl::getOutboundQueueSize() const
+{
+    return mOutboundQueues[0].size() + mOutboundQueues[1].size();
+}
+
+uint64_t
+FlowControl::getInboundCapacity() const
+{
+    return mInboundCapacity;
+}
+
+uint64_t
+FlowControl::getMessagesInProcessing() const
+{
+    return mInProcessing;
+}
+
+Json::Value
+FlowControl::getJsonInfo() const
+{
+    Json::Value res;
+    res["local_capacity"] = static_cast<Json::UInt64>(mInboundCapacity);
+    res["peer_capacity"] = static_cast<Json::UInt64>(mOutboundCapacity);
+    res["outbound_queue_scp"] =
+        static_cast<Json::UInt64>(mOutboundQueues[0].size());
+    res["outbound_queue_tx"] =
+        static_cast<Json::UInt64>(mOutboundQueues[1].size());
+    res["outbound_queue_drops"] =
+        static_cast<Json::UInt64>(mOutboundQueueDrops);
+    return res;
+}
+}
@@ -0,0 +1,107 @@
+#pragma once
+
+// Copyright 2022 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include "lib/json/json-forwards.h"
+#include "overlay/StellarXDR.h"
+#include "util/NonCopyable.h"
+#include "util/Timer.h"
+
+#include <array>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <optional>
+
+namespace stellar
+{
+
+class Application;
+
+/**
+ * FlowControl implements credit-based flow control of flooded messages (see
+ * isFlowControlled) with a peer, when both are on overlay version
+ * FIRST_OVERLAY_VERSION_WITH_FLOW_CONTROL or later.
+ *
+ * Inbound, we grant the peer PEER_FLOOD_READING_CAPACITY messages once
+ * authenticated, and SEND_MORE for FLOW_CONTROL_SEND_MORE_BATCH_SIZE more each
+ * time we have processed that many of them. A peer sending more than it was
+ * granted is dropped, so at most PEER_FLOOD_READING_CAPACITY of its messages
+ * are ever waiting for the main thread.
+ *
+ * Outbound, flooded messages are only written once the peer has granted
+ * capacity for them. Until then they wait in per-peer queues, SCP messages
+ * ahead of transaction traffic; the oldest transaction traffic is dropped
+ * past MAX_TX_QUEUE_SIZE.
+ *
+ * Only used from the main thread.
+ */
+class FlowControl : public NonMovableOrCopyable
+{
+  public:
+    static constexpr size_t MAX_TX_QUEUE_SIZE = 1000;
+
+    static bool isFlowControlled(StellarMessage const& msg);
+
+    explicit FlowControl(Application& app);
+
+    using SendFunc =
+        std::function<void(StellarMessage const&, SharedMessageBody const&)>;
+
+    // `send` writes a message (with its XDR body, if already serialized) to
+    // the peer, bypassing flow control. Grants the peer its initial capacity.
+    void start(SendFunc send);
+
+    // Outbound: sends flow-controlled `msg` now if the peer granted us the
+    // capacity for it, or queues it.
+    void sendMessage(StellarMessage const& msg, SharedMessageBody body);
+    // Outbound: adds capacity the peer granted us, and sends queued messages
+    // it allows.
+    void recvSendMore(uint32_t numMessages);
+    // Outbound: since when messages have been waiting for the peer to grant
+    // us capacity, if they are.
+    std::optional<VirtualClock::time_point> getNoCapacitySince() const;
+
+    // Inbound: accounts for a flow-controlled message received from the peer.
+    // Returns false if the peer had no capacity left to send it.
+    bool beginMessageProcessing();
+    // Inbound: called once a message accepted by beginMessageProcessing is
+    // processed (or dropped without being processed).
+    void endMessageProcessing();
+
+    uint64_t getOutboundCapacity() const;
+    size_t getOutboundQueueSize() const;
+    uint64_t getInboundCapacity() const;
+    uint64_t getMessagesInProcessing() const;
+    Json::Value getJsonInfo() const;
+
+  private:
+    struct QueuedMessage
+    {
+        std::shared_ptr<StellarMessage const> mMessage;
+        SharedMessageBody mBody;
+        VirtualClock::time_point mTimeEmplaced;
+    };
+
+    Application& mApp;
+    SendFunc mSend;
+
+    // Index 0 holds SCP messages, index 1 transaction traffic.
+    std::array<std::deque<QueuedMessage>, 2> mOutboundQueues;
+    uint64_t mOutboundCapacity{0};
+    std::optional<VirtualClock::time_point> mNoCapacitySince;
+    uint64_t mOutboundQueueDrops{0};
+
+    // Capacity granted to the peer and not used yet; messages accepted but
+    // not yet processed; messages processed since our last SEND_MORE. These
+    // always add up to PEER_FLOOD_READING_CAPACITY.
+    uint64_t mInboundCapacity{0};
+    uint64_t mInProcessing{0};
+    uint64_t mProcessedSinceGrant{0};
+
+    void maybeSendQueuedMessages();
+    void sendMore(uint32_t numMessages);
+};
+}
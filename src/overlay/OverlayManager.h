@@ -90,6 +90,15 @@ class OverlayManager
     // message with the ID msgID will cause it to be broadcast to all peers
     virtual void forgetFloodedMsg(Hash const& msgID) = 0;
 
+    // Returns the TRANSACTION message for the transaction with full hash
+    // `txHash` if the FloodGate still knows it, or null.
+    virtual std::shared_ptr<StellarMessage const>
+    getFloodedTx(Hash const& txHash) = 0;
+
+    // Called when a peer advertised transactions to us: makes sure they are
+    // demanded within FLOOD_DEMAND_PERIOD_MS.
+    virtual void scheduleTxDemand() = 0;
+
     // Return a list of random peers from the set of authenticated peers.
     virtual std::vector<Peer::pointer> getRandomAuthenticatedPeers() = 0;
 
@@ -7,6 +7,7 @@
 #include "crypto/SecretKey.h"
 #include "crypto/ShortHash.h"
 #include "database/Database.h"
+#include "herder/Herder.h"
 #include "lib/util/stdrandom.h"
 #include "main/Application.h"
 #include "main/Config.h"
@@ -41,6 +42,11 @@ using namespace std;
 constexpr std::chrono::seconds PEER_IP_RESOLVE_DELAY(600);
 constexpr std::chrono::seconds PEER_IP_RESOLVE_RETRY_DELAY(10);
 
+// Pull-mode flooding: an advertised transaction is demanded from at most this
+// many peers, waiting at most MAX_DELAY_DEMAND between attempts.
+constexpr size_t MAX_RETRY_COUNT = 15;
+constexpr std::chrono::seconds MAX_DELAY_DEMAND(2);
+
 OverlayManagerImpl::PeersList::PeersList(
     OverlayManagerImpl& overlayManager,
     medida::MetricsRegistry& metricsRegistry,
@@ -267,6 +273,7 @@ OverlayManagerImpl::OverlayManagerImpl(Application& app)
     , mTimer(app)
     , mPeerIPTimer(app)
     , mFloodGate(app)
+    , mDemandTimer(app)
     , mSurveyManager(make_shared<SurveyManager>(app))
     , mResolvingPeersWithBackoff(true)
     , mResolvingPeersRetryCount(0)
@@ -665,6 +672,17 @@ void
 OverlayManagerImpl::clearLedgersBelow(uint32_t ledgerSeq, uint32_t lclSeq)
 {
     mFloodGate.clearBelow(ledgerSeq);
+    for (auto it = mDemandHistory.begin(); it != mDemandHistory.end();)
+    {
+        if (it->second.mLedgerSeq < ledgerSeq)
+        {
+            it = mDemandHistory.erase(it);
+        }
+        else
+        {
+            ++it;
+        }
+    }
     mSurveyManager->clearOldLedgers(lclSeq);
 }
 
@@ -948,6 +966,156 @@ OverlayManagerImpl::broadcastMessage(StellarMessage const& msg, bool force)
     return res;
 }
 
+std::shared_ptr<StellarMessage const>
+OverlayManagerImpl::getFloodedTx(Hash const& txHash)
+{
+    return mFloodGate.getTransaction(txHash);
+}
+
+void
+OverlayManagerImpl::scheduleTxDemand()
+{
+    if (mShuttingDown || mDemandScheduled)
+    {
+        return;
+    }
+    mDemandScheduled = true;
+    mDemandTimer.expires_from_now(
+        std::chrono::milliseconds(mApp.getConfig().FLOOD_DEMAND_PERIOD_MS));
+    mDemandTimer.async_wait(
+        [this]() {
+            mDemandScheduled = false;
+            demand();
+        },
+        VirtualTimer::onFailureNoop);
+}
+
+std::chrono::milliseconds
+OverlayManagerImpl::retryDelayDemand(size_t numAttemptsMade) const
+{
+    auto backoff = std::chrono::milliseconds(
+        mApp.getConfig().FLOOD_DEMAND_BACKOFF_DELAY_MS);
+    return std::min<std::chrono::milliseconds>(
+        backoff * static_cast<int64_t>(numAttemptsMade), MAX_DELAY_DEMAND);
+}
+
+OverlayManagerImpl::DemandStatus
+OverlayManagerImpl::demandStatus(Hash const& txHash, Peer::pointer peer) const
+{
+    if (mFloodGate.getTransaction(txHash))
+    {
+        // Already received (or sent) it.
+        return DemandStatus::DISCARD;
+    }
+    auto it = mDemandHistory.find(txHash);
+    if (it == mDemandHistory.end())
+    {
+        return DemandStatus::DEMAND;
+    }
+    auto const& history = it->second;
+    if (history.mPeers.find(peer->getPeerID()) != history.mPeers.end() ||
+        history.mPeers.size() >= MAX_RETRY_COUNT)
+    {
+        return DemandStatus::DISCARD;
+    }
+    // Give the peers already asked some time to answer before asking another.
+    auto sinceLast = mApp.getClock().now() - history.mLastDemanded;
+    return sinceLast >= retryDelayDemand(history.mPeers.size())
+               ? DemandStatus::DEMAND
+               : DemandStatus::RETRY_LATER;
+}
+
+void
+OverlayManagerImpl::demand()
+{
+    ZoneScoped;
+    if (mShuttingDown)
+    {
+        return;
+    }
+
+    // Go through the peers' adverts round-robin, one hash at a time, so that
+    // a transaction advertised by several peers is demanded from the first one
+    // in a random order, and demands are spread across peers.
+    auto peers = getRandomAuthenticatedPeers();
+    std::vector<StellarMessage> demands(peers.size());
+    std::vector<std::vector<Hash>> retries(peers.size());
+    for (auto& d : demands)
+    {
+        d.type(FLOOD_DEMAND);
+    }
+
+    auto now = mApp.getClock().now();
+    auto ledgerSeq = mApp.getHerder().trackingConsensusLedgerIndex();
+    bool anyPending = true;
+    while (anyPending)
+    {
+        anyPending = false;
+        for (size_t i = 0; i < peers.size(); ++i)
+        {
+            auto adverts = peers[i]->getTxAdverts();
+            auto& txHashes = demands[i].floodDemand().txHashes;
+            Hash h;
+            if (!adverts || txHashes.size() == TX_DEMAND_VECTOR_MAX_SIZE ||
+                !adverts->popIncomingAdvert(h))
+            {
+                continue;
+            }
+            anyPending = true;
+            switch (demandStatus(h, peers[i]))
+            {
+            case DemandStatus::DEMAND:
+            {
+                auto& history = mDemandHistory[h];
+                if (history.mPeers.empty())
+                {
+                    history.mLedgerSeq = ledgerSeq;
+                }
+                history.mLastDemanded = now;
+                history.mPeers.emplace(peers[i]->getPeerID());
+                txHashes.emplace_back(h);
+                mOverlayMetrics.mDemandedTxs.Mark();
+                break;
+            }
+            case DemandStatus::RETRY_LATER:
+                retries[i].emplace_back(h);
+                break;
+            case DemandStatus::DISCARD:
+            {
+                auto it = mDemandHistory.find(h);
+                if (it != mDemandHistory.end() &&
+                    it->second.mPeers.size() >= MAX_RETRY_COUNT &&
+                    !mFloodGate.getTransaction(h))
+                {
+                    mOverlayMetrics.mAbandonedDemands.Mark();
+                }
+                break;
+            }
+            }
+        }
+    }
+
+    bool needsMore = false;
+    for (size_t i = 0; i < peers.size(); ++i)
+    {
+        auto adverts = peers[i]->getTxAdverts();
+        if (!adverts)
+        {
+            continue;
+        }
+        if (!demands[i].floodDemand().txHashes.empty())
+        {
+            peers[i]->sendMessage(demands[i]);
+        }
+        adverts->retryIncomingAdverts(retries[i]);
+        needsMore = needsMore || adverts->size() != 0;
+    }
+    if (needsMore)
+    {
+        scheduleTxDemand();
+    }
+}
+
 void
 OverlayManager::dropAll(Database& db)
 {
@@ -1000,6 +1168,7 @@ OverlayManagerImpl::shutdown()
     // Stop ticking and resolving peers
     mTimer.cancel();
     mPeerIPTimer.cancel();
+    mDemandTimer.cancel();
 }
 
 bool
@@ -16,7 +16,9 @@
 #include "overlay/StellarXDR.h"
 #include "overlay/SurveyManager.h"
 #include "util/Logging.h"
+#include "util/HashOfHash.h"
 #include "util/Timer.h"
+#include "util/UnorderedMap.h"
 
 #include "medida/metrics_registry.h"
 #include "util/RandomEvictionCache.h"
@@ -93,6 +95,28 @@ class OverlayManagerImpl : public OverlayManager
 
     Floodgate mFloodGate;
 
+    // Pull-mode flooding: which peers each advertised transaction was demanded
+    // from, and when. Purged along with the FloodGate.
+    struct DemandHistory
+    {
+        uint32_t mLedgerSeq;
+        VirtualClock::time_point mLastDemanded;
+        std::set<NodeID> mPeers;
+    };
+    UnorderedMap<Hash, DemandHistory> mDemandHistory;
+    VirtualTimer mDemandTimer;
+    bool mDemandScheduled{false};
+
+    enum class DemandStatus
+    {
+        DEMAND,
+        RETRY_LATER,
+        DISCARD
+    };
+    DemandStatus demandStatus(Hash const& txHash, Peer::pointer peer) const;
+    std::chrono::milliseconds retryDelayDemand(size_t numAttemptsMade) const;
+    void demand();
+
     std::shared_ptr<SurveyManager> mSurveyManager;
 
   public:
@@ -105,6 +129,9 @@ class OverlayManagerImpl : public OverlayManager
     void forgetFloodedMsg(Hash const& msgID) override;
     bool broadcastMessage(StellarMessage const& msg,
                           bool force = false) override;
+    std::shared_ptr<StellarMessage const>
+    getFloodedTx(Hash const& txHash) override;
+    void scheduleTxDemand() override;
     void connectTo(PeerBareAddress const& address) override;
 
     void addInboundConnection(Peer::pointer peer) override;
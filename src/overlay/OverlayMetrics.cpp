@@ -1,6 +1,7 @@
 #include "overlay/OverlayMetrics.h"
 #include "main/Application.h"
 
+#include "medida/histogram.h"
 #include "medida/meter.h"
 #include "medida/metrics_registry.h"
 #include "medida/timer.h"
@@ -72,11 +73,34 @@ OverlayMetrics::OverlayMetrics(Application& app)
     , mRecvSurveyResponseTimer(
           app.getMetrics().NewTimer({"overlay", "recv", "survey-response"}))
 
+    , mRecvFloodAdvertTimer(
+          app.getMetrics().NewTimer({"overlay", "recv", "flood-advert"}))
+    , mRecvFloodDemandTimer(
+          app.getMetrics().NewTimer({"overlay", "recv", "flood-demand"}))
+    , mRecvSendMoreTimer(
+          app.getMetrics().NewTimer({"overlay", "recv", "send-more"}))
+
+    , mRecvDecodeTimer(
+          app.getMetrics().NewTimer({"overlay", "recv", "decode"}))
+
     , mMessageDelayInWriteQueueTimer(
           app.getMetrics().NewTimer({"overlay", "delay", "write-queue"}))
     , mMessageDelayInAsyncWriteTimer(
           app.getMetrics().NewTimer({"overlay", "delay", "async-write"}))
 
+    , mAsyncWriteBatchSize(
+          app.getMetrics().NewHistogram({"overlay", "async", "write-batch"}))
+    , mAsyncWriteBufferCount(
+          app.getMetrics().NewHistogram({"overlay", "async", "write-buffers"}))
+    , mAsyncWriteDepth1Timer(
+          app.getMetrics().NewTimer({"overlay", "async", "write-depth-1"}))
+    , mAsyncWriteDepth2To15Timer(
+          app.getMetrics().NewTimer({"overlay", "async", "write-depth-2-15"}))
+    , mAsyncWriteDepth16To127Timer(app.getMetrics().NewTimer(
+          {"overlay", "async", "write-depth-16-127"}))
+    , mAsyncWriteDepth128UpTimer(app.getMetrics().NewTimer(
+          {"overlay", "async", "write-depth-128-up"}))
+
     , mSendErrorMeter(
           app.getMetrics().NewMeter({"overlay", "send", "error"}, "message"))
     , mSendHelloMeter(
@@ -107,6 +131,12 @@ OverlayMetrics::OverlayMetrics(Application& app)
           {"overlay", "send", "survey-request"}, "message"))
     , mSendSurveyResponseMeter(app.getMetrics().NewMeter(
           {"overlay", "send", "survey-response"}, "message"))
+    , mSendFloodAdvertMeter(app.getMetrics().NewMeter(
+          {"overlay", "send", "flood-advert"}, "message"))
+    , mSendFloodDemandMeter(app.getMetrics().NewMeter(
+          {"overlay", "send", "flood-demand"}, "message"))
+    , mSendSendMoreMeter(app.getMetrics().NewMeter(
+          {"overlay", "send", "send-more"}, "message"))
     , mMessagesBroadcast(app.getMetrics().NewMeter(
           {"overlay", "message", "broadcast"}, "message"))
     , mPendingPeersSize(
@@ -122,6 +152,40 @@ OverlayMetrics::OverlayMetrics(Application& app)
           {"overlay", "fetch", "unique-recv"}, "byte"))
     , mDuplicateFetchBytesRecv(app.getMetrics().NewMeter(
           {"overlay", "fetch", "duplicate-recv"}, "byte"))
+
+    , mDemandedTxs(app.getMetrics().NewMeter({"overlay", "flood", "demanded"},
+                                             "transaction"))
+    , mAbandonedDemands(app.getMetrics().NewMeter(
+          {"overlay", "flood", "abandoned-demand"}, "transaction"))
+    , mFulfilledDemands(app.getMetrics().NewMeter(
+          {"overlay", "flood", "fulfilled"}, "transaction"))
+    , mUnfulfilledDemands(app.getMetrics().NewMeter(
+          {"overlay", "flood", "unfulfilled"}, "transaction"))
+
+    , mOutboundQueueDelaySCP(
+          app.getMetrics().NewTimer({"overlay", "outbound-queue", "scp"}))
+    , mOutboundQueueDelayTxs(
+          app.getMetrics().NewTimer({"overlay", "outbound-queue", "tx"}))
+    , mOutboundQueueDropTxs(app.getMetrics().NewMeter(
+          {"overlay", "outbound-queue", "drop-tx"}, "message"))
+{
+}
+
+medida::Timer&
+OverlayMetrics::getAsyncWriteTimer(size_t queueDepth)
 {
+    if (queueDepth <= 1)
+    {
+        return mAsyncWriteDepth1Timer;
+    }
+    else if (queueDepth < 16)
+    {
+        return mAsyncWriteDepth2To15Timer;
+    }
+    else if (queueDepth < 128)
+    {
+        return mAsyncWriteDepth16To127Timer;
+    }
+    return mAsyncWriteDepth128UpTimer;
 }
 }
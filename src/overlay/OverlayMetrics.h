@@ -7,11 +7,14 @@
 // This structure just exists to cache frequently-accessed, overlay-wide
 // (non-peer-specific) metrics.
 
+#include <cstddef>
+
 namespace medida
 {
 class Timer;
 class Meter;
 class Counter;
+class Histogram;
 }
 
 namespace stellar
@@ -59,9 +62,24 @@ struct OverlayMetrics
     medida::Timer& mRecvSurveyRequestTimer;
     medida::Timer& mRecvSurveyResponseTimer;
 
+    medida::Timer& mRecvFloodAdvertTimer;
+    medida::Timer& mRecvFloodDemandTimer;
+    medida::Timer& mRecvSendMoreTimer;
+
+    medida::Timer& mRecvDecodeTimer;
+
     medida::Timer& mMessageDelayInWriteQueueTimer;
     medida::Timer& mMessageDelayInAsyncWriteTimer;
 
+    medida::Histogram& mAsyncWriteBatchSize;
+    medida::Histogram& mAsyncWriteBufferCount;
+    // Latency of async writes, by depth of the write queue when issued.
+    medida::Timer& mAsyncWriteDepth1Timer;
+    medida::Timer& mAsyncWriteDepth2To15Timer;
+    medida::Timer& mAsyncWriteDepth16To127Timer;
+    medida::Timer& mAsyncWriteDepth128UpTimer;
+    medida::Timer& getAsyncWriteTimer(size_t queueDepth);
+
     medida::Meter& mSendErrorMeter;
     medida::Meter& mSendHelloMeter;
     medida::Meter& mSendAuthMeter;
@@ -79,6 +97,10 @@ struct OverlayMetrics
     medida::Meter& mSendSurveyRequestMeter;
     medida::Meter& mSendSurveyResponseMeter;
 
+    medida::Meter& mSendFloodAdvertMeter;
+    medida::Meter& mSendFloodDemandMeter;
+    medida::Meter& mSendSendMoreMeter;
+
     medida::Meter& mMessagesBroadcast;
     medida::Counter& mPendingPeersSize;
     medida::Counter& mAuthenticatedPeersSize;
@@ -87,5 +109,14 @@ struct OverlayMetrics
     medida::Meter& mDuplicateFloodBytesRecv;
     medida::Meter& mUniqueFetchBytesRecv;
     medida::Meter& mDuplicateFetchBytesRecv;
+
+    medida::Meter& mDemandedTxs;
+    medida::Meter& mAbandonedDemands;
+    medida::Meter& mFulfilledDemands;
+    medida::Meter& mUnfulfilledDemands;
+
+    medida::Timer& mOutboundQueueDelaySCP;
+    medida::Timer& mOutboundQueueDelayTxs;
+    medida::Meter& mOutboundQueueDropTxs;
 };
 }
@@ -33,6 +33,7 @@
 #include <fmt/format.h>
 
 #include <Tracy.hpp>
+#include <cstring>
 #include <soci.h>
 #include <time.h>
 
@@ -48,6 +49,40 @@ using namespace soci;
 static constexpr VirtualClock::time_point PING_NOT_SENT =
     VirtualClock::time_point::min();
 
+namespace
+{
+void
+putUint32BE(uint8_t* out, uint32_t v)
+{
+    out[0] = static_cast<uint8_t>(v >> 24);
+    out[1] = static_cast<uint8_t>(v >> 16);
+    out[2] = static_cast<uint8_t>(v >> 8);
+    out[3] = static_cast<uint8_t>(v);
+}
+
+// Returns the flow control credit taken by a received message to its peer
+// when destroyed.
+class FlowControlCredit : public NonMovableOrCopyable
+{
+    std::weak_ptr<Peer> mPeer;
+
+  public:
+    explicit FlowControlCredit(std::weak_ptr<Peer> peer)
+        : mPeer(std::move(peer))
+    {
+    }
+
+    ~FlowControlCredit()
+    {
+        auto peer = mPeer.lock();
+        if (peer)
+        {
+            peer->endMessageProcessing();
+        }
+    }
+};
+}
+
 Peer::Peer(Application& app, PeerRole role)
     : mApp(app)
     , mRole(role)
@@ -170,7 +205,10 @@ Peer::recurrentTimerExpired(asio::error_code const& error)
             drop("idle timeout", Peer::DropDirection::WE_DROPPED_REMOTE,
                  Peer::DropMode::IGNORE_WRITE_QUEUE);
         }
-        else if (((now - mEnqueueTimeOfLastWrite) >= stragglerTimeout))
+        else if (((now - mEnqueueTimeOfLastWrite) >= stragglerTimeout) ||
+                 (mFlowControl && mFlowControl->getNoCapacitySince() &&
+                  (now - *mFlowControl->getNoCapacitySince()) >=
+                      stragglerTimeout))
         {
             getOverlayMetrics().mTimeoutStraggler.Mark();
             drop("straggling (cannot keep up)",
@@ -190,6 +228,10 @@ Peer::sendAuth()
     ZoneScoped;
     StellarMessage msg;
     msg.type(AUTH);
+    if (mApp.getConfig().ENABLE_PULL_MODE)
+    {
+        msg.auth().flags = AUTH_MSG_FLAG_PULL_MODE_REQUESTED;
+    }
     sendMessage(msg);
 }
 
@@ -391,12 +433,28 @@ Peer::msgSummary(StellarMessage const& msg)
     case SURVEY_REQUEST:
     case SURVEY_RESPONSE:
         return SurveyManager::getMsgSummary(msg);
+
+    case FLOOD_ADVERT:
+        return fmt::format(FMT_STRING("FLOODADVERT {:d}"),
+                           msg.floodAdvert().txHashes.size());
+    case FLOOD_DEMAND:
+        return fmt::format(FMT_STRING("FLOODDEMAND {:d}"),
+                           msg.floodDemand().txHashes.size());
+    case SEND_MORE:
+        return fmt::format(FMT_STRING("SENDMORE {:d}"),
+                           msg.sendMoreMessage().numMessages);
     }
     return "UNKNOWN";
 }
 
 void
 Peer::sendMessage(StellarMessage const& msg, bool log)
+{
+    sendMessage(msg, SharedMessageBody(), log);
+}
+
+void
+Peer::sendMessage(StellarMessage const& msg, SharedMessageBody body, bool log)
 {
     ZoneScoped;
     CLOG_TRACE(Overlay, "send: {} to : {}", msgSummary(msg),
@@ -409,7 +467,10 @@ Peer::sendMessage(StellarMessage const& msg, bool log)
     // and we're being asked to add messages that are being generated _from_ a
     // droppable action, we drop the message rather than enqueue it. This avoids
     // growing our queues indefinitely.
-    if (mApp.getClock().currentSchedulerActionType() ==
+    // SEND_MORE is exempt: the peer stops sending flooded messages to us
+    // without it.
+    if (msg.type() != SEND_MORE &&
+        mApp.getClock().currentSchedulerActionType() ==
             Scheduler::ActionType::DROPPABLE_ACTION &&
         sendQueueIsOverloaded())
     {
@@ -417,6 +478,21 @@ Peer::sendMessage(StellarMessage const& msg, bool log)
         return;
     }
 
+    if (mFlowControl && FlowControl::isFlowControlled(msg))
+    {
+        mFlowControl->sendMessage(msg, std::move(body));
+    }
+    else
+    {
+        sendAuthenticatedMessage(msg, std::move(body));
+    }
+}
+
+void
+Peer::sendAuthenticatedMessage(StellarMessage const& msg,
+                               SharedMessageBody body)
+{
+    ZoneScoped;
     switch (msg.type())
     {
     case ERROR_MSG:
@@ -464,23 +540,60 @@ Peer::sendMessage(StellarMessage const& msg, bool log)
     case SURVEY_RESPONSE:
         getOverlayMetrics().mSendSurveyResponseMeter.Mark();
         break;
+    case FLOOD_ADVERT:
+        getOverlayMetrics().mSendFloodAdvertMeter.Mark();
+        break;
+    case FLOOD_DEMAND:
+        getOverlayMetrics().mSendFloodDemandMeter.Mark();
+        break;
+    case SEND_MORE:
+        getOverlayMetrics().mSendSendMoreMeter.Mark();
+        break;
     };
 
-    AuthenticatedMessage amsg;
-    amsg.v0().message = msg;
-    if (msg.type() != HELLO && msg.type() != ERROR_MSG)
-    {
-        ZoneNamedN(hmacZone, "message HMAC", true);
-        amsg.v0().sequence = mSendMacSeq;
-        amsg.v0().mac =
-            hmacSha256(mSendMacKey, xdr::xdr_to_opaque(mSendMacSeq, msg));
-        ++mSendMacSeq;
-    }
-    xdr::msg_ptr xdrBytes;
+    if (!body)
     {
         ZoneNamedN(xdrZone, "XDR serialize", true);
-        xdrBytes = xdr::xdr_to_msg(amsg);
+        body =
+            std::make_shared<xdr::opaque_vec<> const>(xdr::xdr_to_opaque(msg));
+    }
+
+    // The AuthenticatedMessage (v0) on the wire is the record mark, the union
+    // discriminant, the sequence number, `body` and the MAC.
+    bool authenticated = msg.type() != HELLO && msg.type() != ERROR_MSG;
+    uint64_t sequence = authenticated ? mSendMacSeq++ : 0;
+    HmacSha256Mac mac;
+    AuthHeader header;
+    auto size = static_cast<uint32_t>(AUTH_HEADER_SIZE - 4 + body->size() +
+                                      mac.mac.size());
+    putUint32BE(header.data(), size | 0x80000000);
+    putUint32BE(header.data() + 4, 0);
+    putUint32BE(header.data() + 8, static_cast<uint32_t>(sequence >> 32));
+    putUint32BE(header.data() + 12, static_cast<uint32_t>(sequence));
+    if (authenticated)
+    {
+        // Same as hmacSha256(key, xdr_to_opaque(sequence, msg))
+        ZoneNamedN(hmacZone, "message HMAC", true);
+        HmacSha256 hmac(mSendMacKey);
+        hmac.add(ByteSlice(header.data() + 8, 8));
+        hmac.add(*body);
+        mac = hmac.finish();
     }
+    this->sendMessage(header, body, mac);
+}
+
+void
+Peer::sendMessage(AuthHeader const& header, SharedMessageBody const& body,
+                  HmacSha256Mac const& mac)
+{
+    auto xdrBytes = xdr::message_t::alloc(AUTH_HEADER_SIZE - 4 + body->size() +
+                                          mac.mac.size());
+    auto out = xdrBytes->data();
+    std::memcpy(out, header.data() + 4, AUTH_HEADER_SIZE - 4);
+    out += AUTH_HEADER_SIZE - 4;
+    std::memcpy(out, body->data(), body->size());
+    out += body->size();
+    std::memcpy(out, mac.mac.data(), mac.mac.size());
     this->sendMessage(std::move(xdrBytes));
 }
 
@@ -525,6 +638,29 @@ Peer::isAuthenticated() const
     return mState == GOT_AUTH;
 }
 
+bool
+Peer::isPullModeEnabled() const
+{
+    return mRemoteRequestedPullMode && mApp.getConfig().ENABLE_PULL_MODE;
+}
+
+bool
+Peer::isFlowControlEnabled() const
+{
+    return mRemoteOverlayVersion >= FIRST_OVERLAY_VERSION_WITH_FLOW_CONTROL &&
+           mApp.getConfig().OVERLAY_PROTOCOL_VERSION >=
+               FIRST_OVERLAY_VERSION_WITH_FLOW_CONTROL;
+}
+
+void
+Peer::endMessageProcessing()
+{
+    if (mFlowControl && !shouldAbort())
+    {
+        mFlowControl->endMessageProcessing();
+    }
+}
+
 std::chrono::seconds
 Peer::getLifeTime() const
 {
@@ -549,28 +685,38 @@ Peer::recvMessage(AuthenticatedMessage const& msg)
 
     if (mState >= GOT_HELLO && msg.v0().message.type() != ERROR_MSG)
     {
-        if (msg.v0().sequence != mRecvMacSeq)
-        {
-            ++mRecvMacSeq;
-            sendErrorAndDrop(ERR_AUTH, "unexpected auth sequence",
-                             DropMode::IGNORE_WRITE_QUEUE);
-            return;
-        }
-
-        if (!hmacSha256Verify(
-                msg.v0().mac, mRecvMacKey,
-                xdr::xdr_to_opaque(msg.v0().sequence, msg.v0().message)))
+        auto err = checkRecvMac(msg, mRecvMacKey, mRecvMacSeq);
+        if (err)
         {
-            ++mRecvMacSeq;
-            sendErrorAndDrop(ERR_AUTH, "unexpected MAC",
-                             DropMode::IGNORE_WRITE_QUEUE);
+            sendErrorAndDrop(ERR_AUTH, err, DropMode::IGNORE_WRITE_QUEUE);
             return;
         }
-        ++mRecvMacSeq;
     }
     recvMessage(msg.v0().message);
 }
 
+char const*
+Peer::checkRecvMac(AuthenticatedMessage const& msg,
+                   HmacSha256Key const& recvMacKey, uint64_t& recvMacSeq)
+{
+    ZoneScoped;
+    if (msg.v0().sequence != recvMacSeq)
+    {
+        ++recvMacSeq;
+        return "unexpected auth sequence";
+    }
+
+    if (!hmacSha256Verify(
+            msg.v0().mac, recvMacKey,
+            xdr::xdr_to_opaque(msg.v0().sequence, msg.v0().message)))
+    {
+        ++recvMacSeq;
+        return "unexpected MAC";
+    }
+    ++recvMacSeq;
+    return nullptr;
+}
+
 void
 Peer::recvMessage(StellarMessage const& stellarMsg)
 {
@@ -594,11 +740,14 @@ Peer::recvMessage(StellarMessage const& stellarMsg)
     case GET_PEERS:
     case PEERS:
     case ERROR_MSG:
+    case SEND_MORE:
         cat = "CTRL";
         break;
 
     // high volume flooding
     case TRANSACTION:
+    case FLOOD_ADVERT:
+    case FLOOD_DEMAND:
         cat = "TX";
         type = Scheduler::ActionType::DROPPABLE_ACTION;
         break;
@@ -624,9 +773,25 @@ Peer::recvMessage(StellarMessage const& stellarMsg)
     }
 
     std::weak_ptr<Peer> weak(static_pointer_cast<Peer>(shared_from_this()));
+
+    // Flow-controlled messages hold a credit until the action processing them
+    // is destroyed, whether it ran or was shed by the scheduler.
+    std::shared_ptr<FlowControlCredit> credit;
+    if (mFlowControl && FlowControl::isFlowControlled(stellarMsg))
+    {
+        if (!mFlowControl->beginMessageProcessing())
+        {
+            sendErrorAndDrop(ERR_LOAD,
+                             "unexpected flood message, peer at capacity",
+                             DropMode::IGNORE_WRITE_QUEUE);
+            return;
+        }
+        credit = std::make_shared<FlowControlCredit>(weak);
+    }
+
     mApp.postOnMainThread(
         [weak, sm = StellarMessage(stellarMsg), mtype = stellarMsg.type(), cat,
-         port = mApp.getConfig().PEER_PORT]() {
+         port = mApp.getConfig().PEER_PORT, credit]() {
             auto self = weak.lock();
             if (self)
             {
@@ -788,6 +953,27 @@ Peer::recvRawMessage(StellarMessage const& stellarMsg)
         recvGetSCPState(stellarMsg);
     }
     break;
+
+    case FLOOD_ADVERT:
+    {
+        auto t = getOverlayMetrics().mRecvFloodAdvertTimer.TimeScope();
+        recvFloodAdvert(stellarMsg);
+    }
+    break;
+
+    case FLOOD_DEMAND:
+    {
+        auto t = getOverlayMetrics().mRecvFloodDemandTimer.TimeScope();
+        recvFloodDemand(stellarMsg);
+    }
+    break;
+
+    case SEND_MORE:
+    {
+        auto t = getOverlayMetrics().mRecvSendMoreTimer.TimeScope();
+        recvSendMore(stellarMsg);
+    }
+    break;
     }
 }
 
@@ -854,6 +1040,54 @@ Peer::recvTransaction(StellarMessage const& msg)
     }
 }
 
+void
+Peer::recvFloodAdvert(StellarMessage const& msg)
+{
+    ZoneScoped;
+    if (!mTxAdverts)
+    {
+        // Only peers that negotiated pull mode advertise transactions.
+        return;
+    }
+    mTxAdverts->queueIncomingAdvert(msg.floodAdvert().txHashes);
+    mApp.getOverlayManager().scheduleTxDemand();
+}
+
+void
+Peer::recvFloodDemand(StellarMessage const& msg)
+{
+    ZoneScoped;
+    auto& om = mApp.getOverlayManager();
+    for (auto const& h : msg.floodDemand().txHashes)
+    {
+        // Transactions are served from the FloodGate, which keeps what we
+        // flooded until the ledger it was flooded for is closed.
+        auto tx = om.getFloodedTx(h);
+        if (tx)
+        {
+            getOverlayMetrics().mFulfilledDemands.Mark();
+            sendMessage(*tx);
+        }
+        else
+        {
+            getOverlayMetrics().mUnfulfilledDemands.Mark();
+        }
+    }
+}
+
+void
+Peer::recvSendMore(StellarMessage const& msg)
+{
+    ZoneScoped;
+    if (!mFlowControl)
+    {
+        sendErrorAndDrop(ERR_MISC, "unexpected SEND_MORE message",
+                         DropMode::IGNORE_WRITE_QUEUE);
+        return;
+    }
+    mFlowControl->recvSendMore(msg.sendMoreMessage().numMessages);
+}
+
 Hash
 Peer::pingIDfromTimePoint(VirtualClock::time_point const& tp)
 {
@@ -1213,6 +1447,15 @@ Peer::recvAuth(StellarMessage const& msg)
     }
 
     mState = GOT_AUTH;
+    mRemoteRequestedPullMode =
+        msg.auth().flags == AUTH_MSG_FLAG_PULL_MODE_REQUESTED;
+
+    if (isPullModeEnabled())
+    {
+        mTxAdverts = std::make_unique<TxAdverts>(mApp);
+        mTxAdverts->start(
+            [this](StellarMessage const& advert) { sendMessage(advert); });
+    }
 
     if (mRole == REMOTE_CALLED_US)
     {
@@ -1220,6 +1463,16 @@ Peer::recvAuth(StellarMessage const& msg)
         sendPeers();
     }
 
+    // Only once AUTH was sent, as the initial SEND_MORE must follow it.
+    if (isFlowControlEnabled())
+    {
+        mFlowControl = std::make_unique<FlowControl>(mApp);
+        mFlowControl->start(
+            [this](StellarMessage const& m, SharedMessageBody const& body) {
+                sendAuthenticatedMessage(m, body);
+            });
+    }
+
     updatePeerRecordAfterAuthentication();
 
     auto self = shared_from_this();
@@ -6,8 +6,10 @@
 
 #include "util/asio.h"
 #include "database/Database.h"
+#include "overlay/FlowControl.h"
 #include "overlay/PeerBareAddress.h"
 #include "overlay/StellarXDR.h"
+#include "overlay/TxAdverts.h"
 #include "util/NonCopyable.h"
 #include "util/Timer.h"
 #include "xdrpp/message.h"
@@ -55,6 +57,11 @@ class Peer : public std::enable_shared_from_this<Peer>,
   public:
     typedef std::shared_ptr<Peer> pointer;
 
+    // Peers both on this overlay version or later only send each other
+    // flooded messages they were granted capacity for (SEND_MORE), see
+    // FlowControl.
+    static constexpr uint32_t FIRST_OVERLAY_VERSION_WITH_FLOW_CONTROL = 20;
+
     enum PeerState
     {
         CONNECTING = 0,
@@ -103,6 +110,11 @@ class Peer : public std::enable_shared_from_this<Peer>,
         VirtualClock::time_point mConnectedTime;
     };
 
+    // Size of what precedes the StellarMessage of an AuthenticatedMessage on
+    // the wire: record mark, union discriminant and sequence number.
+    static constexpr size_t AUTH_HEADER_SIZE = 16;
+    using AuthHeader = std::array<uint8_t, AUTH_HEADER_SIZE>;
+
     struct TimestampedMessage
     {
         VirtualClock::time_point mEnqueuedTime;
@@ -110,6 +122,11 @@ class Peer : public std::enable_shared_from_this<Peer>,
         VirtualClock::time_point mCompletedTime;
         void recordWriteTiming(OverlayMetrics& metrics);
         xdr::msg_ptr mMessage;
+        // Instead of mMessage, for messages written in place (see
+        // TCPPeer::sendMessage): header, shared body and MAC.
+        AuthHeader mHeader;
+        SharedMessageBody mBody;
+        HmacSha256Mac mMac;
     };
 
   protected:
@@ -129,6 +146,8 @@ class Peer : public std::enable_shared_from_this<Peer>,
     std::string mRemoteVersion;
     uint32_t mRemoteOverlayMinVersion;
     uint32_t mRemoteOverlayVersion;
+    // Set from the flags of the remote's AUTH message.
+    bool mRemoteRequestedPullMode{false};
     PeerBareAddress mAddress;
 
     VirtualClock::time_point mCreationTime;
@@ -146,6 +165,11 @@ class Peer : public std::enable_shared_from_this<Peer>,
 
     PeerMetrics mPeerMetrics;
 
+    // Only set once authenticated, if isPullModeEnabled().
+    std::unique_ptr<TxAdverts> mTxAdverts;
+    // Only set once authenticated, if isFlowControlEnabled().
+    std::unique_ptr<FlowControl> mFlowControl;
+
     OverlayMetrics& getOverlayMetrics();
 
     bool shouldAbort() const;
@@ -154,6 +178,13 @@ class Peer : public std::enable_shared_from_this<Peer>,
     void recvMessage(AuthenticatedMessage const& msg);
     void recvMessage(xdr::msg_ptr const& xdrBytes);
 
+    // Checks that `msg` carries the next expected sequence number and a valid
+    // MAC, advancing `recvMacSeq` either way. Returns the reason to drop the
+    // peer, or null. Touches no Peer state, so it may run off the main thread.
+    static char const* checkRecvMac(AuthenticatedMessage const& msg,
+                                    HmacSha256Key const& recvMacKey,
+                                    uint64_t& recvMacSeq);
+
     virtual void recvError(StellarMessage const& msg);
     void updatePeerRecordAfterEcho();
     void updatePeerRecordAfterAuthentication();
@@ -172,6 +203,9 @@ class Peer : public std::enable_shared_from_this<Peer>,
     void recvSCPQuorumSet(StellarMessage const& msg);
     void recvSCPMessage(StellarMessage const& msg);
     void recvGetSCPState(StellarMessage const& msg);
+    void recvFloodAdvert(StellarMessage const& msg);
+    void recvFloodDemand(StellarMessage const& msg);
+    void recvSendMore(StellarMessage const& msg);
 
     void sendHello();
     void sendAuth();
@@ -179,6 +213,10 @@ class Peer : public std::enable_shared_from_this<Peer>,
     void sendDontHave(MessageType type, uint256 const& itemID);
     void sendPeers();
     void sendError(ErrorCode error, std::string const& message);
+    // Authenticates and writes `msg`, bypassing flow control. `body` is the
+    // XDR of `msg` if already serialized, or null.
+    void sendAuthenticatedMessage(StellarMessage const& msg,
+                                  SharedMessageBody body = nullptr);
 
     // NB: This is a move-argument because the write-buffer has to travel
     // with the write-request through the async IO system, and we might have
@@ -188,6 +226,13 @@ class Peer : public std::enable_shared_from_this<Peer>,
     // messages somewhere else. The async write request will point _into_
     // this owned buffer. This is really the best we can do.
     virtual void sendMessage(xdr::msg_ptr&& xdrBytes) = 0;
+    // Writes the AuthenticatedMessage made of `header`, `body` (the XDR of
+    // its StellarMessage) and `mac`. By default these are copied into one
+    // buffer for sendMessage(xdr::msg_ptr&&); a subclass that can write them
+    // in place avoids copying a body shared with other peers.
+    virtual void sendMessage(AuthHeader const& header,
+                             SharedMessageBody const& body,
+                             HmacSha256Mac const& mac);
     virtual void
     connected()
     {
@@ -225,6 +270,10 @@ class Peer : public std::enable_shared_from_this<Peer>,
                           DropMode dropMode);
 
     void sendMessage(StellarMessage const& msg, bool log = true);
+    // Same, with the XDR of `msg` already serialized in `body`, typically
+    // shared by all the peers `msg` is broadcast to.
+    void sendMessage(StellarMessage const& msg, SharedMessageBody body,
+                     bool log = true);
 
     PeerRole
     getRole() const
@@ -235,6 +284,36 @@ class Peer : public std::enable_shared_from_this<Peer>,
     bool isConnected() const;
     bool isAuthenticated() const;
 
+    // True if both sides set AUTH_MSG_FLAG_PULL_MODE_REQUESTED during the
+    // handshake: transactions are then flooded by advertising their hashes
+    // (FLOOD_ADVERT) and only sending their bodies when demanded
+    // (FLOOD_DEMAND).
+    bool isPullModeEnabled() const;
+
+    // Pull-mode flooding state for this peer; null unless the peer is
+    // authenticated and isPullModeEnabled().
+    TxAdverts*
+    getTxAdverts()
+    {
+        return mTxAdverts.get();
+    }
+
+    // True if both sides are on FIRST_OVERLAY_VERSION_WITH_FLOW_CONTROL or
+    // later.
+    bool isFlowControlEnabled() const;
+
+    // Flow control state for this peer; null unless the peer is
+    // authenticated and isFlowControlEnabled().
+    FlowControl*
+    getFlowControl()
+    {
+        return mFlowControl.get();
+    }
+
+    // Called once a flow-controlled message received from this peer has been
+    // processed, or dropped unprocessed.
+    void endMessageProcessing();
+
     VirtualClock::time_point
     getCreationTime() const
     {
@@ -4,3 +4,12 @@
 #include "xdr/Stellar-overlay.h"
 #include "xdr/Stellar-transaction.h"
 #include "xdr/Stellar-types.h"
+
+#include <memory>
+
+namespace stellar
+{
+// XDR of a StellarMessage, serialized once and shared by all the peers it is
+// sent to. Only the sequence number and MAC around it are per-peer.
+using SharedMessageBody = std::shared_ptr<xdr::opaque_vec<> const>;
+}
@@ -9,8 +9,10 @@
 #include "main/Application.h"
 #include "main/Config.h"
 #include "main/ErrorMessages.h"
+#include "medida/histogram.h"
 #include "medida/meter.h"
 #include "medida/metrics_registry.h"
+#include "medida/timer.h"
 #include "overlay/OverlayManager.h"
 #include "overlay/OverlayMetrics.h"
 #include "overlay/PeerManager.h"
@@ -141,11 +143,35 @@ TCPPeer::sendMessage(xdr::msg_ptr&& xdrBytes)
         return;
     }
 
-    assertThreadIsMain();
+    TimestampedMessage msg;
+    msg.mMessage = std::move(xdrBytes);
+    enqueueMessage(std::move(msg));
+}
+
+void
+TCPPeer::sendMessage(AuthHeader const& header, SharedMessageBody const& body,
+                     HmacSha256Mac const& mac)
+{
+    if (shouldAbort())
+    {
+        return;
+    }
 
+    // Written in place by messageSender: `body` may be shared with other
+    // peers, and is never copied.
     TimestampedMessage msg;
+    msg.mHeader = header;
+    msg.mBody = body;
+    msg.mMac = mac;
+    enqueueMessage(std::move(msg));
+}
+
+void
+TCPPeer::enqueueMessage(TimestampedMessage&& msg)
+{
+    assertThreadIsMain();
+
     msg.mEnqueuedTime = mApp.getClock().now();
-    msg.mMessage = std::move(xdrBytes);
     mWriteQueue.emplace_back(std::move(msg));
 
     if (!mWriting)
@@ -238,24 +264,44 @@ TCPPeer::messageSender()
         return;
     }
 
-    // Take a snapshot of the contents of mWriteQueue into mWriteBuffers, in
-    // terms of asio::const_buffers pointing into the elements of mWriteQueue,
-    // and then issue a single multi-buffer ("scatter-gather") async_write that
-    // covers the whole snapshot. We'll get called back when the batch is
-    // completed, at which point we'll clear mWriteBuffers and remove the entire
-    // snapshot worth of corresponding messages from mWriteQueue (though it may
-    // have grown a bit in the meantime -- we remove only a prefix).
-    releaseAssert(mWriteBuffers.empty());
+    // Take a snapshot of a prefix of mWriteQueue (up to MAX_BATCH_WRITE_COUNT
+    // messages and about MAX_BATCH_WRITE_BYTES) into mWriteBuffers, and then
+    // issue a single multi-buffer ("scatter-gather") async_write that covers
+    // the whole snapshot. We'll get called back when the batch is completed,
+    // at which point we'll clear mWriteBuffers and remove the snapshot worth
+    // of messages from mWriteQueue (though it may have grown a bit in the
+    // meantime -- we remove only a prefix).
+    //
+    // Pieces of messages up to COALESCE_MAX_PIECE_SIZE are copied back to back
+    // into mCoalesceBuffer, so that a run of small messages (typically SCP
+    // messages) becomes a single buffer; the socket layer gathers a limited
+    // number of buffers per syscall. Larger pieces are written in place.
+    releaseAssert(mWriteBuffers.empty() && mWriteBatchSize == 0);
     auto now = mApp.getClock().now();
     size_t expected_length = 0;
+    size_t coalesced_length = 0;
     size_t maxQueueSize = mApp.getConfig().MAX_BATCH_WRITE_COUNT;
     releaseAssert(maxQueueSize > 0);
     size_t const maxTotalBytes = mApp.getConfig().MAX_BATCH_WRITE_BYTES;
+    auto coalescedSize = [](size_t sz) {
+        return sz <= COALESCE_MAX_PIECE_SIZE ? sz : 0;
+    };
     for (auto& tsm : mWriteQueue)
     {
         tsm.mIssuedTime = now;
-        size_t sz = tsm.mMessage->raw_size();
-        mWriteBuffers.emplace_back(tsm.mMessage->raw_data(), sz);
+        size_t sz;
+        if (tsm.mBody)
+        {
+            sz = tsm.mHeader.size() + tsm.mBody->size() + tsm.mMac.mac.size();
+            coalesced_length += tsm.mHeader.size() + tsm.mMac.mac.size() +
+                                coalescedSize(tsm.mBody->size());
+        }
+        else
+        {
+            sz = tsm.mMessage->raw_size();
+            coalesced_length += coalescedSize(sz);
+        }
+        ++mWriteBatchSize;
         expected_length += sz;
         mEnqueueTimeOfLastWrite = tsm.mEnqueuedTime;
         // check if we reached any limit
@@ -265,13 +311,63 @@ TCPPeer::messageSender()
             break;
     }
 
-    CLOG_DEBUG(Overlay, "messageSender {} - b:{} n:{}/{}", toString(),
-               expected_length, mWriteBuffers.size(), mWriteQueue.size());
-    getOverlayMetrics().mAsyncWrite.Mark();
+    // Reserved up front: mWriteBuffers points into mCoalesceBuffer, which
+    // must not reallocate while being filled.
+    mCoalesceBuffer.clear();
+    mCoalesceBuffer.reserve(coalesced_length);
+    bool coalescing = false;
+    size_t runStart = 0;
+    auto addPiece = [&](void const* data, size_t size) {
+        if (size > COALESCE_MAX_PIECE_SIZE)
+        {
+            mWriteBuffers.emplace_back(data, size);
+            coalescing = false;
+            return;
+        }
+        if (!coalescing)
+        {
+            runStart = mCoalesceBuffer.size();
+            mWriteBuffers.emplace_back();
+            coalescing = true;
+        }
+        auto bytes = static_cast<uint8_t const*>(data);
+        mCoalesceBuffer.insert(mCoalesceBuffer.end(), bytes, bytes + size);
+        mWriteBuffers.back() =
+            asio::const_buffer(mCoalesceBuffer.data() + runStart,
+                               mCoalesceBuffer.size() - runStart);
+    };
+    auto it = mWriteQueue.begin();
+    for (size_t n = 0; n < mWriteBatchSize; ++n, ++it)
+    {
+        if (it->mBody)
+        {
+            addPiece(it->mHeader.data(), it->mHeader.size());
+            addPiece(it->mBody->data(), it->mBody->size());
+            addPiece(it->mMac.mac.data(), it->mMac.mac.size());
+        }
+        else
+        {
+            addPiece(it->mMessage->raw_data(), it->mMessage->raw_size());
+        }
+    }
+    releaseAssert(mCoalesceBuffer.size() == coalesced_length);
+
+    CLOG_DEBUG(Overlay, "messageSender {} - b:{} n:{}/{} buffers:{}",
+               toString(), expected_length, mWriteBatchSize,
+               mWriteQueue.size(), mWriteBuffers.size());
+    auto& metrics = getOverlayMetrics();
+    metrics.mAsyncWrite.Mark();
+    metrics.mAsyncWriteBatchSize.Update(static_cast<int64_t>(mWriteBatchSize));
+    metrics.mAsyncWriteBufferCount.Update(
+        static_cast<int64_t>(mWriteBuffers.size()));
+    auto& depthTimer = metrics.getAsyncWriteTimer(mWriteQueue.size());
     auto self = static_pointer_cast<TCPPeer>(shared_from_this());
     asio::async_write(*(mSocket.get()), mWriteBuffers,
-                      [self, expected_length](asio::error_code const& ec,
-                                              std::size_t length) {
+                      [self, expected_length, &depthTimer,
+                       issued = now](asio::error_code const& ec,
+                                     std::size_t length) {
+                          depthTimer.Update(self->mApp.getClock().now() -
+                                            issued);
                           if (expected_length != length)
                           {
                               self->drop("error during async_write",
@@ -280,7 +376,7 @@ TCPPeer::messageSender()
                               return;
                           }
                           self->writeHandler(ec, length,
-                                             self->mWriteBuffers.size());
+                                             self->mWriteBatchSize);
 
                           // Walk through a _prefix_ of the write queue
                           // _corresponding_ to the write buffers we just sent.
@@ -290,12 +386,20 @@ TCPPeer::messageSender()
                           // queue.
                           auto now = self->mApp.getClock().now();
                           auto i = self->mWriteQueue.begin();
-                          while (!self->mWriteBuffers.empty())
+                          for (; self->mWriteBatchSize > 0;
+                               --self->mWriteBatchSize)
                           {
                               i->mCompletedTime = now;
                               i->recordWriteTiming(self->getOverlayMetrics());
                               ++i;
-                              self->mWriteBuffers.pop_back();
+                          }
+                          self->mWriteBuffers.clear();
+                          if (self->mCoalesceBuffer.capacity() >
+                              COALESCE_BUFFER_KEEP_SIZE)
+                          {
+                              // don't hold on to the space a burst needed
+                              std::vector<uint8_t>().swap(
+                                  self->mCoalesceBuffer);
                           }
 
                           // Erase the messages from the write queue that we
@@ -441,6 +545,13 @@ TCPPeer::startRead()
         return;
     }
 
+    if (mPendingDecodes >= MAX_PENDING_DECODES)
+    {
+        // messageDecoded resumes reading once the overlay thread catches up.
+        mReadPaused = true;
+        return;
+    }
+
     mIncomingHeader.clear();
 
     CLOG_DEBUG(Overlay, "TCPPeer::startRead {} from {}", mSocket->in_avail(),
@@ -487,7 +598,8 @@ TCPPeer::startRead()
                 }
                 noteFullyReadBody(length);
                 recvMessage();
-                if (mApp.getClock().shouldYield())
+                if (mApp.getClock().shouldYield() ||
+                    mPendingDecodes >= MAX_PENDING_DECODES)
                 {
                     break;
                 }
@@ -520,8 +632,9 @@ TCPPeer::startRead()
     else
     {
         // If we get here it's because we broke out of the input loop above
-        // early (via shouldYield) which means it's time to bounce off a the
-        // per-peer scheduler queue to throttle further input.
+        // early (via shouldYield, or because too many messages are waiting to
+        // be decoded) which means it's time to bounce off a the per-peer
+        // scheduler queue to throttle further input.
         scheduleRead();
     }
 }
@@ -630,6 +743,12 @@ TCPPeer::recvMessage()
     ZoneScoped;
     assertThreadIsMain();
 
+    if (mApp.getConfig().BACKGROUND_OVERLAY_PROCESSING && isAuthenticated())
+    {
+        decodeOnOverlayThread();
+        return;
+    }
+
     try
     {
         xdr::xdr_get g(mIncomingBody.data(),
@@ -653,6 +772,121 @@ TCPPeer::recvMessage()
     }
 }
 
+void
+TCPPeer::decodeOnOverlayThread()
+{
+    ZoneScoped;
+    assertThreadIsMain();
+
+    if (!mRecvMacState)
+    {
+        // Handshake messages were authenticated on the main thread up to
+        // here; carry on from where it left off.
+        mRecvMacState = std::make_shared<RecvMacState>();
+        mRecvMacState->mKey = mRecvMacKey;
+        mRecvMacState->mSeq = mRecvMacSeq;
+    }
+    ++mPendingDecodes;
+
+    Application& app = mApp;
+    medida::Timer& decodeTimer = getOverlayMetrics().mRecvDecodeTimer;
+    std::weak_ptr<TCPPeer> weak(
+        static_pointer_cast<TCPPeer>(shared_from_this()));
+    // Decoded messages go back through a per-peer scheduler queue, like reads,
+    // so that a busy peer does not hold up the others.
+    auto decodedName =
+        fmt::format(FMT_STRING("TCPPeer::messageDecoded for {}"), toString());
+    mApp.postOnOverlayThread(
+        [&app, &decodeTimer, weak, state = mRecvMacState,
+         body = std::move(mIncomingBody),
+         decodedName = std::move(decodedName)]() mutable {
+            if (state->mFailed)
+            {
+                // The peer is being dropped; don't bother.
+                return;
+            }
+            auto msg = std::make_shared<AuthenticatedMessage>();
+            ErrorCode errorCode = ERR_DATA;
+            char const* error = nullptr;
+            {
+                ZoneNamedN(decodeZone, "TCPPeer decode", true);
+                auto timer = decodeTimer.TimeScope();
+                try
+                {
+                    xdr::xdr_get g(body.data(), body.data() + body.size());
+                    xdr::xdr_argpack_archive(g, *msg);
+                    if (msg->v0().message.type() != ERROR_MSG)
+                    {
+                        errorCode = ERR_AUTH;
+                        error = Peer::checkRecvMac(*msg, state->mKey,
+                                                   state->mSeq);
+                    }
+                }
+                catch (xdr::xdr_runtime_error& e)
+                {
+                    CLOG_ERROR(Overlay, "recvMessage got a corrupt xdr: {}",
+                               e.what());
+                    errorCode = ERR_DATA;
+                    error = "received corrupt XDR";
+                }
+            }
+            if (error)
+            {
+                state->mFailed = true;
+            }
+            app.postOnMainThread(
+                [weak, msg, errorCode, error]() {
+                    auto self = weak.lock();
+                    if (self)
+                    {
+                        self->messageDecoded(msg, errorCode, error);
+                    }
+                },
+                std::move(decodedName));
+        },
+        "TCPPeer: decode message");
+    mIncomingBody = std::vector<uint8_t>();
+}
+
+void
+TCPPeer::messageDecoded(std::shared_ptr<AuthenticatedMessage const> msg,
+                        ErrorCode errorCode, char const* error)
+{
+    ZoneScoped;
+    assertThreadIsMain();
+    releaseAssert(mPendingDecodes > 0);
+    --mPendingDecodes;
+
+    if (shouldAbort())
+    {
+        return;
+    }
+
+    if (error)
+    {
+        sendErrorAndDrop(errorCode, error, Peer::DropMode::IGNORE_WRITE_QUEUE);
+        return;
+    }
+
+    try
+    {
+        Peer::recvMessage(msg->v0().message);
+    }
+    catch (CryptoError const& e)
+    {
+        CLOG_ERROR(Overlay, "Crypto error: {}", e.what());
+        sendErrorAndDrop(ERR_DATA, "crypto error",
+                         Peer::DropMode::IGNORE_WRITE_QUEUE);
+        return;
+    }
+
+    if (mReadPaused && mPendingDecodes <= MAX_PENDING_DECODES / 2)
+    {
+        mReadPaused = false;
+        scheduleRead();
+    }
+}
+
 void
 TCPPeer::drop(std::string const& reason, DropDirection dropDirection,
               DropMode dropMode)
@@ -678,6 +912,10 @@ TCPPeer::drop(std::string const& reason, DropDirection dropDirection,
     }
 
     mState = CLOSING;
+    if (mTxAdverts)
+    {
+        mTxAdverts->shutdown();
+    }
 
     auto self = static_pointer_cast<TCPPeer>(shared_from_this());
     getApp().getOverlayManager().removePeer(this);
@@ -32,13 +32,45 @@ class TCPPeer : public Peer
     std::vector<uint8_t> mIncomingBody;
 
     std::vector<asio::const_buffer> mWriteBuffers;
+    // Messages in mWriteQueue that mWriteBuffers points into.
+    size_t mWriteBatchSize{0};
+    // Copies of the small pieces of those messages, see messageSender.
+    std::vector<uint8_t> mCoalesceBuffer;
+    static constexpr size_t COALESCE_MAX_PIECE_SIZE = 4096;
+    static constexpr size_t COALESCE_BUFFER_KEEP_SIZE = 0x10000; // 64KB
     std::deque<TimestampedMessage> mWriteQueue;
     bool mWriting{false};
     bool mDelayedShutdown{false};
     bool mShutdownScheduled{false};
 
+    // With BACKGROUND_OVERLAY_PROCESSING, once the peer is authenticated (so
+    // its MAC key is fixed) message bodies are unmarshaled and their MACs
+    // checked on the overlay thread, in the order they were read. This is the
+    // receiving MAC state used there; once created, only the overlay thread
+    // touches it.
+    struct RecvMacState
+    {
+        HmacSha256Key mKey;
+        uint64_t mSeq{0};
+        bool mFailed{false};
+    };
+    std::shared_ptr<RecvMacState> mRecvMacState;
+
+    // Bodies handed to the overlay thread whose messages haven't come back to
+    // the main thread yet. Reading pauses while there are
+    // MAX_PENDING_DECODES of them, and resumes once half have come back.
+    static constexpr size_t MAX_PENDING_DECODES = 64;
+    size_t mPendingDecodes{0};
+    bool mReadPaused{false};
+
     void recvMessage();
+    void decodeOnOverlayThread();
+    void messageDecoded(std::shared_ptr<AuthenticatedMessage const> msg,
+                        ErrorCode errorCode, char const* error);
     void sendMessage(xdr::msg_ptr&& xdrBytes) override;
+    void sendMessage(AuthHeader const& header, SharedMessageBody const& body,
+                     HmacSha256Mac const& mac) override;
+    void enqueueMessage(TimestampedMessage&& msg);
 
     void messageSender();
 
@@ -0,0 +1,127 @@
+// Copyright 2022 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include "overlay/TxAdverts.h"
+#include "main/Application.h"
+#include "main/Config.h"
+#include "util/GlobalChecks.h"
+#include <Tracy.hpp>
+
+namespace stellar
+{
+
+TxAdverts::TxAdverts(Application& app)
+    : mApp(app), mAdvertTimer(app), mAdvertHistory(ADVERT_HISTORY_SIZE)
+{
+}
+
+void
+TxAdverts::start(std::function<void(StellarMessage const&)> send)
+{
+    releaseAssert(!mSend);
+    mSend = std::move(send);
+}
+
+void
+TxAdverts::shutdown()
+{
+    mAdvertTimer.cancel();
+    mSend = nullptr;
+}
+
+void
+TxAdverts::queueOutgoingAdvert(Hash const& txHash)
+{
+    if (!mSend)
+    {
+        return;
+    }
+    rememberHash(txHash);
+    if (mOutgoingTxHashes.empty())
+    {
+        mAdvertTimer.expires_from_now(
+            std::chrono::milliseconds(mApp.getConfig().FLOOD_ADVERT_PERIOD_MS));
+        mAdvertTimer.async_wait([this]() { flushAdvert(); },
+                                VirtualTimer::onFailureNoop);
+    }
+    mOutgoingTxHashes.emplace_back(txHash);
+    if (mOutgoingTxHashes.size() == TX_ADVERT_VECTOR_MAX_SIZE)
+    {
+        flushAdvert();
+    }
+}
+
+void
+TxAdverts::flushAdvert()
+{
+    ZoneScoped;
+    mAdvertTimer.cancel();
+    if (mOutgoingTxHashes.empty() || !mSend)
+    {
+        return;
+    }
+    StellarMessage msg;
+    msg.type(FLOOD_ADVERT);
+    msg.floodAdvert().txHashes = std::move(mOutgoingTxHashes);
+    mOutgoingTxHashes.clear();
+    mSend(msg);
+}
+
+void
+TxAdverts::queueIncomingAdvert(TxAdvertVector const& txHashes)
+{
+    for (auto const& h : txHashes)
+    {
+        rememberHash(h);
+        mIncomingTxHashes.emplace_back(h);
+    }
+    while (mIncomingTxHashes.size() > MAX_INCOMING_ADVERTS)
+    {
+        mIncomingTxHashes.pop_front();
+    }
+}
+
+bool
+TxAdverts::popIncomingAdvert(Hash& txHash)
+{
+    if (mIncomingTxHashes.empty())
+    {
+        return false;
+    }
+    txHash = mIncomingTxHashes.front();
+    mIncomingTxHashes.pop_front();
+    return true;
+}
+
+void
+TxAdverts::retryIncomingAdverts(std::vector<Hash> const& txHashes)
+{
+    mIncomingTxHashes.insert(mIncomingTxHashes.begin(), txHashes.begin(),
+                             txHashes.end());
+    while (mIncomingTxHashes.size() > MAX_INCOMING_ADVERTS)
+    {
+        mIncomingTxHashes.pop_front();
+    }
+}
+
+size_t
+TxAdverts::size() const
+{
+    return mIncomingTxHashes.size();
+}
+
+void
+TxAdverts::rememberHash(Hash const& txHash)
+{
+    // NOTE: false is used here as a placeholder value, since no value is
+    // needed.
+    mAdvertHistory.put(txHash, false);
+}
+
+bool
+TxAdverts::seenAdvert(Hash const& txHash)
+{
+    return mAdvertHistory.exists(txHash, false);
+}
+}
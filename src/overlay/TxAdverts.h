@@ -0,0 +1,77 @@
+#pragma once
+
+// Copyright 2022 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include "overlay/StellarXDR.h"
+#include "util/HashOfHash.h"
+#include "util/NonCopyable.h"
+#include "util/RandomEvictionCache.h"
+#include "util/Timer.h"
+
+#include <deque>
+#include <functional>
+
+namespace stellar
+{
+
+class Application;
+
+/**
+ * TxAdverts keeps the per-peer state of pull-mode transaction flooding, used
+ * with peers for which Peer::isPullModeEnabled():
+ *
+ *   - outgoing: hashes of transactions to advertise to the peer, sent as a
+ *     FLOOD_ADVERT once TX_ADVERT_VECTOR_MAX_SIZE of them are queued or
+ *     FLOOD_ADVERT_PERIOD_MS after the first one was;
+ *   - incoming: hashes the peer advertised to us, waiting for the
+ *     OverlayManager to decide whether to demand them (see
+ *     OverlayManagerImpl::demand);
+ *   - history: hashes the peer is known to have (it advertised them, or we did
+ *     to it), so that they aren't advertised to it again.
+ *
+ * Only used from the main thread.
+ */
+class TxAdverts : public NonMovableOrCopyable
+{
+  public:
+    // Incoming hashes beyond this many are dropped, oldest first.
+    static constexpr size_t MAX_INCOMING_ADVERTS =
+        10 * TX_ADVERT_VECTOR_MAX_SIZE;
+    static constexpr size_t ADVERT_HISTORY_SIZE = 50000;
+
+    explicit TxAdverts(Application& app);
+
+    // `send` is called with each FLOOD_ADVERT ready to go to the peer.
+    void start(std::function<void(StellarMessage const&)> send);
+    void shutdown();
+
+    void queueOutgoingAdvert(Hash const& txHash);
+    void queueIncomingAdvert(TxAdvertVector const& txHashes);
+
+    // Pops the oldest incoming hash; returns false if there is none.
+    bool popIncomingAdvert(Hash& txHash);
+    // Puts back hashes popped by popIncomingAdvert that should be looked at
+    // again later, ahead of any hash advertised since.
+    void retryIncomingAdverts(std::vector<Hash> const& txHashes);
+    size_t size() const;
+
+    void rememberHash(Hash const& txHash);
+    bool seenAdvert(Hash const& txHash);
+
+  private:
+    Application& mApp;
+    std::function<void(StellarMessage const&)> mSend;
+
+    TxAdvertVector mOutgoingTxHashes;
+    VirtualTimer mAdvertTimer;
+
+    std::deque<Hash> mIncomingTxHashes;
+
+    // NOTE: bool is used here as a placeholder, since no ValueType is needed.
+    RandomEvictionCache<Hash, bool> mAdvertHistory;
+
+    void flushAdvert();
+};
+}
@@ -2,6 +2,7 @@
 // under the Apache License, Version 2.0. See the COPYING file at the root
 // of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
 
+#include "crypto/BLAKE2.h"
 #include "herder/Herder.h"
 #include "herder/HerderImpl.h"
 #include "ledger/LedgerManager.h"
@@ -10,18 +11,26 @@
 #include "lib/catch.hpp"
 #include "main/Application.h"
 #include "main/Config.h"
+#include "overlay/Floodgate.h"
 #include "overlay/OverlayManager.h"
 #include "overlay/PeerDoor.h"
 #include "overlay/TCPPeer.h"
+#include "overlay/test/LoopbackPeer.h"
 #include "simulation/Simulation.h"
 #include "simulation/Topologies.h"
 #include "test/TestAccount.h"
+#include "test/TestUtils.h"
 #include "test/TxTests.h"
 #include "test/test.h"
+#include "transactions/TransactionFrameBase.h"
 #include "util/Logging.h"
 #include "util/Timer.h"
 #include "xdrpp/marshal.h"
 
+#include "medida/meter.h"
+#include "medida/counter.h"
+#include "medida/metrics_registry.h"
+
 namespace stellar
 {
 using namespace txtest;
@@ -353,4 +362,259 @@ TEST_CASE("Flooding", "[flood][overlay][acceptance]")
         }
     }
 }
+
+TEST_CASE("pull mode transaction flooding", "[flood][overlay]")
+{
+    VirtualClock clock;
+    auto cfg1 = getTestConfig(0);
+    auto cfg2 = getTestConfig(1);
+    bool pullMode = true;
+    SECTION("pull mode")
+    {
+    }
+    SECTION("initiator does not request pull mode")
+    {
+        pullMode = false;
+        cfg1.ENABLE_PULL_MODE = false;
+    }
+    SECTION("acceptor does not request pull mode")
+    {
+        pullMode = false;
+        cfg2.ENABLE_PULL_MODE = false;
+    }
+    auto app1 = createTestApplication(clock, cfg1);
+    auto app2 = createTestApplication(clock, cfg2);
+
+    LoopbackPeerConnection conn(*app1, *app2);
+    testutil::crankSome(clock);
+    REQUIRE(conn.getInitiator()->isAuthenticated());
+    REQUIRE(conn.getAcceptor()->isAuthenticated());
+    REQUIRE(conn.getInitiator()->isPullModeEnabled() == pullMode);
+    REQUIRE(conn.getAcceptor()->isPullModeEnabled() == pullMode);
+
+    auto floodMeter = [](Application& app, std::string const& name) {
+        return app.getMetrics()
+            .NewMeter({"overlay", "flood", name}, "message")
+            .count();
+    };
+
+    auto root = TestAccount::createRoot(*app1);
+    auto tx = root.tx({createAccount(
+        SecretKey::pseudoRandomForTesting().getPublicKey(), 10000000)});
+    REQUIRE(app1->getHerder().recvTransaction(tx) ==
+            TransactionQueue::AddResult::ADD_STATUS_PENDING);
+    REQUIRE(app1->getOverlayManager().broadcastMessage(tx->toStellarMessage()));
+    testutil::crankFor(clock, std::chrono::seconds(2));
+
+    REQUIRE(app2->getHerder().getMaxSeqInPendingTxs(root) == tx->getSeqNum());
+    if (pullMode)
+    {
+        REQUIRE(floodMeter(*app1, "advertised") == 1);
+        REQUIRE(floodMeter(*app1, "broadcast") == 0);
+        REQUIRE(floodMeter(*app2, "demanded") == 1);
+        REQUIRE(floodMeter(*app1, "fulfilled") == 1);
+    }
+    else
+    {
+        REQUIRE(floodMeter(*app1, "advertised") == 0);
+        REQUIRE(floodMeter(*app1, "broadcast") == 1);
+        REQUIRE(floodMeter(*app2, "demanded") == 0);
+    }
+    // app2 got the transaction from app1, so doesn't send it back
+    REQUIRE(floodMeter(*app2, "advertised") == 0);
+    REQUIRE(floodMeter(*app2, "broadcast") == 0);
+
+    if (pullMode)
+    {
+        // Demands for transactions we don't know are ignored
+        StellarMessage demand;
+        demand.type(FLOOD_DEMAND);
+        demand.floodDemand().txHashes.emplace_back(
+            HashUtils::pseudoRandomForTesting());
+        conn.getInitiator()->sendMessage(demand);
+        testutil::crankSome(clock);
+        REQUIRE(floodMeter(*app2, "unfulfilled") == 1);
+        REQUIRE(floodMeter(*app2, "fulfilled") == 0);
+        REQUIRE(conn.getInitiator()->isAuthenticated());
+    }
+
+    testutil::shutdownWorkScheduler(*app2);
+    testutil::shutdownWorkScheduler(*app1);
+}
+
+TEST_CASE("floodgate records", "[flood][overlay]")
+{
+    VirtualClock clock;
+    auto app1 = createTestApplication(clock, getTestConfig(0));
+    auto app2 = createTestApplication(clock, getTestConfig(1));
+    LoopbackPeerConnection conn(*app1, *app2);
+    testutil::crankSome(clock);
+    REQUIRE(conn.getInitiator()->isAuthenticated());
+    Peer::pointer peer = conn.getInitiator();
+
+    Floodgate gate(*app1);
+    auto& floodKnown =
+        app1->getMetrics().NewCounter({"overlay", "memory", "flood-known"});
+    auto makeMessage = [](uint32_t i) {
+        StellarMessage msg;
+        msg.type(SCP_MESSAGE);
+        msg.envelope().statement.slotIndex = i;
+        return msg;
+    };
+
+    auto msg1 = makeMessage(1);
+    Hash id1;
+    REQUIRE(gate.addRecord(msg1, peer, id1));
+    Hash id;
+    REQUIRE(!gate.addRecord(msg1, peer, id));
+    REQUIRE(id == id1);
+    REQUIRE(gate.getMessage(id1));
+    REQUIRE(gate.getPeersKnows(id1) == std::set<Peer::pointer>{peer});
+    // the peer sent it to us, so it isn't sent back
+    REQUIRE(!gate.broadcast(msg1, false));
+
+    auto msg2 = makeMessage(2);
+    Hash id2 = xdrBlake2(msg2);
+    REQUIRE(gate.getPeersKnows(id2).empty());
+    REQUIRE(gate.broadcast(msg2, false));
+    REQUIRE(gate.getPeersKnows(id2) == std::set<Peer::pointer>{peer});
+    REQUIRE(!gate.broadcast(msg2, false));
+    REQUIRE(gate.broadcast(msg2, true));
+    REQUIRE(floodKnown.count() == 2);
+
+    auto msg3 = makeMessage(3);
+    gate.updateRecord(msg2, msg3);
+    REQUIRE(!gate.getMessage(id2));
+    REQUIRE(gate.getPeersKnows(xdrBlake2(msg3)) ==
+            std::set<Peer::pointer>{peer});
+
+    // updating a record into one of a message already recorded merges them
+    auto msg4 = makeMessage(4);
+    REQUIRE(gate.addRecord(msg4, nullptr, id));
+    REQUIRE(floodKnown.count() == 3);
+    gate.updateRecord(msg3, msg4);
+    REQUIRE(!gate.getMessage(xdrBlake2(msg3)));
+    REQUIRE(floodKnown.count() == 2);
+    REQUIRE(gate.getPeersKnows(xdrBlake2(msg4)) ==
+            std::set<Peer::pointer>{peer});
+
+    // transactions are also looked up by their full hash, which pull mode
+    // advertises and demands
+    StellarMessage txMsg;
+    txMsg.type(TRANSACTION);
+    auto tx = TransactionFrameBase::makeTransactionFromWire(
+        app1->getNetworkID(), txMsg.transaction());
+    Hash txID;
+    REQUIRE(gate.addRecord(txMsg, peer, txID));
+    REQUIRE(gate.getTransaction(tx->getFullHash()) == gate.getMessage(txID));
+    REQUIRE(!gate.getTransaction(txID));
+    gate.forgetRecord(txID);
+    REQUIRE(!gate.getTransaction(tx->getFullHash()));
+
+    gate.forgetRecord(id1);
+    REQUIRE(!gate.getMessage(id1));
+    REQUIRE(floodKnown.count() == 1);
+
+    auto ledger = app1->getHerder().trackingConsensusLedgerIndex();
+    gate.clearBelow(ledger);
+    REQUIRE(gate.getMessage(xdrBlake2(msg4)));
+    gate.clearBelow(ledger + 1);
+    REQUIRE(!gate.getMessage(xdrBlake2(msg4)));
+    REQUIRE(floodKnown.count() == 0);
+
+    testutil::shutdownWorkScheduler(*app2);
+    testutil::shutdownWorkScheduler(*app1);
+}
+
+TEST_CASE("floodgate bench", "[bench][flood][!hide]")
+{
+    size_t const numPeers = 8;
+    size_t const txsPerLedger = 10000;
+    size_t const numLedgers = 10;
+
+    VirtualClock clock;
+    auto app = createTestApplication(clock, getTestConfig(0));
+    std::vector<Application::pointer> remotes;
+    std::vector<std::unique_ptr<LoopbackPeerConnection>> conns;
+    for (size_t i = 0; i < numPeers; ++i)
+    {
+        remotes.emplace_back(createTestApplication(
+            clock, getTestConfig(static_cast<int>(i + 1))));
+        conns.emplace_back(
+            std::make_unique<LoopbackPeerConnection>(*app, *remotes.back()));
+    }
+    testutil::crankSome(clock);
+    std::vector<Peer::pointer> peers;
+    for (auto const& conn : conns)
+    {
+        REQUIRE(conn->getInitiator()->isAuthenticated());
+        peers.emplace_back(conn->getInitiator());
+    }
+
+    std::vector<StellarMessage> msgs(txsPerLedger * numLedgers);
+    for (size_t i = 0; i < msgs.size(); ++i)
+    {
+        msgs[i].type(TRANSACTION);
+        msgs[i].transaction().v0().tx.seqNum = i;
+    }
+
+    // Records are kept for the last few ledgers, as the overlay does, so
+    // that each purge drops one generation while others are live.
+    uint32_t const keptLedgers = 3;
+    Floodgate gate(*app);
+    std::chrono::nanoseconds insertTime{0}, broadcastTime{0}, clearTime{0};
+    for (size_t l = 0; l < numLedgers; ++l)
+    {
+        auto start = std::chrono::steady_clock::now();
+        for (size_t i = l * txsPerLedger; i < (l + 1) * txsPerLedger; ++i)
+        {
+            // half of the peers send us every transaction
+            Hash id;
+            for (size_t p = 0; p < numPeers / 2; ++p)
+            {
+                gate.addRecord(msgs[i], peers[p], id);
+            }
+        }
+        auto inserted = std::chrono::steady_clock::now();
+        for (size_t i = l * txsPerLedger; i < (l + 1) * txsPerLedger; ++i)
+        {
+            // and it is sent to (or advertised to) the other half
+            REQUIRE(gate.broadcast(msgs[i], false));
+        }
+        auto broadcasted = std::chrono::steady_clock::now();
+        testutil::crankSome(clock);
+
+        auto ledger = app->getLedgerManager().getLastClosedLedgerNum() + 1;
+        closeLedgerOn(*app, ledger, static_cast<int>(l + 1), 1, 2020);
+        REQUIRE(app->getHerder().trackingConsensusLedgerIndex() == ledger);
+        auto closed = std::chrono::steady_clock::now();
+        if (ledger > keptLedgers)
+        {
+            gate.clearBelow(ledger - keptLedgers);
+        }
+        auto cleared = std::chrono::steady_clock::now();
+
+        insertTime += inserted - start;
+        broadcastTime += broadcasted - inserted;
+        clearTime += cleared - closed;
+    }
+    auto perTx = [&](std::chrono::nanoseconds t) {
+        return t.count() / static_cast<int64_t>(msgs.size());
+    };
+    LOG_INFO(DEFAULT_LOG,
+             "floodgate with {} peers, {} txs per ledger: insert {}ns per tx "
+             "({}ns per peer), broadcast {}ns per tx, purge {}us per ledger",
+             numPeers, txsPerLedger, perTx(insertTime),
+             perTx(insertTime) / static_cast<int64_t>(numPeers),
+             perTx(broadcastTime),
+             std::chrono::duration_cast<std::chrono::microseconds>(clearTime)
+                     .count() /
+                 static_cast<int64_t>(numLedgers));
+
+    for (auto const& remote : remotes)
+    {
+        testutil::shutdownWorkScheduler(*remote);
+    }
+    testutil::shutdownWorkScheduler(*app);
+}
 }
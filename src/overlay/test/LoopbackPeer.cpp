@@ -105,6 +105,10 @@ LoopbackPeer::drop(std::string const& reason, DropDirection direction, DropMode)
     mDropReason = reason;
     mState = CLOSING;
     mRecurringTimer.cancel();
+    if (mTxAdverts)
+    {
+        mTxAdverts->shutdown();
+    }
     getApp().getOverlayManager().removePeer(this);
 
     auto remote = mRemote.lock();
@@ -113,6 +113,8 @@ class LoopbackPeer : public Peer
     std::string getIP() const override;
 
     using Peer::sendAuth;
+    using Peer::sendMessage;
+    using Peer::recvMessage;
 
     friend class LoopbackPeerConnection;
 };
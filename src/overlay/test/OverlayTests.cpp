@@ -18,10 +18,12 @@
 #include "util/Logging.h"
 #include "util/Timer.h"
 
+#include "medida/histogram.h"
 #include "medida/meter.h"
 #include "medida/metrics_registry.h"
 #include "medida/timer.h"
 #include <fmt/format.h>
+#include <limits>
 #include <numeric>
 
 using namespace stellar;
@@ -902,6 +904,89 @@ TEST_CASE("drop peers who straggle", "[overlay][connections][straggler]")
     }
 }
 
+TEST_CASE("flow control", "[overlay][flowcontrol]")
+{
+    VirtualClock clock;
+    Config cfg1 = getTestConfig(0);
+    Config cfg2 = getTestConfig(1);
+    uint32_t const capacity = 20;
+    for (auto cfg : {&cfg1, &cfg2})
+    {
+        cfg->PEER_FLOOD_READING_CAPACITY = capacity;
+        cfg->FLOW_CONTROL_SEND_MORE_BATCH_SIZE = 5;
+    }
+
+    auto app1 = createTestApplication(clock, cfg1);
+    auto app2 = createTestApplication(clock, cfg2);
+
+    LoopbackPeerConnection conn(*app1, *app2);
+    testutil::crankSome(clock);
+    REQUIRE(conn.getInitiator()->isAuthenticated());
+    REQUIRE(conn.getAcceptor()->isAuthenticated());
+    REQUIRE(conn.getInitiator()->isFlowControlEnabled());
+    REQUIRE(conn.getAcceptor()->isFlowControlEnabled());
+
+    auto initiatorFC = conn.getInitiator()->getFlowControl();
+    auto acceptorFC = conn.getAcceptor()->getFlowControl();
+    REQUIRE(initiatorFC);
+    REQUIRE(acceptorFC);
+    // SCP traffic may already have used some of the capacity
+    REQUIRE(initiatorFC->getOutboundCapacity() <= capacity);
+    REQUIRE(acceptorFC->getInboundCapacity() <= capacity);
+
+    auto makeDemand = []() {
+        StellarMessage demand;
+        demand.type(FLOOD_DEMAND);
+        demand.floodDemand().txHashes.emplace_back(
+            HashUtils::pseudoRandomForTesting());
+        return demand;
+    };
+
+    SECTION("messages wait for capacity")
+    {
+        size_t const numMessages = 200;
+        for (size_t i = 0; i < numMessages; ++i)
+        {
+            conn.getInitiator()->sendMessage(makeDemand());
+        }
+        REQUIRE(initiatorFC->getOutboundCapacity() == 0);
+        REQUIRE(initiatorFC->getOutboundQueueSize() >=
+                numMessages - capacity);
+
+        auto& unfulfilled = app2->getMetrics().NewMeter(
+            {"overlay", "flood", "unfulfilled"}, "transaction");
+        auto start = clock.now();
+        while (unfulfilled.count() < numMessages &&
+               clock.now() < start + std::chrono::seconds(10))
+        {
+            clock.crank(false);
+            REQUIRE(acceptorFC->getMessagesInProcessing() <= capacity);
+        }
+        REQUIRE(unfulfilled.count() == numMessages);
+        REQUIRE(initiatorFC->getOutboundQueueSize() == 0);
+        REQUIRE(conn.getInitiator()->isAuthenticated());
+        REQUIRE(conn.getAcceptor()->isAuthenticated());
+        REQUIRE(app2->getMetrics()
+                    .NewMeter({"overlay", "send", "send-more"}, "message")
+                    .count() >= (numMessages - capacity) / 5);
+    }
+
+    SECTION("peer sending beyond its capacity is dropped")
+    {
+        // Bypass the initiator's flow control
+        for (uint32_t i = 0; i <= capacity; ++i)
+        {
+            conn.getAcceptor()->recvMessage(makeDemand());
+        }
+        testutil::crankSome(clock);
+        REQUIRE(!conn.getInitiator()->isConnected());
+        REQUIRE(!conn.getAcceptor()->isConnected());
+    }
+
+    testutil::shutdownWorkScheduler(*app2);
+    testutil::shutdownWorkScheduler(*app1);
+}
+
 TEST_CASE("reject peers with the same nodeid", "[overlay][connections]")
 {
     VirtualClock clock;
@@ -1211,6 +1296,84 @@ TEST_CASE("peer numfailures resets after good connection",
     REQUIRE(r.first.mNumFailures == 0);
 }
 
+TEST_CASE("TCP writes are batched", "[overlay]")
+{
+    auto networkID = sha256(getTestConfig().NETWORK_PASSPHRASE);
+    auto simulation =
+        std::make_shared<Simulation>(Simulation::OVER_TCP, networkID);
+
+    SIMULATION_CREATE_NODE(Node1);
+    SIMULATION_CREATE_NODE(Node2);
+
+    SCPQuorumSet qSet;
+    qSet.threshold = 1;
+    qSet.validators.push_back(vNode1NodeID);
+
+    auto app1 = simulation->addNode(vNode1SecretKey, qSet);
+    auto app2 = simulation->addNode(vNode2SecretKey, qSet);
+    simulation->addPendingConnection(vNode1NodeID, vNode2NodeID);
+    simulation->startAllNodes();
+    simulation->crankForAtLeast(std::chrono::seconds{4}, false);
+    REQUIRE(app1->getOverlayManager().getAuthenticatedPeersCount() == 1);
+
+    // Queue many small messages at once: the first one starts a write, and
+    // the others wait for it and are then written together.
+    auto& metrics1 = app1->getMetrics();
+    auto& writeMeter1 =
+        metrics1.NewMeter({"overlay", "async", "write"}, "call");
+    auto& messageMeter1 =
+        metrics1.NewMeter({"overlay", "message", "write"}, "message");
+    auto writesBefore = writeMeter1.count();
+    auto messagesBefore = messageMeter1.count();
+    auto peer =
+        app1->getOverlayManager().getAuthenticatedPeers().begin()->second;
+    size_t const numMessages = 100;
+    for (size_t i = 0; i < numMessages; ++i)
+    {
+        // The peer has no SCP state for that ledger, so doesn't answer.
+        peer->sendGetScpState(std::numeric_limits<uint32_t>::max());
+    }
+    simulation->crankUntil(
+        [&]() {
+            return messageMeter1.count() >= messagesBefore + numMessages;
+        },
+        std::chrono::seconds{10}, false);
+    simulation->crankForAtLeast(std::chrono::seconds{1}, false);
+    REQUIRE(metrics1.NewHistogram({"overlay", "async", "write-batch"}).max() >
+            1);
+    REQUIRE(writeMeter1.count() - writesBefore < numMessages);
+    REQUIRE(app1->getOverlayManager().getAuthenticatedPeersCount() == 1);
+
+    for (auto const& app : {app1, app2})
+    {
+        auto& metrics = app->getMetrics();
+        auto writes =
+            metrics.NewMeter({"overlay", "async", "write"}, "call").count();
+        auto& batches =
+            metrics.NewHistogram({"overlay", "async", "write-batch"});
+        REQUIRE(writes > 0);
+        REQUIRE(batches.count() == writes);
+        // the last write may still be in flight
+        REQUIRE(static_cast<int64_t>(batches.sum()) >=
+                metrics.NewMeter({"overlay", "message", "write"}, "message")
+                    .count());
+        // a message is never written from more than 3 buffers
+        REQUIRE(metrics.NewHistogram({"overlay", "async", "write-buffers"})
+                    .max() <= 3 * batches.max());
+        uint64_t depthCount = 0;
+        for (auto depth : {"1", "2-15", "16-127", "128-up"})
+        {
+            depthCount +=
+                metrics
+                    .NewTimer({"overlay", "async",
+                               std::string("write-depth-") + depth})
+                    .count();
+        }
+        REQUIRE(depthCount <= writes);
+        REQUIRE(depthCount + 1 >= writes);
+    }
+}
+
 TEST_CASE("peer is purged from database after few failures",
           "[overlay][acceptance]")
 {
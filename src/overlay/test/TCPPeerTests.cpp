@@ -2,9 +2,12 @@
 // under the Apache License, Version 2.0. See the COPYING file at the root
 // of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
 
+#include "herder/Herder.h"
 #include "lib/catch.hpp"
 #include "main/Application.h"
 #include "main/Config.h"
+#include "medida/metrics_registry.h"
+#include "medida/timer.h"
 #include "overlay/OverlayManager.h"
 #include "overlay/PeerBareAddress.h"
 #include "overlay/PeerDoor.h"
@@ -53,4 +56,53 @@ TEST_CASE("TCPPeer can communicate", "[overlay][acceptance]")
     REQUIRE(p1->isAuthenticated());
     s->stopAllNodes();
 }
+
+TEST_CASE("TCPPeer decodes messages off the main thread", "[overlay]")
+{
+    bool background = GENERATE(true, false);
+    Hash networkID = sha256(getTestConfig().NETWORK_PASSPHRASE);
+    Simulation::pointer s =
+        std::make_shared<Simulation>(Simulation::OVER_TCP, networkID);
+
+    auto v10SecretKey = SecretKey::fromSeed(sha256("v10"));
+    auto v11SecretKey = SecretKey::fromSeed(sha256("v11"));
+
+    // Neither node can externalize without the other's SCP messages.
+    SCPQuorumSet qset;
+    qset.threshold = 2;
+    qset.validators.push_back(v10SecretKey.getPublicKey());
+    qset.validators.push_back(v11SecretKey.getPublicKey());
+
+    Config cfg0 = s->newConfig();
+    Config cfg1 = s->newConfig();
+    cfg0.BACKGROUND_OVERLAY_PROCESSING = background;
+    cfg1.BACKGROUND_OVERLAY_PROCESSING = background;
+    auto n0 = s->addNode(v10SecretKey, qset, &cfg0);
+    auto n1 = s->addNode(v11SecretKey, qset, &cfg1);
+
+    s->addPendingConnection(v10SecretKey.getPublicKey(),
+                            v11SecretKey.getPublicKey());
+    s->startAllNodes();
+
+    int nLedgers = 3;
+    s->crankUntil([&]() { return s->haveAllExternalized(nLedgers + 1, 1); },
+                  2 * nLedgers * Herder::EXP_LEDGER_TIMESPAN_SECONDS, false);
+    REQUIRE(s->haveAllExternalized(nLedgers + 1, 1));
+
+    for (auto const& app : {n0, n1})
+    {
+        auto decoded = app->getMetrics()
+                           .NewTimer({"overlay", "recv", "decode"})
+                           .count();
+        if (background)
+        {
+            REQUIRE(decoded > 0);
+        }
+        else
+        {
+            REQUIRE(decoded == 0);
+        }
+    }
+    s->stopAllNodes();
+}
 }
@@ -371,6 +371,38 @@ FeeBumpTransactionFrame::insertKeysForTxApply(
     mInnerTx->insertKeysForTxApply(keys);
 }
 
+void
+FeeBumpTransactionFrame::insertSignaturesForTxApply(
+    AbstractLedgerTxn& ltx,
+    std::vector<PubKeyUtils::SignatureToVerify>& sigs) const
+{
+    // The outer signatures are only checked during validation; apply() only
+    // verifies those of the inner transaction.
+    mInnerTx->insertSignaturesForTxApply(ltx, sigs);
+}
+
+bool
+FeeBumpTransactionFrame::insertSignaturesForTxValidation(
+    AbstractLedgerTxn& ltxOuter, SequenceNumber current,
+    uint64_t lowerBoundCloseTimeOffset, uint64_t upperBoundCloseTimeOffset,
+    std::vector<PubKeyUtils::SignatureToVerify>& sigs)
+{
+    {
+        LedgerTxn ltx(ltxOuter);
+        if (!commonValidPreSeqNum(ltx))
+        {
+            return false;
+        }
+    }
+    // The outer signatures are checked before the inner transaction is.
+    insertSignaturesToVerify(ltxOuter, {getFeeSourceID()},
+                             mEnvelope.feeBump().signatures, getContentsHash(),
+                             sigs);
+    return mInnerTx->insertSignaturesForTxValidation(
+        ltxOuter, current, false, lowerBoundCloseTimeOffset,
+        upperBoundCloseTimeOffset, sigs);
+}
+
 void
 FeeBumpTransactionFrame::processFeeSeqNum(AbstractLedgerTxn& ltx,
                                           int64_t baseFee)
@@ -7,6 +7,7 @@
 #include "OperationFrame.h"
 #include "crypto/Hex.h"
 #include "crypto/SHA.h"
+#include "crypto/SecretKey.h"
 #include "crypto/SignerKey.h"
 #include "crypto/SignerKeyUtils.h"
 #include "database/Database.h"
@@ -718,6 +719,81 @@ TransactionFrame::insertKeysForTxApply(UnorderedSet<LedgerKey>& keys) const
     }
 }
 
+void
+TransactionFrame::insertSignaturesForTxApply(
+    AbstractLedgerTxn& ltx,
+    std::vector<PubKeyUtils::SignatureToVerify>& sigs) const
+{
+    ZoneScoped;
+    // Use the raw operations, as this may be called before mOperations is
+    // populated.
+    std::vector<AccountID> accountIDs{getSourceID()};
+    for (auto const& op : getRawOperations())
+    {
+        if (!op.sourceAccount)
+        {
+            continue;
+        }
+        auto opSourceID = toAccountID(*op.sourceAccount);
+        if (std::find(accountIDs.begin(), accountIDs.end(), opSourceID) ==
+            accountIDs.end())
+        {
+            accountIDs.emplace_back(opSourceID);
+        }
+    }
+
+    auto const& signatures = mEnvelope.type() == ENVELOPE_TYPE_TX_V0
+                                 ? mEnvelope.v0().signatures
+                                 : mEnvelope.v1().signatures;
+    insertSignaturesToVerify(ltx, accountIDs, signatures, getContentsHash(),
+                             sigs);
+}
+
+bool
+TransactionFrame::insertSignaturesForTxValidation(
+    AbstractLedgerTxn& ltxOuter, SequenceNumber current, bool chargeFee,
+    uint64_t lowerBoundCloseTimeOffset, uint64_t upperBoundCloseTimeOffset,
+    std::vector<PubKeyUtils::SignatureToVerify>& sigs)
+{
+    ZoneScoped;
+    mCachedAccount.reset();
+    {
+        // Same checks as commonValid makes before checkSignature; the results
+        // they set are reset by checkValid.
+        LedgerTxn ltx(ltxOuter);
+        if (!commonValidPreSeqNum(ltx, chargeFee, lowerBoundCloseTimeOffset,
+                                  upperBoundCloseTimeOffset))
+        {
+            return false;
+        }
+        auto header = ltx.loadHeader();
+        if (current == 0)
+        {
+            current = loadSourceAccount(ltx, header)
+                          .current()
+                          .data.account()
+                          .seqNum;
+        }
+        if (isBadSeq(header, current))
+        {
+            return false;
+        }
+    }
+    insertSignaturesForTxApply(ltxOuter, sigs);
+    return true;
+}
+
+bool
+TransactionFrame::insertSignaturesForTxValidation(
+    AbstractLedgerTxn& ltxOuter, SequenceNumber current,
+    uint64_t lowerBoundCloseTimeOffset, uint64_t upperBoundCloseTimeOffset,
+    std::vector<PubKeyUtils::SignatureToVerify>& sigs)
+{
+    return insertSignaturesForTxValidation(ltxOuter, current, true,
+                                           lowerBoundCloseTimeOffset,
+                                           upperBoundCloseTimeOffset, sigs);
+}
+
 void
 TransactionFrame::markResultFailed()
 {
@@ -186,6 +186,19 @@ class TransactionFrame : public TransactionFrameBase
     void
     insertKeysForFeeProcessing(UnorderedSet<LedgerKey>& keys) const override;
     void insertKeysForTxApply(UnorderedSet<LedgerKey>& keys) const override;
+    void insertSignaturesForTxApply(
+        AbstractLedgerTxn& ltx,
+        std::vector<PubKeyUtils::SignatureToVerify>& sigs) const override;
+    bool insertSignaturesForTxValidation(
+        AbstractLedgerTxn& ltxOuter, SequenceNumber current, bool chargeFee,
+        uint64_t lowerBoundCloseTimeOffset,
+        uint64_t upperBoundCloseTimeOffset,
+        std::vector<PubKeyUtils::SignatureToVerify>& sigs);
+    bool insertSignaturesForTxValidation(
+        AbstractLedgerTxn& ltxOuter, SequenceNumber current,
+        uint64_t lowerBoundCloseTimeOffset,
+        uint64_t upperBoundCloseTimeOffset,
+        std::vector<PubKeyUtils::SignatureToVerify>& sigs) override;
 
     // collect fee, consume sequence number
     void processFeeSeqNum(AbstractLedgerTxn& ltx, int64_t baseFee) override;
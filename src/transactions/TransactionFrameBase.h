@@ -15,6 +15,11 @@ class Application;
 class Database;
 class OperationFrame;
 
+namespace PubKeyUtils
+{
+struct SignatureToVerify;
+}
+
 class TransactionFrameBase;
 using TransactionFrameBasePtr = std::shared_ptr<TransactionFrameBase>;
 
@@ -56,6 +61,23 @@ class TransactionFrameBase
     insertKeysForFeeProcessing(UnorderedSet<LedgerKey>& keys) const = 0;
     virtual void insertKeysForTxApply(UnorderedSet<LedgerKey>& keys) const = 0;
 
+    // Append every (key, signature) pair over the contents hash that apply()
+    // is expected to verify, given the signers currently recorded in `ltx`.
+    // This is only a hint used to warm the signature-verification cache: it
+    // never affects the outcome of apply().
+    virtual void insertSignaturesForTxApply(
+        AbstractLedgerTxn& ltx,
+        std::vector<PubKeyUtils::SignatureToVerify>& sigs) const = 0;
+    // Same as above, for the signatures checked by checkValid() with the same
+    // arguments. Returns false if the checks that checkValid() makes before
+    // verifying signatures fail, in which case the signatures it would not
+    // get to are not appended.
+    virtual bool insertSignaturesForTxValidation(
+        AbstractLedgerTxn& ltx, SequenceNumber current,
+        uint64_t lowerBoundCloseTimeOffset,
+        uint64_t upperBoundCloseTimeOffset,
+        std::vector<PubKeyUtils::SignatureToVerify>& sigs) = 0;
+
     virtual void processFeeSeqNum(AbstractLedgerTxn& ltx, int64_t baseFee) = 0;
 
     virtual StellarMessage toStellarMessage() const = 0;
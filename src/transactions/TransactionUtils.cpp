@@ -5,12 +5,14 @@
 #include "transactions/TransactionUtils.h"
 #include "crypto/SHA.h"
 #include "crypto/SecretKey.h"
+#include "crypto/SignerKey.h"
 #include "ledger/InternalLedgerEntry.h"
 #include "ledger/LedgerTxn.h"
 #include "ledger/LedgerTxnEntry.h"
 #include "ledger/LedgerTxnHeader.h"
 #include "ledger/TrustLineWrapper.h"
 #include "transactions/OfferExchange.h"
+#include "transactions/SignatureUtils.h"
 #include "transactions/SponsorshipUtils.h"
 #include "util/XDROperators.h"
 #include "util/types.h"
@@ -271,6 +273,50 @@ loadAccountWithoutRecord(AbstractLedgerTxn& ltx, AccountID const& accountID)
     return ltx.loadWithoutRecord(accountKey(accountID));
 }
 
+void
+insertSignaturesToVerify(AbstractLedgerTxn& ltx,
+                         std::vector<AccountID> const& accountIDs,
+                         xdr::xvector<DecoratedSignature, 20> const& signatures,
+                         Hash const& contentsHash,
+                         std::vector<PubKeyUtils::SignatureToVerify>& sigs)
+{
+    ZoneScoped;
+    if (signatures.empty())
+    {
+        return;
+    }
+
+    auto insertMatching = [&](PublicKey const& key) {
+        for (auto const& sig : signatures)
+        {
+            if (SignatureUtils::doesHintMatch(key.ed25519(), sig.hint))
+            {
+                sigs.push_back({key, sig.signature, contentsHash});
+            }
+        }
+    };
+
+    for (auto const& accountID : accountIDs)
+    {
+        // The master key is checked even if the account does not exist (see
+        // TransactionFrame::checkSignatureNoAccount), so always consider it.
+        insertMatching(accountID);
+
+        auto account = loadAccountWithoutRecord(ltx, accountID);
+        if (!account)
+        {
+            continue;
+        }
+        for (auto const& signer : account.current().data.account().signers)
+        {
+            if (signer.key.type() == SIGNER_KEY_TYPE_ED25519)
+            {
+                insertMatching(KeyUtils::convertKey<PublicKey>(signer.key));
+            }
+        }
+    }
+}
+
 LedgerTxnEntry
 loadData(AbstractLedgerTxn& ltx, AccountID const& accountID,
          std::string const& dataName)
@@ -27,6 +27,11 @@ struct LedgerKey;
 struct TransactionEnvelope;
 struct MuxedAccount;
 
+namespace PubKeyUtils
+{
+struct SignatureToVerify;
+}
+
 template <typename IterType>
 std::pair<IterType, bool>
 findSignerByKey(IterType begin, IterType end, SignerKey const& key)
@@ -90,6 +95,15 @@ LedgerTxnEntry loadAccount(AbstractLedgerTxn& ltx, AccountID const& accountID);
 ConstLedgerTxnEntry loadAccountWithoutRecord(AbstractLedgerTxn& ltx,
                                              AccountID const& accountID);
 
+// Append to `sigs` each of `signatures` over `contentsHash`, paired with every
+// key whose hint it matches among the master keys and ed25519 signers of
+// `accountIDs` (which must not contain duplicates).
+void insertSignaturesToVerify(
+    AbstractLedgerTxn& ltx, std::vector<AccountID> const& accountIDs,
+    xdr::xvector<DecoratedSignature, 20> const& signatures,
+    Hash const& contentsHash,
+    std::vector<PubKeyUtils::SignatureToVerify>& sigs);
+
 LedgerTxnEntry loadData(AbstractLedgerTxn& ltx, AccountID const& accountID,
                         std::string const& dataName);
 
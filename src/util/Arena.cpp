@@ -0,0 +1,144 @@
+// Copyright 2022 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include "util/Arena.h"
+#include "util/GlobalChecks.h"
+
+#include <algorithm>
+#include <new>
+
+namespace stellar
+{
+
+namespace
+{
+std::atomic<uint64_t> gAllocations{0};
+std::atomic<uint64_t> gHeapAllocations{0};
+std::atomic<uint64_t> gBlockBytes{0};
+std::atomic<uint64_t> gRewinds{0};
+}
+
+void
+Arena::flushCounts(Counts& counts)
+{
+    counts.mAllocations = gAllocations.exchange(0);
+    counts.mHeapAllocations = gHeapAllocations.exchange(0);
+    counts.mBlockBytes = gBlockBytes.exchange(0);
+    counts.mRewinds = gRewinds.exchange(0);
+}
+
+void*
+Arena::allocate(size_t bytes, size_t alignment)
+{
+    releaseAssert(alignment <= alignof(std::max_align_t));
+    if (mLive.load(std::memory_order_acquire) == 0 && mCur != nullptr)
+    {
+        rewind();
+    }
+    gAllocations.fetch_add(1, std::memory_order_relaxed);
+
+    if (bytes <= MAX_ALLOCATION_SIZE && !mFull.load(std::memory_order_relaxed))
+    {
+        auto space = static_cast<size_t>(mEnd - mCur);
+        void* p = mCur;
+        if (mCur == nullptr || !std::align(alignment, bytes, p, space))
+        {
+            if (nextBlock(bytes))
+            {
+                p = mCur;
+            }
+            else
+            {
+                p = nullptr;
+            }
+        }
+        if (p != nullptr)
+        {
+            mCur = static_cast<char*>(p) + bytes;
+            mLive.fetch_add(1, std::memory_order_relaxed);
+            return p;
+        }
+    }
+
+    gHeapAllocations.fetch_add(1, std::memory_order_relaxed);
+    auto p = ::operator new(bytes);
+    mLive.fetch_add(1, std::memory_order_relaxed);
+    return p;
+}
+
+void
+Arena::deallocate(void* p, size_t bytes) noexcept
+{
+    bool fromHeap = bytes > MAX_ALLOCATION_SIZE ||
+                    (mFull.load(std::memory_order_acquire) && !inBlocks(p));
+    if (fromHeap)
+    {
+        ::operator delete(p);
+    }
+    mLive.fetch_sub(1, std::memory_order_release);
+}
+
+size_t
+Arena::getLiveAllocations() const
+{
+    return mLive.load(std::memory_order_relaxed);
+}
+
+size_t
+Arena::getBlockBytes() const
+{
+    return mBlockBytes;
+}
+
+bool
+Arena::nextBlock(size_t bytes)
+{
+    // Blocks are aligned for any type, so an allocation of at most
+    // MAX_ALLOCATION_SIZE bytes always fits at the start of one.
+    if (mBlockIndex + 1 < mBlocks.size())
+    {
+        auto& block = mBlocks[++mBlockIndex];
+        mCur = block.first.get();
+        mEnd = mCur + block.second;
+        return true;
+    }
+
+    auto size = mBlocks.empty()
+                    ? FIRST_BLOCK_SIZE
+                    : std::min(mBlocks.back().second * 2, MAX_BLOCK_SIZE);
+    if (mBlockBytes + size > MAX_SIZE)
+    {
+        mFull.store(true, std::memory_order_release);
+        return false;
+    }
+    releaseAssert(size >= bytes);
+    mBlocks.emplace_back(std::make_unique<char[]>(size), size);
+    mBlockIndex = mBlocks.size() - 1;
+    mBlockBytes += size;
+    gBlockBytes.fetch_add(size, std::memory_order_relaxed);
+    mCur = mBlocks.back().first.get();
+    mEnd = mCur + size;
+    return true;
+}
+
+bool
+Arena::inBlocks(void const* p) const
+{
+    auto c = static_cast<char const*>(p);
+    return std::any_of(mBlocks.begin(), mBlocks.end(), [c](auto const& b) {
+        return c >= b.first.get() && c < b.first.get() + b.second;
+    });
+}
+
+void
+Arena::rewind()
+{
+    // Nothing allocated is live, so no other thread can be deallocating.
+    gRewinds.fetch_add(1, std::memory_order_relaxed);
+    mBlockIndex = 0;
+    mCur = mBlocks.front().first.get();
+    mEnd = mCur + mBlocks.front().second;
+    mFull.store(false, std::memory_order_relaxed);
+}
+}
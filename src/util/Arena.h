@@ -0,0 +1,137 @@
+#pragma once
+
+// Copyright 2022 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include "util/NonCopyable.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace stellar
+{
+
+/**
+ * Arena is a monotonic allocator: allocations are carved out of large blocks
+ * one after the other, and deallocation only counts them down. Once no
+ * allocation is live anymore, the next one rewinds to the start of the first
+ * block, reusing all of them.
+ *
+ * Allocations larger than MAX_ALLOCATION_SIZE, and any allocation once the
+ * blocks add up to MAX_SIZE, are passed through to the heap instead.
+ *
+ * Allocating is only safe from one thread at a time; deallocating is safe
+ * from any thread. Alignments beyond std::max_align_t are not supported.
+ */
+class Arena : public NonMovableOrCopyable
+{
+  public:
+    static constexpr size_t FIRST_BLOCK_SIZE = 0x10000;
+    static constexpr size_t MAX_BLOCK_SIZE = 0x400000;
+    static constexpr size_t MAX_SIZE = 0x4000000;
+    static constexpr size_t MAX_ALLOCATION_SIZE = 0x1000;
+
+    // Process-wide counters of all arenas since the last flush.
+    struct Counts
+    {
+        uint64_t mAllocations{0};
+        uint64_t mHeapAllocations{0};
+        uint64_t mBlockBytes{0};
+        uint64_t mRewinds{0};
+    };
+    static void flushCounts(Counts& counts);
+
+    Arena() = default;
+
+    void* allocate(size_t bytes, size_t alignment);
+    void deallocate(void* p, size_t bytes) noexcept;
+
+    size_t getLiveAllocations() const;
+    size_t getBlockBytes() const;
+
+  private:
+    std::vector<std::pair<std::unique_ptr<char[]>, size_t>> mBlocks;
+    size_t mBlockIndex{0};
+    char* mCur{nullptr};
+    char* mEnd{nullptr};
+    size_t mBlockBytes{0};
+    std::atomic<size_t> mLive{0};
+    // set once small allocations started going to the heap, after which
+    // deallocate needs to tell them apart from those in the blocks
+    std::atomic<bool> mFull{false};
+
+    bool nextBlock(size_t bytes);
+    bool inBlocks(void const* p) const;
+    void rewind();
+};
+
+// Standard allocator allocating from an Arena, or from the heap when it has
+// none. Each copy keeps the arena alive, so that memory allocated from it
+// (for instance by std::allocate_shared) can outlive its other users.
+template <typename T> class ArenaAllocator
+{
+    static_assert(alignof(T) <= alignof(std::max_align_t));
+
+  public:
+    using value_type = T;
+
+    ArenaAllocator() noexcept = default;
+    explicit ArenaAllocator(std::shared_ptr<Arena> arena) noexcept
+        : mArena(std::move(arena))
+    {
+    }
+    template <typename U>
+    ArenaAllocator(ArenaAllocator<U> const& other) noexcept
+        : mArena(other.mArena)
+    {
+    }
+
+    T*
+    allocate(size_t n)
+    {
+        if (!mArena)
+        {
+            return std::allocator<T>().allocate(n);
+        }
+        return static_cast<T*>(mArena->allocate(n * sizeof(T), alignof(T)));
+    }
+
+    void
+    deallocate(T* p, size_t n) noexcept
+    {
+        if (!mArena)
+        {
+            std::allocator<T>().deallocate(p, n);
+            return;
+        }
+        mArena->deallocate(p, n * sizeof(T));
+    }
+
+    std::shared_ptr<Arena> const&
+    getArena() const
+    {
+        return mArena;
+    }
+
+    template <typename U>
+    bool
+    operator==(ArenaAllocator<U> const& other) const
+    {
+        return mArena == other.mArena;
+    }
+    template <typename U>
+    bool
+    operator!=(ArenaAllocator<U> const& other) const
+    {
+        return mArena != other.mArena;
+    }
+
+  private:
+    template <typename U> friend class ArenaAllocator;
+    std::shared_ptr<Arena> mArena;
+};
+}
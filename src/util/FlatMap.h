@@ -0,0 +1,639 @@
+#pragma once
+
+// Copyright 2022 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include "util/GlobalChecks.h"
+#include "util/RandHasher.h"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+namespace stellar
+{
+
+namespace flat
+{
+// HashTable stores its elements inline in a single array, and resolves
+// collisions by linear probing, so that a lookup usually touches a single
+// cache line of control bytes and a single element, rather than following
+// the node pointers of std::unordered_map.
+//
+// Each slot has a control byte: EMPTY, DELETED (a tombstone left by erase, so
+// that probe sequences going through the slot still work) or, for full slots,
+// 0x80 with 7 bits of the hash, checked before comparing keys.
+//
+// Compared to std::unordered_map:
+//  - Inserting may move every element (when the table grows), invalidating
+//    all iterators, pointers and references.
+//  - Erasing only invalidates iterators, pointers and references to the
+//    erased element, and does not throw.
+//  - Inserting has the strong exception safety guarantee, but the arguments
+//    it constructs the new element from must not refer to elements of the
+//    table.
+//  - Elements are stored as Access::stored_type, whose key isn't const so
+//    that growing the table can move it, and handed out through
+//    Access::reference, which only gives const access to the key. For maps
+//    that is a pair of references rather than a reference to a pair, so
+//    iterators are proxy iterators.
+template <typename Key, typename Access, typename Hasher, typename KeyEqual>
+class HashTable
+{
+    using Stored = typename Access::stored_type;
+
+    static constexpr uint8_t EMPTY = 0;
+    static constexpr uint8_t DELETED = 1;
+    static constexpr uint8_t FULL = 0x80;
+    static constexpr size_t MIN_CAPACITY = 16;
+
+    union Slot
+    {
+        Slot()
+        {
+        }
+        ~Slot()
+        {
+        }
+        Stored mValue;
+    };
+
+    std::unique_ptr<uint8_t[]> mCtrl;
+    std::unique_ptr<Slot[]> mSlots;
+    size_t mCapacity{0};
+    size_t mSize{0};
+    size_t mDeleted{0};
+
+    template <bool IsConst> class Iterator
+    {
+        friend class HashTable;
+        using TablePtr =
+            std::conditional_t<IsConst, HashTable const*, HashTable*>;
+        TablePtr mTable{nullptr};
+        size_t mIndex{0};
+
+        Iterator(TablePtr table, size_t index) : mTable(table), mIndex(index)
+        {
+        }
+
+        void
+        skipNonFull()
+        {
+            while (mIndex < mTable->mCapacity &&
+                   (mTable->mCtrl[mIndex] & FULL) == 0)
+            {
+                ++mIndex;
+            }
+        }
+
+      public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = typename Access::value_type;
+        using difference_type = std::ptrdiff_t;
+        using reference =
+            std::conditional_t<IsConst, typename Access::const_reference,
+                               typename Access::reference>;
+        // Holds the reference operator-> returns, which may be a temporary.
+        struct pointer
+        {
+            reference mRef;
+            std::remove_reference_t<reference>*
+            operator->()
+            {
+                return std::addressof(mRef);
+            }
+        };
+
+        Iterator() = default;
+        template <bool C = IsConst, typename = std::enable_if_t<C>>
+        Iterator(Iterator<false> const& other)
+            : mTable(other.mTable), mIndex(other.mIndex)
+        {
+        }
+
+        reference
+        operator*() const
+        {
+            using StoredRef =
+                std::conditional_t<IsConst, Stored const&, Stored&>;
+            return Access::ref(
+                static_cast<StoredRef>(mTable->mSlots[mIndex].mValue));
+        }
+        pointer
+        operator->() const
+        {
+            return pointer{**this};
+        }
+        Iterator&
+        operator++()
+        {
+            ++mIndex;
+            skipNonFull();
+            return *this;
+        }
+        Iterator
+        operator++(int)
+        {
+            auto res = *this;
+            ++*this;
+            return res;
+        }
+        bool
+        operator==(Iterator const& other) const
+        {
+            return mIndex == other.mIndex;
+        }
+        bool
+        operator!=(Iterator const& other) const
+        {
+            return mIndex != other.mIndex;
+        }
+
+        template <bool> friend class Iterator;
+    };
+
+  public:
+    using key_type = Key;
+    using value_type = typename Access::value_type;
+    using size_type = size_t;
+    using hasher = Hasher;
+    using key_equal = KeyEqual;
+    using iterator = Iterator<false>;
+    using const_iterator = Iterator<true>;
+
+    HashTable() = default;
+
+    HashTable(HashTable const& other)
+    {
+        if (other.mSize != 0)
+        {
+            HashTable tmp;
+            tmp.allocate(other.mCapacity);
+            for (size_t i = 0; i < other.mCapacity; ++i)
+            {
+                if ((other.mCtrl[i] & FULL) != 0)
+                {
+                    tmp.insertUnique(other.mSlots[i].mValue);
+                }
+            }
+            swap(tmp);
+        }
+    }
+
+    HashTable(HashTable&& other) noexcept
+    {
+        swap(other);
+    }
+
+    HashTable&
+    operator=(HashTable const& other)
+    {
+        if (this != &other)
+        {
+            HashTable tmp(other);
+            swap(tmp);
+        }
+        return *this;
+    }
+
+    HashTable&
+    operator=(HashTable&& other) noexcept
+    {
+        HashTable tmp(std::move(other));
+        swap(tmp);
+        return *this;
+    }
+
+    ~HashTable()
+    {
+        destroyAll();
+    }
+
+    void
+    swap(HashTable& other) noexcept
+    {
+        std::swap(mCtrl, other.mCtrl);
+        std::swap(mSlots, other.mSlots);
+        std::swap(mCapacity, other.mCapacity);
+        std::swap(mSize, other.mSize);
+        std::swap(mDeleted, other.mDeleted);
+    }
+
+    iterator
+    begin()
+    {
+        iterator it(this, 0);
+        it.skipNonFull();
+        return it;
+    }
+    const_iterator
+    begin() const
+    {
+        const_iterator it(this, 0);
+        it.skipNonFull();
+        return it;
+    }
+    iterator
+    end()
+    {
+        return iterator(this, mCapacity);
+    }
+    const_iterator
+    end() const
+    {
+        return const_iterator(this, mCapacity);
+    }
+
+    size_t
+    size() const
+    {
+        return mSize;
+    }
+    bool
+    empty() const
+    {
+        return mSize == 0;
+    }
+    size_t
+    capacity() const
+    {
+        return mCapacity;
+    }
+
+    iterator
+    find(Key const& key)
+    {
+        return iterator(this, findIndex(key));
+    }
+    const_iterator
+    find(Key const& key) const
+    {
+        return const_iterator(this, findIndex(key));
+    }
+    size_t
+    count(Key const& key) const
+    {
+        return findIndex(key) != mCapacity ? 1 : 0;
+    }
+
+    // Makes room for n elements without growing again.
+    void
+    reserve(size_t n)
+    {
+        auto capacity = capacityFor(n);
+        if (capacity > mCapacity)
+        {
+            rehash(capacity);
+        }
+    }
+
+    void
+    clear() noexcept
+    {
+        if (mSize + mDeleted == 0)
+        {
+            return;
+        }
+        destroyAll();
+        std::fill(mCtrl.get(), mCtrl.get() + mCapacity, EMPTY);
+        mSize = 0;
+        mDeleted = 0;
+    }
+
+    iterator
+    erase(const_iterator pos) noexcept
+    {
+        eraseIndex(pos.mIndex);
+        iterator it(this, pos.mIndex);
+        it.skipNonFull();
+        return it;
+    }
+    iterator
+    erase(iterator pos) noexcept
+    {
+        return erase(const_iterator(pos));
+    }
+    size_t
+    erase(Key const& key)
+    {
+        auto index = findIndex(key);
+        if (index == mCapacity)
+        {
+            return 0;
+        }
+        eraseIndex(index);
+        return 1;
+    }
+
+  protected:
+    // Inserts the element constructed from args... unless an element with
+    // key `key` already exists.
+    template <typename... Args>
+    std::pair<iterator, bool>
+    emplaceKey(Key const& key, Args&&... args)
+    {
+        auto index = findIndex(key);
+        if (index != mCapacity)
+        {
+            return {iterator(this, index), false};
+        }
+        // args may move from key, so hash it first
+        auto hash = Hasher()(key);
+        if ((mSize + mDeleted + 1) * 8 > mCapacity * 7)
+        {
+            // Clearing tombstones is enough if they are at least half of the
+            // used slots, since the load is then at most 7/16.
+            rehash(mCapacity != 0 && mDeleted >= mSize
+                       ? mCapacity
+                       : std::max(mCapacity * 2, MIN_CAPACITY));
+        }
+        index = freeIndexFor(hash);
+        new (&mSlots[index].mValue) Stored(std::forward<Args>(args)...);
+        if (mCtrl[index] == DELETED)
+        {
+            --mDeleted;
+        }
+        mCtrl[index] = controlByte(hash);
+        ++mSize;
+        return {iterator(this, index), true};
+    }
+
+  private:
+    static uint8_t
+    controlByte(size_t hash)
+    {
+        return static_cast<uint8_t>(
+            FULL | (hash >> (std::numeric_limits<size_t>::digits - 7)));
+    }
+
+    static size_t
+    capacityFor(size_t n)
+    {
+        size_t capacity = MIN_CAPACITY;
+        while (capacity * 7 < n * 8)
+        {
+            capacity *= 2;
+        }
+        return capacity;
+    }
+
+    size_t
+    findIndex(Key const& key) const
+    {
+        if (mSize == 0)
+        {
+            return mCapacity;
+        }
+        auto hash = Hasher()(key);
+        auto ctrl = controlByte(hash);
+        auto mask = mCapacity - 1;
+        for (auto index = hash & mask;; index = (index + 1) & mask)
+        {
+            auto c = mCtrl[index];
+            if (c == EMPTY)
+            {
+                return mCapacity;
+            }
+            if (c == ctrl &&
+                KeyEqual()(Access::key(mSlots[index].mValue), key))
+            {
+                return index;
+            }
+        }
+    }
+
+    size_t
+    freeIndexFor(size_t hash) const
+    {
+        auto mask = mCapacity - 1;
+        auto index = hash & mask;
+        while ((mCtrl[index] & FULL) != 0)
+        {
+            index = (index + 1) & mask;
+        }
+        return index;
+    }
+
+    // Inserts v, which is known not to be in the table yet, without growing.
+    void
+    insertUnique(Stored const& v)
+    {
+        auto hash = Hasher()(Access::key(v));
+        auto index = freeIndexFor(hash);
+        new (&mSlots[index].mValue) Stored(v);
+        mCtrl[index] = controlByte(hash);
+        ++mSize;
+    }
+
+    void
+    allocate(size_t capacity)
+    {
+        releaseAssert(capacity >= MIN_CAPACITY &&
+                      (capacity & (capacity - 1)) == 0);
+        mSlots = std::make_unique<Slot[]>(capacity);
+        mCtrl = std::make_unique<uint8_t[]>(capacity);
+        std::fill(mCtrl.get(), mCtrl.get() + capacity, EMPTY);
+        mCapacity = capacity;
+    }
+
+    void
+    rehash(size_t capacity)
+    {
+        HashTable tmp;
+        tmp.allocate(capacity);
+        for (size_t i = 0; i < mCapacity; ++i)
+        {
+            if ((mCtrl[i] & FULL) != 0)
+            {
+                auto& v = mSlots[i].mValue;
+                auto index = tmp.freeIndexFor(Hasher()(Access::key(v)));
+                // Only moves elements that can't throw while doing so, to
+                // keep the original table intact otherwise.
+                new (&tmp.mSlots[index].mValue)
+                    Stored(std::move_if_noexcept(v));
+                tmp.mCtrl[index] = mCtrl[i];
+                ++tmp.mSize;
+            }
+        }
+        swap(tmp);
+    }
+
+    void
+    eraseIndex(size_t index) noexcept
+    {
+        mSlots[index].mValue.~Stored();
+        --mSize;
+        auto mask = mCapacity - 1;
+        if (mCtrl[(index + 1) & mask] != EMPTY)
+        {
+            mCtrl[index] = DELETED;
+            ++mDeleted;
+            return;
+        }
+        // No probe sequence goes past an EMPTY slot, so the erased slot and
+        // the tombstones right before it can all become EMPTY.
+        mCtrl[index] = EMPTY;
+        for (index = (index - 1) & mask; mCtrl[index] == DELETED;
+             index = (index - 1) & mask)
+        {
+            mCtrl[index] = EMPTY;
+            --mDeleted;
+        }
+    }
+
+    void
+    destroyAll() noexcept
+    {
+        for (size_t i = 0; i < mCapacity; ++i)
+        {
+            if ((mCtrl[i] & FULL) != 0)
+            {
+                mSlots[i].mValue.~Stored();
+            }
+        }
+    }
+};
+
+template <typename K, typename V> struct MapAccess
+{
+    using value_type = std::pair<K const, V>;
+    using stored_type = std::pair<K, V>;
+    template <typename VV> struct Ref
+    {
+        K const& first;
+        VV& second;
+    };
+    using reference = Ref<V>;
+    using const_reference = Ref<V const>;
+
+    static reference
+    ref(stored_type& p)
+    {
+        return {p.first, p.second};
+    }
+    static const_reference
+    ref(stored_type const& p)
+    {
+        return {p.first, p.second};
+    }
+    static K const&
+    key(stored_type const& p)
+    {
+        return p.first;
+    }
+};
+
+template <typename K> struct SetAccess
+{
+    using value_type = K;
+    using stored_type = K;
+    using reference = K const&;
+    using const_reference = K const&;
+
+    static K const&
+    ref(K const& k)
+    {
+        return k;
+    }
+    static K const&
+    key(K const& k)
+    {
+        return k;
+    }
+};
+}
+
+// Open addressing replacement for UnorderedMap, with the same randomized
+// hashing. See flat::HashTable for how its guarantees differ from those of
+// std::unordered_map: it suits maps that are looked up often and whose
+// elements are not referred to across insertions.
+template <typename K, typename V, typename Hasher = std::hash<K>>
+class FlatMap : public flat::HashTable<K, flat::MapAccess<K, V>,
+                                       RandHasher<K, Hasher>, std::equal_to<K>>
+{
+    using Base = flat::HashTable<K, flat::MapAccess<K, V>,
+                                 RandHasher<K, Hasher>, std::equal_to<K>>;
+
+  public:
+    using mapped_type = V;
+    using typename Base::iterator;
+
+    // Like std::unordered_map::try_emplace, only constructs the value if key
+    // is not in the map yet.
+    template <typename KK, typename... Args>
+    std::pair<iterator, bool>
+    emplace(KK&& key, Args&&... args)
+    {
+        return this->emplaceKey(key, std::piecewise_construct,
+                                std::forward_as_tuple(std::forward<KK>(key)),
+                                std::forward_as_tuple(
+                                    std::forward<Args>(args)...));
+    }
+
+    std::pair<iterator, bool>
+    insert(std::pair<K const, V> const& kv)
+    {
+        return this->emplaceKey(kv.first, kv);
+    }
+
+    V&
+    operator[](K const& key)
+    {
+        return emplace(key).first->second;
+    }
+
+    V&
+    at(K const& key)
+    {
+        auto it = this->find(key);
+        if (it == this->end())
+        {
+            throw std::out_of_range("FlatMap::at");
+        }
+        return it->second;
+    }
+    V const&
+    at(K const& key) const
+    {
+        auto it = this->find(key);
+        if (it == this->end())
+        {
+            throw std::out_of_range("FlatMap::at");
+        }
+        return it->second;
+    }
+};
+
+// Open addressing replacement for UnorderedSet; see FlatMap.
+template <typename K, typename Hasher = std::hash<K>>
+class FlatSet : public flat::HashTable<K, flat::SetAccess<K>,
+                                       RandHasher<K, Hasher>, std::equal_to<K>>
+{
+    using Base = flat::HashTable<K, flat::SetAccess<K>, RandHasher<K, Hasher>,
+                                 std::equal_to<K>>;
+
+  public:
+    using typename Base::iterator;
+
+    template <typename KK>
+    std::pair<iterator, bool>
+    emplace(KK&& key)
+    {
+        return this->emplaceKey(key, std::forward<KK>(key));
+    }
+
+    std::pair<iterator, bool>
+    insert(K const& key)
+    {
+        return this->emplaceKey(key, key);
+    }
+};
+}
@@ -11,6 +11,7 @@
 #include <filesystem>
 #include <fmt/format.h>
 
+#include <algorithm>
 #include <map>
 #include <regex>
 #include <sstream>
@@ -31,6 +32,7 @@
 #include <io.h>
 #else
 #include <dirent.h>
+#include <sys/mman.h>
 #include <sys/resource.h>
 #include <sys/stat.h>
 #endif
@@ -427,6 +429,57 @@ size(std::string const& filename)
 
 #ifdef _WIN32
 
+MappedFile::MappedFile(std::string const& path)
+{
+    ZoneScoped;
+    // No access-pattern hint: FILE_FLAG_SEQUENTIAL_SCAN only affects cached
+    // ReadFile I/O, not faults on a mapped view.
+    HANDLE fh = ::CreateFile(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL,
+                             OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (fh == INVALID_HANDLE_VALUE)
+    {
+        FileSystemException::failWithGetLastError(
+            std::string("fs::MappedFile() failed on CreateFile(\"") + path +
+            std::string("\"): "));
+    }
+    LARGE_INTEGER sz;
+    if (GetFileSizeEx(fh, &sz) == FALSE)
+    {
+        ::CloseHandle(fh);
+        FileSystemException::failWithGetLastError(
+            "fs::MappedFile() failed on GetFileSizeEx(): ");
+    }
+    mSize = static_cast<size_t>(sz.QuadPart);
+    if (mSize == 0)
+    {
+        // Empty files can't be mapped.
+        ::CloseHandle(fh);
+        return;
+    }
+    HANDLE mh = ::CreateFileMapping(fh, NULL, PAGE_READONLY, 0, 0, NULL);
+    ::CloseHandle(fh);
+    if (mh == NULL)
+    {
+        FileSystemException::failWithGetLastError(
+            "fs::MappedFile() failed on CreateFileMapping(): ");
+    }
+    mData = static_cast<char const*>(::MapViewOfFile(mh, FILE_MAP_READ, 0, 0, 0));
+    ::CloseHandle(mh);
+    if (mData == nullptr)
+    {
+        FileSystemException::failWithGetLastError(
+            "fs::MappedFile() failed on MapViewOfFile(): ");
+    }
+}
+
+MappedFile::~MappedFile()
+{
+    if (mData)
+    {
+        ::UnmapViewOfFile(mData);
+    }
+}
+
 int
 getMaxConnections()
 {
@@ -436,6 +489,57 @@ getMaxConnections()
 }
 
 #else
+
+MappedFile::MappedFile(std::string const& path)
+{
+    ZoneScoped;
+    int fd;
+    while ((fd = ::open(path.c_str(), O_RDONLY)) == -1)
+    {
+        if (errno == EINTR)
+        {
+            continue;
+        }
+        FileSystemException::failWithErrno(std::string("fs::MappedFile(\"") +
+                                           path + "\") failed on open: ");
+    }
+    struct stat st;
+    if (::fstat(fd, &st) != 0)
+    {
+        ::close(fd);
+        FileSystemException::failWithErrno(
+            "fs::MappedFile() failed on fstat(): ");
+    }
+    mSize = static_cast<size_t>(st.st_size);
+    if (mSize == 0)
+    {
+        // Empty files can't be mapped.
+        ::close(fd);
+        return;
+    }
+    void* p = ::mmap(nullptr, mSize, PROT_READ, MAP_PRIVATE, fd, 0);
+    // The mapping holds its own reference to the file.
+    ::close(fd);
+    if (p == MAP_FAILED)
+    {
+        FileSystemException::failWithErrno(
+            "fs::MappedFile() failed on mmap(): ");
+    }
+    // Advice is only a hint: failures are harmless, so ignore them.
+    ::madvise(p, mSize, MADV_SEQUENTIAL);
+    size_t const prefetchSize = 1024 * 1024;
+    ::madvise(p, std::min(mSize, prefetchSize), MADV_WILLNEED);
+    mData = static_cast<char const*>(p);
+}
+
+MappedFile::~MappedFile()
+{
+    if (mData)
+    {
+        ::munmap(const_cast<char*>(mData), mSize);
+    }
+}
+
 int
 getMaxConnections()
 {
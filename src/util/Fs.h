@@ -4,6 +4,7 @@
 // under the Apache License, Version 2.0. See the COPYING file at the root
 // of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
 
+#include "util/NonCopyable.h"
 #include "util/asio.h"
 
 #include <filesystem>
@@ -83,6 +84,33 @@ size_t size(std::ifstream& ifs);
 
 size_t size(std::string const& path);
 
+// Read-only memory mapping of an entire file. On POSIX it is advised for
+// sequential access, with readahead of the first 1MiB; Win32 gets no hint.
+// Throws FileSystemException if the file can't be mapped.
+// The file must not be truncated while mapped; bucket files are immutable so
+// this is safe for them.
+class MappedFile : public NonMovableOrCopyable
+{
+    char const* mData{nullptr};
+    size_t mSize{0};
+
+  public:
+    explicit MappedFile(std::string const& path);
+    ~MappedFile();
+
+    char const*
+    data() const
+    {
+        return mData;
+    }
+
+    size_t
+    size() const
+    {
+        return mSize;
+    }
+};
+
 ////
 // Utility functions for constructing path names
 ////
@@ -0,0 +1,287 @@
+// Copyright 2022 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include "util/Gzip.h"
+#include "crypto/ByteSlice.h"
+#include "crypto/SHA.h"
+#include "util/FileSystemException.h"
+#include "util/Fs.h"
+#include <Tracy.hpp>
+#include <fmt/format.h>
+
+#include <fstream>
+#include <stdexcept>
+#include <vector>
+#include <zlib.h>
+
+namespace stellar
+{
+
+namespace
+{
+// Adds 16 to zlib's default window bits to read and write the gzip format
+// (header and CRC trailer) rather than a raw zlib stream.
+int const GZIP_WINDOW_BITS = 15 + 16;
+
+std::ifstream
+openInput(std::string const& in)
+{
+    std::ifstream ifs(in, std::ifstream::binary);
+    if (!ifs)
+    {
+        throw FileSystemException(
+            fmt::format(FMT_STRING("failed to open {} for reading"), in));
+    }
+    return ifs;
+}
+
+std::ofstream
+openOutput(std::string const& out)
+{
+    std::ofstream ofs(out, std::ofstream::binary | std::ofstream::trunc);
+    if (!ofs)
+    {
+        throw FileSystemException(
+            fmt::format(FMT_STRING("failed to open {} for writing"), out));
+    }
+    return ofs;
+}
+
+size_t
+readBlock(std::ifstream& ifs, std::vector<char>& buf, std::string const& in)
+{
+    ifs.read(buf.data(), buf.size());
+    if (ifs.bad())
+    {
+        throw FileSystemException(
+            fmt::format(FMT_STRING("failed to read {}"), in));
+    }
+    return static_cast<size_t>(ifs.gcount());
+}
+
+void
+writeBlock(std::ofstream& ofs, char const* data, size_t len,
+           std::string const& out)
+{
+    if (!ofs.write(data, len))
+    {
+        throw FileSystemException(
+            fmt::format(FMT_STRING("failed to write {}"), out));
+    }
+}
+
+void
+checkCancel(std::atomic<bool> const* cancel)
+{
+    if (cancel && *cancel)
+    {
+        throw std::runtime_error("gzip cancelled");
+    }
+}
+}
+
+void
+gzipFile(std::string const& in, std::string const& out,
+         std::atomic<bool> const* cancel)
+{
+    ZoneScoped;
+    auto ifs = openInput(in);
+    auto ofs = openOutput(out);
+    std::vector<char> inBuf(fs::bufsz());
+    std::vector<char> outBuf(fs::bufsz());
+
+    z_stream zs{};
+    if (deflateInit2(&zs, Z_DEFAULT_COMPRESSION, Z_DEFLATED, GZIP_WINDOW_BITS,
+                     8, Z_DEFAULT_STRATEGY) != Z_OK)
+    {
+        throw std::runtime_error("deflateInit2 failed");
+    }
+    try
+    {
+        int flush;
+        do
+        {
+            checkCancel(cancel);
+            size_t n = readBlock(ifs, inBuf, in);
+            flush = ifs.eof() ? Z_FINISH : Z_NO_FLUSH;
+            zs.next_in = reinterpret_cast<Bytef*>(inBuf.data());
+            zs.avail_in = static_cast<uInt>(n);
+            do
+            {
+                zs.next_out = reinterpret_cast<Bytef*>(outBuf.data());
+                zs.avail_out = static_cast<uInt>(outBuf.size());
+                if (deflate(&zs, flush) == Z_STREAM_ERROR)
+                {
+                    throw std::runtime_error("deflate failed");
+                }
+                writeBlock(ofs, outBuf.data(), outBuf.size() - zs.avail_out,
+                           out);
+            } while (zs.avail_out == 0);
+        } while (flush != Z_FINISH);
+    }
+    catch (...)
+    {
+        deflateEnd(&zs);
+        throw;
+    }
+    deflateEnd(&zs);
+
+    ofs.close();
+    if (!ofs)
+    {
+        throw FileSystemException(
+            fmt::format(FMT_STRING("failed to close {}"), out));
+    }
+}
+
+struct GunzipInputStream::Impl
+{
+    std::string const mIn;
+    std::ifstream mIfs;
+    std::vector<char> mInBuf;
+    z_stream mZs{};
+    bool mInMember{false};
+    bool mSawMember{false};
+    bool mEof{false};
+
+    std::string const mTeeOut;
+    std::ofstream mTee;
+    SHA256* const mHasher;
+    std::atomic<bool> const* const mCancel;
+
+    Impl(std::string const& in, std::string const& teeOut, SHA256* hasher,
+         std::atomic<bool> const* cancel)
+        : mIn(in)
+        , mIfs(openInput(in))
+        , mInBuf(fs::bufsz())
+        , mTeeOut(teeOut)
+        , mHasher(hasher)
+        , mCancel(cancel)
+    {
+        if (!mTeeOut.empty())
+        {
+            mTee = openOutput(mTeeOut);
+        }
+        // 32 added to the window bits enables gzip header detection.
+        if (inflateInit2(&mZs, 15 + 32) != Z_OK)
+        {
+            throw std::runtime_error("inflateInit2 failed");
+        }
+    }
+
+    ~Impl()
+    {
+        inflateEnd(&mZs);
+    }
+
+    void
+    tee(char const* data, size_t len)
+    {
+        if (mTee.is_open())
+        {
+            writeBlock(mTee, data, len, mTeeOut);
+        }
+        if (mHasher)
+        {
+            mHasher->add(ByteSlice(data, len));
+        }
+    }
+};
+
+GunzipInputStream::GunzipInputStream(std::string const& in,
+                                     std::string const& teeOut, SHA256* hasher,
+                                     std::atomic<bool> const* cancel)
+    : mImpl(std::make_unique<Impl>(in, teeOut, hasher, cancel))
+{
+}
+
+GunzipInputStream::~GunzipInputStream()
+{
+}
+
+size_t
+GunzipInputStream::read(char* buf, size_t len)
+{
+    ZoneScoped;
+    auto& zs = mImpl->mZs;
+    size_t got = 0;
+    while (got < len && !mImpl->mEof)
+    {
+        if (zs.avail_in == 0)
+        {
+            checkCancel(mImpl->mCancel);
+            size_t n = readBlock(mImpl->mIfs, mImpl->mInBuf, mImpl->mIn);
+            if (n == 0)
+            {
+                if (mImpl->mInMember || !mImpl->mSawMember)
+                {
+                    throw std::runtime_error(fmt::format(
+                        FMT_STRING("truncated gzip file {}"), mImpl->mIn));
+                }
+                mImpl->mEof = true;
+                break;
+            }
+            zs.next_in = reinterpret_cast<Bytef*>(mImpl->mInBuf.data());
+            zs.avail_in = static_cast<uInt>(n);
+        }
+        if (!mImpl->mInMember)
+        {
+            // Start of the next gzip member.
+            inflateReset(&zs);
+            mImpl->mInMember = true;
+            mImpl->mSawMember = true;
+        }
+        zs.next_out = reinterpret_cast<Bytef*>(buf + got);
+        zs.avail_out = static_cast<uInt>(len - got);
+        int ret = inflate(&zs, Z_NO_FLUSH);
+        if (ret != Z_OK && ret != Z_STREAM_END && ret != Z_BUF_ERROR)
+        {
+            throw std::runtime_error(
+                fmt::format(FMT_STRING("corrupt gzip file {}: {}"), mImpl->mIn,
+                            zs.msg ? zs.msg : "inflate failed"));
+        }
+        size_t produced = (len - got) - zs.avail_out;
+        mImpl->tee(buf + got, produced);
+        got += produced;
+        if (ret == Z_STREAM_END)
+        {
+            mImpl->mInMember = false;
+        }
+    }
+    return got;
+}
+
+bool
+GunzipInputStream::eof() const
+{
+    return mImpl->mEof;
+}
+
+void
+GunzipInputStream::finish()
+{
+    ZoneScoped;
+    std::vector<char> buf(fs::bufsz());
+    while (read(buf.data(), buf.size()) != 0)
+    {
+    }
+    if (mImpl->mTee.is_open())
+    {
+        mImpl->mTee.close();
+        if (!mImpl->mTee)
+        {
+            throw FileSystemException(fmt::format(
+                FMT_STRING("failed to close {}"), mImpl->mTeeOut));
+        }
+    }
+}
+
+void
+gunzipFile(std::string const& in, std::string const& out, SHA256* hasher,
+           std::atomic<bool> const* cancel)
+{
+    ZoneScoped;
+    GunzipInputStream(in, out, hasher, cancel).finish();
+}
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+// Copyright 2022 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include "util/NonCopyable.h"
+
+#include <atomic>
+#include <memory>
+#include <string>
+
+namespace stellar
+{
+
+class SHA256;
+
+// In-process, streaming replacements for `gzip -c` and `gzip -dc`, built on
+// zlib. Both read and write in fs::bufsz() blocks, (over)write `out`, leave
+// `in` in place, and throw on I/O errors, on corrupt or truncated input, or if
+// `cancel` becomes true between blocks. On failure `out` may be left partially
+// written.
+
+void gzipFile(std::string const& in, std::string const& out,
+              std::atomic<bool> const* cancel = nullptr);
+
+// Decompresses every gzip member of `in`, one after the other, as gzip does.
+// If `hasher` is non-null the decompressed bytes are also added to it.
+void gunzipFile(std::string const& in, std::string const& out,
+                SHA256* hasher = nullptr,
+                std::atomic<bool> const* cancel = nullptr);
+
+// Decompresses a gzip file incrementally, for callers that want to look at
+// the contents as they're decompressed rather than after landing them on disk
+// (see XDRInputGunzipStream). Every decompressed byte is also written to
+// `teeOut`, unless it is empty, and added to `hasher`, unless it is null.
+// gunzipFile is a GunzipInputStream read to the end.
+class GunzipInputStream : public NonMovableOrCopyable
+{
+    struct Impl;
+    std::unique_ptr<Impl> mImpl;
+
+  public:
+    GunzipInputStream(std::string const& in, std::string const& teeOut = "",
+                      SHA256* hasher = nullptr,
+                      std::atomic<bool> const* cancel = nullptr);
+    ~GunzipInputStream();
+
+    // Returns the number of bytes decompressed into `buf`, which is less than
+    // `len` only at the end of the input. Throws like gunzipFile.
+    size_t read(char* buf, size_t len);
+
+    bool eof() const;
+
+    // Decompresses (and tees) whatever is left, then closes `teeOut`.
+    void finish();
+};
+}
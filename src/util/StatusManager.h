@@ -19,6 +19,7 @@ enum class StatusCategory
     HISTORY_PUBLISH,
     NTP,
     REQUIRES_UPGRADES,
+    BUCKETLIST_CONSISTENCY_CHECK,
     COUNT
 };
 
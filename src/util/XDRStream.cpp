@@ -0,0 +1,62 @@
+// Copyright 2022 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include "util/XDRStream.h"
+#include "util/Gzip.h"
+
+namespace stellar
+{
+
+XDRInputGunzipStream::XDRInputGunzipStream(std::string const& filename,
+                                           std::string const& teeOut,
+                                           SHA256* hasher,
+                                           std::atomic<bool> const* cancel,
+                                           unsigned int sizeLimit)
+    : mIn(std::make_unique<GunzipInputStream>(filename, teeOut, hasher,
+                                              cancel))
+    , mSizeLimit{sizeLimit}
+{
+}
+
+XDRInputGunzipStream::~XDRInputGunzipStream() = default;
+
+XDRInputGunzipStream::operator bool() const
+{
+    return !mIn->eof();
+}
+
+void
+XDRInputGunzipStream::finish()
+{
+    mIn->finish();
+}
+
+bool
+XDRInputGunzipStream::readRecord(uint32_t& sz)
+{
+    char szBuf[4];
+    size_t n = mIn->read(szBuf, 4);
+    if (n == 0)
+    {
+        return false;
+    }
+    if (n < 4)
+    {
+        throw xdr::xdr_runtime_error("malformed XDR file");
+    }
+    if (!readXDRRecordSize(szBuf, mSizeLimit, sz))
+    {
+        return false;
+    }
+    if (sz > mBuf.size())
+    {
+        mBuf.resize(sz);
+    }
+    if (mIn->read(mBuf.data(), sz) != sz)
+    {
+        throw xdr::xdr_runtime_error("malformed XDR file");
+    }
+    return true;
+}
+}
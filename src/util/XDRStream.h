@@ -13,7 +13,9 @@
 #include "xdrpp/marshal.h"
 #include <Tracy.hpp>
 
+#include <atomic>
 #include <fstream>
+#include <memory>
 #include <string>
 #include <vector>
 #ifdef _WIN32
@@ -23,9 +25,33 @@
 namespace stellar
 {
 
+class GunzipInputStream;
+
+// Reads the 4-byte size that precedes each XDR object in a file: big-endian,
+// with the XDR 'continuation' bit cleared (high bit of high byte). Returns
+// false if the size exceeds `sizeLimit`, unless that is 0.
+inline bool
+readXDRRecordSize(char const* szBuf, size_t sizeLimit, uint32_t& sz)
+{
+    sz = 0;
+    sz |= static_cast<uint8_t>(szBuf[0] & '\x7f');
+    sz <<= 8;
+    sz |= static_cast<uint8_t>(szBuf[1]);
+    sz <<= 8;
+    sz |= static_cast<uint8_t>(szBuf[2]);
+    sz <<= 8;
+    sz |= static_cast<uint8_t>(szBuf[3]);
+
+    return sizeLimit == 0 || sz <= sizeLimit;
+}
+
 /**
  * Helper for loading a sequence of XDR objects from a file one at a time,
  * rather than all at once.
+ *
+ * When opened with `useMmap`, the file is memory-mapped (see fs::MappedFile)
+ * and objects are unmarshaled directly out of the mapping, avoiding a read
+ * syscall and a copy through the intermediate buffer per object.
  */
 class XDRInputFileStream
 {
@@ -33,6 +59,14 @@ class XDRInputFileStream
     std::vector<char> mBuf;
     size_t mSizeLimit;
     size_t mSize;
+    std::unique_ptr<fs::MappedFile> mMapped;
+    size_t mMappedPos{0};
+
+    bool
+    readSize(char const* szBuf, uint32_t& sz) const
+    {
+        return readXDRRecordSize(szBuf, mSizeLimit, sz);
+    }
 
   public:
     XDRInputFileStream(unsigned int sizeLimit = 0)
@@ -45,12 +79,21 @@ class XDRInputFileStream
     {
         ZoneScoped;
         mIn.close();
+        mMapped.reset();
+        mMappedPos = 0;
     }
 
     void
-    open(std::string const& filename)
+    open(std::string const& filename, bool useMmap = false)
     {
         ZoneScoped;
+        if (useMmap)
+        {
+            mMapped = std::make_unique<fs::MappedFile>(filename);
+            mMappedPos = 0;
+            mSize = mMapped->size();
+            return;
+        }
         mIn.open(filename, std::ifstream::binary);
         if (!mIn)
         {
@@ -67,6 +110,10 @@ class XDRInputFileStream
 
     operator bool() const
     {
+        if (mMapped)
+        {
+            return mMappedPos < mSize;
+        }
         return mIn.good();
     }
 
@@ -79,34 +126,107 @@ class XDRInputFileStream
     size_t
     pos()
     {
+        if (mMapped)
+        {
+            return mMappedPos;
+        }
         releaseAssertOrThrow(!mIn.fail());
 
         return mIn.tellg();
     }
 
-    template <typename T>
+    // Repositions the stream at byte offset `pos`, clearing any EOF state
+    // left over from a previous read.
+    void
+    seek(size_t pos)
+    {
+        if (mMapped)
+        {
+            releaseAssertOrThrow(pos <= mSize);
+            mMappedPos = pos;
+            return;
+        }
+        mIn.clear();
+        mIn.seekg(pos);
+        releaseAssertOrThrow(!mIn.fail());
+    }
+
+    // Advances past the next object without unmarshaling it. Returns false at
+    // end of stream.
     bool
-    readOne(T& out)
+    skipOne()
     {
         ZoneScoped;
+        uint32_t sz = 0;
+        if (mMapped)
+        {
+            if (mSize - mMappedPos < 4)
+            {
+                mMappedPos = mSize;
+                return false;
+            }
+            if (!readSize(mMapped->data() + mMappedPos, sz))
+            {
+                return false;
+            }
+            if (mSize - mMappedPos - 4 < sz)
+            {
+                throw xdr::xdr_runtime_error("malformed XDR file");
+            }
+            mMappedPos += 4 + sz;
+            return true;
+        }
+
         char szBuf[4];
         if (!mIn.read(szBuf, 4))
         {
             return false;
         }
+        if (!readSize(szBuf, sz))
+        {
+            return false;
+        }
+        if (!mIn.seekg(sz, std::ios_base::cur))
+        {
+            throw xdr::xdr_runtime_error("malformed XDR file");
+        }
+        return true;
+    }
 
-        // Read 4 bytes of size, big-endian, with XDR 'continuation' bit cleared
-        // (high bit of high byte).
+    template <typename T>
+    bool
+    readOne(T& out)
+    {
+        ZoneScoped;
         uint32_t sz = 0;
-        sz |= static_cast<uint8_t>(szBuf[0] & '\x7f');
-        sz <<= 8;
-        sz |= static_cast<uint8_t>(szBuf[1]);
-        sz <<= 8;
-        sz |= static_cast<uint8_t>(szBuf[2]);
-        sz <<= 8;
-        sz |= static_cast<uint8_t>(szBuf[3]);
-
-        if (mSizeLimit != 0 && sz > mSizeLimit)
+        if (mMapped)
+        {
+            if (mSize - mMappedPos < 4)
+            {
+                mMappedPos = mSize;
+                return false;
+            }
+            char const* p = mMapped->data() + mMappedPos;
+            if (!readSize(p, sz))
+            {
+                return false;
+            }
+            if (mSize - mMappedPos - 4 < sz)
+            {
+                throw xdr::xdr_runtime_error("malformed XDR file");
+            }
+            xdr::xdr_get g(p + 4, p + 4 + sz);
+            xdr::xdr_argpack_archive(g, out);
+            mMappedPos += 4 + sz;
+            return true;
+        }
+
+        char szBuf[4];
+        if (!mIn.read(szBuf, 4))
+        {
+            return false;
+        }
+        if (!readSize(szBuf, sz))
         {
             return false;
         }
@@ -124,6 +244,51 @@ class XDRInputFileStream
     }
 };
 
+/**
+ * Reads a sequence of XDR objects, framed as by XDROutputFileStream, out of a
+ * gzipped file as it is decompressed, so that a downloaded file can be checked
+ * without first being gunzipped to disk and read back. `teeOut`, `hasher` and
+ * `cancel` are passed to GunzipInputStream; callers that stop reading early
+ * should call `finish` to get the rest of the file teed.
+ */
+class XDRInputGunzipStream
+{
+    std::unique_ptr<GunzipInputStream> mIn;
+    std::vector<char> mBuf;
+    size_t mSizeLimit;
+
+    // Reads the next object into mBuf and returns its size through `sz`.
+    // Returns false at end of stream.
+    bool readRecord(uint32_t& sz);
+
+  public:
+    XDRInputGunzipStream(std::string const& filename,
+                         std::string const& teeOut = "",
+                         SHA256* hasher = nullptr,
+                         std::atomic<bool> const* cancel = nullptr,
+                         unsigned int sizeLimit = 0);
+    ~XDRInputGunzipStream();
+
+    operator bool() const;
+
+    void finish();
+
+    template <typename T>
+    bool
+    readOne(T& out)
+    {
+        ZoneScoped;
+        uint32_t sz = 0;
+        if (!readRecord(sz))
+        {
+            return false;
+        }
+        xdr::xdr_get g(mBuf.data(), mBuf.data() + sz);
+        xdr::xdr_argpack_archive(g, out);
+        return true;
+    }
+};
+
 // XDROutputFileStream needs access to a file descriptor to do fsync, so we use
 // asio's synchronous stream types here rather than fstreams.
 class XDROutputFileStream
@@ -305,22 +470,37 @@ class XDROutputFileStream
         xdr::xdr_put p(mBuf.data() + 4, mBuf.data() + 4 + sz);
         xdr_argpack_archive(p, t);
 
-        size_t const to_write = sz + 4;
+        writeBytes(mBuf.data(), sz + 4, hasher, bytesPut);
+    }
+
+    // Writes `len` bytes that are already XDR-framed (such as the contents of
+    // another file written by an XDROutputFileStream).
+    void
+    writeBytes(char const* buf, size_t len, SHA256* hasher = nullptr,
+               size_t* bytesPut = nullptr)
+    {
+        ZoneScoped;
+        if (!isOpen())
+        {
+            FileSystemException::failWith(
+                "XDROutputFileStream::writeBytes() on non-open stream");
+        }
+
         size_t written = 0;
-        while (written < to_write)
+        while (written < len)
         {
 #ifdef WIN32
-            auto w = fwrite(mBuf.data() + written, 1, to_write - written, mOut);
+            auto w = fwrite(buf + written, 1, len - written, mOut);
             if (w == 0)
             {
                 FileSystemException::failWith(
-                    std::string("XDROutputFileStream::writeOne() failed"));
+                    std::string("XDROutputFileStream::writeBytes() failed"));
             }
             written += w;
 #else
             asio::error_code ec;
-            auto buf = asio::buffer(mBuf.data() + written, to_write - written);
-            written += asio::write(mBufferedWriteStream, buf, ec);
+            auto abuf = asio::buffer(buf + written, len - written);
+            written += asio::write(mBufferedWriteStream, abuf, ec);
             if (ec)
             {
                 if (ec == asio::error::interrupted)
@@ -331,7 +511,7 @@ class XDROutputFileStream
                 {
                     FileSystemException::failWith(
                         std::string(
-                            "XDROutputFileStream::writeOne() failed: ") +
+                            "XDROutputFileStream::writeBytes() failed: ") +
                         ec.message());
                 }
             }
@@ -339,11 +519,11 @@ class XDROutputFileStream
         }
         if (hasher)
         {
-            hasher->add(ByteSlice(mBuf.data(), sz + 4));
+            hasher->add(ByteSlice(buf, len));
         }
         if (bytesPut)
         {
-            *bytesPut += (sz + 4);
+            *bytesPut += len;
         }
     }
 };
@@ -0,0 +1,151 @@
+// Copyright 2022 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include "lib/catch.hpp"
+#include "util/Arena.h"
+#include <cstring>
+#include <unordered_map>
+#include <vector>
+
+using namespace stellar;
+
+TEST_CASE("arena allocates from blocks and rewinds", "[arena]")
+{
+    Arena::Counts counts;
+    Arena::flushCounts(counts);
+
+    Arena arena;
+    std::vector<void*> ptrs;
+    for (size_t i = 0; i < 100; ++i)
+    {
+        auto p = arena.allocate(24, alignof(std::max_align_t));
+        REQUIRE(reinterpret_cast<uintptr_t>(p) % alignof(std::max_align_t) ==
+                0);
+        std::memset(p, static_cast<int>(i), 24);
+        ptrs.emplace_back(p);
+    }
+    REQUIRE(arena.getLiveAllocations() == 100);
+    REQUIRE(arena.getBlockBytes() == Arena::FIRST_BLOCK_SIZE);
+    for (size_t i = 0; i < ptrs.size(); ++i)
+    {
+        REQUIRE(static_cast<unsigned char*>(ptrs[i])[23] == i);
+    }
+
+    // Too large for the arena
+    auto large = arena.allocate(Arena::MAX_ALLOCATION_SIZE + 1, 8);
+    REQUIRE(arena.getLiveAllocations() == 101);
+
+    Arena::flushCounts(counts);
+    REQUIRE(counts.mAllocations == 101);
+    REQUIRE(counts.mHeapAllocations == 1);
+    REQUIRE(counts.mBlockBytes == Arena::FIRST_BLOCK_SIZE);
+    REQUIRE(counts.mRewinds == 0);
+
+    SECTION("no rewind while allocations are live")
+    {
+        arena.deallocate(ptrs.back(), 24);
+        auto p = arena.allocate(24, 8);
+        REQUIRE(p != ptrs.back());
+        REQUIRE(p != ptrs.front());
+        arena.deallocate(p, 24);
+        ptrs.pop_back();
+        Arena::flushCounts(counts);
+        REQUIRE(counts.mRewinds == 0);
+    }
+
+    for (auto p : ptrs)
+    {
+        arena.deallocate(p, 24);
+    }
+    arena.deallocate(large, Arena::MAX_ALLOCATION_SIZE + 1);
+    REQUIRE(arena.getLiveAllocations() == 0);
+
+    // Once everything is freed, the blocks are reused from the start
+    auto p = arena.allocate(24, 8);
+    REQUIRE(p == ptrs.front());
+    REQUIRE(arena.getBlockBytes() == Arena::FIRST_BLOCK_SIZE);
+    arena.deallocate(p, 24);
+    Arena::flushCounts(counts);
+    REQUIRE(counts.mRewinds == 1);
+    REQUIRE(counts.mBlockBytes == 0);
+}
+
+TEST_CASE("arena falls back to the heap when full", "[arena]")
+{
+    Arena arena;
+    Arena::Counts counts;
+    Arena::flushCounts(counts);
+
+    size_t const size = Arena::MAX_ALLOCATION_SIZE;
+    std::vector<void*> ptrs;
+    while (true)
+    {
+        ptrs.emplace_back(arena.allocate(size, 8));
+        Arena::flushCounts(counts);
+        if (counts.mHeapAllocations != 0)
+        {
+            break;
+        }
+    }
+    REQUIRE(arena.getBlockBytes() <= Arena::MAX_SIZE);
+    REQUIRE(arena.getBlockBytes() + Arena::MAX_BLOCK_SIZE > Arena::MAX_SIZE);
+
+    // Allocations from the blocks and from the heap are both freed correctly
+    auto heap = ptrs.back();
+    std::memset(heap, 1, size);
+    arena.deallocate(heap, size);
+    ptrs.pop_back();
+    arena.deallocate(ptrs.front(), size);
+    ptrs.erase(ptrs.begin());
+    for (auto p : ptrs)
+    {
+        arena.deallocate(p, size);
+    }
+    REQUIRE(arena.getLiveAllocations() == 0);
+
+    // Rewinding makes the blocks available again
+    auto p = arena.allocate(size, 8);
+    Arena::flushCounts(counts);
+    REQUIRE(counts.mHeapAllocations == 0);
+    REQUIRE(counts.mRewinds == 1);
+    arena.deallocate(p, size);
+}
+
+TEST_CASE("arena allocator in containers", "[arena]")
+{
+    auto arena = std::make_shared<Arena>();
+    using Alloc = ArenaAllocator<std::pair<int const, int>>;
+    {
+        std::unordered_map<int, int, std::hash<int>, std::equal_to<int>, Alloc>
+            map{Alloc(arena)};
+        for (int i = 0; i < 1000; ++i)
+        {
+            map.emplace(i, i * 2);
+        }
+        auto copy = map;
+        REQUIRE(copy.get_allocator() == map.get_allocator());
+        for (int i = 0; i < 1000; ++i)
+        {
+            REQUIRE(copy.at(i) == i * 2);
+        }
+        REQUIRE(arena->getLiveAllocations() > 2000);
+    }
+    REQUIRE(arena->getLiveAllocations() == 0);
+
+    // Shared pointers keep the arena alive
+    std::shared_ptr<int> p =
+        std::allocate_shared<int>(ArenaAllocator<int>(arena), 42);
+    std::weak_ptr<Arena> weak = arena;
+    arena.reset();
+    REQUIRE(!weak.expired());
+    REQUIRE(*p == 42);
+    p.reset();
+    REQUIRE(weak.expired());
+
+    // Without an arena, the allocator uses the heap
+    ArenaAllocator<int> heapAlloc;
+    auto q = heapAlloc.allocate(4);
+    heapAlloc.deallocate(q, 4);
+    REQUIRE(heapAlloc != ArenaAllocator<int>(std::make_shared<Arena>()));
+}
@@ -0,0 +1,255 @@
+// Copyright 2022 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include "ledger/LedgerHashUtils.h"
+#include "ledger/test/LedgerTestUtils.h"
+#include "lib/catch.hpp"
+#include "util/FlatMap.h"
+#include "util/Logging.h"
+#include "util/Math.h"
+#include "util/UnorderedMap.h"
+#include <algorithm>
+#include <chrono>
+#include <fmt/chrono.h>
+#include <map>
+#include <memory>
+#include <string>
+
+using namespace stellar;
+
+TEST_CASE("FlatMap matches std::unordered_map", "[flatmap]")
+{
+    FlatMap<uint32_t, uint32_t> flat;
+    std::unordered_map<uint32_t, uint32_t> expected;
+
+    auto check = [&]() {
+        REQUIRE(flat.size() == expected.size());
+        REQUIRE(flat.empty() == expected.empty());
+        std::map<uint32_t, uint32_t> iterated;
+        for (auto const& kv : flat)
+        {
+            REQUIRE(iterated.emplace(kv.first, kv.second).second);
+        }
+        REQUIRE(iterated ==
+                std::map<uint32_t, uint32_t>(expected.begin(), expected.end()));
+    };
+
+    // A small key range makes inserts of erased keys, and so tombstones,
+    // frequent.
+    for (uint32_t i = 0; i < 100000; ++i)
+    {
+        auto key = rand_uniform<uint32_t>(0, 2000);
+        switch (rand_uniform<int>(0, 3))
+        {
+        case 0:
+        {
+            auto res = flat.emplace(key, i);
+            auto expectedRes = expected.emplace(key, i);
+            REQUIRE(res.second == expectedRes.second);
+            REQUIRE(res.first->second == expectedRes.first->second);
+            break;
+        }
+        case 1:
+            flat[key] = i;
+            expected[key] = i;
+            break;
+        case 2:
+            REQUIRE(flat.erase(key) == expected.erase(key));
+            break;
+        case 3:
+        {
+            auto it = flat.find(key);
+            auto expectedIt = expected.find(key);
+            REQUIRE((it == flat.end()) == (expectedIt == expected.end()));
+            if (it != flat.end())
+            {
+                REQUIRE(it->second == expectedIt->second);
+                flat.erase(it);
+                expected.erase(expectedIt);
+            }
+            break;
+        }
+        }
+        if (i % 10000 == 0)
+        {
+            check();
+        }
+    }
+    check();
+
+    SECTION("copy and move")
+    {
+        auto copy = flat;
+        flat.clear();
+        REQUIRE(flat.empty());
+        REQUIRE(flat.begin() == flat.end());
+        flat = std::move(copy);
+        check();
+    }
+
+    SECTION("erase while iterating")
+    {
+        for (auto it = flat.begin(); it != flat.end();)
+        {
+            if (it->first % 2 == 0)
+            {
+                expected.erase(it->first);
+                it = flat.erase(it);
+            }
+            else
+            {
+                ++it;
+            }
+        }
+        check();
+    }
+
+    SECTION("reserve")
+    {
+        flat.clear();
+        expected.clear();
+        flat.reserve(1000);
+        auto capacity = flat.capacity();
+        for (uint32_t i = 0; i < 1000; ++i)
+        {
+            flat.emplace(i, i);
+            expected.emplace(i, i);
+        }
+        REQUIRE(flat.capacity() == capacity);
+        check();
+    }
+}
+
+TEST_CASE("FlatSet with non-trivial elements", "[flatmap]")
+{
+    FlatSet<std::string> set;
+    for (int i = 0; i < 1000; ++i)
+    {
+        REQUIRE(set.emplace(std::to_string(i)).second);
+    }
+    REQUIRE(!set.insert("10").second);
+    REQUIRE(set.size() == 1000);
+    REQUIRE(set.count("999") == 1);
+    REQUIRE(set.count("1000") == 0);
+    for (int i = 0; i < 1000; i += 3)
+    {
+        REQUIRE(set.erase(std::to_string(i)) == 1);
+    }
+    REQUIRE(set.size() == 666);
+
+    // Values are destroyed along with the map
+    auto p = std::make_shared<int>(1);
+    {
+        FlatMap<int, std::shared_ptr<int>> map;
+        for (int i = 0; i < 100; ++i)
+        {
+            map.emplace(i, p);
+        }
+        map.erase(0);
+        REQUIRE(p.use_count() == 100);
+    }
+    REQUIRE(p.use_count() == 1);
+}
+
+namespace
+{
+struct CountedKey
+{
+    int mValue;
+    int* mCopies;
+
+    CountedKey(int value, int* copies) : mValue(value), mCopies(copies)
+    {
+    }
+    CountedKey(CountedKey const& other)
+        : mValue(other.mValue), mCopies(other.mCopies)
+    {
+        ++*mCopies;
+    }
+    CountedKey(CountedKey&& other) noexcept = default;
+    bool
+    operator==(CountedKey const& other) const
+    {
+        return mValue == other.mValue;
+    }
+};
+
+struct CountedKeyHash
+{
+    size_t
+    operator()(CountedKey const& k) const
+    {
+        return std::hash<int>()(k.mValue);
+    }
+};
+}
+
+TEST_CASE("FlatMap moves keys when growing", "[flatmap]")
+{
+    int copies = 0;
+    FlatMap<CountedKey, std::string, CountedKeyHash> map;
+    for (int i = 0; i < 1000; ++i)
+    {
+        REQUIRE(map.emplace(CountedKey(i, &copies), std::to_string(i)).second);
+    }
+    REQUIRE(map.capacity() > 1000);
+    REQUIRE(copies == 0);
+    REQUIRE(map.at(CountedKey(999, &copies)) == "999");
+}
+
+TEST_CASE("FlatMap LedgerKey benchmark", "[bench][flatmap][!hide]")
+{
+    size_t const n = 100000;
+    std::vector<LedgerKey> keys;
+    for (auto const& le : LedgerTestUtils::generateValidLedgerEntries(n))
+    {
+        keys.emplace_back(LedgerEntryKey(le));
+    }
+    std::shuffle(keys.begin(), keys.end(), gRandomEngine);
+    std::vector<LedgerKey> missing(keys.begin() + n / 2, keys.end());
+    keys.resize(n / 2);
+
+    auto run = [&](auto& map, char const* name) {
+        using namespace std::chrono;
+        auto start = high_resolution_clock::now();
+        for (auto const& k : keys)
+        {
+            map.emplace(k, 1);
+        }
+        auto inserted = high_resolution_clock::now();
+        size_t found = 0;
+        for (int i = 0; i < 10; ++i)
+        {
+            for (auto const& k : keys)
+            {
+                found += map.find(k) != map.end() ? 1 : 0;
+            }
+            for (auto const& k : missing)
+            {
+                found += map.find(k) != map.end() ? 1 : 0;
+            }
+        }
+        auto lookedUp = high_resolution_clock::now();
+        int64_t sum = 0;
+        for (int i = 0; i < 10; ++i)
+        {
+            for (auto const& kv : map)
+            {
+                sum += kv.second;
+            }
+        }
+        auto iterated = high_resolution_clock::now();
+        REQUIRE(found == 10 * keys.size());
+        REQUIRE(sum == static_cast<int64_t>(10 * keys.size()));
+        LOG_INFO(DEFAULT_LOG, "{}: insert {} lookup {} iterate {} per element",
+                 name, (inserted - start) / keys.size(),
+                 (lookedUp - inserted) / (10 * (keys.size() + missing.size())),
+                 (iterated - lookedUp) / (10 * keys.size()));
+    };
+
+    UnorderedMap<LedgerKey, int> unordered;
+    run(unordered, "UnorderedMap");
+    FlatMap<LedgerKey, int> flat;
+    run(flat, "FlatMap");
+}
@@ -11,6 +11,7 @@
 #include <fmt/format.h>
 
 #include <chrono>
+#include <filesystem>
 
 using namespace stellar;
 
@@ -44,6 +45,84 @@ TEST_CASE("XDROutputFileStream fail modes", "[xdrstream]")
     }
 }
 
+TEST_CASE("XDRInputFileStream mmap mode", "[xdrstream]")
+{
+    VirtualClock clock;
+    Config const& cfg = getTestConfig(0);
+    fs::mkpath(cfg.BUCKET_DIR_PATH);
+    auto filename = fmt::format("{}/mmap-input.xdr", cfg.BUCKET_DIR_PATH);
+
+    auto ledgerEntries = LedgerTestUtils::generateValidLedgerEntries(1000);
+    auto bucketEntries =
+        Bucket::convertToBucketEntry(false, {}, ledgerEntries, {});
+    std::vector<size_t> offsets;
+    {
+        XDROutputFileStream out(clock.getIOContext(), /*doFsync=*/false);
+        out.open(filename);
+        SHA256 hasher;
+        size_t bytes = 0;
+        for (auto const& e : bucketEntries)
+        {
+            offsets.emplace_back(bytes);
+            out.writeOne(e, &hasher, &bytes);
+        }
+        out.close();
+    }
+
+    XDRInputFileStream streamed;
+    XDRInputFileStream mapped;
+    streamed.open(filename);
+    mapped.open(filename, /*useMmap=*/true);
+    REQUIRE(mapped.size() == streamed.size());
+
+    SECTION("sequential reads match")
+    {
+        BucketEntry a, b;
+        size_t n = 0;
+        while (streamed.readOne(a))
+        {
+            REQUIRE(mapped.pos() == offsets.at(n));
+            REQUIRE(mapped.readOne(b));
+            REQUIRE(a == b);
+            REQUIRE(a == bucketEntries.at(n));
+            ++n;
+        }
+        REQUIRE(n == bucketEntries.size());
+        REQUIRE(!mapped.readOne(b));
+        REQUIRE(!mapped);
+    }
+    SECTION("seeks match")
+    {
+        BucketEntry a, b;
+        for (size_t i : {bucketEntries.size() - 1, bucketEntries.size() / 2,
+                         size_t(1), size_t(0)})
+        {
+            streamed.seek(offsets.at(i));
+            mapped.seek(offsets.at(i));
+            REQUIRE(streamed.readOne(a));
+            REQUIRE(mapped.readOne(b));
+            REQUIRE(a == bucketEntries.at(i));
+            REQUIRE(b == bucketEntries.at(i));
+        }
+    }
+    SECTION("truncated file throws")
+    {
+        // Never truncate a file that is still mapped.
+        streamed.close();
+        mapped.close();
+        std::filesystem::resize_file(filename, offsets.at(1) + 6);
+        XDRInputFileStream truncated;
+        truncated.open(filename, /*useMmap=*/true);
+        BucketEntry a;
+        REQUIRE(truncated.readOne(a));
+        REQUIRE_THROWS_AS(truncated.readOne(a), xdr::xdr_runtime_error);
+        truncated.close();
+    }
+    streamed.close();
+    mapped.close();
+    std::remove(filename.c_str());
+}
+
 TEST_CASE("XDROutputFileStream fsync bench", "[!hide][xdrstream][bench]")
 {
     VirtualClock clock;
@@ -11,8 +11,9 @@
 namespace stellar
 {
 
-BatchWork::BatchWork(Application& app, std::string name)
-    : Work(app, name, BasicWork::RETRY_NEVER)
+BatchWork::BatchWork(Application& app, std::string name,
+                     size_t maxConcurrency)
+    : Work(app, name, BasicWork::RETRY_NEVER), mMaxConcurrency(maxConcurrency)
 {
 }
 
@@ -70,7 +71,9 @@ BatchWork::addMoreWorkIfNeeded()
         throw std::runtime_error(getName() + " is being aborted!");
     }
 
-    size_t nChildren = mApp.getConfig().MAX_CONCURRENT_SUBPROCESSES;
+    size_t nChildren = mMaxConcurrency != 0
+                           ? mMaxConcurrency
+                           : mApp.getConfig().MAX_CONCURRENT_SUBPROCESSES;
     while (mBatch.size() < nChildren && hasNext())
     {
         auto w = yieldMoreWork();
@@ -20,10 +20,13 @@ class BatchWork : public Work
 {
     // Keep track of children here
     std::map<std::string, std::shared_ptr<BasicWork>> mBatch;
+    size_t const mMaxConcurrency;
     void addMoreWorkIfNeeded();
 
   public:
-    BatchWork(Application& app, std::string name);
+    // At most `maxConcurrency` children run at once; 0 means
+    // MAX_CONCURRENT_SUBPROCESSES.
+    BatchWork(Application& app, std::string name, size_t maxConcurrency = 0);
     ~BatchWork() = default;
 
     size_t
@@ -42,11 +42,14 @@ struct Hello
     uint256 nonce;
 };
 
+// During the handshake, a peer setting this flag in its AUTH asks the other
+// side to flood transactions to it in pull mode (FLOOD_ADVERT/FLOOD_DEMAND).
+const AUTH_MSG_FLAG_PULL_MODE_REQUESTED = 100;
+
 struct Auth
 {
-    // Empty message, just to confirm
-    // establishment of MAC keys.
-    int unused;
+    // Confirms establishment of MAC keys; carries AUTH_MSG_FLAG_* values.
+    int flags;
 };
 
 enum IPAddrType
@@ -93,7 +96,13 @@ enum MessageType
     HELLO = 13,
 
     SURVEY_REQUEST = 14,
-    SURVEY_RESPONSE = 15
+    SURVEY_RESPONSE = 15,
+
+    SEND_MORE = 16,
+    // 17 is GENERALIZED_TX_SET, not supported by this version
+
+    FLOOD_ADVERT = 18,
+    FLOOD_DEMAND = 19
 };
 
 struct DontHave
@@ -176,6 +185,32 @@ case SURVEY_TOPOLOGY:
     TopologyResponseBody topologyResponseBody;
 };
 
+// Grants the receiver capacity to send `numMessages` more flooded messages
+// (overlay version 20 and later).
+struct SendMore
+{
+    uint32 numMessages;
+};
+
+const TX_ADVERT_VECTOR_MAX_SIZE = 1000;
+typedef Hash TxAdvertVector<TX_ADVERT_VECTOR_MAX_SIZE>;
+
+// Announces the hashes of transactions the sender has available, without
+// sending their bodies (to peers that set AUTH_MSG_FLAG_PULL_MODE_REQUESTED).
+struct FloodAdvert
+{
+    TxAdvertVector txHashes;
+};
+
+const TX_DEMAND_VECTOR_MAX_SIZE = 1000;
+typedef Hash TxDemandVector<TX_DEMAND_VECTOR_MAX_SIZE>;
+
+// Asks the receiver for the bodies of previously advertised transactions.
+struct FloodDemand
+{
+    TxDemandVector txHashes;
+};
+
 union StellarMessage switch (MessageType type)
 {
 case ERROR_MSG:
@@ -214,6 +249,16 @@ case SCP_MESSAGE:
     SCPEnvelope envelope;
 case GET_SCP_STATE:
     uint32 getSCPLedgerSeq; // ledger seq requested ; if 0, requests the latest
+
+// flow control
+case SEND_MORE:
+    SendMore sendMoreMessage;
+
+// pull-mode transaction flooding
+case FLOOD_ADVERT:
+    FloodAdvert floodAdvert;
+case FLOOD_DEMAND:
+    FloodDemand floodDemand;
 };
 
 union AuthenticatedMessage switch (uint32 v)